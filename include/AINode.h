@@ -6,6 +6,7 @@
 #include <ctime>
 #include <iomanip>
 #include <list>
+#include <memory>
 #include "edge_interface.h"
 #include "json.h"
 #include "opencv2/core/core.hpp"
@@ -15,8 +16,12 @@
 
 // #define RTSP_ENCODE_ENABLE //推流
 #define ALGO_INFER_ENABLE // 打开算法
+// #define ROI_CROP_INFER_ENABLE // ROI只占画面一部分时，只对ROI外接矩形区域推理（ROI外的目标不再被检出，默认关闭）
+// #define SLICE_INFER_ENABLE // 大分辨率画面切片推理，提高远处小目标的检出率
 // #define SHOW_LOCAL_ENABLE // 打开摄像头
-#define PIPELINEINFO_LIST_THRESH 100
+// #define PREVIEW_SERVER_ENABLE // HTTP MJPEG预览，有客户端连接时才编码；监听0.0.0.0且没有认证，只在调试时打开（默认关闭）
+#define PIPELINEINFO_LIST_THRESH 100 // 报警队列上限，超过时丢弃最旧的报警
+#define PIPELINEINFO_BATCH_MAX 16 // ReadNode每次最多取出的报警个数
 
 // ## 是预处理器的连接符   \是行继续符号  # 操作符会把宏的参数转换为一个字符串常量
 #define TIME_START(id) auto time_start_##id = std::chrono::system_clock::now();
@@ -77,8 +82,15 @@ struct resultInfo
 };
 
 // 存储管道信息（每个管道可以理解为一个摄像头）,每一帧
+// 只能移动不能拷贝：从rk3588Node到AppMqttNode的每一步都转移所有权，图像和配置是共享的只读对象，转移时不拷贝
 struct pipelineInfo  // 这里包含了检测结果信息，在rk3588_node.cpp中并没有进行赋值
 {
+    pipelineInfo() = default;
+    pipelineInfo(const pipelineInfo &) = delete;
+    pipelineInfo &operator=(const pipelineInfo &) = delete;
+    pipelineInfo(pipelineInfo &&) = default;
+    pipelineInfo &operator=(pipelineInfo &&) = default;
+
     int camera_index {0};
     std::string camera_id;  // 摄像头id区分于摄像头的索引序号
     std::string camera_name;
@@ -86,14 +98,16 @@ struct pipelineInfo  // 这里包含了检测结果信息，在rk3588_node.cpp
     std::string seawayos_namespace;
     
     int alarm_type {0};
-    std::string alarm_date;
+    int64_t alarm_time_ms {0}; // 报警时间，毫秒时间戳，发布时格式化为YYYY-MM-DDTHH:MM:SS.mmm+HH:MM
 
     alarmInfo alarm_information;
     resultInfo result_information;
 
-    cv::Mat source_image;
-    settingInfo setting_information;  
-    bool ready_for_mqtt = false;
+    std::shared_ptr<const cv::Mat> source_image; // 报警帧原图，创建后不再修改
+    std::shared_ptr<const settingInfo> setting_information; // 该路摄像头的配置，同一路摄像头的所有报警共享一份
+    bool ready_for_mqtt = false; // AppRoiNode已完成ROI筛选，AppEndNode可以发送
+    uint64_t trace_id = 0;    // 报警帧的追踪id，0表示未采样
+    int64_t trace_ts_us = 0;  // 进入当前队列的时间
 };
 
 
@@ -108,6 +122,7 @@ struct mqttMessageParam
 struct sendInfoParam 
 {
     std::list<pipelineInfo>  pipelineinfo_list;
+    std::size_t dropped_count {0}; // 队列超过上限后丢弃的报警总数
 };
 
 // 功能：用于存储 EdgeInterface 类型的对象
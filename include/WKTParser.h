@@ -2,6 +2,8 @@
 #define WKTPARSER_H_
 
 #include <vector>
+#include <string>
+#include <cstdint>
 #include <opencv2/opencv.hpp>
 
 typedef std::vector<cv::Point> VectorPoint;
@@ -12,6 +14,37 @@ struct point {
     double x, y;
 };
 
+/**
+ * 多边形的一条边，起点(x0, y0)，终点(x1, y1)
+ * a*x + b*y + c 等于边向量与(点 - 起点)的叉积，用整数计算，结果精确：
+ * 等于0表示点在边所在直线上，正负号表示点在边的哪一侧
+ */
+struct GeoEdge {
+    int x0, y0, x1, y1;
+    int64_t a, b, c;
+};
+
+/**
+ * 预处理后的多边形环：边表、外接矩形和凸性在解析时计算一次，判断时不再重复计算
+ */
+struct GeoRing {
+    VectorPoint points;          // 反归一化后的顶点
+    std::vector<GeoEdge> edges;  // 边表
+    cv::Rect bbox;               // 外接矩形，与polygon2Rect一致，右边界和下边界为bbox.x + bbox.width, bbox.y + bbox.height
+    bool convex = false;         // 是否为凸多边形，凸多边形使用半平面判断
+    int orientation = 0;         // 顶点方向，内部的点对每条边的叉积与orientation同号
+};
+
+/**
+ * 一个区域：一个外环和若干个内环，内环（洞）是外环中的排除区域
+ */
+struct GeoZone {
+    GeoRing outer;
+    std::vector<GeoRing> holes;
+};
+
+typedef std::vector<GeoZone> VectorZone;
+
 /**
  * WKTParser类用于解析使用WKT格式表示的字符串，并将这些字符串转换成点、线、多边形等易于使用的类对象，其功能包括：
  * 1. 用于解析WKT格式的点,线，框(多边形)
@@ -57,6 +90,16 @@ public:
      */
     bool parsePolygon(const std::string &src, VectorPoint *pvp = nullptr);
 
+    /**
+     * 解析WKT格式表示的多边形或多多边形字符串，每个多边形的第一个环为外环，其余的环为内环（排除区域）
+     *
+     * @param src 使用WKT格式表示的字符串，例如："POLYGON((0 0,1 0,1 1,0 1,0 0),(0.4 0.4,0.6 0.4,0.6 0.6,0.4 0.4))"
+     *            或 "MULTIPOLYGON(((0 0,0.5 0,0.5 0.5,0 0)),((0.5 0.5,1 0.5,1 1,0.5 0.5)))"
+     * @param zones 当不为NULL时，追加解析后的区域，由外部分配空间
+     * @return 成功返回true，否则返回false
+     */
+    bool parseZones(const std::string &src, VectorZone *zones = nullptr);
+
     /**
      * 判断点是否在m_polygons多表示的多个多边形中的某个多边形内部
      *
@@ -94,13 +137,20 @@ public:
      */
     const VectorPolygon &getPolygons() const { return m_polygons; }
 
+    /**
+     * 获取WKTParser::parseZones已经正确解析的区域
+     *
+     * @return 所有解析正确的区域
+     */
+    const VectorZone &getZones() const { return m_zones; }
+
     /**
      * 判断所解析的点、线、多边形是否有效是否有效
      *
      * @return 如果m_points、m_lines、m_polygons都不为空，则返回true，否则返回false
      */
     bool empty() const {
-        return (m_size.empty() || (m_points.empty() && m_lines.empty() && m_polygons.empty()));
+        return (m_size.empty() || (m_points.empty() && m_lines.empty() && m_polygons.empty() && m_zones.empty()));
     }
 
 public:
@@ -131,12 +181,52 @@ public:
      */
     static bool inPolygon(const VectorPoint &polygon, const cv::Rect &rect);
 
+    /**
+     * 由顶点构造多边形环：计算边表、外接矩形和凸性，首尾点不相等时自动闭合
+     *
+     * @param polygon 多边形顶点
+     * @param ring 返回的多边形环
+     * @return 顶点数量少于3时返回false，否则返回true
+     */
+    static bool buildRing(const VectorPoint &polygon, GeoRing &ring);
+
+    /**
+     * 判断点point是否在多边形环ring内部（包括边界）
+     *
+     * @param ring 多边形环
+     * @param point 点
+     * @param on_edge 当不为NULL时，返回点是否在边界上
+     * @return 如果point在ring内部或边界上，返回true，否则返回false
+     */
+    static bool inRing(const GeoRing &ring, const cv::Point &point, bool *on_edge = nullptr);
+
+    /**
+     * 判断点point是否在区域zone内：在外环内部或边界上，且不在任何内环的内部（内环的边界属于区域）
+     */
+    static bool inZone(const GeoZone &zone, const cv::Point &point);
+
+    /**
+     * 判断矩形框rect是否在区域zone内：四个角点都在区域内，且没有内环的边经过矩形内部
+     */
+    static bool inZone(const GeoZone &zone, const cv::Rect &rect);
+
+    /**
+     * 判断矩形框rect是否在zones中的某个区域内
+     */
+    static bool inZones(const VectorZone &zones, const cv::Rect &rect);
+
+    /**
+     * 批量判断：results[i]表示rects[i]是否在zones中的某个区域内，results的空间由函数分配
+     */
+    static void inZones(const VectorZone &zones, const std::vector<cv::Rect> &rects, std::vector<uchar> &results);
+
 private:
     cv::Size m_size;    // 通常是图像的宽高，用于反归一化WKT格式的坐标值
 
     VectorPoint m_points;  // 存储正确解析的点
     VectorLine m_lines;    // 存储正确解析的线
     VectorPolygon m_polygons;  // 存储正确解析的多边形
+    VectorZone m_zones;        // 存储正确解析的区域
 
     bool read_wkt_point(const std::string& wkt, point& pt);
 };
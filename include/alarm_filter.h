@@ -0,0 +1,55 @@
+#ifndef _ALARM_FILTER_H_
+#define _ALARM_FILTER_H_
+
+#include <cstdint>
+#include <unordered_map>
+
+// 报警状态在目标多久未出现后被清理（毫秒）
+#define ALARM_STATE_EXPIRE_MS (60 * 1000)
+// 每路摄像头最多保存的报警状态个数，超过时先清理长时间未出现的目标，仍然超过时删除最久未出现的目标
+#define ALARM_STATE_MAX_COUNT 1024
+// 未首次上报的目标（AlarmSmooth为false）在ROI内中断出现超过该时间（毫秒）后，持续出现的时间重新计算
+#define ALARM_PERSIST_GAP_MS 1000
+
+/*
+每路摄像头一个报警抑制状态机，按 (track_id, label) 记录每个目标的报警状态：
+1. 新目标：AlarmSmooth（首次上报）为true时立即报警，否则目标需要持续出现 AlarmInterval 秒后才报警（中断超过 ALARM_PERSIST_GAP_MS 重新计时）
+2. 已报警的目标：距离上次报警超过 AlarmInterval 秒才再次报警
+3. AlarmInterval <= 0 时不做抑制，每帧都报警
+该判断在图像克隆、JPEG编码、base64之前完成，被抑制的目标不产生任何编码和上报开销；调用者只对ROI内的目标调用check
+*/
+class AlarmFilter
+{
+    public:
+        AlarmFilter() : alarm_interval_ms(0), alarm_smooth(true) {}
+
+        // 功能：设置报警参数，alarm_interval 单位为秒
+        void set_config(int alarm_interval, bool alarm_smooth);
+
+        // 功能：判断目标本次是否需要报警，now_ms为当前时间戳（毫秒）
+        bool check(int track_id, const char *label, int64_t now_ms);
+
+        // 功能：清理长时间未出现的目标
+        void expire(int64_t now_ms);
+
+        std::size_t size() const { return m_states.size(); }
+
+    private:
+        // 功能：删除最久未出现的目标
+        void evict_oldest();
+
+        struct AlarmState
+        {
+            int64_t first_seen_ms;
+            int64_t last_seen_ms;
+            int64_t last_alarm_ms;
+            bool alarmed;
+        };
+
+        int64_t alarm_interval_ms;
+        bool alarm_smooth;
+        int64_t last_expire_ms = 0;
+        std::unordered_map<uint64_t, AlarmState> m_states;
+};
+
+#endif // _ALARM_FILTER_H_
@@ -0,0 +1,141 @@
+#ifndef _ALARM_JOURNAL_H_
+#define _ALARM_JOURNAL_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+// 报警日志目录
+#define JOURNAL_DIR "./alarm_journal"
+// 每个段文件的大小和所有段文件的总大小上限（字节），超过上限时删除最早的段，其中未确认的报警丢失
+#define JOURNAL_SEGMENT_BYTES (8 * 1024 * 1024)
+#define JOURNAL_MAX_BYTES (64 * 1024 * 1024)
+// 刷盘间隔（毫秒），由后台线程msync；为0时每次写入后同步刷盘（写入会阻塞到落盘）
+#define JOURNAL_FSYNC_INTERVAL_MS 200
+
+// 报警消息的发送通道
+enum JournalSink
+{
+    JOURNAL_SINK_MQTT = 0,
+    JOURNAL_SINK_KAFKA = 1,
+    JOURNAL_SINK_COUNT = 2
+};
+
+// 功能：一条报警记录。key为kafka的分区键（摄像头id），image_ref为报警图片在minio中的对象名
+struct JournalRecord
+{
+    uint64_t seq = 0;
+    int64_t timestamp_ms = 0;
+    int camera_index = 0;
+    JournalSink sink = JOURNAL_SINK_MQTT;
+    std::string key;
+    std::string image_ref;
+    std::string payload;
+};
+
+struct JournalStats
+{
+    uint64_t appended = 0;  // 写入的报警记录数
+    uint64_t acked = 0;     // 已确认发送成功的记录数
+    uint64_t failed = 0;    // 发送失败等待重放的次数
+    uint64_t replayed = 0;  // 重放的记录数
+    uint64_t dropped = 0;   // 超过磁盘上限时丢失的未确认记录数
+    size_t unacked = 0;
+    uint64_t rotations = 0;      // 段轮转次数
+    uint64_t rotations_sync = 0; // 其中备用段未就绪、在写入线程中同步创建段的次数
+    size_t segments = 0;
+    uint64_t disk_bytes = 0;
+};
+
+/*
+报警日志：只追加、按段轮转、内存映射的文件，mqtt或kafka不可用以及进程崩溃重启时报警不丢失
+1. 每条报警在发送前写入日志，发送成功后追加一条确认记录；记录头包含CRC32，最后写magic，
+   崩溃时写了一半的记录在恢复时被丢弃
+2. 写入只是拷贝到映射的内存中，msync由后台线程按 JOURNAL_FSYNC_INTERVAL_MS 执行，不阻塞发送流程；
+   下一个段也由后台线程预先创建（预分配磁盘空间、映射、目录项落盘），轮转时只切换映射，
+   删除段文件同样交给后台线程，写入和确认路径上没有文件系统调用
+3. 最早的段中所有报警都已确认后删除该段；总大小超过 JOURNAL_MAX_BYTES 时强制删除最早的段
+4. 启动时扫描所有段，未确认的报警全部重放；运行中发送失败的报警在该通道再次发送成功（重新连上）后重放
+*/
+class AlarmJournal
+{
+    public:
+        explicit AlarmJournal(const std::string &dir = JOURNAL_DIR,
+                              size_t segment_bytes = JOURNAL_SEGMENT_BYTES,
+                              uint64_t max_bytes = JOURNAL_MAX_BYTES);
+        ~AlarmJournal();
+
+        bool valid() const { return m_current != nullptr; }
+
+        // 功能：写入一条报警记录，返回序号，失败时返回0
+        uint64_t append(JournalSink sink, int camera_index, const std::string &key,
+                        const std::string &image_ref, const std::string &payload);
+
+        // 功能：报告一条记录的发送结果，可以在任意线程调用
+        void complete(uint64_t seq, bool delivered);
+
+        // 功能：取出需要重放的记录，重放后仍用原序号调用complete
+        std::vector<JournalRecord> take_replay();
+
+        JournalStats stats() const;
+
+    private:
+        struct Mapping;
+        struct Segment
+        {
+            uint64_t id;
+            std::string path;
+            size_t unacked = 0;
+        };
+        struct Location
+        {
+            uint64_t segment;
+            size_t offset;
+            JournalSink sink;
+        };
+
+        // 功能：写入一条记录（报警或确认），需持有m_mutex
+        bool write_record(uint8_t type, JournalSink sink, uint64_t seq, int camera_index, const std::string &key,
+                          const std::string &image_ref, const std::string &payload);
+        // 功能：切换到备用段，备用段未就绪时同步创建，需持有m_mutex
+        bool rotate_segment();
+        // 功能：创建并映射segment.id对应的段文件，只读取构造后不变的成员，不需持有m_mutex
+        std::shared_ptr<Mapping> create_segment(Segment &segment) const;
+        void recover();
+        // 功能：删除已全部确认的最早的段，以及超过磁盘上限的段，需持有m_mutex
+        void collect();
+        bool read_record(const Location &location, JournalRecord &record) const;
+        void flush_loop();
+
+        std::string m_dir;
+        size_t m_segment_bytes;
+        uint64_t m_max_bytes;
+
+        std::deque<Segment> m_segments;
+        std::shared_ptr<Mapping> m_current;
+        std::vector<std::shared_ptr<Mapping>> m_retired; // 已轮转、等待后台线程刷盘后释放的映射
+        std::shared_ptr<Mapping> m_spare;                // 后台线程预先创建的下一个段
+        Segment m_spare_segment;
+        uint64_t m_next_segment_id = 1;
+        std::vector<std::string> m_unlink;               // 等待后台线程删除的段文件
+        size_t m_write_offset = 0;
+        uint64_t m_next_seq = 1;
+        std::map<uint64_t, Location> m_unacked;
+        std::set<uint64_t> m_failed[JOURNAL_SINK_COUNT];
+        bool m_replay_ready[JOURNAL_SINK_COUNT] = {false, false};
+        JournalStats m_stats;
+
+        bool m_stop = false;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::thread m_flush_thread;
+};
+
+#endif // _ALARM_JOURNAL_H_
@@ -0,0 +1,69 @@
+#ifndef _ALARM_JSON_WRITER_H_
+#define _ALARM_JSON_WRITER_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "AINode.h"
+
+// 功能：报警消息中NVR录像相关的字段，只有录像启动成功时enable为true并输出这些字段
+struct AlarmNvrInfo
+{
+    bool enable = false;
+    std::string ip;
+    int port = 0;
+    std::string user;
+    std::string password;
+    int channel = 0;
+    int64_t timestamp = 0;        // 毫秒时间戳
+    std::string video_url;
+    int64_t stop_alarm_time_ms = 0; // 录像结束时间，输出为stop_alarm_date
+};
+
+// nvr录像结果晚于报警返回时补发的更新消息的type字段
+#define ALARM_NVR_UPDATE_TYPE "nvr_update"
+
+// 功能：写入带引号的JSON字符串，转义规则与Json2String(emitUTF8=true)一致
+void json_append_string(std::string &out, const std::string &str);
+
+/*
+报警消息的流式JSON序列化，替代先组装Json::Value再用StreamWriterBuilder转字符串的方式：
+1. 按报警消息的固定格式直接写入内部缓冲区，缓冲区在消息之间复用，容量只增不减
+2. 报警原图和缩略图是JPEG数据，直接base64编码到缓冲区中，不再生成中间的base64字符串和Json::Value的拷贝
+3. 输出与改造前AppMqttNode::Json2String(emitUTF8=true)逐字节一致：tab缩进，键按字节序排列，
+   嵌套的对象和数组另起一行，数组总是多行，空的目标列表输出null，浮点数按%.17g输出
+*/
+class AlarmJsonWriter
+{
+    public:
+        // 功能：序列化一条报警消息，camera_id为已转换为整数的摄像头id；
+        // image_ref不为空时输出alarm_image_path（报警原图的minio对象名），用于不带图片、写入报警日志的消息
+        // 返回：内部缓冲区的引用，下一次write前有效
+        const std::string &write(const pipelineInfo &info, int64_t camera_id,
+                                 const std::vector<uchar> &raw_pic, const std::vector<uchar> &thumbnail_pic,
+                                 const AlarmNvrInfo &nvr, const std::string &image_ref = std::string());
+
+        // 功能：序列化nvr录像结果的更新消息，只在报警发布后录像结果才返回时发送。
+        // 消息的type为 ALARM_NVR_UPDATE_TYPE，用camera_id和alarm_date（与原报警相同）以及alarm_id（"<camera_id>_<报警毫秒时间戳>"）
+        // 对应原报警，只带nvr字段，不带图片和目标；nvr.enable为false时不应调用
+        // 返回：内部缓冲区的引用，下一次write前有效
+        const std::string &write_nvr_update(const pipelineInfo &info, int64_t camera_id, const AlarmNvrInfo &nvr);
+
+        // 功能：对浮点数位数进行限制，precision为有效数字位数
+        static std::string format_float(float val, int precision);
+
+    private:
+        void key(const char *name);
+        void key(const std::string &name);
+        void begin(char bracket);
+        void end(char bracket);
+        void write_objects(const char *name, const std::list<objectInfo> &objects, bool score_as_string);
+        void write_settings(const settingInfo &settings);
+        void write_nvr_information(const AlarmNvrInfo &nvr);
+
+        std::string m_buffer;
+        int m_depth = 0;
+        bool m_first = true; // 当前对象或数组中还没有写入成员
+};
+
+#endif // _ALARM_JSON_WRITER_H_
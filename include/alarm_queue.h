@@ -0,0 +1,46 @@
+#ifndef _ALARM_QUEUE_H_
+#define _ALARM_QUEUE_H_
+
+#include <list>
+#include <map>
+#include <vector>
+#include "AINode.h"
+#include "roi_mask.h"
+
+/*
+CGraph报警路径上各节点对报警的操作，节点本身只负责收发消息和加锁：
+1. ReadNode：add 把收到的报警移入本批，append 把整批接到sendInfoParam队列尾部
+2. AppRoiNode：AlarmRoiFilter::filter 在队列中原地筛选ROI外的目标
+3. AppEndNode：take_ready 把已筛选的报警移出队列，to_message 移入发给AppMqttNode的消息
+每一步只转移所有权，原图和配置通过shared_ptr共享，不拷贝；test/test_alarm_queue.cpp 统计内存分配验证
+*/
+class AlarmQueue
+{
+    public:
+        // 功能：收到的报警移入本批
+        static void add(std::list<pipelineInfo> &batch, pipelineInfo &&info);
+
+        // 功能：整批接到队列尾部，超过max_size时丢弃最旧的报警，返回丢弃的个数
+        static size_t append(std::list<pipelineInfo> &queue, std::list<pipelineInfo> &batch, size_t max_size);
+
+        // 功能：已完成ROI筛选的报警从队列移到ready尾部
+        static void take_ready(std::list<pipelineInfo> &queue, std::list<pipelineInfo> &ready);
+
+        // 功能：报警移入发给AppMqttNode的消息
+        static void to_message(pipelineInfo &info, mqttMessageParam &message);
+};
+
+// 功能：AppRoiNode的ROI筛选，每路摄像头的ROI只在配置变化时重新编译
+class AlarmRoiFilter
+{
+    public:
+        // 功能：筛选队列中还没筛选过的报警，ROI外的目标从alarm_object_list中删除，筛选后标记ready_for_mqtt
+        void filter(std::list<pipelineInfo> &queue);
+
+    private:
+        std::map<int, RoiMask> m_roi_masks; // key为camera_index
+        std::vector<cv::Rect> m_object_rects; // 复用的目标框和判断结果
+        std::vector<uchar> m_in_roi;
+};
+
+#endif // _ALARM_QUEUE_H_
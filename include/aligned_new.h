@@ -0,0 +1,40 @@
+#ifndef _ALIGNED_NEW_H_
+#define _ALIGNED_NEW_H_
+
+#include <cstdlib>
+#include <new>
+
+/*
+按缓存行对齐（alignas(64)）的类型用new创建时继承它：
+C++17之前的operator new只保证alignof(std::max_align_t)（16字节），alignas(64)的成员可能跨缓存行，
+g++在-std=c++14下给出-Waligned-new警告。这里按alignof(T)用posix_memalign分配，C++14和C++17下行为相同
+用法：class Counter : public AlignedNew<Counter> { ... };
+*/
+template <typename T>
+struct AlignedNew
+{
+    static void *operator new(std::size_t size)
+    {
+        void *pointer = nullptr;
+        if(posix_memalign(&pointer, alignof(T), size) != 0)
+            throw std::bad_alloc();
+        return pointer;
+    }
+
+    static void *operator new[](std::size_t size)
+    {
+        return operator new(size);
+    }
+
+    static void operator delete(void *pointer) noexcept
+    {
+        free(pointer);
+    }
+
+    static void operator delete[](void *pointer) noexcept
+    {
+        free(pointer);
+    }
+};
+
+#endif // _ALIGNED_NEW_H_
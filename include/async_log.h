@@ -0,0 +1,140 @@
+#ifndef _ASYNC_LOG_H_
+#define _ASYNC_LOG_H_
+
+#include <atomic>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include "aligned_new.h"
+
+#define ASYNC_LOG_DEBUG 0
+#define ASYNC_LOG_INFO 1
+#define ASYNC_LOG_WARNING 2
+#define ASYNC_LOG_ERROR 3
+
+// 低于该级别的日志在编译时去掉，条件是常量，流表达式不会执行
+#ifndef ASYNC_LOG_MIN_SEVERITY
+#define ASYNC_LOG_MIN_SEVERITY ASYNC_LOG_INFO
+#endif
+// 队列的槽数（2的幂），队列满时丢弃新日志并计数
+#define ASYNC_LOG_QUEUE_SIZE 1024
+// 单条日志的最大长度，超过的部分截断
+#define ASYNC_LOG_LINE_MAX 256
+// 队列为空时输出线程的休眠时间
+#define ASYNC_LOG_FLUSH_INTERVAL_MS 10
+
+/*
+异步日志，替代帧处理路径上同步的std::cout：
+1. 调用线程把日志格式化到线程自己的缓冲区，再写入无锁的多生产者单消费者环形队列，不等待stdout
+2. 后台线程批量取出，加上时间和级别后一次写入stdout；队列满时丢弃并计数（dropped()），由main注册为 seaway_dropped_total{reason="log queue full"}，
+   日志本身不依赖metrics
+3. ALOG_EVERY_MS 按调用位置限速，间隔内的调用只做一次原子读并计数，不格式化，下一条输出时附带被抑制的条数
+4. 级别低于 ASYNC_LOG_MIN_SEVERITY 的调用在编译时去掉
+用法：ALOG(INFO) << "camera " << index; ALOG_EVERY_MS(WARNING, 1000) << "infer frame error";
+宏展开为一个表达式（!条件 ? (void)0 : AsyncLogVoidify() & 流），没有悬空的else，可以放在不带花括号的if-else中；流表达式中不能再调用ALOG
+*/
+class AsyncLogger : public AlignedNew<AsyncLogger>
+{
+    public:
+        static AsyncLogger &instance();
+
+        // 功能：写入一条日志，队列满时返回false
+        bool push(int severity, const char *text, size_t length);
+        // 功能：把队列中已有的日志写到stdout，进程退出时自动调用
+        void flush();
+
+        uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    private:
+        AsyncLogger();
+        void output_thread();
+        size_t drain();
+
+        struct Slot
+        {
+            std::atomic<size_t> sequence;
+            int severity;
+            int64_t time_ms;
+            size_t length;
+            char text[ASYNC_LOG_LINE_MAX];
+        };
+
+        std::unique_ptr<Slot[]> m_slots;
+        alignas(64) std::atomic<size_t> m_tail{0}; // 生产者
+        alignas(64) size_t m_head = 0;             // 只由持有m_drain_mutex的线程访问
+        std::mutex m_drain_mutex; // 输出线程和flush之间互斥，生产者不使用
+        std::atomic<uint64_t> m_dropped{0};
+};
+
+// 功能：一个调用位置的限速状态
+class AsyncLogSite
+{
+    public:
+        // 功能：允许输出时返回true，被抑制的条数保存到本线程，由紧接着的suppressed()取出
+        bool allow(int interval_ms);
+        // 功能：本线程最近一次allow返回true时被抑制的条数
+        static uint64_t suppressed() { return t_suppressed; }
+
+    private:
+        std::atomic<int64_t> m_next_ms{0};
+        std::atomic<uint64_t> m_suppressed{0};
+        static thread_local uint64_t t_suppressed;
+};
+
+// 功能：一条日志，析构时写入队列
+class AsyncLogLine
+{
+    public:
+        AsyncLogLine(int severity, uint64_t suppressed);
+        ~AsyncLogLine();
+        std::ostream &stream() { return m_stream; }
+
+    private:
+        // 写入固定长度缓冲区的streambuf，写满后丢弃后面的字符，不分配内存
+        class LineBuffer : public std::streambuf
+        {
+            public:
+                void reset() { setp(m_text, m_text + ASYNC_LOG_LINE_MAX); }
+                const char *data() const { return pbase(); }
+                size_t size() const { return static_cast<size_t>(pptr() - pbase()); }
+
+            protected:
+                int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+
+            private:
+                char m_text[ASYNC_LOG_LINE_MAX];
+        };
+        struct ThreadStream
+        {
+            ThreadStream() : stream(&buffer) {}
+            LineBuffer buffer;
+            std::ostream stream;
+        };
+        static ThreadStream &thread_stream();
+
+        int m_severity;
+        uint64_t m_suppressed;
+        std::ostream &m_stream;
+};
+
+// 每个调用位置一个限速状态，lambda中的静态变量按位置区分
+#define ASYNC_LOG_SITE() ([]() -> AsyncLogSite & { static AsyncLogSite async_log_site; return async_log_site; }())
+
+// 功能：把流表达式转为void，使条件表达式的两个分支类型相同；&的优先级低于<<、高于?:
+struct AsyncLogVoidify
+{
+    void operator&(std::ostream &) {}
+};
+
+#define ALOG_EVERY_MS(severity, interval_ms) \
+    !(ASYNC_LOG_##severity >= ASYNC_LOG_MIN_SEVERITY && ASYNC_LOG_SITE().allow(interval_ms)) ? (void)0 : \
+        AsyncLogVoidify() & AsyncLogLine(ASYNC_LOG_##severity, AsyncLogSite::suppressed()).stream()
+
+#define ALOG(severity) \
+    !(ASYNC_LOG_##severity >= ASYNC_LOG_MIN_SEVERITY) ? (void)0 : \
+        AsyncLogVoidify() & AsyncLogLine(ASYNC_LOG_##severity, 0).stream()
+
+#endif // _ASYNC_LOG_H_
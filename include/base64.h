@@ -4,6 +4,18 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <cstddef>
+
+// 功能：len字节的数据base64编码后的长度（包括补齐的'='）
+inline size_t base64_encoded_size(size_t len) { return (len + 2) / 3 * 4; }
+
+// 功能：编码到调用者分配的缓冲区，out至少有base64_encoded_size(len)字节，不写结尾的'\0'
+// 返回：写入的字节数
+// aarch64使用NEON，x86编译时打开SSSE3（-mssse3）使用SSSE3，其他平台逐字节查表
+size_t base64_encode_to(const unsigned char *src, size_t len, char *out);
+
+// 功能：编码后追加到out末尾，out只扩容一次，用于直接写入待发送的消息
+void base64_encode_append(const unsigned char *src, size_t len, std::string &out);
 
 std::string base64_encode(unsigned const char* byteToEncode, unsigned int len);
 
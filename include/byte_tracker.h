@@ -0,0 +1,92 @@
+#ifndef _BYTE_TRACKER_H_
+#define _BYTE_TRACKER_H_
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+// 功能：跟踪器的输入，即一帧中的一个检测框
+struct Object
+{
+    float rect[4]; // 左上角坐标和右下角坐标 x1, y1, x2, y2（原图坐标）
+    int label;     // 类别索引，不同类别之间不会互相关联
+    float prob;    // 置信度
+};
+
+// 功能：跟踪器的输出，即一条处于跟踪状态的轨迹
+struct STrack
+{
+    int track_id;   // 轨迹编号，从1开始，0保留表示"未跟踪"
+    int det_index;  // 本帧关联到的输入检测框下标，-1表示本帧没有关联到检测框
+    int label;
+    float score;
+    float tlwh[4];  // 卡尔曼滤波后的左上角坐标和宽高
+};
+
+/*
+ByteTrack 多目标跟踪器（每路摄像头一个实例）
+1. 卡尔曼状态为 (cx, cy, a, h) 及其速度，四个分量的运动模型和观测模型相互独立，
+   所以8x8的协方差矩阵始终是4个2x2块，只需存储每个分量的 P00,P01,P11
+2. 所有轨迹状态按结构体数组(SoA)连续存放，predict和IoU矩阵的计算都是对连续数组的循环，便于编译器向量化
+3. 关联分三步：高分框与跟踪/丢失轨迹，低分框与剩余跟踪轨迹，剩余高分框与未确认轨迹
+4. 丢失超过 frame_rate / 30 * track_buffer 帧的轨迹被删除，轨迹总数不超过 BYTE_TRACK_MAX_COUNT
+*/
+#define BYTE_TRACK_MAX_COUNT 512
+
+class BYTETracker
+{
+    public:
+        BYTETracker(int frame_rate = 30, int track_buffer = 30);
+
+        // 功能：输入一帧的检测结果，返回当前处于跟踪状态的轨迹（引用在下一次update前有效）
+        const std::vector<STrack> &update(const std::vector<Object> &objects);
+
+        // 功能：当前保存的轨迹数量（包括未确认和丢失的轨迹）
+        int size() const { return static_cast<int>(m_track_id.size()); }
+
+    private:
+        enum TrackState { New = 0, Tracked = 1, Lost = 2, Removed = 3 };
+
+        // 功能：新建一条轨迹并初始化卡尔曼状态
+        void add_track(const Object &object, int det_index, bool activated);
+        // 功能：所有轨迹的卡尔曼预测
+        void predict();
+        // 功能：用检测框更新第index条轨迹
+        void update_track(int index, const Object &object, int det_index);
+        // 功能：删除状态为Removed的轨迹，并保证轨迹总数不超过上限
+        void compact();
+        // 功能：计算轨迹和检测框之间的代价矩阵（1 - IoU），不同类别的代价为1
+        void iou_cost(const std::vector<int> &tracks, const std::vector<Object> &objects, const std::vector<int> &dets);
+        // 功能：线性分配，小矩阵使用匈牙利算法，大矩阵使用贪心算法。代价大于thresh的不匹配
+        void linear_assignment(int rows, int cols, float thresh);
+        void hungarian(const float *cost, int rows, int cols);
+
+        float track_thresh;  // 高分框阈值
+        float high_thresh;   // 新建轨迹的阈值
+        float match_thresh;  // 第一次关联的代价阈值
+        int frame_id;
+        int max_time_lost;
+        int track_id_count;
+
+        // 卡尔曼状态：m_mean[0..3] 为 cx, cy, a, h，m_mean[4..7] 为对应的速度
+        std::vector<float> m_mean[8];
+        // 协方差：每个分量一个2x2对称块
+        std::vector<float> m_p00[4], m_p01[4], m_p11[4];
+        // 轨迹属性
+        std::vector<int> m_track_id, m_state, m_label, m_end_frame, m_det_index;
+        std::vector<float> m_score;
+        std::vector<uint8_t> m_activated;
+
+        // 每帧复用的临时缓冲区，避免每帧分配内存
+        std::vector<int> m_high_dets, m_low_dets, m_remain_dets, m_pool, m_unconfirmed, m_remain_tracks;
+        std::vector<float> m_box[4], m_cost, m_transposed;
+        std::vector<std::pair<int, int>> m_matches;
+        std::vector<uint8_t> m_row_matched, m_col_matched;
+        std::vector<int> m_row_to_col, m_hg_p, m_hg_way;
+        std::vector<float> m_hg_u, m_hg_v, m_hg_minv;
+        std::vector<uint8_t> m_hg_used;
+        std::vector<std::pair<float, int>> m_greedy;
+        std::vector<STrack> m_output;
+};
+
+#endif // _BYTE_TRACKER_H_
@@ -0,0 +1,33 @@
+#ifndef _CLOCK_SERVICE_H_
+#define _CLOCK_SERVICE_H_
+
+#include <string>
+#include <cstdint>
+
+// 本地时区偏移的缓存时间（秒），时区或夏令时变化后最多延迟这么久生效
+#define CLOCK_TZ_REFRESH_S 60
+
+/*
+时间服务，报警流程内部的时间都是毫秒时间戳（int64），只在序列化时格式化为字符串：
+1. 本地时区偏移缓存 CLOCK_TZ_REFRESH_S 秒，格式化不再调用localtime，按偏移后的时间戳整数计算年月日
+2. 每个线程缓存最近一秒格式化好的 "年月日时分秒" 前缀，同一秒内只拼接毫秒
+3. 替代逐个目标调用localtime/put_time生成报警时间，以及AppMqttNode中get_time/mktime解析后再格式化
+*/
+class ClockService
+{
+    public:
+        // 功能：当前的毫秒时间戳（UTC）
+        static int64_t now_ms();
+
+        // 功能：本地时区相对UTC的偏移（秒）
+        static int tz_offset_s();
+
+        // 功能：格式化为 YYYY-MM-DDTHH:MM:SS.mmm+HH:MM（本地时间），追加到out
+        static void append_iso8601(int64_t ms, std::string &out);
+        static std::string iso8601(int64_t ms);
+
+        // 功能：格式化为 YYYYMMDDHHMMSSmmm（本地时间），nvr录像文件名使用
+        static std::string compact(int64_t ms);
+};
+
+#endif // _CLOCK_SERVICE_H_
@@ -6,12 +6,15 @@
 #include <mutex>
 #include <chrono>
 #include <vector>
+#include <list>
+#include <memory>
 #include <cstdint>
 #include <condition_variable>
 
 #include "opencv2/core/core.hpp"
 #include "opencv2/highgui.hpp"
 #include "opencv2/imgproc.hpp"
+#include "AINode.h"
 
 // 功能：枚举类型，显示矩阵, 这里用的，不是；
 enum DisplaySize {
@@ -21,33 +24,49 @@ enum DisplaySize {
     SIZE_4X4 = 4
 };
 
-// 功能：处理视频帧的拼接，主要用于在显示时，用于输出一路还是四路，还是16路用的
+/*
+功能：处理视频帧的拼接，主要用于在显示时，用于输出一路还是四路，还是16路用的
+1. 两块常驻的画布轮流输出，空白的格子只在创建时清零一次，不再每帧分配画布
+2. 每路输入有一个代数，addFrame时加一；输出时只缩放有新帧的格子，多个格子并行缩放，缩放结果缓存在该路的缓冲区中
+3. 每块画布记录各个格子已绘制的代数，只把变化的格子拷贝到画布上
+4. 按输出帧率定时输出（sleep_until），不再循环等待所有输入都有新帧
+5. OSD（目标框和标签）在缩放后的格子上绘制，不修改原分辨率的输入帧，绘制量随格子变小而减少
+*/
 class FrameConcate
 {
     public:
         //构造函数
         FrameConcate(int numInputs, int outputFPS, int width, int height);
         // 输入每路RTSP解码后的一帧，以及对应的输入流编号，将帧添加到输入流缓冲区中
-        void addFrame(int inputIndex, const cv::Mat &frame);
-        // 获取并输出合成帧
+        // objects为需要在该格子上叠加显示的目标（原图坐标），不开启OSD时为空
+        void addFrame(int inputIndex, const cv::Mat &frame, const std::list<objectInfo> &objects = std::list<objectInfo>());
+        // 获取并输出合成帧，返回的画布在下下次调用前有效，只能在一个线程中调用
         cv::Mat getConcateFrame();
 
     private:
         // 帧缓冲区
         struct FrameBuffer
         {
-            cv::Mat frame; // 存储输入源的最新帧
-            cv::Mat resizeFrame; //存储调整大小后的帧
-            bool hasNewFrame = false; // 标志是否有新的帧到达
+            cv::Mat frame; // 输入源的最新帧，addFrame写入，与调用者共享只读的帧数据
+            cv::Mat sourceFrame; // 输出线程取走的最新帧，只在输出线程中访问
+            cv::Mat resizeFrame; //存储调整大小后的帧，已画好OSD
+            std::list<objectInfo> objects; // 最新帧的OSD目标
+            std::list<objectInfo> sourceObjects; // sourceFrame的OSD目标
+            uint64_t generation = 0; // addFrame的次数
+            uint64_t resizeGeneration = 0; // resizeFrame对应的代数
+            cv::Rect rect; // 该路在画布上的位置
             std::unique_ptr<std::mutex> mutex; // 智能指针mutex，指针指向一个互斥锁
             // 结构体的构造函数, 初始化列表，为成员变量赋值 ：成员变量1（值）, 成员变量2（值）{}
-            FrameBuffer() : hasNewFrame(false), mutex(std::make_unique<std::mutex>()) {}
+            FrameBuffer() : mutex(std::make_unique<std::mutex>()) {}
         };
         int inputNums; // 输入流的数量，一般是1或者2
         int outputFps; // 输出的帧率，一般是30
         int frameWidth, frameHeight;  // 一般是640,640  如果是四路，那就是320x320
         std::vector<FrameBuffer> buffers; // 存储每个输入流的最新帧。
+        cv::Mat canvas[2]; // 轮流输出的两块画布
+        std::vector<uint64_t> canvasGeneration[2]; // 每块画布上各个格子已绘制的代数
+        int backCanvas = 0; // 下一次绘制的画布
         std::chrono::steady_clock::time_point nextFrameTime = std::chrono::steady_clock::now();
         int show_size_plan = 0;
 };
-#endif // _FRAME_CONCATE_H_
\ No newline at end of file
+#endif // _FRAME_CONCATE_H_
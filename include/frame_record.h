@@ -0,0 +1,174 @@
+#ifndef _FRAME_RECORD_H_
+#define _FRAME_RECORD_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+
+#include "opencv2/core/core.hpp"
+#include "postprocess.h"
+
+// 录制帧的JPEG质量，录制时在解码线程中编码
+#define FRAME_RECORD_JPEG_QUALITY 95
+// 回放结束后等待帧处理完的最长时间，之后输出报告
+#define REPLAY_DRAIN_TIMEOUT_MS 3000
+// 回放结束并输出报告后退出进程，有不一致的结果时退出码为1
+#define REPLAY_EXIT_ON_END 1
+// 比较检测结果时框坐标和置信度的容差
+#define REPLAY_BOX_TOLERANCE 2
+#define REPLAY_PROP_TOLERANCE 0.01f
+
+// 录制文件的格式版本，格式变化时加一，读取时不认识的版本拒绝打开
+#define FRAME_RECORD_VERSION 2
+
+/*
+录制文件，每路摄像头一个文件。所有整数按小端序定长写入，浮点数按IEEE 754单精度的位写入，不直接写结构体，
+录制和回放可以在不同的架构和编译器上：
+文件头（16字节）：magic "SWRECORD"(8) + version u32 + 文件头字节数 u32，之后是连续的记录
+记录头（24字节）：type u32 + 数据字节数 u32 + frame_seq u64 + timestamp_us i64，之后是数据
+1. RECORD_FRAME：解码后的一帧，JPEG编码（没有拿到解码前的码流），timestamp_us为解码时间
+2. RECORD_RESULT：该帧的检测结果（推理线程池输出，跟踪之前），数据为 count u32 + count个目标，
+   每个目标40字节：name 16字节（不足补0）+ left、right、top、bottom i32 + prop f32 + track_id i32
+两种记录都用该路摄像头的解码帧序号frame_seq对应
+*/
+enum FrameRecordType
+{
+    RECORD_FRAME = 1,
+    RECORD_RESULT = 2
+};
+
+// 功能：记录头在内存中的形式，读写文件时逐字段编解码
+struct FrameRecordHeader
+{
+    uint32_t type;
+    uint32_t size; // 数据的字节数
+    uint64_t frame_seq;
+    int64_t timestamp_us;
+};
+
+// 功能：写入一路摄像头的录制文件，帧和检测结果可以在不同线程写入
+class FrameRecorder
+{
+    public:
+        FrameRecorder() = default;
+        ~FrameRecorder();
+        FrameRecorder(const FrameRecorder &) = delete;
+        FrameRecorder &operator=(const FrameRecorder &) = delete;
+
+        bool open(const std::string &path);
+        void close();
+
+        void write_frame(uint64_t frame_seq, int64_t timestamp_us, const cv::Mat &frame);
+        void write_result(uint64_t frame_seq, const detect_result_group_t &result);
+
+    private:
+        void write_record(uint32_t type, uint64_t frame_seq, int64_t timestamp_us, const void *data, size_t size);
+
+        std::mutex m_mutex;
+        FILE *m_file = nullptr;
+};
+
+// 一帧录制的检测结果
+typedef std::vector<detect_result_t> RecordedResult;
+
+// 功能：按顺序读取录制文件中的帧，打开时读入所有检测结果
+class FrameReplayer
+{
+    public:
+        FrameReplayer() = default;
+        ~FrameReplayer();
+        FrameReplayer(const FrameReplayer &) = delete;
+        FrameReplayer &operator=(const FrameReplayer &) = delete;
+
+        bool open(const std::string &path);
+        // 功能：读取下一帧，文件结束时返回false；rewind后从第一帧重新读
+        bool next(uint64_t &frame_seq, int64_t &timestamp_us, cv::Mat &frame);
+        void rewind();
+
+        const std::map<uint64_t, RecordedResult> &results() const { return m_results; }
+
+        // 功能：只读取文件中的检测结果，用于和另一次回放的结果比较
+        static bool load_results(const std::string &path, std::map<uint64_t, RecordedResult> &results);
+
+    private:
+        FILE *m_file = nullptr;
+        long m_first_record = 0;
+        std::vector<uchar> m_buffer;
+        std::map<uint64_t, RecordedResult> m_results;
+};
+
+// 功能：回放地址 replay://<文件>?speed=1&infer=npu&expect=<文件>&save=<文件>
+//      speed：1为按录制时的间隔实时回放，2为两倍速，0为不等待尽快回放
+//      infer：npu为实际推理，recorded为直接使用录制的检测结果，none为不推理
+//      expect：比较用的检测结果文件，默认用录制文件中的结果；save：保存这次推理的检测结果，作为下一次的expect
+struct ReplayConfig
+{
+    std::string path;
+    double speed = 1;
+    std::string infer = "npu";
+    std::string expect;
+    std::string save;
+    bool loop = false; // 循环回放，不输出报告
+
+    static bool is_replay_url(const std::string &url);
+    static ReplayConfig parse(const std::string &url);
+};
+
+/*
+回放报告，所有回放的摄像头结束后输出：
+1. 帧率：帧处理线程处理完的帧数 / 回放开始到最后一帧处理完的时间
+2. 各阶段延迟的分位数：read（读文件和JPEG解码）、infer（提交推理到取出结果）、end to end（读出到帧处理线程处理完）
+3. 输出一致性：推理结果与expect逐帧比较，框数、类别相同且框和置信度在容差内算一致
+*/
+class ReplayReport
+{
+    public:
+        static ReplayReport &global();
+
+        // 功能：开始回放一路，expected为比较用的检测结果，save_path不为空时保存这次推理的检测结果
+        void camera_started(int camera_index, const std::map<uint64_t, RecordedResult> &expected, const std::string &save_path);
+        // 功能：该路回放结束，返回是否所有回放的摄像头都已结束
+        bool camera_finished(int camera_index);
+
+        void frame_read(int camera_index, uint64_t frame_seq, double read_ms);
+        void infer_submitted(int camera_index, uint64_t frame_seq);
+        // 功能：推理结果已取出，result.id为摄像头编号
+        void infer_done(uint64_t frame_seq, const detect_result_group_t &result);
+        void frame_processed(int camera_index, uint64_t frame_seq);
+
+        // 功能：等待读出的帧处理完（最多timeout_ms），输出报告，返回是否有不一致的结果
+        bool finish(int timeout_ms);
+
+    private:
+        struct Camera
+        {
+            std::map<uint64_t, RecordedResult> expected;
+            std::map<uint64_t, int64_t> read_time_us; // 读出但还没处理完的帧
+            std::map<uint64_t, int64_t> submit_time_us; // 提交但还没取出结果的帧
+            std::unique_ptr<FrameRecorder> save;
+            bool finished = false;
+        };
+
+        static bool same_result(const RecordedResult &expected, const detect_result_group_t &actual);
+        static std::string percentiles(std::vector<double> &samples);
+
+        std::mutex m_mutex;
+        std::map<int, Camera> m_cameras;
+        int64_t m_start_us = 0;
+        int64_t m_last_processed_us = 0;
+        uint64_t m_frames_read = 0;
+        uint64_t m_frames_processed = 0;
+        uint64_t m_compared = 0;
+        uint64_t m_mismatched = 0;
+        uint64_t m_missing = 0; // expect中没有该帧的结果
+        std::vector<double> m_read_ms;
+        std::vector<double> m_infer_ms;
+        std::vector<double> m_end_to_end_ms;
+};
+
+#endif // _FRAME_RECORD_H_
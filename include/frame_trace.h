@@ -0,0 +1,76 @@
+#ifndef _FRAME_TRACE_H_
+#define _FRAME_TRACE_H_
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+// 默认每隔多少帧（所有摄像头合计）采样一帧，0表示关闭；运行时可以用 GET /trace?sample=N 修改
+#define FRAME_TRACE_SAMPLE_INTERVAL 100
+// 每个线程保存的最近事件数，写满后覆盖最旧的
+#define FRAME_TRACE_RING_SIZE 4096
+// 缓冲区个数的上限，超过后新线程复用已退出线程的缓冲区；所有线程都在运行时仍然新建
+#define FRAME_TRACE_THREAD_MAX 64
+// 收到 SIGUSR2 时写入的文件，用 https://ui.perfetto.dev 打开
+#define FRAME_TRACE_DUMP_PATH "/tmp/seaway_trace.json"
+
+/*
+按帧采样的链路追踪，用于定位延迟尖峰时帧在哪里等待：
+1. 解码线程调用sample()，被采样的帧得到非0的trace_id，随inputData、dataEncode和pipelineInfo一起传递；
+   没被采样的帧trace_id为0，record直接返回，不影响帧处理
+2. 结构体中的trace_ts_us是帧进入当前队列的时间，出队时record一个等待区间（wait=true），
+   导出为以trace_id为id的异步事件，Perfetto中同一帧的各段等待显示在同一行；
+   工作区间（wait=false）导出为所在线程上的完整事件
+3. 事件写入当前线程的环形缓冲区，缓冲区的锁只在导出时才有竞争；线程退出后缓冲区保留，个数超过上限时留给新线程复用
+4. 收到 SIGUSR2 或请求 GET /trace 时导出为Chrome trace JSON
+只有带报警的帧才会生成pipelineInfo，所以send-recv之后的区间只出现在有报警的采样帧上
+*/
+class FrameTrace
+{
+    public:
+        // 功能：当前帧是否采样，采样时返回trace_id，否则返回0
+        static uint64_t sample();
+        static void set_sample_interval(int interval);
+        static int sample_interval();
+
+        // 功能：steady_clock的微秒数，作为事件的时间
+        static int64_t now_us();
+
+        // 功能：记录一个区间，name必须是字符串常量（只保存指针）；trace_id为0时直接返回
+        static void record(uint64_t trace_id, const char *name, int64_t start_us, int64_t end_us, bool wait);
+
+        // 功能：记录从start_us到现在的等待区间，返回现在的时间，调用者用它作为下一段的开始
+        static int64_t wait(uint64_t trace_id, const char *name, int64_t start_us);
+
+        // 功能：设置当前线程在导出结果中的名字
+        static void set_thread_name(const std::string &name);
+
+        // 功能：导出所有线程缓冲区中的事件
+        static std::string dump_json();
+        static bool dump_file(const std::string &path);
+
+        // 功能：安装 SIGUSR2 处理函数，收到信号后由后台线程写入path
+        static void install_signal_dump(const std::string &path = FRAME_TRACE_DUMP_PATH);
+};
+
+// 功能：在作用域内记录一个工作区间
+class FrameTraceSpan
+{
+    public:
+        FrameTraceSpan(uint64_t trace_id, const char *name)
+            : m_trace_id(trace_id), m_name(name), m_start_us(trace_id ? FrameTrace::now_us() : 0) {}
+        ~FrameTraceSpan()
+        {
+            if(m_trace_id)
+                FrameTrace::record(m_trace_id, m_name, m_start_us, FrameTrace::now_us(), false);
+        }
+        FrameTraceSpan(const FrameTraceSpan &) = delete;
+        FrameTraceSpan &operator=(const FrameTraceSpan &) = delete;
+
+    private:
+        uint64_t m_trace_id;
+        const char *m_name;
+        int64_t m_start_us;
+};
+
+#endif // _FRAME_TRACE_H_
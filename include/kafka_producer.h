@@ -0,0 +1,111 @@
+#ifndef _KAFKA_PRODUCER_H_
+#define _KAFKA_PRODUCER_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include "AINode.h"
+
+// 消息在本地攒批的最长等待时间（毫秒）和每批的最大字节数
+#define KAFKA_LINGER_MS 50
+#define KAFKA_BATCH_SIZE (1024 * 1024)
+// 压缩算法：lz4 或 zstd
+#define KAFKA_COMPRESSION_TYPE "lz4"
+// 本地待发送的消息上限，超过时丢弃新消息，不阻塞报警流程
+#define KAFKA_QUEUE_MAX_MESSAGES 10000
+// 发送结果回调的轮询间隔（毫秒）
+#define KAFKA_POLL_INTERVAL_MS 100
+// 析构时等待未发送消息的最长时间（毫秒）
+#define KAFKA_FLUSH_TIMEOUT_MS 5000
+
+// 功能：kafka发送统计，latency为消息创建到broker确认的时间
+struct KafkaProducerStats
+{
+    uint64_t produced = 0;   // 进入本地队列的消息数
+    uint64_t delivered = 0;  // broker确认的消息数
+    uint64_t failed = 0;     // 发送失败的消息数（包括本地队列满被丢弃的）
+    uint64_t queue_full = 0; // 本地队列满被丢弃的消息数
+    double latency_avg_ms = 0;
+    double latency_max_ms = 0;
+};
+
+/*
+kafka报警消息模板，初始化时编译一次，每次报警只按顺序拼接：
+1. 模板是完整的JSON文本，字段位置写 "${name}"（带引号时引号也被替换），可用字段：
+   alarm_date(秒)、timestamp(毫秒)、pic_url、camera_id、camera_name、camera_index、alarm_type
+2. 字符串字段输出为带引号并转义的JSON字符串，数值字段直接输出
+*/
+class KafkaAlarmTemplate
+{
+    public:
+        // 功能：编译模板，返回是否成功；有未知字段时失败，error不为空时写入原因
+        bool compile(const std::string &text, std::string *error = nullptr);
+
+        // 功能：默认的报警消息模板，字段与改造前AppMqttNode组装的kafka_root相同，按Json2String(emitUTF8=true)的格式输出
+        static std::string default_text();
+
+        // 功能：按模板生成一条消息，写入out（out先清空）
+        void fill(const pipelineInfo &info, int64_t alarm_date_s, int64_t timestamp_ms, const std::string &pic_url, std::string &out) const;
+
+    private:
+        enum Field { AlarmDate, Timestamp, PicUrl, CameraId, CameraName, CameraIndex, AlarmType };
+
+        struct Segment
+        {
+            std::string literal; // 字段之前的固定文本
+            Field field;
+        };
+
+        std::vector<Segment> m_segments;
+        std::string m_tail; // 最后一个字段之后的固定文本
+        size_t m_size_hint = 0;
+};
+
+struct rd_kafka_s;
+struct rd_kafka_message_s;
+
+/*
+基于librdkafka的报警消息发送，替代EdgeSDK中逐条同步发送的SendEdgeIKafkaMessage：
+1. 按 linger.ms/batch.size 攒批并压缩，produce只把消息放进本地队列，立即返回
+2. 以摄像头id为key，同一路摄像头的消息进入同一个分区，开启幂等保证重试时分区内不乱序
+3. 一个线程轮询发送结果回调，统计确认数、失败数和延迟
+4. extra_conf中的配置覆盖默认配置，例如 {"test.mock.num.brokers", "3"} 使用librdkafka内置的模拟集群
+*/
+class KafkaProducer
+{
+    public:
+        KafkaProducer(const std::string &brokers, const std::string &topic,
+                      const std::map<std::string, std::string> &extra_conf = {});
+        ~KafkaProducer();
+
+        // 功能：是否创建成功
+        bool valid() const { return m_rk != nullptr; }
+
+        // 功能：发送结果，在轮询线程的发送结果回调中调用；produce失败时直接在produce中调用
+        typedef std::function<void(bool delivered)> DoneFunction;
+
+        // 功能：发送一条消息，key为分区键。返回是否进入本地队列
+        bool produce(const std::string &key, const std::string &payload, DoneFunction done = DoneFunction());
+
+        KafkaProducerStats stats() const;
+
+    private:
+        static void on_delivery(struct rd_kafka_s *rk, const struct rd_kafka_message_s *message, void *opaque);
+        void poll_loop();
+
+        struct rd_kafka_s *m_rk = nullptr;
+        std::string m_topic;
+        std::atomic<bool> m_stop {false};
+        std::thread m_poll_thread;
+
+        KafkaProducerStats m_stats;
+        double m_latency_sum_ms = 0;
+        mutable std::mutex m_mutex;
+};
+
+#endif // _KAFKA_PRODUCER_H_
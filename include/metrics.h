@@ -0,0 +1,155 @@
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <cstdint>
+#include "aligned_new.h"
+
+// 计数器和直方图的分片数，每个线程固定使用一个分片，更新时不与其他线程竞争同一缓存行
+#define METRICS_SHARD_COUNT 16
+// /metrics 服务的端口
+#define METRICS_SERVER_PORT 9100
+
+namespace httplib
+{
+    class Server;
+}
+
+// 功能：当前线程使用的分片编号，线程第一次调用时按顺序分配
+int metrics_shard();
+
+// 功能：生成一个标签 key="value"，多个标签用逗号连接
+std::string metrics_label(const std::string &key, const std::string &value);
+
+// 功能：只增不减的计数器，inc只是一次对本线程分片的relaxed原子加
+class Counter : public AlignedNew<Counter>
+{
+    public:
+        void inc(uint64_t n = 1)
+        {
+            m_shards[metrics_shard()].value.fetch_add(n, std::memory_order_relaxed);
+        }
+        uint64_t value() const;
+
+    private:
+        struct alignas(64) Shard
+        {
+            std::atomic<uint64_t> value{0};
+        };
+        Shard m_shards[METRICS_SHARD_COUNT];
+};
+
+// 功能：可增可减的瞬时值，例如队列长度
+class Gauge
+{
+    public:
+        void set(double value) { m_value.store(value, std::memory_order_relaxed); }
+        void add(double delta);
+        double value() const { return m_value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<double> m_value{0};
+};
+
+// 功能：直方图，bounds为各个桶的上界（升序），最后还有一个+Inf桶
+class Histogram : public AlignedNew<Histogram>
+{
+    public:
+        explicit Histogram(const std::vector<double> &bounds);
+
+        void observe(double value);
+
+        const std::vector<double> &bounds() const { return m_bounds; }
+        // 功能：合并所有分片，counts为各个桶（不累加）的计数，最后一个是+Inf桶
+        void snapshot(std::vector<uint64_t> &counts, double &sum) const;
+
+    private:
+        struct alignas(64) Shard
+        {
+            std::unique_ptr<std::atomic<uint64_t>[]> counts;
+            std::atomic<double> sum{0};
+        };
+        std::vector<double> m_bounds;
+        Shard m_shards[METRICS_SHARD_COUNT];
+};
+
+// 默认的耗时直方图桶（秒）
+std::vector<double> metrics_latency_buckets();
+
+/*
+指标注册表，替代定时打印到标准输出的帧率、内存和队列长度，以Prometheus文本格式导出：
+1. 计数器、瞬时值和直方图按 名称+标签 注册一次，调用者保存返回的引用，热路径上只做一次原子操作
+2. 队列长度、各模块stats()等已有的值用回调注册，只在抓取时计算；owner析构前要调用remove_callbacks
+3. 注册表的锁只在注册和抓取时使用，不影响更新
+*/
+class MetricsRegistry
+{
+    public:
+        typedef std::function<double()> ValueFunction;
+
+        static MetricsRegistry &global();
+
+        Counter &counter(const std::string &name, const std::string &help, const std::string &labels = std::string());
+        Gauge &gauge(const std::string &name, const std::string &help, const std::string &labels = std::string());
+        Histogram &histogram(const std::string &name, const std::string &help, const std::vector<double> &bounds,
+                             const std::string &labels = std::string());
+
+        // 功能：抓取时调用function得到值，owner用于注销
+        void counter_callback(const std::string &name, const std::string &help, const std::string &labels,
+                              ValueFunction function, const void *owner);
+        void gauge_callback(const std::string &name, const std::string &help, const std::string &labels,
+                            ValueFunction function, const void *owner);
+        // 功能：注销owner注册的所有回调，返回后不会再调用这些回调
+        void remove_callbacks(const void *owner);
+
+        // 功能：Prometheus文本格式
+        std::string render() const;
+
+    private:
+        struct Series
+        {
+            std::string labels;
+            std::unique_ptr<Counter> counter;
+            std::unique_ptr<Gauge> gauge;
+            std::unique_ptr<Histogram> histogram;
+            ValueFunction function;
+            const void *owner = nullptr;
+        };
+        struct Family
+        {
+            std::string name;
+            std::string help;
+            std::string type;
+            std::vector<std::unique_ptr<Series>> series;
+        };
+
+        Series &series(const std::string &name, const std::string &help, const std::string &type, const std::string &labels);
+
+        mutable std::mutex m_mutex;
+        std::vector<std::unique_ptr<Family>> m_families;
+};
+
+// 功能：在后台线程中提供 GET /metrics，以及帧追踪的 GET /trace（见frame_trace.h）
+class MetricsServer
+{
+    public:
+        MetricsServer(MetricsRegistry &registry, int port = METRICS_SERVER_PORT);
+        ~MetricsServer();
+
+        bool start();
+        void stop();
+
+    private:
+        MetricsRegistry &m_registry;
+        int m_port;
+        std::unique_ptr<httplib::Server> m_server;
+        std::thread m_listen_thread;
+};
+
+#endif // _METRICS_H_
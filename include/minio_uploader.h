@@ -0,0 +1,103 @@
+#ifndef _MINIO_UPLOADER_H_
+#define _MINIO_UPLOADER_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include "opencv2/core/core.hpp"
+
+// 上传线程数，每个线程持有一个客户端，连接在上传之间复用
+#define MINIO_UPLOAD_THREAD_COUNT 2
+// 内存中等待上传的报警图片上限，超过时直接写入磁盘缓存
+#define MINIO_QUEUE_MAX 32
+// 每张图片的上传重试次数和首次重试的等待时间（毫秒，每次翻倍）
+#define MINIO_RETRY_MAX 2
+#define MINIO_RETRY_BACKOFF_MS 500
+// 磁盘缓存目录和占用上限，超过上限时删除最早的缓存
+#define MINIO_SPOOL_DIR "./minio_spool"
+#define MINIO_SPOOL_MAX_BYTES (512LL * 1024 * 1024)
+// 对象存储不可达时，重新上传磁盘缓存的间隔（秒）
+#define MINIO_SPOOL_RETRY_INTERVAL_S 30
+
+// 功能：上传统计
+struct MinioUploaderStats
+{
+    uint64_t submitted = 0;  // 提交的图片数
+    uint64_t uploaded = 0;   // 上传成功的图片数（包括从磁盘缓存补传的）
+    uint64_t retries = 0;    // 重试次数
+    uint64_t spooled = 0;    // 写入磁盘缓存的图片数
+    uint64_t spool_dropped = 0; // 超过磁盘缓存上限被删除的图片数
+    size_t queued = 0;
+    size_t spool_files = 0;
+    int64_t spool_bytes = 0;
+};
+
+/*
+报警图片异步上传到minio，替代AppMqttNode中逐个报警同步调用upload_filedata：
+1. 对象名在提交时确定并立即返回，报警消息的picUrl直接使用，不等待上传完成
+2. 固定数量的上传线程，每个线程通过工厂函数创建自己的上传函数（客户端），连接在上传之间复用
+3. 上传失败按指数退避重试，仍失败或内存队列已满时写入磁盘缓存：先写临时文件并fsync，再rename，进程崩溃不会留下不完整的缓存
+4. 启动时加载磁盘缓存，空闲时按时间顺序补传，补传成功后删除缓存文件
+*/
+class MinioUploader
+{
+    public:
+        // 功能：上传一个对象，返回是否成功
+        typedef std::function<bool(const std::string &key, const uchar *data, size_t size)> UploadFunction;
+        // 功能：为每个上传线程创建上传函数，在上传线程中调用
+        typedef std::function<UploadFunction()> UploadFactory;
+
+        MinioUploader(UploadFactory factory, const std::string &spool_dir = MINIO_SPOOL_DIR,
+                      int thread_num = MINIO_UPLOAD_THREAD_COUNT, int64_t spool_max_bytes = MINIO_SPOOL_MAX_BYTES);
+        ~MinioUploader();
+
+        // 功能：提交一张图片，返回对象名（"/<bucket>/<毫秒时间戳>.jpg"）
+        std::string submit(const std::string &bucket, std::vector<uchar> data);
+
+        // 功能：先分配对象名，图片编码完成后再用submit_key提交，报警在编码前就能引用图片
+        std::string reserve_key(const std::string &bucket);
+        void submit_key(const std::string &key, std::vector<uchar> data);
+
+        MinioUploaderStats stats() const;
+
+    private:
+        struct Job
+        {
+            std::string key;
+            std::vector<uchar> data;
+            std::string spool_path; // 来自磁盘缓存时为缓存文件路径
+        };
+
+        void worker();
+        // 功能：取一个磁盘缓存的任务，需持有m_mutex
+        bool take_spooled(Job &job);
+        // 功能：写入磁盘缓存，超过上限时删除最早的缓存
+        void spool(const Job &job);
+        void load_spool();
+        bool wait_stop(std::chrono::milliseconds duration);
+
+        UploadFactory m_factory;
+        std::string m_spool_dir;
+        int64_t m_spool_max_bytes;
+        std::vector<std::thread> m_threads;
+
+        std::deque<Job> m_queue;
+        std::deque<std::string> m_spool_files; // 按文件名（时间）排序
+        std::set<std::string> m_spool_busy;    // 正在补传的缓存文件
+        std::chrono::steady_clock::time_point m_spool_next_try;
+        int64_t m_last_key_ms = 0;
+        MinioUploaderStats m_stats;
+        bool m_stop = false;
+        mutable std::mutex m_mutex;
+        std::mutex m_spool_mutex; // 写缓存文件和删除最早缓存互斥
+        std::condition_variable m_cond;
+};
+
+#endif // _MINIO_UPLOADER_H_
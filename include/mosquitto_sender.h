@@ -0,0 +1,44 @@
+#ifndef _MOSQUITTO_SENDER_H_
+#define _MOSQUITTO_SENDER_H_
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "mqtt_publisher.h"
+
+struct mosquitto;
+
+/*
+基于libmosquitto的发送函数，直连broker发布到固定的topic，用于本地broker联调和断线测试：
+1. 网络线程由libmosquitto维护，断开后自动重连
+2. QoS大于0时等待PUBACK/PUBCOMP，超时或断开返回false，由MqttPublisher重试
+3. 超时后才到达的确认只保留MQTT_ACK_TIMEOUT_MS，下一次发送时清理
+*/
+class MosquittoSender
+{
+    public:
+        MosquittoSender(const std::string &host, int port, const std::string &topic, int qos = MQTT_DEFAULT_QOS, int keepalive = 60);
+        ~MosquittoSender();
+
+        bool send(const std::string &payload);
+        bool connected() const;
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        static void on_connect(struct mosquitto *mosq, void *obj, int rc);
+        static void on_disconnect(struct mosquitto *mosq, void *obj, int rc);
+        static void on_publish(struct mosquitto *mosq, void *obj, int mid);
+
+        struct mosquitto *m_mosq = nullptr;
+        std::string m_topic;
+        int m_qos;
+        bool m_connected = false;
+        std::map<int, Clock::time_point> m_acked; // 已确认但send尚未取走的消息id和确认时间
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cond;
+};
+
+#endif // _MOSQUITTO_SENDER_H_
@@ -0,0 +1,114 @@
+#ifndef _MQTT_PUBLISHER_H_
+#define _MQTT_PUBLISHER_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+// 待发送消息占用的内存上限（字节），超过时丢弃最早的消息
+#define MQTT_QUEUE_MAX_BYTES (64 * 1024 * 1024)
+// 同一路摄像头的合并窗口（毫秒）：发送一条报警后，窗口内到达的报警合并为一条消息在窗口结束时发送，0表示不合并。
+// 合并消息是JSON数组，不是EdgeSDK约定的单个报警对象，默认不合并；订阅端都能解析数组后再打开
+#define MQTT_COALESCE_WINDOW_MS 0
+// 一条合并消息最多包含的报警数，超过时后面的报警合并到下一个窗口
+#define MQTT_COALESCE_MAX_COUNT 16
+// 默认的QoS等级，QoS为0时发送失败不重试
+#define MQTT_DEFAULT_QOS 1
+// 发送失败后的最大重试次数
+#define MQTT_RETRY_MAX 5
+// 重试的退避时间（毫秒），每次翻倍，不超过上限
+#define MQTT_RETRY_BACKOFF_MS 200
+#define MQTT_RETRY_BACKOFF_MAX_MS 5000
+// QoS大于0时等待broker确认的超时时间（毫秒）
+#define MQTT_ACK_TIMEOUT_MS 3000
+
+// 功能：发布统计，按报警计数（一条合并消息包含多条报警），latency为入队到发送成功的时间
+struct MqttPublisherStats
+{
+    uint64_t enqueued = 0;   // 入队的报警数
+    uint64_t coalesced = 0;  // 合并到同一路摄像头前一条消息中发送的报警数
+    uint64_t dropped = 0;    // 超过内存上限被丢弃的报警数
+    uint64_t sent = 0;       // 发送成功的报警数
+    uint64_t failed = 0;     // 重试次数用完仍失败的报警数
+    uint64_t retries = 0;    // 重试次数
+    size_t queued_messages = 0;
+    size_t queued_bytes = 0;
+    double latency_avg_ms = 0;
+    double latency_max_ms = 0;
+};
+
+/*
+异步MQTT发布，AppMqttNode只负责入队，broker慢或断开时不再阻塞报警流程：
+1. 一个发送线程按入队顺序发送已到发送时间的消息，在合并窗口中等待的消息不阻塞其他摄像头；
+   失败时按指数退避重试，退避期间后面的消息等待，保证顺序
+2. 队列按字节数限制，超过 MQTT_QUEUE_MAX_BYTES 时丢弃最早的消息
+3. 同一路摄像头没有待发送的消息且不在合并窗口内时立即发送；发送后窗口内到达的报警合并为一条消息，
+   在窗口结束时发送。合并消息是各条报警组成的JSON数组 [报警1,报警2,...]，单条报警仍是原来的JSON对象；
+   合并窗口默认为0，每条报警单独发送，消息格式与EdgeSDK一致
+4. 发送函数由调用者注入：默认使用EdgeSDK的SendEdgeIMqttMessage，也可以使用MosquittoSender直连broker
+*/
+class MqttPublisher
+{
+    public:
+        // 功能：发送一条消息，返回是否成功（QoS大于0时应在收到broker确认后返回true）
+        typedef std::function<bool(const std::string &payload)> SendFunction;
+        // 功能：消息的最终结果，发送成功为true，丢弃或重试用完为false；合并消息中的每条报警都以合并消息的结果回调，持有发送队列的锁调用
+        typedef std::function<void(bool delivered)> DoneFunction;
+
+        explicit MqttPublisher(SendFunction send, int qos = MQTT_DEFAULT_QOS,
+                               size_t max_bytes = MQTT_QUEUE_MAX_BYTES,
+                               int coalesce_window_ms = MQTT_COALESCE_WINDOW_MS,
+                               int retry_max = MQTT_RETRY_MAX);
+        ~MqttPublisher();
+
+        // 功能：入队一条消息，立即返回。camera_index为负时不参与合并；析构时仍在队列中的消息不回调done
+        void publish(int camera_index, std::string payload, DoneFunction done = DoneFunction());
+
+        MqttPublisherStats stats() const;
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Message
+        {
+            int camera_index;
+            std::vector<std::string> payloads; // 合并的各条报警，发送时才拼接
+            size_t bytes;
+            Clock::time_point enqueue_time;
+            Clock::time_point ready_time; // 合并窗口结束或退避结束的时间，之前不发送
+            int attempts;
+            std::vector<DoneFunction> done; // 每条报警的回调
+        };
+
+        void worker();
+        // 功能：丢弃最早的消息直到不超过内存上限，需持有m_mutex
+        void trim();
+        // 功能：取出最早的可发送消息，没有时返回false并给出最早的发送时间，需持有m_mutex
+        bool take_ready(Clock::time_point now, Message &message, Clock::time_point &next_time);
+        // 功能：合并消息拼接为JSON数组
+        static const std::string &merged_payload(const Message &message, std::string &buffer);
+
+        SendFunction m_send;
+        int m_qos;
+        size_t m_max_bytes;
+        std::chrono::milliseconds m_coalesce_window;
+        int m_retry_max;
+
+        std::deque<Message> m_queue;
+        std::map<int, Clock::time_point> m_window_end; // 每路摄像头合并窗口的结束时间
+        MqttPublisherStats m_stats;
+        double m_latency_sum_ms = 0;
+        bool m_stop = false;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::thread m_thread;
+};
+
+#endif // _MQTT_PUBLISHER_H_
@@ -0,0 +1,105 @@
+#ifndef _NVR_RECORDER_H_
+#define _NVR_RECORDER_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <chrono>
+#include <cstdint>
+
+// 录像请求在队列中等待的最长时间（毫秒），超时的请求不再发给nvr；只限制排队时间，不限制发给nvr的调用本身
+#define NVR_RECORD_TIMEOUT_MS 3000
+// 等待发给nvr的录像请求上限，超过时新请求直接失败
+#define NVR_RECORD_QUEUE_MAX 16
+
+// 功能：从摄像头地址末尾的数字解析nvr通道号，例如 rtsp://.../Streaming/Channels/3 为3，没有数字时返回0
+int nvr_channel_from_url(const std::string &url);
+
+/*
+摄像头到nvr通道号的映射，替代每次报警对摄像头地址执行正则匹配：
+配置中的摄像头地址列表变化时（配置更新）重新解析一次，之后按camera_index直接查表
+*/
+class NvrChannelMap
+{
+    public:
+        // 功能：地址列表与上次不同时重新解析，返回是否重新解析
+        bool update(const std::vector<std::string> &camera_urls);
+
+        // 功能：摄像头的通道号，0表示没有对应的通道
+        int channel(int camera_index) const;
+
+    private:
+        std::vector<std::string> m_urls;
+        std::vector<int> m_channels;
+};
+
+// 功能：一次录像请求的结果
+struct NvrRecordResult
+{
+    bool ok = false;
+    int64_t timestamp_ms = 0; // 录像启动成功的时间
+};
+
+struct NvrRecorderStats
+{
+    uint64_t submitted = 0;
+    uint64_t recorded = 0;  // 录像启动成功的请求数
+    uint64_t failed = 0;    // nvr返回失败的请求数
+    uint64_t expired = 0;   // 在队列中超时的请求数
+    uint64_t rejected = 0;  // 队列已满直接失败的请求数
+};
+
+/*
+nvr录像异步触发，替代AppMqttNode在mqtt发布前同步调用record_nvr：
+1. 报警接收时就提交录像请求，与图片编码并行，发布时结果通常已经返回
+2. 一个线程按顺序发给nvr（nvr客户端不要求线程安全），在队列中等待超过 NVR_RECORD_TIMEOUT_MS 的请求直接失败。
+   超时只限制排队时间：已经发给nvr的调用（RecordFunction）不会被打断，它的耗时由nvr客户端自己的网络超时决定；
+   一次调用很慢时，后面的请求在队列中超时失败，这次请求的结果（以及调用者的补发）推迟到调用返回
+3. 发布时结果还没返回的报警先不带nvr信息发布，结果返回后由调用者补发一条只带nvr信息的更新消息（AlarmJsonWriter::write_nvr_update）
+*/
+class NvrRecorder
+{
+    public:
+        // 功能：启动一路录像，返回nvr是否成功，在录像线程中调用
+        typedef std::function<bool(int channel, const std::string &alarm_date_str)> RecordFunction;
+
+        explicit NvrRecorder(RecordFunction record, int timeout_ms = NVR_RECORD_TIMEOUT_MS,
+                             size_t queue_max = NVR_RECORD_QUEUE_MAX);
+        ~NvrRecorder();
+
+        // 功能：提交一次录像请求，立即返回；alarm_date_str为YYYYMMDDHHMMSSmmm格式的报警时间
+        std::future<NvrRecordResult> submit(int channel, const std::string &alarm_date_str);
+
+        NvrRecorderStats stats() const;
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Request
+        {
+            int channel;
+            std::string alarm_date_str;
+            Clock::time_point deadline;
+            std::promise<NvrRecordResult> result;
+        };
+
+        void worker();
+
+        RecordFunction m_record;
+        std::chrono::milliseconds m_timeout;
+        size_t m_queue_max;
+
+        std::deque<Request> m_queue;
+        NvrRecorderStats m_stats;
+        bool m_stop = false;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::thread m_thread;
+};
+
+#endif // _NVR_RECORDER_H_
@@ -38,7 +38,13 @@ typedef struct _detect_result_group_t
 
 int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h, int model_in_w, float conf_threshold, float nms_threshold,
             BOX_RECT pads, float scale_w, float scale_h, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
-             detect_result_group_t *group, std::vector<std::string> labels);
+             detect_result_group_t *group, std::vector<std::string> labels, int offset_x = 0, int offset_y = 0);
+
+// 跨切片合并时，交集占较小框面积的比例超过该值也认为是同一目标（被切片截断的框与完整框IoU较小）
+#define MERGE_IOS_THRESHOLD 0.8
+
+// 功能：合并多个检测结果组，按置信度从高到低对同类别的框做NMS，结果写入group
+int merge_detect_results(const std::vector<const detect_result_group_t *> &parts, float nms_threshold, detect_result_group_t *group);
 
 void deinitPostProcess();
 
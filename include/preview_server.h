@@ -0,0 +1,93 @@
+#ifndef _PREVIEW_SERVER_H_
+#define _PREVIEW_SERVER_H_
+
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+
+#include "opencv2/core/core.hpp"
+#include "AINode.h"
+
+// 预览服务的端口，浏览器打开 http://<设备IP>:PREVIEW_SERVER_PORT/ 查看各路摄像头；没有认证，需在AINode.h中定义 PREVIEW_SERVER_ENABLE 才启动
+#define PREVIEW_SERVER_PORT 8090
+// 预览图像的宽度，高度按原图比例计算
+#define PREVIEW_WIDTH 640
+#define PREVIEW_JPEG_QUALITY 60
+// 每个客户端的默认帧率和最大帧率，客户端可以用 ?fps= 指定
+#define PREVIEW_DEFAULT_FPS 5
+#define PREVIEW_MAX_FPS 15
+// 同时连接的客户端上限，每个客户端占用一个http工作线程
+#define PREVIEW_CLIENT_MAX 4
+
+namespace httplib
+{
+    class Server;
+}
+
+struct PreviewServerStats
+{
+    uint64_t frames_encoded = 0; // 编码的JPEG数
+    uint64_t frames_sent = 0;    // 发给客户端的JPEG数（多个客户端共用同一次编码）
+    uint64_t rejected = 0;       // 超过客户端上限被拒绝的连接数
+    int clients = 0;             // 当前连接的客户端数
+};
+
+/*
+HTTP MJPEG预览，不需要编译时打开 RTSP_ENCODE_ENABLE 或 SHOW_LOCAL_ENABLE 就能查看各路摄像头的检测结果：
+1. GET /preview/<摄像头编号>?fps=N 返回 multipart/x-mixed-replace 的MJPEG流，GET / 返回各路摄像头的列表
+2. 没有客户端时addFrame直接返回，不保存帧也不编码；有客户端时只保存帧的引用（不拷贝）
+3. JPEG在客户端取帧时才编码：缩放到 PREVIEW_WIDTH 后画OSD再编码，同一帧只编码一次，同一路的多个客户端共用
+4. 每个客户端按自己的帧率取帧，没有新帧时不重复发送
+*/
+class PreviewServer
+{
+    public:
+        PreviewServer(int camera_count, int port = PREVIEW_SERVER_PORT);
+        ~PreviewServer();
+
+        // 功能：在后台线程中监听，端口被占用等原因失败时返回false
+        bool start();
+        void stop();
+
+        // 功能：输入一路摄像头处理后的帧，objects为需要叠加显示的目标（原图坐标）
+        void addFrame(int camera_index, const cv::Mat &frame, const std::list<objectInfo> &objects);
+
+        PreviewServerStats stats() const;
+
+    private:
+        struct Camera
+        {
+            std::mutex mutex;
+            std::condition_variable cond;
+            cv::Mat frame; // 最新帧，与帧处理线程共享数据
+            std::list<objectInfo> objects;
+            uint64_t generation = 0;
+            int clients = 0;
+            std::mutex encode_mutex; // 同一帧只由一个客户端编码
+            std::shared_ptr<const std::vector<uchar>> jpeg; // 最近一次编码的结果
+            uint64_t jpeg_generation = 0;
+        };
+
+        // 功能：等待比generation新的帧并返回其JPEG，超时或退出时返回空
+        std::shared_ptr<const std::vector<uchar>> next_jpeg(Camera &camera, uint64_t &generation, int timeout_ms);
+        void register_handlers();
+
+        int m_port;
+        std::vector<std::unique_ptr<Camera>> m_cameras;
+        std::unique_ptr<httplib::Server> m_server;
+        std::thread m_listen_thread;
+        std::atomic<bool> m_quit{false};
+        std::atomic<int> m_clients{0};
+
+        std::atomic<uint64_t> m_frames_encoded{0};
+        std::atomic<uint64_t> m_frames_sent{0};
+        std::atomic<uint64_t> m_rejected{0};
+};
+
+#endif // _PREVIEW_SERVER_H_
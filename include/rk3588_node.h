@@ -28,6 +28,19 @@
 #include "AINode.h"
 #include "base64.h"
 #include "frame_concate.h"
+#include "snapshot_encoder.h"
+#include "stream_encoder.h"
+#include "stream_hub.h"
+#include "preview_server.h"
+#include "metrics.h"
+#include "frame_trace.h"
+#include "async_log.h"
+#include "frame_record.h"
+#include "byte_tracker.h"
+#include "alarm_filter.h"
+#include "roi_mask.h"
+#include "clock_service.h"
+#include "WKTParser.h"
 
 using namespace CGraph;
 using namespace dpool;
@@ -37,6 +50,38 @@ using namespace dpool;
 // 定义推理结果缓冲区的最大值
 #define ALGO_FRAME_RESULT_COUNT 120
 #define IMGSHOW_BUFFER_COUNT 10
+// 定义跟踪轨迹丢失后保留的帧数（按30fps计算，实际帧数随帧率缩放）
+#define TRACK_BUFFER_COUNT 30
+// ROI外接矩形向四周扩展的比例（相对外接矩形宽高），避免边界上的目标被截断
+#define ROI_CROP_MARGIN_RATIO 0.1
+// 扩展后的推理区域面积占整幅图像的比例不小于该值时，仍推理整幅图像
+#define ROI_CROP_AREA_RATIO 0.6
+// 推理线程池的线程数（模型上下文数），RK3588有3个NPU核心，上下文按顺序绑定到各个核心
+#define ALGO_INFER_THREAD_COUNT 3
+// 切片推理：推理区域按 SLICE_GRID_COLS x SLICE_GRID_ROWS 切片，相邻切片重叠 SLICE_OVERLAP_RATIO（相对切片宽高）
+#define SLICE_GRID_COLS 2
+#define SLICE_GRID_ROWS 2
+#define SLICE_OVERLAP_RATIO 0.2
+// 推理区域宽度小于该值时不切片
+#define SLICE_MIN_WIDTH 1920
+// 切片之外是否再推理一次整个推理区域，用于检出被切片截断的大目标
+#define SLICE_FULL_FRAME_ENABLE 1
+// 拼接画面的推流参数
+#define MOSAIC_STREAM_WIDTH 1920
+#define MOSAIC_STREAM_HEIGHT 1080
+#define MOSAIC_STREAM_PORT 8554
+#define MOSAIC_STREAM_NAME "stream"
+// 每路摄像头子码流的推流参数，流名称为 SUBSTREAM_NAME_PREFIX 加摄像头编号，例如 camera0
+#define SUBSTREAM_WIDTH 640
+#define SUBSTREAM_HEIGHT 360
+#define SUBSTREAM_FPS 10
+#define SUBSTREAM_PORT 8554
+#define SUBSTREAM_NAME_PREFIX "camera"
+// rk_vcodec的rtsp服务没有客户端连接的回调，无法按需acquire：为1时创建子码流并常开，为0时不创建子码流（p_stream_hub为空）
+#define SUBSTREAM_ALWAYS_ON 0
+// 不为空时把每路摄像头解码后的帧和检测结果录制到该目录下的 camera_<编号>.rec；
+// 摄像头地址配置为 replay://<文件> 时回放录制文件，参数见frame_record.h中的ReplayConfig
+#define FRAME_RECORD_DIR ""
 
 // 返回系统开始时间1970到现在经过的毫秒数
 #define TIME_STAMP_MS std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count()
@@ -94,11 +139,13 @@ static std::mutex quit_mutex;
     frame_process_thread 线程会从 p_algo_infer_pool 中获取推理结果，再把结果添加到 m_algo_frame_result 里。
 5. 帧处理与拼接阶段
     m_frame_buffer 中取出帧数据，还会查找对应的推理结果，把结果合并到帧数据里
-    若启用了 RTSP 编码（RTSP_ENCODE_ENABLE 被定义），会把处理后的帧添加到 p_encode_frame_concate 中进行拼接。
+    若启用了 RTSP 编码（RTSP_ENCODE_ENABLE 被定义），会把处理后的帧添加到 p_encode_frame_concate 中进行拼接，启用子码流时同一帧也交给 p_stream_hub 作为该路摄像头的子码流。
     若启用了本地显示（SHOW_LOCAL_ENABLE 被定义），并且该路摄像头的帧需要显示，就会把处理后的帧添加到 m_frame_concate_deque 中
+    若启用了HTTP预览（PREVIEW_SERVER_ENABLE 被定义），同一帧也交给 p_preview_server，有客户端时才编码为MJPEG
 6. 显示与编码阶段
     显示阶段：show_local_thread 线程会从 m_frame_concate_deque 中取出帧，依据显示布局进行缩放和拼接，然后使用 cv::imshow 显示。
-    编码阶段：encode_thread 线程会从 p_encode_frame_concate 中获取拼接后的帧，再使用 m_encoder 进行编码并传输到rtsp服务器中
+    编码阶段：encode_thread 线程会从 p_encode_frame_concate 中获取拼接后的帧，再使用 p_mosaic_encoder 进行编码并传输到rtsp服务器中；
+              子码流（SUBSTREAM_ALWAYS_ON 为1时）由 p_stream_hub 中每路一个线程缩放编码
 */
 
 
@@ -109,14 +156,16 @@ class RK3588Node : public CGraph::GNode
 
         CStatus run() override;  // 并不是单纯的run函数，而是继承自CGraph::GNode。
 
+        ~RK3588Node();
+
         static void signalHandler(int signum); 
 
         void handleSignal(int signum); 
 
     private:
         // 成员函数
-        // 功能：图像缩放并填充
-        cv::Mat resize_with_padding(const cv::Mat &inputImage, int targetWidth, int targetHeight); 
+        // 功能：图像缩放并填充，content_rect不为空时返回填充边以内有效图像的区域
+        cv::Mat resize_with_padding(const cv::Mat &inputImage, int targetWidth, int targetHeight, cv::Rect *content_rect = nullptr); 
 
         // 功能：监控文件的线程
         void monitor_file_thread(const std::string &filePath);
@@ -127,6 +176,8 @@ class RK3588Node : public CGraph::GNode
         bool contain_IP_address(const std::string &str, const std::string &ipAddress);
         // 功能：从指定的输入URL中获取视频帧
         void frame_get_thread(int input_url_index, std::string camera_url); // put
+        // 功能：回放录制文件代替从摄像头获取帧，所有回放结束后输出报告
+        void replay_frames(int camera_url_index, const std::string &camera_url);
         // 功能：对帧进行处理
         void frame_process_thread();  // get
         // 功能：对视频帧进行编码处理
@@ -145,10 +196,21 @@ class RK3588Node : public CGraph::GNode
         // 功能：定时输出当前时间，内存使用情况和各个缓冲区大小
         void time_memory_thread();
 
+        // 功能：获取该路摄像头的推理区域（ROI外接矩形加边距），返回空矩形表示推理整幅图像
+        cv::Rect get_infer_roi(int camera_index, const cv::Size &img_size);
+        // 功能：计算切片推理的各个切片区域，不需要切片时tiles为空
+        void get_slice_rects(const cv::Size &img_size, const cv::Rect &roi_rect, std::vector<cv::Rect> &tiles);
+        // 功能：将一帧提交到推理线程池，开启切片推理时各切片作为一个请求提交
+        int infer_submit(const inputData &input_data);
+
         // 功能：将配置拷贝到AI管道中
         void camera_setting_to_node(int camera_index, pipelineInfo &output);
-        // 功能：对浮点数限制位数
-        std::string formatFloatValue(float val, int fixed);
+        // 功能：获取该路摄像头的配置，每路摄像头只在配置重新加载后创建一次
+        std::shared_ptr<const settingInfo> get_camera_setting(int camera_index);
+        // 功能：注册队列长度等抓取时才读取的指标
+        void register_metrics();
+        // 功能：将检测结果转换为需要叠加显示（OSD）的目标
+        void get_osd_objects(const detect_result_group_t &group, std::list<objectInfo> &objects);
         
         // 变量
         bool edgeI_data_update = false;
@@ -165,9 +227,15 @@ class RK3588Node : public CGraph::GNode
         std::unique_ptr< FrameConcate > p_encode_frame_concate; // 指向拼接帧的指针,类型为视频帧拼接类
         // 单纯定义，并没有初始化，上面俩在代码中已经初始化了
         // std::shared_ptr<RKDecoder> p_decoder; // 解码器指针(共享智能指针)，因为有多个frame_get_thread线程去从rtsp解码
-        // std::shared_ptr<RKEncoder> p_encoder; // 编码器指针(共享指针) 可是只有一个encode_thread()线程去调用 问题：
-        // 在这里直接定义，作为共享指针，因为在run函数中用于open编码, 在encode_thread中用于写入拼接后的帧。 先写入后编码上传推流
-        std::shared_ptr<RKEncoder> p_encoder = std::make_shared<RKEncoder>();
+        // 拼接画面的编码器，在run函数中open，在encode_thread中写入拼接后的帧
+        std::unique_ptr<StreamEncoder> p_mosaic_encoder;
+        // 每路摄像头的子码流，与拼接画面共用帧处理线程输出的帧
+        std::unique_ptr<StreamHub> p_stream_hub;
+        // HTTP MJPEG预览服务
+        std::unique_ptr<PreviewServer> p_preview_server;
+        // 每路摄像头的录制文件，FRAME_RECORD_DIR为空时没有
+        std::vector<std::unique_ptr<FrameRecorder>> m_frame_recorders;
+        bool m_replay_enabled = false; // 有摄像头地址是 replay:// 时统计回放报告
         
         // 整型变量，定义fps打印间隔时间
         int fps_print_interval_ms = 5 * 1000;
@@ -200,7 +268,20 @@ class RK3588Node : public CGraph::GNode
 
         // 图
         std::map<int, std::string> m_track_info;
-        // std::map<int, std::shared_ptr<BYTETracker>> m_tracker_per_channel;
+        std::map<int, std::shared_ptr<BYTETracker>> m_tracker_per_channel; // 每路摄像头一个跟踪器
+        std::vector<Object> m_track_objects; // 跟踪器输入，每帧复用
+        std::vector<AlarmFilter> m_alarm_filter_per_channel; // 每路摄像头的报警抑制状态
+        std::vector<RoiMask> m_roi_mask_per_channel; // 每路摄像头预编译的ROI，报警抑制只对ROI内的目标计时
+
+        // 每路摄像头的推理区域，只在roi或图像尺寸变化时重新计算；每个元素只被对应的帧获取线程访问
+        struct InferRoi
+        {
+            std::string roi;
+            cv::Size img_size;
+            cv::Rect rect;
+        };
+        std::vector<InferRoi> m_infer_roi_per_channel;
+        std::vector<std::shared_ptr<const settingInfo>> m_setting_per_channel; // 每路摄像头共享的只读配置，只在结果处理线程中访问
 
         // 模板函数，清空队列容器中的内容，队列中传入的数据类型不一样。
         // 当一个成员函数被声明为 const 时，它不能修改调用对象的非 mutable 成员变量，可以修改通过引用传入进来的，并非直接修改调用对象的成员变量。
@@ -208,7 +289,8 @@ class RK3588Node : public CGraph::GNode
         void check_and_clear_buffer(std::deque<dequeType> &buffer, size_t buffer_count, const std::string &buffer_name) const {
             if(buffer.size() >= buffer_count)
             {
-                std::cout << "WARNING: " << buffer_name << " size = " << buffer.size() << " is overload" << std::endl;
+                ALOG_EVERY_MS(WARNING, 1000) << buffer_name << " size = " << buffer.size() << " is overload";
+                MetricsRegistry::global().counter("seaway_dropped_total", "Items dropped, by reason.", metrics_label("reason", buffer_name)).inc(buffer.size());
                 // 移除队列所有元素，队列大小为0，但是并不会释放双端队列内部为存储元素而预先分配的内存（size 变为 0，但 capacity 可能保持不变）。
                 buffer.clear(); 
                 // std::queue<dequeType>()创建一个临时的空双端队列，交换内存，临时队列有了内容，但是没有获取原队列预先分配的内存。
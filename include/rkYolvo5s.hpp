@@ -9,6 +9,7 @@
 #include "rknn/preprocess.h"
 #include "rknn/postprocess.h"
 #include "opencv2/core/core.hpp"
+#include "metrics.h"
 /*
 typedef struct _BOX_RECT
 {
@@ -43,6 +44,10 @@ struct inputData{
     cv::Mat frame_data;
     int frame_index;
     int64_t frame_time_stamp;
+    cv::Rect roi_rect; // 推理区域（原图坐标），为空时推理整幅图像
+    uint64_t frame_seq = 0;   // 该路摄像头的解码帧序号，录制和回放时用来对应帧和检测结果
+    uint64_t trace_id = 0;    // 帧追踪id，0表示未采样，见frame_trace.h
+    int64_t trace_ts_us = 0;  // 进入当前队列的时间
 };
 
 //功能：推理结束后的输出结构体
@@ -52,8 +57,14 @@ struct dataEncode{
     bool isInit = false;
     bool isNeedTrack = false;
     int64_t frame_time_stamp;
+    uint64_t frame_seq = 0;
+    uint64_t trace_id = 0;
+    int64_t trace_ts_us = 0;
 };
 
+// 功能：合并同一帧各个切片的推理结果，跨切片做一次NMS，图像、时间戳和帧索引取第一个切片的
+dataEncode merge_slice_results(std::vector<dataEncode> &parts, float nms_threshold);
+
 // static修饰函数的作用域也被限制在当前源文件内
 static void dump_tensor_attr(rknn_tensor_attr *attr);
 
@@ -87,6 +98,9 @@ class rkYolov5s
 
         float nms_threshold, conf_threshold;
 
+        int core_index = 0; // 绑定的NPU核心
+        Histogram *infer_latency = nullptr; // 该核心的推理耗时
+
         void load_label(const std::string &label_path, std::vector<std::string> &labels);
 
 
@@ -2,12 +2,15 @@
 #define RKNNPOOL_H
 
 #include "ThreadPool.hpp"
+#include "metrics.h"
+#include "async_log.h"
 #include <vector>
 #include <iostream>
 #include <chrono>
 #include <mutex>
 #include <queue>
 #include <memory>
+#include <future>
 
 // 注： 该模板类的三个模板参数并不代表构造函数的三个参数传入
 // 实例化举例：rknnPool<rkYolov5s, inputData, dataEncode> 
@@ -25,6 +28,10 @@ class rknnPool
 
         int put(inputType inputData); // 将推理任务添加进
 
+        // 将一个逻辑请求拆分成多个推理任务，分发到线程池中并行推理，merge在get时将各任务的结果合并成一个结果
+        template <typename MergeFunc>
+        int putBatch(const std::vector<inputType> &inputDatas, MergeFunc merge);
+
         int get(outputType &outputData); // 获取任务推理的结果
 
         ~rknnPool();
@@ -103,7 +110,8 @@ int rknnPool<rknnModel, inputType, outputType>::put(inputType inputdata)
     std::unique_lock<std::mutex> lock(queueMutex); // 对队列上锁
     if(futures.size() >= queue_thresh)
     {
-        std::cout << "input data is too much ,please reduce the input" << std::endl;
+        ALOG_EVERY_MS(WARNING, 1000) << "input data is too much ,please reduce the input";
+        MetricsRegistry::global().counter("seaway_dropped_total", "Items dropped, by reason.", metrics_label("reason", "infer queue")).inc(futures.size());
         std::queue<std::future<outputType>> temp_empty_queue;
         swap(temp_empty_queue, futures); // 交换两个队列的内容，存储数据
         return 0;
@@ -115,6 +123,37 @@ int rknnPool<rknnModel, inputType, outputType>::put(inputType inputdata)
     return 0;
 }
 
+// 功能：将一个逻辑请求的多个推理任务提交到线程池，结果队列中只占一个位置，保证结果顺序不变
+template <typename rknnModel, typename inputType, typename outputType>
+template <typename MergeFunc>
+int rknnPool<rknnModel, inputType, outputType>::putBatch(const std::vector<inputType> &inputdatas, MergeFunc merge)
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+    if(futures.size() >= queue_thresh)
+    {
+        ALOG_EVERY_MS(WARNING, 1000) << "input data is too much ,please reduce the input";
+        MetricsRegistry::global().counter("seaway_dropped_total", "Items dropped, by reason.", metrics_label("reason", "infer queue")).inc(futures.size());
+        std::queue<std::future<outputType>> temp_empty_queue;
+        swap(temp_empty_queue, futures);
+        return 0;
+    }
+
+    std::vector<std::future<outputType>> parts;
+    parts.reserve(inputdatas.size());
+    for(const inputType &inputdata : inputdatas)
+        parts.push_back(pool->submit(&rknnModel::infer, models[this->getModelId()], inputdata));
+
+    // 合并延迟到get时在调用线程执行，不占用推理线程
+    futures.push(std::async(std::launch::deferred, [merge](std::vector<std::future<outputType>> parts) {
+        std::vector<outputType> outputs;
+        outputs.reserve(parts.size());
+        for(auto &part : parts)
+            outputs.push_back(part.get());
+        return merge(outputs);
+    }, std::move(parts)));
+    return 0;
+}
+
 // 功能：从队列中获取推理结果，并将其存储到outputData中
 // std::queue<std::future<outputType>> futures; 所以定义futures_data是为了取队列头元素的
 template <typename rknnModel, typename inputType, typename outputType>
@@ -128,6 +167,7 @@ int rknnPool<rknnModel, inputType, outputType>::get(outputType &outputdata)
 
         if(futures.size() >= queue_thresh)
         {
+            MetricsRegistry::global().counter("seaway_dropped_total", "Items dropped, by reason.", metrics_label("reason", "infer queue")).inc(futures.size());
             std::queue<std::future<outputType>> temp_empty_queue; // 空结果队列
             swap(temp_empty_queue, futures); // 为了高效清空futures,避免了逐个元素处理的开销
             return 1;
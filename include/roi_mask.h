@@ -0,0 +1,61 @@
+#ifndef _ROI_MASK_H_
+#define _ROI_MASK_H_
+
+#include <string>
+#include <vector>
+#include "opencv2/core/core.hpp"
+#include "WKTParser.h"
+
+// ROI掩码最长边的像素数，掩码按比例缩小到该尺寸以内
+#define ROI_MASK_MAX_SIDE 320
+
+/*
+预编译的ROI，替代每个目标都重新解析WKT字符串并调用cv::pointPolygonTest：
+1. 每路摄像头的ROI只在配置（roi字符串或图像尺寸）变化时解析一次，支持POLYGON和MULTIPOLYGON，内环为排除区域
+2. 先用所有区域外接矩形的并集快速排除
+3. 再查缩小后的掩码：完全在内部/外部的格子直接得出结果，只有边界经过的格子才回退到WKTParser::inZone精确判断
+*/
+class RoiMask
+{
+    public:
+        RoiMask() : m_compiled(false), m_valid(false), m_simple(false), m_scale(1.f) {}
+
+        // 功能：编译ROI，roi为WKT多边形或多多边形字符串，img_size为原图尺寸；与上次编译的配置相同时直接返回
+        // 返回：ROI是否有效
+        bool compile(const std::string &roi, const cv::Size &img_size);
+
+        // 功能：判断点是否在ROI内（包括边界）
+        bool contains(const cv::Point &point) const;
+
+        // 功能：判断矩形框是否在ROI的某个区域内，与WKTParser::inZones(zones, rect)结果一致
+        bool contains(const cv::Rect &rect) const;
+
+        // 功能：批量判断一帧的所有框，results[i]表示rects[i]是否在ROI内；掩码无法判定的框一起交给WKTParser::inZones
+        void contains(const std::vector<cv::Rect> &rects, std::vector<uchar> &results);
+
+        bool valid() const { return m_valid; }
+
+    private:
+        enum MaskValue { MASK_OUTSIDE = 0, MASK_EDGE = 128, MASK_INSIDE = 255 };
+
+        // 功能：查询点所在掩码格子的值，不在外接矩形内的点返回MASK_OUTSIDE
+        uchar lookup(const cv::Point &point) const;
+        // 功能：只用掩码判断矩形框，返回1在ROI内，0不在，-1需要精确判断
+        int classify(const cv::Rect &rect) const;
+
+        std::string m_roi;      // 已编译的roi字符串，用于判断配置是否变化
+        cv::Size m_img_size;    // 已编译的图像尺寸
+        bool m_compiled;
+        bool m_valid;
+        VectorZone m_zones;     // 反归一化后的区域，边界格子精确判断时使用
+        bool m_simple;          // 只有一个区域且没有内环，此时角点全在内部的格子即可判定矩形在ROI内
+        cv::Rect m_bbox;        // 所有区域外接矩形的并集（包含右边界和下边界）
+        float m_scale;          // 原图坐标到掩码坐标的缩放比例
+        cv::Mat m_mask;         // 覆盖m_bbox的缩小掩码，值为MaskValue
+        // 批量判断时复用的缓冲区：需要精确判断的框、它们在输入中的下标和判断结果
+        std::vector<cv::Rect> m_exact_rects;
+        std::vector<size_t> m_exact_index;
+        std::vector<uchar> m_exact_results;
+};
+
+#endif // _ROI_MASK_H_
@@ -0,0 +1,81 @@
+#ifndef _SNAPSHOT_ENCODER_H_
+#define _SNAPSHOT_ENCODER_H_
+
+#include <string>
+#include <list>
+#include <vector>
+#include <memory>
+#include <future>
+#include <mutex>
+#include "opencv2/core/core.hpp"
+#include "ThreadPool.hpp"
+#include "AINode.h"
+
+// 编码线程数，一次报警的原图和缩略图分别是一个任务
+#define SNAPSHOT_ENCODER_THREAD_COUNT 4
+// 报警图片的JPEG质量
+#define SNAPSHOT_JPEG_QUALITY 50
+// 缩略图的缩小倍数
+#define SNAPSHOT_THUMBNAIL_SCALE 4
+// 已提交但未发布的报警上限，超过时发布线程阻塞等待最早的报警编码完成
+#define SNAPSHOT_PENDING_MAX 16
+// 空闲JPEG缓冲区的上限，待发布的报警每个占用两个缓冲区
+#define SNAPSHOT_JPEG_POOL_MAX (SNAPSHOT_PENDING_MAX * 2)
+
+// 功能：一次报警的编码任务，原图和缩略图并行编码，结果都是JPEG数据，发布时再直接base64编码到消息中
+struct SnapshotJob
+{
+    std::future<std::vector<uchar>> full;
+    std::future<std::vector<uchar>> thumbnail;
+
+    // 功能：两张图是否都已编码完成，不阻塞
+    bool ready() const;
+};
+
+// 功能：JPEG输出缓冲区池，imencode写入取出的缓冲区，发布后归还，分辨率不变时不再分配内存
+class JpegBufferPool
+{
+    public:
+        // 功能：取出一个空闲缓冲区，没有时返回空的缓冲区
+        std::vector<uchar> acquire();
+        // 功能：归还缓冲区，保留容量；空闲缓冲区已满时直接释放
+        void release(std::vector<uchar> &&buffer);
+
+    private:
+        std::mutex m_mutex;
+        std::vector<std::vector<uchar>> m_free;
+};
+
+/*
+报警图片编码线程池，替代AppMqttNode中逐个报警串行的画框、JPEG编码和base64：
+1. 原图和缩略图是两个独立任务：原图在原分辨率上画框后编码，缩略图先缩小再按比例画框后编码，不需要先拷贝一份画好框的原图
+2. 每个线程画框用的图像缓冲区是thread_local的，分辨率不变时不再分配内存
+3. JPEG结果写入缓冲区池中的缓冲区，调用者发布后用recycle归还；交给minio上传的原图不再归还
+4. 提交后立即返回，调用者按摄像头维护待发布队列，保证同一路摄像头的报警按顺序发布
+*/
+class SnapshotEncoder
+{
+    public:
+        explicit SnapshotEncoder(int thread_num = SNAPSHOT_ENCODER_THREAD_COUNT);
+
+        // 功能：提交一次报警的编码，objects为需要画框的目标，image为共享的只读原图
+        SnapshotJob submit(const std::shared_ptr<const cv::Mat> &image, const std::list<objectInfo> &objects);
+
+        // 功能：归还SnapshotJob编码结果的缓冲区，下次编码复用
+        void recycle(std::vector<uchar> &&jpeg);
+
+        // 功能：在图像上画出目标框和标签，scale为图像相对原图的缩放比例
+        static void draw_objects(cv::Mat &image, const std::list<objectInfo> &objects, float scale);
+        // 功能：宽高缩放比例不同时画框（拼接画面的格子），线宽和字号按较小的比例
+        static void draw_objects(cv::Mat &image, const std::list<objectInfo> &objects, float scale_x, float scale_y);
+
+    private:
+        static std::vector<uchar> encode_full(JpegBufferPool *buffers, std::shared_ptr<const cv::Mat> image, std::shared_ptr<const std::list<objectInfo>> objects);
+        static std::vector<uchar> encode_thumbnail(JpegBufferPool *buffers, std::shared_ptr<const cv::Mat> image, std::shared_ptr<const std::list<objectInfo>> objects);
+        static std::vector<uchar> encode_jpeg(JpegBufferPool *buffers, const cv::Mat &image);
+
+        JpegBufferPool m_buffers; // 在线程池之前声明，析构晚于编码线程
+        std::unique_ptr<dpool::ThreadPool> m_pool;
+};
+
+#endif // _SNAPSHOT_ENCODER_H_
@@ -0,0 +1,75 @@
+#ifndef _STREAM_ENCODER_H_
+#define _STREAM_ENCODER_H_
+
+#include <string>
+#include <memory>
+#include "opencv2/core/core.hpp"
+#include "opencv2/videoio.hpp"
+
+// 使用RK3588的MPP硬件编码（rk_vcodec）推流；注释掉后使用软件编码，用于在x86上调试
+#define STREAM_ENCODER_RK_ENABLE
+// 软件编码的GStreamer管道，参数依次为：关键帧间隔、rtsp服务端口、流名称；推流到外部的rtsp服务（如mediamtx）
+#define SOFTWARE_STREAM_PIPELINE "appsrc ! videoconvert ! x264enc tune=zerolatency speed-preset=ultrafast key-int-max=%d ! " \
+                                 "rtspclientsink location=rtsp://127.0.0.1:%d/%s"
+
+#ifdef STREAM_ENCODER_RK_ENABLE
+#include "rk_vcodec/rkencode.h"
+#endif
+
+// 功能：一路推流的参数
+struct StreamConfig
+{
+    std::string name; // 流名称，rtsp地址的路径
+    int width = 1920;
+    int height = 1080;
+    int fps = 25;
+    int port = 8554; // rtsp服务端口
+};
+
+/*
+推流编码器的抽象，拼接画面和每路摄像头的子码流共用：
+1. open时按StreamConfig创建编码会话，write输入的图像必须是配置的分辨率（BGR）
+2. RKStreamEncoder使用rk_vcodec的硬件编码，SoftwareStreamEncoder使用OpenCV的GStreamer后端
+3. 编码器不要求线程安全，每个编码器只在一个线程中使用
+*/
+class StreamEncoder
+{
+    public:
+        virtual ~StreamEncoder() = default;
+
+        // 功能：创建编码会话，失败返回false
+        virtual bool open(const StreamConfig &config) = 0;
+        // 功能：编码一帧并推流
+        virtual bool write(const cv::Mat &frame) = 0;
+        // 功能：关闭编码会话，释放编码器资源
+        virtual void close() = 0;
+};
+
+#ifdef STREAM_ENCODER_RK_ENABLE
+class RKStreamEncoder : public StreamEncoder
+{
+    public:
+        bool open(const StreamConfig &config) override;
+        bool write(const cv::Mat &frame) override;
+        void close() override;
+
+    private:
+        std::shared_ptr<RKEncoder> m_encoder;
+};
+#endif
+
+class SoftwareStreamEncoder : public StreamEncoder
+{
+    public:
+        bool open(const StreamConfig &config) override;
+        bool write(const cv::Mat &frame) override;
+        void close() override;
+
+    private:
+        cv::VideoWriter m_writer;
+};
+
+// 功能：按 STREAM_ENCODER_RK_ENABLE 创建硬件或软件编码器，编码会话在open时才创建
+std::unique_ptr<StreamEncoder> create_stream_encoder();
+
+#endif // _STREAM_ENCODER_H_
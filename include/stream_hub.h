@@ -0,0 +1,87 @@
+#ifndef _STREAM_HUB_H_
+#define _STREAM_HUB_H_
+
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+#include "opencv2/core/core.hpp"
+#include "AINode.h"
+#include "stream_encoder.h"
+
+// 没有客户端后保持编码会话的时间（毫秒），客户端短时间内重连时不重新创建编码器
+#define STREAM_IDLE_CLOSE_MS 5000
+// 编码会话创建失败后的重试间隔（毫秒）
+#define STREAM_REOPEN_INTERVAL_MS 3000
+
+struct StreamHubStats
+{
+    uint64_t opened = 0;          // 创建编码会话的次数
+    uint64_t open_failed = 0;     // 创建编码会话失败的次数
+    uint64_t frames_encoded = 0;  // 编码的帧数
+    int active = 0;               // 当前已创建编码会话的子码流数
+};
+
+/*
+每路摄像头的子码流，与拼接画面共用帧处理线程输出的同一帧：
+1. addFrame只保存帧的引用（cv::Mat共享数据，不拷贝）和OSD目标，帧处理后的原图是只读的
+2. 每路子码流一个线程，按配置的帧率取最新帧，缩放到配置的分辨率后画OSD再编码，没有新帧时不重复编码
+3. 编码会话按需创建：acquire/release对客户端计数，第一个客户端到来时才创建编码器，
+   最后一个客户端离开 STREAM_IDLE_CLOSE_MS 后关闭；没有客户端的子码流addFrame直接返回，不占用任何资源
+4. rk_vcodec的rtsp服务没有客户端连接的回调，RK3588Node只在 SUBSTREAM_ALWAYS_ON 时创建StreamHub并为每路acquire一次；
+   能感知客户端的服务（如自带rtsp服务的编码器）再按连接调用acquire/release
+*/
+class StreamHub
+{
+    public:
+        typedef std::function<std::unique_ptr<StreamEncoder>()> EncoderFactory;
+
+        // 功能：configs为每路摄像头的子码流参数，下标为摄像头编号
+        StreamHub(const std::vector<StreamConfig> &configs, EncoderFactory factory = create_stream_encoder);
+        ~StreamHub();
+
+        // 功能：输入一路摄像头处理后的帧，objects为需要叠加显示的目标（原图坐标）
+        void addFrame(int camera_index, const cv::Mat &frame, const std::list<objectInfo> &objects);
+
+        // 功能：该路子码流的客户端连接和断开，按计数创建和关闭编码会话
+        void acquire(int camera_index);
+        void release(int camera_index);
+
+        // 功能：流名称对应的摄像头编号，没有时返回-1
+        int find(const std::string &name) const;
+
+        StreamHubStats stats() const;
+
+    private:
+        struct Substream
+        {
+            StreamConfig config;
+            std::mutex mutex;
+            std::condition_variable cond;
+            cv::Mat frame; // 最新帧，与帧处理线程共享数据
+            std::list<objectInfo> objects;
+            uint64_t generation = 0;
+            int clients = 0;
+            std::thread worker;
+        };
+
+        void substream_thread(Substream &substream);
+
+        EncoderFactory m_factory;
+        std::vector<std::unique_ptr<Substream>> m_substreams;
+        std::atomic<bool> m_quit{false};
+
+        std::atomic<uint64_t> m_opened{0};
+        std::atomic<uint64_t> m_open_failed{0};
+        std::atomic<uint64_t> m_frames_encoded{0};
+        std::atomic<int> m_active{0};
+};
+
+#endif // _STREAM_HUB_H_
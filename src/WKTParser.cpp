@@ -1,6 +1,11 @@
 #include "WKTParser.h"
 #include <iostream>
 #include <exception>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
 
 // typedef boost::geometry::model::d2::point_xy<double> Boost_Point;
 // 主要用于判断一个点或者矩阵是否在一个多边形内
@@ -13,6 +18,184 @@ WKTParser::~WKTParser() {
 
 }
 
+namespace {
+
+// 在原字符串上移动的游标，解析过程中不产生子串
+struct WktCursor {
+    const char *p;
+    const char *end;
+
+    explicit WktCursor(const std::string &src) : p(src.c_str()), end(src.c_str() + src.size()) {}
+
+    void skip_space() {
+        while (p < end && std::isspace(static_cast<unsigned char>(*p))) p++;
+    }
+
+    bool eat(char ch) {
+        skip_space();
+        if (p < end && *p == ch) {
+            p++;
+            return true;
+        }
+        return false;
+    }
+
+    // 匹配关键字（不区分大小写），关键字后不能紧跟字母，避免POLYGON匹配到POLYGONZ之类
+    bool keyword(const char *word) {
+        skip_space();
+        const char *q = p;
+        for (; *word; word++, q++) {
+            if (q >= end || std::toupper(static_cast<unsigned char>(*q)) != *word) return false;
+        }
+        if (q < end && std::isalpha(static_cast<unsigned char>(*q))) return false;
+        p = q;
+        return true;
+    }
+
+    // 原字符串以'\0'结尾，strtod不会越界
+    bool number(double &value) {
+        skip_space();
+        char *next = nullptr;
+        value = std::strtod(p, &next);
+        if (next == p || next > end) return false;
+        p = next;
+        return true;
+    }
+
+    bool finished() {
+        skip_space();
+        return p == end;
+    }
+};
+
+// 解析一个环 "(x y, x y, ...)"，要求至少4个点且首尾点相等
+bool read_wkt_ring(WktCursor &cursor, const cv::Size &size, VectorPoint &ring) {
+    ring.clear();
+    if (!cursor.eat('(')) {
+        return false;
+    }
+
+    double first_x = 0, first_y = 0, x = 0, y = 0;
+    do {
+        if (!cursor.number(x) || !cursor.number(y)) {
+            return false;
+        }
+        if (ring.empty()) {
+            first_x = x;
+            first_y = y;
+        }
+        ring.emplace_back(static_cast<int>(x * size.width), static_cast<int>(y * size.height));
+    } while (cursor.eat(','));
+
+    if (!cursor.eat(')')) {
+        return false;
+    }
+
+    // 点数量不正确或首尾点不相等，不是合法的多边形
+    return ring.size() >= 4 && first_x == x && first_y == y;
+}
+
+// 解析一个多边形 "((外环), (内环), ...)"，rings中已有的空间会被复用
+bool read_wkt_rings(WktCursor &cursor, const cv::Size &size, std::vector<VectorPoint> &rings) {
+    if (!cursor.eat('(')) {
+        return false;
+    }
+
+    size_t count = 0;
+    do {
+        if (rings.size() <= count) {
+            rings.emplace_back();
+        }
+        if (!read_wkt_ring(cursor, size, rings[count])) {
+            return false;
+        }
+        count++;
+    } while (cursor.eat(','));
+    rings.resize(count);
+
+    return cursor.eat(')');
+}
+
+bool build_zone(const std::vector<VectorPoint> &rings, GeoZone &zone) {
+    if (!WKTParser::buildRing(rings.front(), zone.outer)) {
+        return false;
+    }
+
+    zone.holes.resize(rings.size() - 1);
+    for (size_t i = 1; i < rings.size(); i++) {
+        if (!WKTParser::buildRing(rings[i], zone.holes[i - 1])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// 矩形是否完全落在外接矩形内（包括右边界和下边界）
+inline bool rect_in_bbox(const cv::Rect &bbox, const cv::Rect &rect) {
+    return rect.x >= bbox.x && rect.y >= bbox.y &&
+           rect.x + rect.width <= bbox.x + bbox.width &&
+           rect.y + rect.height <= bbox.y + bbox.height;
+}
+
+// 线段是否经过矩形内部（不含边界）：先把线段裁剪到闭矩形内（Liang-Barsky），
+// 裁剪后的线段长度大于0且中点在矩形内部时经过内部；只沿矩形边界走或只碰到角点的不算
+bool edge_crosses_rect(const GeoEdge &edge, const cv::Rect &rect) {
+    const double x0 = edge.x0, y0 = edge.y0;
+    const double dx = edge.x1 - edge.x0, dy = edge.y1 - edge.y0;
+    const double p[4] = {-dx, dx, -dy, dy};
+    const double q[4] = {x0 - rect.x, rect.x + rect.width - x0, y0 - rect.y, rect.y + rect.height - y0};
+    double t0 = 0, t1 = 1;
+    for (int i = 0; i < 4; i++) {
+        if (p[i] == 0) {
+            if (q[i] < 0) {
+                return false;
+            }
+            continue;
+        }
+        double t = q[i] / p[i];
+        if (p[i] < 0) {
+            t0 = std::max(t0, t);
+        } else {
+            t1 = std::min(t1, t);
+        }
+        if (t0 >= t1) {
+            return false;
+        }
+    }
+    double mx = x0 + dx * (t0 + t1) / 2, my = y0 + dy * (t0 + t1) / 2;
+    return mx > rect.x && mx < rect.x + rect.width && my > rect.y && my < rect.y + rect.height;
+}
+
+// 与cv::pointPolygonTest(polygon, point, false) >= 0 结果一致，整数计算且不分配内存
+bool point_in_points(const VectorPoint &polygon, int px, int py) {
+    size_t count = polygon.size();
+    if (count == 0) {
+        return false;
+    }
+
+    const int64_t x = px, y = py;
+    bool inside = false;
+    for (size_t i = 0, j = count - 1; i < count; j = i++) {
+        const cv::Point &p0 = polygon[j];
+        const cv::Point &p1 = polygon[i];
+        int64_t side = (static_cast<int64_t>(p1.x) - p0.x) * (y - p0.y) - (static_cast<int64_t>(p1.y) - p0.y) * (x - p0.x);
+        if (side == 0 && x >= std::min(p0.x, p1.x) && x <= std::max(p0.x, p1.x) &&
+            y >= std::min(p0.y, p1.y) && y <= std::max(p0.y, p1.y)) {
+            return true;
+        }
+        if ((p0.y > y) != (p1.y > y)) {
+            if ((p1.y > p0.y) ? (side > 0) : (side < 0)) {
+                inside = !inside;
+            }
+        }
+    }
+
+    return inside;
+}
+
+}  // namespace
+
 bool WKTParser::read_wkt_point(const std::string& wkt, point& pt) {
     std::vector<std::string> tokens;
     // 按照空格和括号分割 WKT 格式字符串
@@ -90,48 +273,57 @@ bool WKTParser::parseLinestring(const std::string &src, VectorPoint *pvp) {
 }
 
 bool WKTParser::parsePolygon(const std::string& src, VectorPoint* pvp) {
-    std::string wkt = src;
-    std::vector<std::vector<double>> points;
-
-    // 解析 WKT 格式字符串
-    size_t pos_begin = wkt.find_first_of("("), pos_end = 0;
-    if (pos_begin == std::string::npos) {
-        // 缺少左括号，解析失败
+    WktCursor cursor(src);
+    std::vector<VectorPoint> rings;
+    if (!cursor.keyword("POLYGON") || !read_wkt_rings(cursor, m_size, rings) || !cursor.finished()) {
         return false;
     }
 
-    pos_begin++;
-    pos_end = wkt.find_first_of(",)", pos_begin + 1);
-    while (pos_end != std::string::npos) {
-        std::string token = wkt.substr(pos_begin + 1, pos_end - pos_begin - 1);
-        if(token.empty())
-            break;
-        token = "(" + token + ")";
-        point pt;
-        if (!read_wkt_point(token, pt)) {
-            // 解析当前点失败，解析失败
-            return false;
-        }
-        points.push_back({pt.x, pt.y});
+    // 只返回外环，内环通过parseZones获取
+    m_polygons.push_back(rings.front());
 
-        pos_begin = pos_end;
-        pos_end = wkt.find_first_of(",)", pos_begin + 1);
+    if (pvp) {
+        *pvp = rings.front();
     }
 
-    if (points.size() < 4 || points.front() != points.back()) {
-        // 点数量不正确或首尾点不相等，不是合法的多边形，解析失败
+    return true;
+}
+
+bool WKTParser::parseZones(const std::string &src, VectorZone *zones) {
+    WktCursor cursor(src);
+    std::vector<VectorPoint> rings;
+    VectorZone parsed;
+
+    if (cursor.keyword("MULTIPOLYGON")) {
+        if (!cursor.eat('(')) {
+            return false;
+        }
+        do {
+            parsed.emplace_back();
+            if (!read_wkt_rings(cursor, m_size, rings) || !build_zone(rings, parsed.back())) {
+                return false;
+            }
+        } while (cursor.eat(','));
+        if (!cursor.eat(')')) {
+            return false;
+        }
+    } else if (cursor.keyword("POLYGON")) {
+        parsed.emplace_back();
+        if (!read_wkt_rings(cursor, m_size, rings) || !build_zone(rings, parsed.back())) {
+            return false;
+        }
+    } else {
         return false;
     }
 
-    VectorPoint vp(points.size());
-    for (size_t i = 0; i < points.size(); i++) {
-        vp[i].x = points[i][0] * m_size.width;
-        vp[i].y = points[i][1] * m_size.height;
+    if (!cursor.finished()) {
+        return false;
     }
-    m_polygons.push_back(vp);
 
-    if (pvp) {
-        *pvp = vp;
+    m_zones.insert(m_zones.end(), parsed.begin(), parsed.end());
+
+    if (zones) {
+        zones->insert(zones->end(), parsed.begin(), parsed.end());
     }
 
     return true;
@@ -182,13 +374,211 @@ bool WKTParser::polygon2Rect(const VectorPoint &polygon, cv::Rect &rect) {
 }
 
 bool WKTParser::inPolygon(const VectorPoint &polygon, const cv::Point &point) {
-    cv::Point2f pf(point.x, point.y);
-    return (cv::pointPolygonTest(polygon, pf, false) >= 0);
+    return point_in_points(polygon, point.x, point.y);
 }
 
 bool WKTParser::inPolygon(const VectorPoint &polygon, const cv::Rect &rect) {
-    return (WKTParser::inPolygon(polygon, rect.tl()) &&
-            WKTParser::inPolygon(polygon, cv::Point(rect.x + rect.width, rect.y)) &&
-            WKTParser::inPolygon(polygon, rect.br()) &&
-            WKTParser::inPolygon(polygon, cv::Point(rect.x, rect.y + rect.height)));
+    if (polygon.empty()) {
+        return false;
+    }
+
+    // 先用外接矩形快速排除，再判断四个角点
+    cv::Rect bbox;
+    WKTParser::polygon2Rect(polygon, bbox);
+    if (!rect_in_bbox(bbox, rect)) {
+        return false;
+    }
+
+    return (point_in_points(polygon, rect.x, rect.y) &&
+            point_in_points(polygon, rect.x + rect.width, rect.y) &&
+            point_in_points(polygon, rect.x + rect.width, rect.y + rect.height) &&
+            point_in_points(polygon, rect.x, rect.y + rect.height));
+}
+
+bool WKTParser::buildRing(const VectorPoint &polygon, GeoRing &ring) {
+    ring.points = polygon;
+    ring.edges.clear();
+    ring.convex = false;
+    ring.orientation = 0;
+
+    size_t count = polygon.size();
+    if (count > 1 && polygon.front().x == polygon.back().x && polygon.front().y == polygon.back().y) {
+        count--;
+    }
+    if (count < 3) {
+        return false;
+    }
+
+    // 边表，最后一条边回到起点
+    int64_t area = 0;
+    ring.edges.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        const cv::Point &p0 = polygon[i];
+        const cv::Point &p1 = polygon[(i + 1) % count];
+        GeoEdge edge;
+        edge.x0 = p0.x;
+        edge.y0 = p0.y;
+        edge.x1 = p1.x;
+        edge.y1 = p1.y;
+        edge.a = static_cast<int64_t>(p0.y) - p1.y;
+        edge.b = static_cast<int64_t>(p1.x) - p0.x;
+        edge.c = static_cast<int64_t>(p0.x) * p1.y - static_cast<int64_t>(p1.x) * p0.y;
+        area += edge.c;
+        ring.edges.push_back(edge);
+    }
+    WKTParser::polygon2Rect(polygon, ring.bbox);
+    ring.orientation = (area > 0) ? 1 : ((area < 0) ? -1 : 0);
+
+    // 凸性：所有相邻边的转向与顶点方向一致，且总转角为一周（排除五角星这类自相交的多边形）
+    if (ring.orientation != 0) {
+        std::vector<const GeoEdge *> valid_edges;
+        valid_edges.reserve(ring.edges.size());
+        for (const GeoEdge &edge : ring.edges) {
+            if (edge.a != 0 || edge.b != 0) {
+                valid_edges.push_back(&edge);
+            }
+        }
+
+        bool convex = valid_edges.size() >= 3;
+        double turn = 0;
+        for (size_t i = 0; convex && i < valid_edges.size(); i++) {
+            const GeoEdge &e = *valid_edges[i];
+            const GeoEdge &f = *valid_edges[(i + 1) % valid_edges.size()];
+            int64_t cross = e.b * (-f.a) - (-e.a) * f.b;
+            int64_t dot = e.b * f.b + e.a * f.a;
+            if (cross * ring.orientation < 0) {
+                convex = false;
+            }
+            turn += std::atan2(static_cast<double>(cross), static_cast<double>(dot));
+        }
+        ring.convex = convex && std::fabs(std::fabs(turn) - 2 * CV_PI) < 1e-3;
+    }
+
+    return true;
+}
+
+bool WKTParser::inRing(const GeoRing &ring, const cv::Point &point, bool *on_edge) {
+    if (on_edge) {
+        *on_edge = false;
+    }
+
+    if (point.x < ring.bbox.x || point.x > ring.bbox.x + ring.bbox.width ||
+        point.y < ring.bbox.y || point.y > ring.bbox.y + ring.bbox.height) {
+        return false;
+    }
+
+    const int64_t x = point.x, y = point.y;
+    if (ring.convex) {
+        // 凸多边形：点在每条边的内侧（或边上）
+        bool edge = false;
+        for (const GeoEdge &e : ring.edges) {
+            int64_t side = e.a * x + e.b * y + e.c;
+            if (side * ring.orientation < 0) {
+                return false;
+            }
+            edge = edge || (side == 0);
+        }
+        if (on_edge) {
+            *on_edge = edge;
+        }
+        return true;
+    }
+
+    // 一般多边形：射线法，边界上的点直接返回
+    bool inside = false;
+    for (const GeoEdge &e : ring.edges) {
+        int64_t side = e.a * x + e.b * y + e.c;
+        if (side == 0 && x >= std::min(e.x0, e.x1) && x <= std::max(e.x0, e.x1) &&
+            y >= std::min(e.y0, e.y1) && y <= std::max(e.y0, e.y1)) {
+            if (on_edge) {
+                *on_edge = true;
+            }
+            return true;
+        }
+        if ((e.y0 > y) != (e.y1 > y)) {
+            // 边与水平线相交，交点在点的右侧时翻转
+            if ((e.y1 > e.y0) ? (side > 0) : (side < 0)) {
+                inside = !inside;
+            }
+        }
+    }
+
+    return inside;
+}
+
+bool WKTParser::inZone(const GeoZone &zone, const cv::Point &point) {
+    if (!WKTParser::inRing(zone.outer, point)) {
+        return false;
+    }
+
+    for (const GeoRing &hole : zone.holes) {
+        bool on_edge = false;
+        if (WKTParser::inRing(hole, point, &on_edge) && !on_edge) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool WKTParser::inZone(const GeoZone &zone, const cv::Rect &rect) {
+    if (!rect_in_bbox(zone.outer.bbox, rect)) {
+        return false;
+    }
+
+    if (!(WKTParser::inZone(zone, rect.tl()) &&
+          WKTParser::inZone(zone, cv::Point(rect.x + rect.width, rect.y)) &&
+          WKTParser::inZone(zone, rect.br()) &&
+          WKTParser::inZone(zone, cv::Point(rect.x, rect.y + rect.height)))) {
+        return false;
+    }
+
+    // 四个角点都不在洞内时，洞仍可能整个或部分落在矩形内部：洞的某条边经过矩形内部
+    // （顶点在矩形内，或顶点都在矩形外但边穿过矩形）
+    for (const GeoRing &hole : zone.holes) {
+        if ((hole.bbox & rect).empty()) {
+            continue;
+        }
+        for (const GeoEdge &edge : hole.edges) {
+            if (edge_crosses_rect(edge, rect)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool WKTParser::inZones(const VectorZone &zones, const cv::Rect &rect) {
+    for (const GeoZone &zone : zones) {
+        if (WKTParser::inZone(zone, rect)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WKTParser::inZones(const VectorZone &zones, const std::vector<cv::Rect> &rects, std::vector<uchar> &results) {
+    results.assign(rects.size(), 0);
+    if (zones.empty()) {
+        return;
+    }
+
+    // 所有区域外接矩形的并集，完全不在其中的框不用逐个区域判断
+    int min_x = std::numeric_limits<int>::max(), min_y = std::numeric_limits<int>::max();
+    int max_x = std::numeric_limits<int>::min(), max_y = std::numeric_limits<int>::min();
+    for (const GeoZone &zone : zones) {
+        min_x = std::min(min_x, zone.outer.bbox.x);
+        min_y = std::min(min_y, zone.outer.bbox.y);
+        max_x = std::max(max_x, zone.outer.bbox.x + zone.outer.bbox.width);
+        max_y = std::max(max_y, zone.outer.bbox.y + zone.outer.bbox.height);
+    }
+    cv::Rect bounds(min_x, min_y, max_x - min_x, max_y - min_y);
+
+    for (size_t i = 0; i < rects.size(); i++) {
+        if (rect_in_bbox(bounds, rects[i])) {
+            results[i] = WKTParser::inZones(zones, rects[i]) ? 1 : 0;
+        }
+    }
 }
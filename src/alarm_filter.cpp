@@ -0,0 +1,90 @@
+#include "alarm_filter.h"
+
+// 功能：标签名的32位FNV-1a哈希，与track_id组合为报警状态的键，避免每次查询构造字符串
+static uint32_t label_hash(const char *label)
+{
+    uint32_t hash = 2166136261u;
+    for(const unsigned char *p = reinterpret_cast<const unsigned char *>(label); *p; p++)
+    {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void AlarmFilter::set_config(int alarm_interval, bool smooth)
+{
+    alarm_interval_ms = static_cast<int64_t>(alarm_interval) * 1000;
+    alarm_smooth = smooth;
+}
+
+bool AlarmFilter::check(int track_id, const char *label, int64_t now_ms)
+{
+    if(alarm_interval_ms <= 0)
+        return true;
+
+    uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(track_id)) << 32) | label_hash(label);
+    auto it = m_states.find(key);
+    if(it == m_states.end())
+    {
+        if(m_states.size() >= ALARM_STATE_MAX_COUNT)
+        {
+            last_expire_ms = 0;
+            expire(now_ms);
+            if(m_states.size() >= ALARM_STATE_MAX_COUNT)
+                evict_oldest();
+        }
+        AlarmState state;
+        state.first_seen_ms = now_ms;
+        state.last_seen_ms = now_ms;
+        state.last_alarm_ms = now_ms;
+        state.alarmed = alarm_smooth;
+        m_states.emplace(key, state);
+        return alarm_smooth;
+    }
+
+    AlarmState &state = it->second;
+    if(!state.alarmed && now_ms - state.last_seen_ms > ALARM_PERSIST_GAP_MS)
+        state.first_seen_ms = now_ms; // 中断后重新出现，持续时间重新计算
+    state.last_seen_ms = now_ms;
+    if(!state.alarmed)
+    {
+        // 未首次上报的目标需要持续出现一个报警间隔才报警
+        if(now_ms - state.first_seen_ms < alarm_interval_ms)
+            return false;
+    }
+    else if(now_ms - state.last_alarm_ms < alarm_interval_ms)
+    {
+        return false;
+    }
+    state.alarmed = true;
+    state.last_alarm_ms = now_ms;
+    return true;
+}
+
+void AlarmFilter::expire(int64_t now_ms)
+{
+    // 每秒最多清理一次
+    if(now_ms - last_expire_ms < 1000)
+        return;
+    last_expire_ms = now_ms;
+    for(auto it = m_states.begin(); it != m_states.end();)
+    {
+        if(now_ms - it->second.last_seen_ms > ALARM_STATE_EXPIRE_MS)
+            it = m_states.erase(it);
+        else
+            ++it;
+    }
+}
+
+void AlarmFilter::evict_oldest()
+{
+    auto oldest = m_states.begin();
+    for(auto it = m_states.begin(); it != m_states.end(); ++it)
+    {
+        if(it->second.last_seen_ms < oldest->second.last_seen_ms)
+            oldest = it;
+    }
+    if(oldest != m_states.end())
+        m_states.erase(oldest);
+}
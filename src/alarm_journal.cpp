@@ -0,0 +1,542 @@
+#include "alarm_journal.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+
+const uint32_t kJournalMagic = 0x4c4e524a; // "JRNL"
+const uint8_t kRecordAlarm = 1;
+const uint8_t kRecordAck = 2;
+const char *kSegmentPrefix = "segment-";
+const char *kSegmentSuffix = ".log";
+
+// 记录头，后面依次是key、image_ref、payload，整条记录按8字节对齐
+struct RecordHeader
+{
+    uint32_t magic;
+    uint32_t crc;         // 从size开始到记录末尾的CRC32
+    uint32_t size;        // 包括记录头和对齐填充
+    uint8_t type;
+    uint8_t sink;
+    uint16_t key_len;
+    uint64_t seq;
+    int64_t timestamp_ms;
+    int32_t camera_index;
+    uint32_t ref_len;
+    uint32_t payload_len;
+    uint32_t reserved;
+};
+static_assert(sizeof(RecordHeader) == 48, "journal record header must be 48 bytes");
+
+uint32_t crc32(const uint8_t *data, size_t len)
+{
+    static const std::vector<uint32_t> table = []()
+    {
+        std::vector<uint32_t> table(256);
+        for(uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for(int k = 0; k < 8; k++)
+                c = (c & 1) ? (0xedb88320u ^ (c >> 1)) : (c >> 1);
+            table[i] = c;
+        }
+        return table;
+    }();
+    uint32_t crc = 0xffffffffu;
+    for(size_t i = 0; i < len; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffffu;
+}
+
+size_t align8(size_t size)
+{
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+// 功能：检查offset处是否是一条完整的记录
+bool valid_record(const uint8_t *base, size_t size, size_t offset, RecordHeader &header)
+{
+    if(offset + sizeof(RecordHeader) > size)
+        return false;
+    memcpy(&header, base + offset, sizeof(RecordHeader));
+    if(header.magic != kJournalMagic || header.size < sizeof(RecordHeader) || header.size % 8 != 0 ||
+       header.size > size - offset)
+        return false;
+    if(sizeof(RecordHeader) + header.key_len + static_cast<size_t>(header.ref_len) + header.payload_len > header.size)
+        return false;
+    return crc32(base + offset + 8, header.size - 8) == header.crc;
+}
+
+} // namespace
+
+// 功能：一个段文件的内存映射，最后一个引用释放时解除映射
+struct AlarmJournal::Mapping
+{
+    int fd = -1;
+    uint8_t *base = nullptr;
+    size_t size = 0;
+    size_t end = 0;      // 轮转时的写入位置
+    size_t synced = 0;   // 已刷盘的位置
+    std::mutex sync_mutex;
+
+    void sync(size_t to)
+    {
+        std::lock_guard<std::mutex> lock(sync_mutex);
+        if(to <= synced)
+            return;
+        static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t from = synced / page * page;
+        msync(base + from, to - from, MS_SYNC);
+        synced = to;
+    }
+
+    ~Mapping()
+    {
+        if(base != nullptr)
+            munmap(base, size);
+        if(fd >= 0)
+            close(fd);
+    }
+};
+
+AlarmJournal::AlarmJournal(const std::string &dir, size_t segment_bytes, uint64_t max_bytes)
+    : m_dir(dir), m_segment_bytes(segment_bytes), m_max_bytes(std::max<uint64_t>(max_bytes, segment_bytes))
+{
+    mkdir(m_dir.c_str(), 0755);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    recover();
+    if(!rotate_segment())
+    {
+        std::cout << "AlarmJournal: open segment in " << m_dir << " fail, journal disabled" << std::endl;
+        return;
+    }
+    m_flush_thread = std::thread(&AlarmJournal::flush_loop, this);
+}
+
+AlarmJournal::~AlarmJournal()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    if(m_flush_thread.joinable())
+        m_flush_thread.join();
+    for(auto &mapping : m_retired)
+        mapping->sync(mapping->end);
+    if(m_current)
+        m_current->sync(m_write_offset);
+    for(const std::string &path : m_unlink)
+        unlink(path.c_str());
+    // 没有用到的备用段是空文件，删除
+    if(m_spare)
+    {
+        m_spare.reset();
+        unlink(m_spare_segment.path.c_str());
+    }
+}
+
+void AlarmJournal::recover()
+{
+    std::vector<std::string> names;
+    if(DIR *dir = opendir(m_dir.c_str()))
+    {
+        while(struct dirent *entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            if(name.compare(0, strlen(kSegmentPrefix), kSegmentPrefix) == 0 &&
+               name.size() > strlen(kSegmentSuffix) &&
+               name.compare(name.size() - strlen(kSegmentSuffix), std::string::npos, kSegmentSuffix) == 0)
+                names.push_back(name);
+        }
+        closedir(dir);
+    }
+    // 段编号是定长的，文件名顺序即写入顺序
+    std::sort(names.begin(), names.end());
+
+    uint64_t max_seq = 0;
+    for(const std::string &name : names)
+    {
+        Segment segment;
+        segment.id = std::stoull(name.substr(strlen(kSegmentPrefix)));
+        segment.path = m_dir + "/" + name;
+        int fd = open(segment.path.c_str(), O_RDONLY);
+        struct stat st;
+        if(fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            if(fd >= 0)
+                close(fd);
+            unlink(segment.path.c_str());
+            continue;
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        void *base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if(base == MAP_FAILED)
+            continue;
+
+        // 顺序扫描到第一条不完整的记录为止
+        RecordHeader header;
+        size_t offset = 0;
+        while(valid_record(static_cast<const uint8_t *>(base), size, offset, header))
+        {
+            if(header.type == kRecordAlarm && header.sink < JOURNAL_SINK_COUNT)
+                m_unacked[header.seq] = Location{segment.id, offset, static_cast<JournalSink>(header.sink)};
+            else if(header.type == kRecordAck)
+                m_unacked.erase(header.seq);
+            max_seq = std::max(max_seq, header.seq);
+            offset += header.size;
+        }
+        munmap(base, size);
+        m_next_segment_id = std::max(m_next_segment_id, segment.id + 1);
+        // 预先创建但还没有写入的备用段
+        if(offset == 0)
+        {
+            unlink(segment.path.c_str());
+            continue;
+        }
+        m_segments.push_back(segment);
+    }
+
+    for(const auto &item : m_unacked)
+    {
+        for(Segment &segment : m_segments)
+        {
+            if(segment.id == item.second.segment)
+                segment.unacked++;
+        }
+        // 上次运行时没有确认的报警，启动后全部重放
+        m_failed[item.second.sink].insert(item.first);
+        m_replay_ready[item.second.sink] = true;
+    }
+    m_next_seq = max_seq + 1;
+    if(!m_unacked.empty())
+        std::cout << "AlarmJournal: " << m_unacked.size() << " unacked alarms recovered from " << m_dir << std::endl;
+}
+
+std::shared_ptr<AlarmJournal::Mapping> AlarmJournal::create_segment(Segment &segment) const
+{
+    char name[64];
+    snprintf(name, sizeof(name), "%s%020llu%s", kSegmentPrefix, static_cast<unsigned long long>(segment.id), kSegmentSuffix);
+    segment.path = m_dir + "/" + name;
+
+    // 预分配磁盘空间并预先映射页面，写入时不会因为分配块或缺页而阻塞
+    std::shared_ptr<Mapping> mapping = std::make_shared<Mapping>();
+    mapping->fd = open(segment.path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(mapping->fd < 0 || posix_fallocate(mapping->fd, 0, static_cast<off_t>(m_segment_bytes)) != 0)
+    {
+        unlink(segment.path.c_str());
+        return nullptr;
+    }
+    void *base = mmap(nullptr, m_segment_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mapping->fd, 0);
+    if(base == MAP_FAILED)
+    {
+        unlink(segment.path.c_str());
+        return nullptr;
+    }
+    mapping->base = static_cast<uint8_t *>(base);
+    mapping->size = m_segment_bytes;
+
+    // 新文件的目录项落盘，崩溃后能找到这个段
+    int dir_fd = open(m_dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if(dir_fd >= 0)
+    {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    return mapping;
+}
+
+bool AlarmJournal::rotate_segment()
+{
+    Segment segment;
+    std::shared_ptr<Mapping> mapping;
+    if(m_spare)
+    {
+        segment = m_spare_segment;
+        mapping.swap(m_spare);
+    }
+    else
+    {
+        // 启动时或写入太快、备用段还没创建好，在当前线程创建
+        segment.id = m_next_segment_id++;
+        mapping = create_segment(segment);
+        if(!mapping)
+            return false;
+        if(m_current)
+            m_stats.rotations_sync++;
+    }
+
+    if(m_current)
+    {
+        m_current->end = m_write_offset;
+        m_retired.push_back(m_current);
+        m_stats.rotations++;
+    }
+    m_segments.push_back(segment);
+    m_current = mapping;
+    m_write_offset = 0;
+    collect();
+    // 后台线程刷盘并释放旧的映射，创建下一个备用段
+    m_cond.notify_all();
+    return true;
+}
+
+void AlarmJournal::collect()
+{
+    // 最早的段中的报警都已确认，可以删除；只从最早的段开始删，后面段中的确认记录不会丢
+    while(m_segments.size() > 1 && m_segments.front().unacked == 0)
+    {
+        m_unlink.push_back(m_segments.front().path);
+        m_segments.pop_front();
+    }
+    // 超过磁盘上限，丢弃最早的段和其中未确认的报警
+    while(m_segments.size() > 1 && static_cast<uint64_t>(m_segments.size()) * m_segment_bytes > m_max_bytes)
+    {
+        const Segment &front = m_segments.front();
+        size_t dropped = 0;
+        for(auto it = m_unacked.begin(); it != m_unacked.end();)
+        {
+            if(it->second.segment != front.id)
+            {
+                ++it;
+                continue;
+            }
+            m_failed[it->second.sink].erase(it->first);
+            it = m_unacked.erase(it);
+            dropped++;
+        }
+        m_stats.dropped += dropped;
+        std::cout << "WARNING: AlarmJournal over " << m_max_bytes << " bytes, drop " << front.path
+                  << " with " << dropped << " unacked alarms" << std::endl;
+        m_unlink.push_back(front.path);
+        m_segments.pop_front();
+    }
+}
+
+bool AlarmJournal::write_record(uint8_t type, JournalSink sink, uint64_t seq, int camera_index, const std::string &key,
+                                const std::string &image_ref, const std::string &payload)
+{
+    size_t data_len = key.size() + image_ref.size() + payload.size();
+    size_t size = align8(sizeof(RecordHeader) + data_len);
+    if(size > m_segment_bytes || key.size() > UINT16_MAX)
+        return false;
+    if(!m_current || m_write_offset + size > m_segment_bytes)
+    {
+        if(!rotate_segment())
+            return false;
+    }
+
+    uint8_t *dst = m_current->base + m_write_offset;
+    RecordHeader header;
+    header.magic = 0;
+    header.crc = 0;
+    header.size = static_cast<uint32_t>(size);
+    header.type = type;
+    header.sink = static_cast<uint8_t>(sink);
+    header.key_len = static_cast<uint16_t>(key.size());
+    header.seq = seq;
+    header.timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    header.camera_index = camera_index;
+    header.ref_len = static_cast<uint32_t>(image_ref.size());
+    header.payload_len = static_cast<uint32_t>(payload.size());
+    header.reserved = 0;
+    memcpy(dst, &header, sizeof(header));
+    uint8_t *data = dst + sizeof(header);
+    memcpy(data, key.data(), key.size());
+    memcpy(data + key.size(), image_ref.data(), image_ref.size());
+    memcpy(data + key.size() + image_ref.size(), payload.data(), payload.size());
+    memset(data + data_len, 0, size - sizeof(header) - data_len);
+
+    // magic最后写入，崩溃时没写完的记录在恢复时被丢弃
+    header.crc = crc32(dst + 8, size - 8);
+    memcpy(dst + 4, &header.crc, sizeof(header.crc));
+    std::atomic_thread_fence(std::memory_order_release);
+    header.magic = kJournalMagic;
+    memcpy(dst, &header.magic, sizeof(header.magic));
+    m_write_offset += size;
+
+    if(JOURNAL_FSYNC_INTERVAL_MS == 0)
+        m_current->sync(m_write_offset);
+    return true;
+}
+
+uint64_t AlarmJournal::append(JournalSink sink, int camera_index, const std::string &key,
+                              const std::string &image_ref, const std::string &payload)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(!m_current)
+        return 0;
+    uint64_t seq = m_next_seq;
+    if(!write_record(kRecordAlarm, sink, seq, camera_index, key, image_ref, payload))
+    {
+        std::cout << "WARNING: AlarmJournal append " << payload.size() << " bytes fail" << std::endl;
+        return 0;
+    }
+    m_next_seq++;
+    m_unacked[seq] = Location{m_segments.back().id, m_write_offset - align8(sizeof(RecordHeader) + key.size() + image_ref.size() + payload.size()), sink};
+    m_segments.back().unacked++;
+    m_stats.appended++;
+    return seq;
+}
+
+void AlarmJournal::complete(uint64_t seq, bool delivered)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_unacked.find(seq);
+    if(it == m_unacked.end())
+        return;
+    Location location = it->second;
+    if(!delivered)
+    {
+        m_failed[location.sink].insert(seq);
+        m_stats.failed++;
+        return;
+    }
+
+    m_unacked.erase(it);
+    m_failed[location.sink].erase(seq);
+    for(Segment &segment : m_segments)
+    {
+        if(segment.id == location.segment)
+        {
+            segment.unacked--;
+            break;
+        }
+    }
+    m_stats.acked++;
+    write_record(kRecordAck, location.sink, seq, 0, std::string(), std::string(), std::string());
+    // 该通道恢复发送，之前失败的报警可以重放
+    if(!m_failed[location.sink].empty())
+        m_replay_ready[location.sink] = true;
+    collect();
+}
+
+bool AlarmJournal::read_record(const Location &location, JournalRecord &record) const
+{
+    std::string path;
+    for(const Segment &segment : m_segments)
+    {
+        if(segment.id == location.segment)
+            path = segment.path;
+    }
+    int fd = path.empty() ? -1 : open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    RecordHeader header;
+    std::vector<uint8_t> buffer(sizeof(RecordHeader));
+    bool ok = pread(fd, buffer.data(), buffer.size(), static_cast<off_t>(location.offset)) == static_cast<ssize_t>(buffer.size());
+    if(ok)
+    {
+        memcpy(&header, buffer.data(), sizeof(header));
+        ok = header.magic == kJournalMagic && header.size >= sizeof(header) && header.size <= m_segment_bytes;
+    }
+    if(ok)
+    {
+        buffer.resize(header.size);
+        ok = pread(fd, buffer.data(), buffer.size(), static_cast<off_t>(location.offset)) == static_cast<ssize_t>(buffer.size()) &&
+             valid_record(buffer.data(), buffer.size(), 0, header);
+    }
+    close(fd);
+    if(!ok)
+        return false;
+
+    const char *data = reinterpret_cast<const char *>(buffer.data() + sizeof(header));
+    record.seq = header.seq;
+    record.timestamp_ms = header.timestamp_ms;
+    record.camera_index = header.camera_index;
+    record.sink = static_cast<JournalSink>(header.sink);
+    record.key.assign(data, header.key_len);
+    record.image_ref.assign(data + header.key_len, header.ref_len);
+    record.payload.assign(data + header.key_len + header.ref_len, header.payload_len);
+    return true;
+}
+
+std::vector<JournalRecord> AlarmJournal::take_replay()
+{
+    std::vector<JournalRecord> records;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(int sink = 0; sink < JOURNAL_SINK_COUNT; sink++)
+    {
+        if(!m_replay_ready[sink])
+            continue;
+        m_replay_ready[sink] = false;
+        for(uint64_t seq : m_failed[sink])
+        {
+            auto it = m_unacked.find(seq);
+            JournalRecord record;
+            if(it != m_unacked.end() && read_record(it->second, record))
+                records.push_back(std::move(record));
+        }
+        m_failed[sink].clear();
+    }
+    m_stats.replayed += records.size();
+    return records;
+}
+
+JournalStats AlarmJournal::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    JournalStats stats = m_stats;
+    stats.unacked = m_unacked.size();
+    stats.segments = m_segments.size();
+    stats.disk_bytes = static_cast<uint64_t>(m_segments.size() + (m_spare ? 1 : 0)) * m_segment_bytes;
+    return stats;
+}
+
+void AlarmJournal::flush_loop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(!m_stop)
+    {
+        std::shared_ptr<Mapping> current = m_current;
+        size_t end = m_write_offset;
+        std::vector<std::shared_ptr<Mapping>> retired;
+        retired.swap(m_retired);
+        std::vector<std::string> unlinks;
+        unlinks.swap(m_unlink);
+        Segment spare_segment;
+        spare_segment.id = m_spare ? 0 : m_next_segment_id++;
+        lock.unlock();
+        // 刷盘、删除和创建段文件都不持锁，写入不会被磁盘IO阻塞；轮转下来的映射刷盘后在这里释放
+        for(auto &mapping : retired)
+            mapping->sync(mapping->end);
+        retired.clear();
+        if(current && JOURNAL_FSYNC_INTERVAL_MS > 0)
+            current->sync(end);
+        current.reset();
+        for(const std::string &path : unlinks)
+            unlink(path.c_str());
+        std::shared_ptr<Mapping> spare;
+        if(spare_segment.id != 0)
+            spare = create_segment(spare_segment);
+        lock.lock();
+
+        // 备用段被取走时立即创建下一个；创建失败（如磁盘满）时等到下一个刷盘周期再试
+        bool spare_failed = spare_segment.id != 0 && !spare;
+        if(spare)
+        {
+            // 创建期间写入线程已经同步创建了编号更大的段，这个段不能再用，否则段文件的顺序与写入顺序不一致
+            if(!m_spare && (m_segments.empty() || spare_segment.id > m_segments.back().id))
+            {
+                m_spare = spare;
+                m_spare_segment = spare_segment;
+            }
+            else
+            {
+                spare.reset();
+                m_unlink.push_back(spare_segment.path);
+            }
+        }
+        m_cond.wait_for(lock, std::chrono::milliseconds(std::max(JOURNAL_FSYNC_INTERVAL_MS, 100)),
+                        [&]() { return m_stop || (!m_spare && !spare_failed); });
+    }
+}
@@ -0,0 +1,298 @@
+#include "alarm_json_writer.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include "base64.h"
+#include "clock_service.h"
+
+namespace {
+
+// 功能：写入带引号的字符串，转义规则与jsoncpp emitUTF8=true时一致：非ASCII字节原样输出，控制字符用\u00xx
+void append_string(std::string &out, const char *str, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    out.push_back('"');
+    const char *begin = str;
+    const char *end = str + len;
+    for(const char *c = str; c != end; ++c)
+    {
+        unsigned char ch = static_cast<unsigned char>(*c);
+        if(ch >= 0x20 && ch != '"' && ch != '\\')
+            continue;
+        out.append(begin, c - begin);
+        begin = c + 1;
+        switch(ch)
+        {
+            case '"':  out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\b': out.append("\\b"); break;
+            case '\f': out.append("\\f"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            default:
+                out.append("\\u00");
+                out.push_back(hex[ch >> 4]);
+                out.push_back(hex[ch & 0xf]);
+                break;
+        }
+    }
+    out.append(begin, end - begin);
+    out.push_back('"');
+}
+
+void append_string(std::string &out, const std::string &str)
+{
+    append_string(out, str.data(), str.size());
+}
+
+// 功能：写入带引号的本地时间，毫秒时间戳只在这里格式化
+void append_time(std::string &out, int64_t ms)
+{
+    out.push_back('"');
+    ClockService::append_iso8601(ms, out);
+    out.push_back('"');
+}
+
+void append_int(std::string &out, int64_t value)
+{
+    char buffer[24];
+    int len = snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(value));
+    out.append(buffer, len);
+}
+
+void append_bool(std::string &out, bool value)
+{
+    out.append(value ? "true" : "false");
+}
+
+// 功能：与jsoncpp的valueToString(double)一致，17位有效数字，整数值补".0"，非有限值输出null/±1e+9999
+void append_double(std::string &out, double value)
+{
+    if(!std::isfinite(value))
+    {
+        out.append(std::isnan(value) ? "null" : (value < 0 ? "-1e+9999" : "1e+9999"));
+        return;
+    }
+    char buffer[40];
+    int len = snprintf(buffer, sizeof(buffer), "%.17g", value);
+    bool has_point = false;
+    for(int i = 0; i < len; i++)
+    {
+        if(buffer[i] == ',')
+            buffer[i] = '.';
+        if(buffer[i] == '.' || buffer[i] == 'e')
+            has_point = true;
+    }
+    out.append(buffer, len);
+    if(!has_point)
+        out.append(".0");
+}
+
+// 功能：JPEG数据base64编码后作为字符串写入，base64字符不需要转义
+void append_base64(std::string &out, const std::vector<uchar> &data)
+{
+    out.push_back('"');
+    base64_encode_append(data.data(), data.size(), out);
+    out.push_back('"');
+}
+
+} // namespace
+
+void json_append_string(std::string &out, const std::string &str)
+{
+    append_string(out, str);
+}
+
+std::string AlarmJsonWriter::format_float(float val, int precision)
+{
+    std::ostringstream oss;
+    oss << std::setprecision(precision) << val;
+    return oss.str();
+}
+
+void AlarmJsonWriter::key(const char *name)
+{
+    if(!m_first)
+        m_buffer.push_back(',');
+    m_first = false;
+    m_buffer.push_back('\n');
+    m_buffer.append(m_depth, '\t');
+    append_string(m_buffer, name, strlen(name));
+    m_buffer.append(" : ");
+}
+
+void AlarmJsonWriter::key(const std::string &name)
+{
+    if(!m_first)
+        m_buffer.push_back(',');
+    m_first = false;
+    m_buffer.push_back('\n');
+    m_buffer.append(m_depth, '\t');
+    append_string(m_buffer, name);
+    m_buffer.append(" : ");
+}
+
+void AlarmJsonWriter::begin(char bracket)
+{
+    // 顶层对象直接输出，嵌套的对象和数组另起一行
+    if(!m_buffer.empty())
+    {
+        m_buffer.push_back('\n');
+        m_buffer.append(m_depth, '\t');
+    }
+    m_buffer.push_back(bracket);
+    m_depth++;
+    m_first = true;
+}
+
+void AlarmJsonWriter::end(char bracket)
+{
+    m_depth--;
+    m_buffer.push_back('\n');
+    m_buffer.append(m_depth, '\t');
+    m_buffer.push_back(bracket);
+    m_first = false;
+}
+
+void AlarmJsonWriter::write_objects(const char *name, const std::list<objectInfo> &objects, bool score_as_string)
+{
+    key(name);
+    if(objects.empty())
+    {
+        m_buffer.append("null");
+        return;
+    }
+    begin('[');
+    for(const objectInfo &object : objects)
+    {
+        if(!m_first)
+            m_buffer.push_back(',');
+        begin('{');
+        key("h");        append_int(m_buffer, object.h);
+        key("label");    append_string(m_buffer, object.label);
+        key("score");
+        if(score_as_string)
+            append_string(m_buffer, format_float(object.score, 1));
+        else
+            append_double(m_buffer, object.score);
+        key("track_id"); append_int(m_buffer, object.track_id);
+        key("w");        append_int(m_buffer, object.w);
+        key("x");        append_int(m_buffer, object.x);
+        key("y");        append_int(m_buffer, object.y);
+        end('}');
+    }
+    end(']');
+}
+
+void AlarmJsonWriter::write_settings(const settingInfo &settings)
+{
+    // 类别阈值的键由配置决定，和固定字段一起排序，同名时类别阈值覆盖固定字段
+    std::map<std::string, std::string> values;
+    append_string(values["roi"], settings.roi);
+    append_int(values["FrameInterval"], settings.frameInterval);
+    append_string(values["NmsThreshold"], format_float(settings.nmsThreshold, 1));
+    append_int(values["AlarmInterval"], settings.alarmInterval);
+    append_bool(values["AlarmSmooth"], settings.alarmSmooth);
+    append_string(values["StatisticsStartTime"], settings.statisiticsStartTime);
+    append_string(values["StatisticsEndTime"], settings.statisiticsEndTime);
+    for(const auto &thresh : settings.labelThreshMap)
+    {
+        std::string &value = values[thresh.first];
+        value.clear();
+        append_string(value, format_float(thresh.second, 1));
+    }
+
+    key("settings");
+    begin('{');
+    for(const auto &item : values)
+    {
+        key(item.first);
+        m_buffer.append(item.second);
+    }
+    end('}');
+}
+
+void AlarmJsonWriter::write_nvr_information(const AlarmNvrInfo &nvr)
+{
+    key("nvr_channel");     append_int(m_buffer, nvr.channel);
+    key("nvr_ip");          append_string(m_buffer, nvr.ip);
+    key("nvr_password");    append_string(m_buffer, nvr.password);
+    key("nvr_port");        append_int(m_buffer, nvr.port);
+    key("nvr_timestamp");   append_int(m_buffer, nvr.timestamp);
+    key("nvr_user");        append_string(m_buffer, nvr.user);
+}
+
+const std::string &AlarmJsonWriter::write(const pipelineInfo &info, int64_t camera_id,
+                                          const std::vector<uchar> &raw_pic, const std::vector<uchar> &thumbnail_pic,
+                                          const AlarmNvrInfo &nvr, const std::string &image_ref)
+{
+    m_buffer.clear();
+    m_depth = 0;
+    // 两张图占消息的绝大部分，一次预留好，编码时不再扩容
+    m_buffer.reserve(base64_encoded_size(raw_pic.size()) + base64_encoded_size(thumbnail_pic.size()) + 4096);
+
+    // 各层的键按字节序排列（大写字母在小写字母之前，'_'在小写字母之前）
+    begin('{');
+    key("alarm_date");          append_time(m_buffer, info.alarm_time_ms);
+    if(!image_ref.empty())
+    {
+        key("alarm_image_path"); append_string(m_buffer, image_ref);
+    }
+    key("alarm_raw_pic");       append_base64(m_buffer, raw_pic);
+    key("alarm_thumbnail_pic"); append_base64(m_buffer, thumbnail_pic);
+    key("alarm_type");          append_int(m_buffer, info.alarm_type);
+    key("camera_id");           append_int(m_buffer, camera_id);
+    key("camera_name");         append_string(m_buffer, info.camera_name);
+    if(nvr.enable)
+    {
+        key("channel_no");      append_int(m_buffer, nvr.channel);
+    }
+    key("deployment");          append_string(m_buffer, info.seawayos_app);
+
+    key("information");
+    begin('{');
+    write_objects("alarm", info.alarm_information.alarm_object_list, false);
+    key("alarm_num");           append_int(m_buffer, info.alarm_information.alarm_num);
+    if(nvr.enable)
+        write_nvr_information(nvr);
+    write_objects("result", info.result_information.result_object_list, true);
+    key("result_num");          append_int(m_buffer, info.result_information.result_num);
+    if(info.setting_information)
+        write_settings(*info.setting_information);
+    end('}');
+
+    key("namespace");           append_string(m_buffer, info.seawayos_namespace);
+    if(nvr.enable)
+    {
+        key("stop_alarm_date"); append_time(m_buffer, nvr.stop_alarm_time_ms);
+        key("video_url");       append_string(m_buffer, nvr.video_url);
+    }
+    end('}');
+    return m_buffer;
+}
+
+const std::string &AlarmJsonWriter::write_nvr_update(const pipelineInfo &info, int64_t camera_id, const AlarmNvrInfo &nvr)
+{
+    m_buffer.clear();
+    m_depth = 0;
+
+    // 键按字节序排列，与报警消息相同的字段格式相同
+    begin('{');
+    key("alarm_date");          append_time(m_buffer, info.alarm_time_ms);
+    key("alarm_id");            append_string(m_buffer, std::to_string(camera_id) + "_" + std::to_string(info.alarm_time_ms));
+    key("camera_id");           append_int(m_buffer, camera_id);
+    key("channel_no");          append_int(m_buffer, nvr.channel);
+    key("information");
+    begin('{');
+    write_nvr_information(nvr);
+    end('}');
+    key("stop_alarm_date");     append_time(m_buffer, nvr.stop_alarm_time_ms);
+    key("type");                append_string(m_buffer, ALARM_NVR_UPDATE_TYPE);
+    key("video_url");           append_string(m_buffer, nvr.video_url);
+    end('}');
+    return m_buffer;
+}
@@ -0,0 +1,68 @@
+#include "alarm_queue.h"
+
+void AlarmQueue::add(std::list<pipelineInfo> &batch, pipelineInfo &&info)
+{
+    batch.push_back(std::move(info));
+}
+
+size_t AlarmQueue::append(std::list<pipelineInfo> &queue, std::list<pipelineInfo> &batch, size_t max_size)
+{
+    queue.splice(queue.end(), batch);
+    size_t dropped = 0;
+    while(queue.size() > max_size)
+    {
+        queue.pop_front();
+        dropped++;
+    }
+    return dropped;
+}
+
+void AlarmQueue::take_ready(std::list<pipelineInfo> &queue, std::list<pipelineInfo> &ready)
+{
+    auto iter = queue.begin();
+    while(iter != queue.end())
+    {
+        auto current = iter++;
+        if(current->ready_for_mqtt)
+            ready.splice(ready.end(), queue, current);
+    }
+}
+
+void AlarmQueue::to_message(pipelineInfo &info, mqttMessageParam &message)
+{
+    message.pipelineinfo = std::move(info);
+}
+
+void AlarmRoiFilter::filter(std::list<pipelineInfo> &queue)
+{
+    for(pipelineInfo &pipelineinfo : queue)
+    {
+        // 直接在队列中的管道信息上筛选，AppEndNode读取的就是筛选后的结果
+        if(pipelineinfo.ready_for_mqtt)
+            continue;
+        pipelineinfo.ready_for_mqtt = true;
+        if(!pipelineinfo.setting_information || !pipelineinfo.source_image)
+            continue;
+        RoiMask &roi_mask = m_roi_masks[pipelineinfo.camera_index];
+        roi_mask.compile(pipelineinfo.setting_information->roi, pipelineinfo.source_image->size());
+        // 一个报警的所有目标框一次判断，掩码无法判定的框批量精确判断
+        m_object_rects.clear();
+        for(const objectInfo &alarm_object : pipelineinfo.alarm_information.alarm_object_list)
+            m_object_rects.emplace_back(alarm_object.x, alarm_object.y, alarm_object.w, alarm_object.h);
+        roi_mask.contains(m_object_rects, m_in_roi);
+        size_t object_index = 0;
+        std::list<objectInfo>::iterator alarm_object_iterator = pipelineinfo.alarm_information.alarm_object_list.begin();
+        while(alarm_object_iterator != pipelineinfo.alarm_information.alarm_object_list.end())
+        {
+            if(!m_in_roi[object_index++])
+            {
+                alarm_object_iterator = pipelineinfo.alarm_information.alarm_object_list.erase(alarm_object_iterator);
+                pipelineinfo.alarm_information.alarm_num--;
+            }
+            else
+            {
+                ++alarm_object_iterator;
+            }
+        }
+    }
+}
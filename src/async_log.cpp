@@ -0,0 +1,146 @@
+#include "async_log.h"
+#include "clock_service.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+static_assert((ASYNC_LOG_QUEUE_SIZE & (ASYNC_LOG_QUEUE_SIZE - 1)) == 0, "ASYNC_LOG_QUEUE_SIZE must be a power of 2");
+
+AsyncLogger &AsyncLogger::instance()
+{
+    static AsyncLogger *logger = []()
+    {
+        AsyncLogger *logger = new AsyncLogger(); // 不析构，退出时其他线程可能还在写日志
+        std::thread(&AsyncLogger::output_thread, logger).detach();
+        std::atexit([]{ AsyncLogger::instance().flush(); });
+        return logger;
+    }();
+    return *logger;
+}
+
+AsyncLogger::AsyncLogger() : m_slots(new Slot[ASYNC_LOG_QUEUE_SIZE])
+{
+    for(size_t i = 0; i < ASYNC_LOG_QUEUE_SIZE; i++)
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool AsyncLogger::push(int severity, const char *text, size_t length)
+{
+    // 有界队列：槽的sequence等于写入位置时可写，写完后置为位置+1交给消费者
+    size_t position = m_tail.load(std::memory_order_relaxed);
+    Slot *slot = nullptr;
+    while(true)
+    {
+        slot = &m_slots[position & (ASYNC_LOG_QUEUE_SIZE - 1)];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if(diff == 0)
+        {
+            if(m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if(diff < 0)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed); // 队列满，输出线程跟不上
+            return false;
+        }
+        else
+            position = m_tail.load(std::memory_order_relaxed);
+    }
+    slot->severity = severity;
+    slot->time_ms = ClockService::now_ms();
+    slot->length = std::min(length, static_cast<size_t>(ASYNC_LOG_LINE_MAX));
+    memcpy(slot->text, text, slot->length);
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+size_t AsyncLogger::drain()
+{
+    static const char severity_names[] = {'D', 'I', 'W', 'E'};
+    thread_local std::string batch;
+    batch.clear();
+    size_t count = 0;
+    std::lock_guard<std::mutex> lock(m_drain_mutex);
+    while(true)
+    {
+        Slot &slot = m_slots[m_head & (ASYNC_LOG_QUEUE_SIZE - 1)];
+        if(slot.sequence.load(std::memory_order_acquire) != m_head + 1)
+            break;
+        batch += severity_names[std::max(0, std::min(slot.severity, ASYNC_LOG_ERROR))];
+        batch += ' ';
+        ClockService::append_iso8601(slot.time_ms, batch);
+        batch += ' ';
+        batch.append(slot.text, slot.length);
+        batch += '\n';
+        slot.sequence.store(m_head + ASYNC_LOG_QUEUE_SIZE, std::memory_order_release); // 槽可以被下一轮写入
+        m_head++;
+        count++;
+    }
+    if(count > 0)
+    {
+        fwrite(batch.data(), 1, batch.size(), stdout);
+        fflush(stdout);
+    }
+    return count;
+}
+
+void AsyncLogger::flush()
+{
+    drain();
+}
+
+void AsyncLogger::output_thread()
+{
+    while(true)
+    {
+        if(drain() == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(ASYNC_LOG_FLUSH_INTERVAL_MS));
+    }
+}
+
+thread_local uint64_t AsyncLogSite::t_suppressed = 0;
+
+bool AsyncLogSite::allow(int interval_ms)
+{
+    if(interval_ms <= 0)
+    {
+        t_suppressed = 0;
+        return true;
+    }
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t next = m_next_ms.load(std::memory_order_relaxed);
+    if(now < next || !m_next_ms.compare_exchange_strong(next, now + interval_ms, std::memory_order_relaxed))
+    {
+        m_suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    t_suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
+AsyncLogLine::ThreadStream &AsyncLogLine::thread_stream()
+{
+    thread_local ThreadStream thread_stream;
+    return thread_stream;
+}
+
+AsyncLogLine::AsyncLogLine(int severity, uint64_t suppressed)
+    : m_severity(severity), m_suppressed(suppressed), m_stream(thread_stream().stream)
+{
+    thread_stream().buffer.reset();
+    m_stream.clear();
+}
+
+AsyncLogLine::~AsyncLogLine()
+{
+    if(m_suppressed > 0)
+        m_stream << " (suppressed " << m_suppressed << ")";
+    ThreadStream &line = thread_stream();
+    AsyncLogger::instance().push(m_severity, line.buffer.data(), line.buffer.size());
+}
@@ -1,5 +1,11 @@
 #include "../include/base64.h"
 #include <iostream>
+#include <cstdint>
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
 
 const std::string base64_chars = 
     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
@@ -11,52 +17,135 @@ bool is_base64(unsigned char c)
     return (isalnum(c) || (c == '+') || (c == '/'));
 }
 
-std::string base64_encode(unsigned const char* byteToEncode, unsigned int byteLength)
+namespace {
+
+// 功能：逐字节查表编码，处理SIMD剩余的尾部数据，返回写入的字节数
+size_t base64_encode_scalar(const unsigned char *src, size_t len, char *out)
 {
-    std::string ret; //返回的是一种字符串类型 
-    int i = 0;
-    unsigned char char_array_3[3];
-    unsigned char char_array_4[4];
-    while(byteLength--)
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char *dst = out;
+    while(len >= 3)
     {
-        char_array_3[i++] = *(byteToEncode++);
-        if(i == 3)
-        {
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = (char_array_3[2] & 0x3f);
+        uint32_t value = (uint32_t(src[0]) << 16) | (uint32_t(src[1]) << 8) | src[2];
+        dst[0] = table[(value >> 18) & 0x3f];
+        dst[1] = table[(value >> 12) & 0x3f];
+        dst[2] = table[(value >> 6) & 0x3f];
+        dst[3] = table[value & 0x3f];
+        src += 3;
+        len -= 3;
+        dst += 4;
+    }
+    if(len)
+    {
+        uint32_t value = uint32_t(src[0]) << 16;
+        if(len == 2)
+            value |= uint32_t(src[1]) << 8;
+        dst[0] = table[(value >> 18) & 0x3f];
+        dst[1] = table[(value >> 12) & 0x3f];
+        dst[2] = (len == 2) ? table[(value >> 6) & 0x3f] : '=';
+        dst[3] = '=';
+        dst += 4;
+    }
+    return dst - out;
+}
 
-            for(int j = 0; j < 4; j++){
-                ret += base64_chars[char_array_4[j]];
-            }
-            // std::cout << ret << std::endl;
-            i = 0;
-        }
-        // std::cout << char_array_3[0] << char_array_3[1] << char_array_3[2] << std::endl;
+#if defined(__aarch64__)
+// 功能：NEON每次把48字节编码为64个字符，vld3按3字节交错读入，4个16字节的表查64个字符
+size_t base64_encode_simd(const unsigned char *&src, size_t &len, char *out)
+{
+    static const uint8_t table[64] = {
+        'A','B','C','D','E','F','G','H','I','J','K','L','M','N','O','P',
+        'Q','R','S','T','U','V','W','X','Y','Z','a','b','c','d','e','f',
+        'g','h','i','j','k','l','m','n','o','p','q','r','s','t','u','v',
+        'w','x','y','z','0','1','2','3','4','5','6','7','8','9','+','/'};
+    uint8x16x4_t lut;
+    lut.val[0] = vld1q_u8(table);
+    lut.val[1] = vld1q_u8(table + 16);
+    lut.val[2] = vld1q_u8(table + 32);
+    lut.val[3] = vld1q_u8(table + 48);
+    const uint8x16_t mask = vdupq_n_u8(0x3f);
+
+    char *dst = out;
+    while(len >= 48)
+    {
+        uint8x16x3_t in = vld3q_u8(src);
+        uint8x16x4_t index, result;
+        index.val[0] = vshrq_n_u8(in.val[0], 2);
+        index.val[1] = vandq_u8(vorrq_u8(vshrq_n_u8(in.val[1], 4), vshlq_n_u8(in.val[0], 4)), mask);
+        index.val[2] = vandq_u8(vorrq_u8(vshrq_n_u8(in.val[2], 6), vshlq_n_u8(in.val[1], 2)), mask);
+        index.val[3] = vandq_u8(in.val[2], mask);
+        result.val[0] = vqtbl4q_u8(lut, index.val[0]);
+        result.val[1] = vqtbl4q_u8(lut, index.val[1]);
+        result.val[2] = vqtbl4q_u8(lut, index.val[2]);
+        result.val[3] = vqtbl4q_u8(lut, index.val[3]);
+        vst4q_u8(reinterpret_cast<uint8_t *>(dst), result);
+        src += 48;
+        len -= 48;
+        dst += 64;
     }
-    if(i)
+    return dst - out;
+}
+#elif defined(__SSSE3__)
+// 功能：SSSE3每次把12字节编码为16个字符（读入16字节，所以剩余不少于16字节时才处理）
+// 先用pshufb把每3字节展开到一个32位字，再用乘法移位得到4个6位索引，最后按索引所在区间加偏移得到字符
+size_t base64_encode_simd(const unsigned char *&src, size_t &len, char *out)
+{
+    const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i shift_lut = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                            '/' - 63, 'A', 0, 0);
+    char *dst = out;
+    while(len >= 16)
     {
-        for(int j = 1; j < 3; j++){
-            char_array_3[j] = '\0';
-        }
-        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-        char_array_4[3] = (char_array_3[2] & 0x3f);
-        for(int j = 0; j < 4; j++){
-            if(j < (i + 1))
-            {
-                ret += base64_chars[char_array_4[j]];
-            }
-            else
-            {
-                ret += '=';
-            }
-        }
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        in = _mm_shuffle_epi8(in, shuffle);
+        const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+        const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+        const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+        const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+        const __m128i index = _mm_or_si128(t1, t3);
+
+        // 0..25 -> 'A'..'Z'，26..51 -> 'a'..'z'，52..61 -> '0'..'9'，62 -> '+'，63 -> '/'
+        __m128i reduced = _mm_subs_epu8(index, _mm_set1_epi8(51));
+        const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), index);
+        reduced = _mm_or_si128(reduced, _mm_and_si128(less, _mm_set1_epi8(13)));
+        const __m128i result = _mm_add_epi8(_mm_shuffle_epi8(shift_lut, reduced), index);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), result);
+        src += 12;
+        len -= 12;
+        dst += 16;
     }
-    return ret;
+    return dst - out;
+}
+#else
+size_t base64_encode_simd(const unsigned char *&, size_t &, char *)
+{
+    return 0;
+}
+#endif
 
+} // namespace
+
+size_t base64_encode_to(const unsigned char *src, size_t len, char *out)
+{
+    size_t written = base64_encode_simd(src, len, out);
+    return written + base64_encode_scalar(src, len, out + written);
+}
+
+void base64_encode_append(const unsigned char *src, size_t len, std::string &out)
+{
+    size_t offset = out.size();
+    out.resize(offset + base64_encoded_size(len));
+    base64_encode_to(src, len, &out[offset]);
+}
+
+std::string base64_encode(unsigned const char* byteToEncode, unsigned int byteLength)
+{
+    // 一次分配好编码后的长度，不再逐字符追加
+    std::string ret(base64_encoded_size(byteLength), '\0');
+    if(byteLength)
+        base64_encode_to(byteToEncode, byteLength, &ret[0]);
+    return ret;
 }
 
 
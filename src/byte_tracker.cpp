@@ -0,0 +1,474 @@
+#include "byte_tracker.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// 卡尔曼滤波的噪声权重，与ByteTrack原实现一致，噪声与目标高度成正比
+static const float kStdWeightPosition = 1.f / 20;
+static const float kStdWeightVelocity = 1.f / 160;
+// 代价矩阵的元素个数不超过该值时使用匈牙利算法，否则使用贪心算法（O(n^3)在200x200时过慢）
+static const int kHungarianMaxCells = 64 * 64;
+
+// 功能：检测框（左上角和右下角坐标）转换为卡尔曼观测量 (cx, cy, a, h)
+static inline void rect_to_xyah(const float rect[4], float xyah[4])
+{
+    float w = rect[2] - rect[0];
+    float h = rect[3] - rect[1];
+    xyah[0] = rect[0] + w * 0.5f;
+    xyah[1] = rect[1] + h * 0.5f;
+    xyah[2] = h > 0 ? w / h : 0.f;
+    xyah[3] = h;
+}
+
+BYTETracker::BYTETracker(int frame_rate, int track_buffer)
+    : track_thresh(0.5f), high_thresh(0.6f), match_thresh(0.8f), frame_id(0), track_id_count(0)
+{
+    max_time_lost = static_cast<int>(frame_rate / 30.0 * track_buffer);
+    if(max_time_lost < 1)
+        max_time_lost = 1;
+}
+
+void BYTETracker::add_track(const Object &object, int det_index, bool activated)
+{
+    float xyah[4];
+    rect_to_xyah(object.rect, xyah);
+    float h = xyah[3];
+    // 位置方差和速度方差，a分量使用固定值
+    float std_pos[4] = {2 * kStdWeightPosition * h, 2 * kStdWeightPosition * h, 1e-2f, 2 * kStdWeightPosition * h};
+    float std_vel[4] = {10 * kStdWeightVelocity * h, 10 * kStdWeightVelocity * h, 1e-5f, 10 * kStdWeightVelocity * h};
+    for(int d = 0; d < 4; d++)
+    {
+        m_mean[d].push_back(xyah[d]);
+        m_mean[d + 4].push_back(0.f);
+        m_p00[d].push_back(std_pos[d] * std_pos[d]);
+        m_p01[d].push_back(0.f);
+        m_p11[d].push_back(std_vel[d] * std_vel[d]);
+    }
+    m_track_id.push_back(++track_id_count);
+    m_state.push_back(Tracked);
+    m_label.push_back(object.label);
+    m_end_frame.push_back(frame_id);
+    m_det_index.push_back(det_index);
+    m_score.push_back(object.prob);
+    m_activated.push_back(activated ? 1 : 0);
+}
+
+// 每个分量的运动模型 F = [1 1; 0 1]，P' = F P F^T + Q
+void BYTETracker::predict()
+{
+    int n = size();
+    float *h = m_mean[3].data();
+    float *vh = m_mean[7].data();
+    for(int i = 0; i < n; i++)
+    {
+        if(m_state[i] != Tracked)
+            vh[i] = 0.f; // 非跟踪状态的轨迹不再按高度速度外推
+    }
+    for(int d = 0; d < 4; d++)
+    {
+        float *pos = m_mean[d].data();
+        float *vel = m_mean[d + 4].data();
+        float *p00 = m_p00[d].data();
+        float *p01 = m_p01[d].data();
+        float *p11 = m_p11[d].data();
+        for(int i = 0; i < n; i++)
+        {
+            float std_pos = d == 2 ? 1e-2f : kStdWeightPosition * h[i];
+            float std_vel = d == 2 ? 1e-5f : kStdWeightVelocity * h[i];
+            pos[i] += vel[i];
+            p00[i] += 2 * p01[i] + p11[i] + std_pos * std_pos;
+            p01[i] += p11[i];
+            p11[i] += std_vel * std_vel;
+        }
+    }
+}
+
+// 观测模型 H = [1 0]，K = P H^T / (H P H^T + R)
+void BYTETracker::update_track(int index, const Object &object, int det_index)
+{
+    float xyah[4];
+    rect_to_xyah(object.rect, xyah);
+    float h = m_mean[3][index];
+    for(int d = 0; d < 4; d++)
+    {
+        float std_meas = d == 2 ? 1e-1f : kStdWeightPosition * h;
+        float &p00 = m_p00[d][index];
+        float &p01 = m_p01[d][index];
+        float &p11 = m_p11[d][index];
+        float s = p00 + std_meas * std_meas;
+        float k0 = p00 / s;
+        float k1 = p01 / s;
+        float innovation = xyah[d] - m_mean[d][index];
+        m_mean[d][index] += k0 * innovation;
+        m_mean[d + 4][index] += k1 * innovation;
+        p11 -= k1 * p01;
+        p00 *= (1.f - k0);
+        p01 *= (1.f - k0);
+    }
+    m_state[index] = Tracked;
+    m_activated[index] = 1;
+    m_score[index] = object.prob;
+    m_end_frame[index] = frame_id;
+    m_det_index[index] = det_index;
+}
+
+void BYTETracker::compact()
+{
+    int n = size();
+    // 超出上限时，最早丢失的轨迹优先删除
+    int alive = 0;
+    for(int i = 0; i < n; i++)
+        alive += m_state[i] != Removed;
+    while(alive > BYTE_TRACK_MAX_COUNT)
+    {
+        int oldest = -1;
+        for(int i = 0; i < n; i++)
+        {
+            if(m_state[i] == Lost && (oldest < 0 || m_end_frame[i] < m_end_frame[oldest]))
+                oldest = i;
+        }
+        if(oldest < 0)
+            break;
+        m_state[oldest] = Removed;
+        alive--;
+    }
+
+    int dst = 0;
+    for(int src = 0; src < n; src++)
+    {
+        if(m_state[src] == Removed)
+            continue;
+        if(dst != src)
+        {
+            for(int d = 0; d < 8; d++)
+                m_mean[d][dst] = m_mean[d][src];
+            for(int d = 0; d < 4; d++)
+            {
+                m_p00[d][dst] = m_p00[d][src];
+                m_p01[d][dst] = m_p01[d][src];
+                m_p11[d][dst] = m_p11[d][src];
+            }
+            m_track_id[dst] = m_track_id[src];
+            m_state[dst] = m_state[src];
+            m_label[dst] = m_label[src];
+            m_end_frame[dst] = m_end_frame[src];
+            m_det_index[dst] = m_det_index[src];
+            m_score[dst] = m_score[src];
+            m_activated[dst] = m_activated[src];
+        }
+        dst++;
+    }
+    for(int d = 0; d < 8; d++)
+        m_mean[d].resize(dst);
+    for(int d = 0; d < 4; d++)
+    {
+        m_p00[d].resize(dst);
+        m_p01[d].resize(dst);
+        m_p11[d].resize(dst);
+    }
+    m_track_id.resize(dst);
+    m_state.resize(dst);
+    m_label.resize(dst);
+    m_end_frame.resize(dst);
+    m_det_index.resize(dst);
+    m_score.resize(dst);
+    m_activated.resize(dst);
+}
+
+void BYTETracker::iou_cost(const std::vector<int> &tracks, const std::vector<Object> &objects, const std::vector<int> &dets)
+{
+    int rows = static_cast<int>(tracks.size());
+    int cols = static_cast<int>(dets.size());
+    m_cost.resize(rows * cols);
+    if(rows == 0 || cols == 0)
+        return;
+
+    // 先把检测框整理为连续数组，内层循环只访问连续内存
+    for(int d = 0; d < 4; d++)
+        m_box[d].resize(cols);
+    for(int c = 0; c < cols; c++)
+    {
+        const float *rect = objects[dets[c]].rect;
+        m_box[0][c] = rect[0];
+        m_box[1][c] = rect[1];
+        m_box[2][c] = rect[2];
+        m_box[3][c] = rect[3];
+    }
+    const float *bx1 = m_box[0].data();
+    const float *by1 = m_box[1].data();
+    const float *bx2 = m_box[2].data();
+    const float *by2 = m_box[3].data();
+
+    for(int r = 0; r < rows; r++)
+    {
+        int t = tracks[r];
+        float h = m_mean[3][t];
+        float w = m_mean[2][t] * h;
+        float tx1 = m_mean[0][t] - w * 0.5f;
+        float ty1 = m_mean[1][t] - h * 0.5f;
+        float tx2 = tx1 + w;
+        float ty2 = ty1 + h;
+        float tarea = w * h;
+        float *row = m_cost.data() + r * cols;
+        for(int c = 0; c < cols; c++)
+        {
+            float iw = std::max(0.f, std::min(tx2, bx2[c]) - std::max(tx1, bx1[c]));
+            float ih = std::max(0.f, std::min(ty2, by2[c]) - std::max(ty1, by1[c]));
+            float inter = iw * ih;
+            float uni = tarea + (bx2[c] - bx1[c]) * (by2[c] - by1[c]) - inter;
+            row[c] = 1.f - (uni > 0.f ? inter / uni : 0.f);
+        }
+        for(int c = 0; c < cols; c++)
+        {
+            if(objects[dets[c]].label != m_label[t])
+                row[c] = 1.f;
+        }
+    }
+}
+
+// 匈牙利算法（势能+最短增广路），要求 rows <= cols，结果写入 m_row_to_col
+void BYTETracker::hungarian(const float *cost, int rows, int cols)
+{
+    const float inf = std::numeric_limits<float>::max();
+    m_hg_u.assign(rows + 1, 0.f);
+    m_hg_v.assign(cols + 1, 0.f);
+    m_hg_p.assign(cols + 1, 0);
+    m_hg_way.assign(cols + 1, 0);
+    m_hg_minv.resize(cols + 1);
+    m_hg_used.resize(cols + 1);
+    for(int i = 1; i <= rows; i++)
+    {
+        m_hg_p[0] = i;
+        int j0 = 0;
+        std::fill(m_hg_minv.begin(), m_hg_minv.end(), inf);
+        std::fill(m_hg_used.begin(), m_hg_used.end(), 0);
+        do
+        {
+            m_hg_used[j0] = 1;
+            int i0 = m_hg_p[j0], j1 = 0;
+            float delta = inf;
+            const float *row = cost + (i0 - 1) * cols;
+            for(int j = 1; j <= cols; j++)
+            {
+                if(m_hg_used[j])
+                    continue;
+                float cur = row[j - 1] - m_hg_u[i0] - m_hg_v[j];
+                if(cur < m_hg_minv[j])
+                {
+                    m_hg_minv[j] = cur;
+                    m_hg_way[j] = j0;
+                }
+                if(m_hg_minv[j] < delta)
+                {
+                    delta = m_hg_minv[j];
+                    j1 = j;
+                }
+            }
+            for(int j = 0; j <= cols; j++)
+            {
+                if(m_hg_used[j])
+                {
+                    m_hg_u[m_hg_p[j]] += delta;
+                    m_hg_v[j] -= delta;
+                }
+                else
+                {
+                    m_hg_minv[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while(m_hg_p[j0] != 0);
+        do
+        {
+            int j1 = m_hg_way[j0];
+            m_hg_p[j0] = m_hg_p[j1];
+            j0 = j1;
+        } while(j0);
+    }
+    m_row_to_col.assign(rows, -1);
+    for(int j = 1; j <= cols; j++)
+    {
+        if(m_hg_p[j] != 0)
+            m_row_to_col[m_hg_p[j] - 1] = j - 1;
+    }
+}
+
+void BYTETracker::linear_assignment(int rows, int cols, float thresh)
+{
+    m_matches.clear();
+    m_row_matched.assign(rows, 0);
+    m_col_matched.assign(cols, 0);
+    if(rows == 0 || cols == 0)
+        return;
+
+    if(rows * cols <= kHungarianMaxCells)
+    {
+        // 超过阈值的代价截断，避免不可匹配的元素影响其它元素的分配
+        float limit = thresh + 1e-4f;
+        bool transpose = rows > cols;
+        const float *cost = m_cost.data();
+        if(transpose)
+        {
+            m_transposed.resize(rows * cols);
+            for(int r = 0; r < rows; r++)
+                for(int c = 0; c < cols; c++)
+                    m_transposed[c * rows + r] = std::min(m_cost[r * cols + c], limit);
+            cost = m_transposed.data();
+            hungarian(cost, cols, rows);
+        }
+        else
+        {
+            for(int i = 0; i < rows * cols; i++)
+                m_cost[i] = std::min(m_cost[i], limit);
+            hungarian(cost, rows, cols);
+        }
+        int n = transpose ? cols : rows;
+        for(int i = 0; i < n; i++)
+        {
+            int j = m_row_to_col[i];
+            if(j < 0)
+                continue;
+            int r = transpose ? j : i;
+            int c = transpose ? i : j;
+            if(m_cost[r * cols + c] > thresh)
+                continue;
+            m_matches.emplace_back(r, c);
+        }
+    }
+    else
+    {
+        // 贪心：按代价从小到大依次匹配
+        m_greedy.clear();
+        for(int i = 0; i < rows * cols; i++)
+        {
+            if(m_cost[i] <= thresh)
+                m_greedy.emplace_back(m_cost[i], i);
+        }
+        std::sort(m_greedy.begin(), m_greedy.end());
+        for(const auto &item : m_greedy)
+        {
+            int r = item.second / cols;
+            int c = item.second % cols;
+            if(m_row_matched[r] || m_col_matched[c])
+                continue;
+            m_row_matched[r] = 1;
+            m_col_matched[c] = 1;
+            m_matches.emplace_back(r, c);
+        }
+        return;
+    }
+    for(const auto &match : m_matches)
+    {
+        m_row_matched[match.first] = 1;
+        m_col_matched[match.second] = 1;
+    }
+}
+
+const std::vector<STrack> &BYTETracker::update(const std::vector<Object> &objects)
+{
+    frame_id++;
+    int track_count = size();
+    for(int i = 0; i < track_count; i++)
+        m_det_index[i] = -1;
+
+    // 按置信度拆分为高分框和低分框
+    m_high_dets.clear();
+    m_low_dets.clear();
+    for(int k = 0; k < static_cast<int>(objects.size()); k++)
+    {
+        if(objects[k].prob >= track_thresh)
+            m_high_dets.push_back(k);
+        else if(objects[k].prob > 0.1f)
+            m_low_dets.push_back(k);
+    }
+
+    // 已确认的跟踪/丢失轨迹进入第一次关联，未确认轨迹单独关联
+    m_pool.clear();
+    m_unconfirmed.clear();
+    for(int i = 0; i < track_count; i++)
+    {
+        if(m_state[i] == Tracked && !m_activated[i])
+            m_unconfirmed.push_back(i);
+        else if(m_state[i] == Tracked || m_state[i] == Lost)
+            m_pool.push_back(i);
+    }
+    predict();
+
+    // 第一次关联：高分框 与 跟踪/丢失轨迹
+    iou_cost(m_pool, objects, m_high_dets);
+    linear_assignment(static_cast<int>(m_pool.size()), static_cast<int>(m_high_dets.size()), match_thresh);
+    for(const auto &match : m_matches)
+        update_track(m_pool[match.first], objects[m_high_dets[match.second]], m_high_dets[match.second]);
+    m_remain_dets.clear();
+    for(int c = 0; c < static_cast<int>(m_high_dets.size()); c++)
+    {
+        if(!m_col_matched[c])
+            m_remain_dets.push_back(m_high_dets[c]);
+    }
+    m_remain_tracks.clear();
+    for(int r = 0; r < static_cast<int>(m_pool.size()); r++)
+    {
+        if(!m_row_matched[r] && m_state[m_pool[r]] == Tracked)
+            m_remain_tracks.push_back(m_pool[r]);
+    }
+
+    // 第二次关联：低分框 与 剩余的跟踪轨迹，仍未关联的轨迹标记为丢失
+    iou_cost(m_remain_tracks, objects, m_low_dets);
+    linear_assignment(static_cast<int>(m_remain_tracks.size()), static_cast<int>(m_low_dets.size()), 0.5f);
+    for(const auto &match : m_matches)
+        update_track(m_remain_tracks[match.first], objects[m_low_dets[match.second]], m_low_dets[match.second]);
+    for(int r = 0; r < static_cast<int>(m_remain_tracks.size()); r++)
+    {
+        if(!m_row_matched[r])
+            m_state[m_remain_tracks[r]] = Lost;
+    }
+
+    // 第三次关联：剩余高分框 与 未确认轨迹，未关联的未确认轨迹直接删除
+    iou_cost(m_unconfirmed, objects, m_remain_dets);
+    linear_assignment(static_cast<int>(m_unconfirmed.size()), static_cast<int>(m_remain_dets.size()), 0.7f);
+    for(const auto &match : m_matches)
+        update_track(m_unconfirmed[match.first], objects[m_remain_dets[match.second]], m_remain_dets[match.second]);
+    for(int r = 0; r < static_cast<int>(m_unconfirmed.size()); r++)
+    {
+        if(!m_row_matched[r])
+            m_state[m_unconfirmed[r]] = Removed;
+    }
+
+    // 剩余的高分框新建轨迹，第一帧直接确认，之后需要再关联一次才确认
+    for(int c = 0; c < static_cast<int>(m_remain_dets.size()); c++)
+    {
+        if(m_col_matched[c])
+            continue;
+        const Object &object = objects[m_remain_dets[c]];
+        if(object.prob >= high_thresh)
+            add_track(object, m_remain_dets[c], frame_id == 1);
+    }
+
+    // 丢失时间过长的轨迹删除
+    for(int i = 0; i < track_count; i++)
+    {
+        if(m_state[i] == Lost && frame_id - m_end_frame[i] > max_time_lost)
+            m_state[i] = Removed;
+    }
+    compact();
+
+    m_output.clear();
+    for(int i = 0; i < size(); i++)
+    {
+        if(m_state[i] != Tracked || !m_activated[i])
+            continue;
+        STrack track;
+        track.track_id = m_track_id[i];
+        track.det_index = m_det_index[i];
+        track.label = m_label[i];
+        track.score = m_score[i];
+        float h = m_mean[3][i];
+        float w = m_mean[2][i] * h;
+        track.tlwh[0] = m_mean[0][i] - w * 0.5f;
+        track.tlwh[1] = m_mean[1][i] - h * 0.5f;
+        track.tlwh[2] = w;
+        track.tlwh[3] = h;
+        m_output.push_back(track);
+    }
+    return m_output;
+}
@@ -0,0 +1,139 @@
+#include "clock_service.h"
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <ctime>
+
+namespace {
+
+std::atomic<int64_t> g_tz_expire_s {INT64_MIN};
+std::atomic<int> g_tz_offset_s {0};
+
+// 功能：写入定宽的十进制数字
+inline char *put_digits(char *p, unsigned value, int width)
+{
+    for(int i = width - 1; i >= 0; i--)
+    {
+        p[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    return p + width;
+}
+
+int64_t floor_div(int64_t a, int64_t b)
+{
+    int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+// 功能：1970-01-01起的天数转换为年月日（公历）
+void civil_from_days(int64_t days, int64_t &year, unsigned &month, unsigned &day)
+{
+    days += 719468;
+    int64_t era = floor_div(days, 146097);
+    unsigned doe = static_cast<unsigned>(days - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = static_cast<int64_t>(yoe) + era * 400 + (month <= 2);
+}
+
+// 功能：某一秒（本地时间）格式化好的前缀，每个线程、每种格式一份
+struct PrefixCache
+{
+    int64_t local_s = INT64_MIN;
+    char text[20];
+    size_t len = 0;
+};
+
+// 功能：按本地时间的秒数生成 "年月日时分秒" 前缀，iso为true时带分隔符
+const PrefixCache &prefix(PrefixCache &cache, int64_t local_s, bool iso)
+{
+    if(cache.local_s == local_s)
+        return cache;
+    int64_t days = floor_div(local_s, 86400);
+    unsigned second_of_day = static_cast<unsigned>(local_s - days * 86400);
+    int64_t year;
+    unsigned month, day;
+    civil_from_days(days, year, month, day);
+
+    char *p = cache.text;
+    p = put_digits(p, static_cast<unsigned>(year), 4);
+    if(iso) *p++ = '-';
+    p = put_digits(p, month, 2);
+    if(iso) *p++ = '-';
+    p = put_digits(p, day, 2);
+    if(iso) *p++ = 'T';
+    p = put_digits(p, second_of_day / 3600, 2);
+    if(iso) *p++ = ':';
+    p = put_digits(p, second_of_day / 60 % 60, 2);
+    if(iso) *p++ = ':';
+    p = put_digits(p, second_of_day % 60, 2);
+    cache.len = p - cache.text;
+    cache.local_s = local_s;
+    return cache;
+}
+
+} // namespace
+
+int64_t ClockService::now_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int ClockService::tz_offset_s()
+{
+    time_t now = time(nullptr);
+    if(static_cast<int64_t>(now) < g_tz_expire_s.load(std::memory_order_relaxed))
+        return g_tz_offset_s.load(std::memory_order_relaxed);
+    // 多个线程同时过期时各自计算一次，结果相同
+    struct tm local;
+    localtime_r(&now, &local);
+    g_tz_offset_s.store(static_cast<int>(local.tm_gmtoff), std::memory_order_relaxed);
+    g_tz_expire_s.store(static_cast<int64_t>(now) + CLOCK_TZ_REFRESH_S, std::memory_order_relaxed);
+    return static_cast<int>(local.tm_gmtoff);
+}
+
+void ClockService::append_iso8601(int64_t ms, std::string &out)
+{
+    thread_local PrefixCache cache;
+    int offset = tz_offset_s();
+    int64_t local_ms = ms + static_cast<int64_t>(offset) * 1000;
+    int64_t local_s = floor_div(local_ms, 1000);
+    const PrefixCache &text = prefix(cache, local_s, true);
+
+    char suffix[16];
+    char *p = suffix;
+    *p++ = '.';
+    p = put_digits(p, static_cast<unsigned>(local_ms - local_s * 1000), 3);
+    *p++ = offset >= 0 ? '+' : '-';
+    unsigned abs_offset = static_cast<unsigned>(offset >= 0 ? offset : -offset);
+    p = put_digits(p, abs_offset / 3600, 2);
+    *p++ = ':';
+    p = put_digits(p, abs_offset / 60 % 60, 2);
+    out.append(text.text, text.len);
+    out.append(suffix, p - suffix);
+}
+
+std::string ClockService::iso8601(int64_t ms)
+{
+    std::string out;
+    out.reserve(29);
+    append_iso8601(ms, out);
+    return out;
+}
+
+std::string ClockService::compact(int64_t ms)
+{
+    thread_local PrefixCache cache;
+    int64_t local_ms = ms + static_cast<int64_t>(tz_offset_s()) * 1000;
+    int64_t local_s = floor_div(local_ms, 1000);
+    const PrefixCache &text = prefix(cache, local_s, false);
+    std::string out(text.text, text.len);
+    char millis[3];
+    put_digits(millis, static_cast<unsigned>(local_ms - local_s * 1000), 3);
+    out.append(millis, 3);
+    return out;
+}
@@ -1,4 +1,5 @@
 #include "frame_concate.h"
+#include "snapshot_encoder.h"
 
 // 功能：构造函数，初始化类的成员变量   传入的参数列表 ： 成员变量1（形参1），成员变量2（形参2）{} 或者用this也可以
 FrameConcate::FrameConcate(int numInputs, int outputFPS, int width, int height) : inputNums(numInputs), outputFps(outputFPS), frameWidth(width), frameHeight(height)
@@ -17,74 +18,101 @@ FrameConcate::FrameConcate(int numInputs, int outputFPS, int width, int height)
     {
         show_size_plan = DisplaySize::SIZE_3X3;
     }
-    else if( numInputs > 9 && numInputs <= 16)
+    else
     {
+        // 超过16路时只显示前16路
+        if(numInputs > 16)
+            std::cout << "show over size, numInputs is : " << numInputs << std::endl;
         show_size_plan = DisplaySize::SIZE_4X4;
     }
-    else
+    if(outputFps <= 0)
+        outputFps = 25;
+
+    int tileWidth = frameWidth / show_size_plan;
+    int tileHeight = frameHeight / show_size_plan;
+    for(int index = 0; index < inputNums; index++)
+    {
+        if(index < show_size_plan * show_size_plan)
+            buffers[index].rect = cv::Rect(index % show_size_plan * tileWidth, index / show_size_plan * tileHeight, tileWidth, tileHeight);
+    }
+    // 画布只在这里清零一次，没有输入的格子一直是黑色
+    for(int i = 0; i < 2; i++)
     {
-        std::cout << "show over size, numInputs is : " << numInputs << std::endl;
+        canvas[i] = cv::Mat::zeros(frameHeight, frameWidth, CV_8UC3);
+        canvasGeneration[i].assign(inputNums, 0);
     }
 }
 
 // 输入每路RTSP解码后的一帧，和对应的输入流编号，存储在对应该流的缓冲区内  inputIndex指的是第几个摄像头
-void FrameConcate::addFrame(int inputIndex, const cv::Mat &frame)
+void FrameConcate::addFrame(int inputIndex, const cv::Mat &frame, const std::list<objectInfo> &objects)
 {
+    if(inputIndex < 0 || inputIndex >= inputNums || buffers[inputIndex].rect.empty() || frame.empty())
+        return;
     // 对缓冲区的锁进行上锁，使用unique_lock锁管理器管理互斥锁mutex
     std::unique_lock<std::mutex> lock(*buffers[inputIndex].mutex); // mutex是一个智能指针，该指针指向一个互斥锁， lock是一个unique_lock对象（锁管理器）
-    buffers[inputIndex].frame = frame.clone(); // 克隆：避免直接引用输入帧，防止输入帧被修改
-    buffers[inputIndex].hasNewFrame = true;
+    buffers[inputIndex].frame = frame; // 只引用输入帧：帧处理线程输出的帧是只读的，拼接和子码流共用同一份数据
+    buffers[inputIndex].objects = objects;
+    buffers[inputIndex].generation++;
 }
 
 
 // 按照设定帧率输出帧
 cv::Mat FrameConcate::getConcateFrame()
 {
-    auto startTime = std::chrono::steady_clock::now();
-    auto frameDuration = std::chrono::milliseconds( 1000 / outputFps);
+    auto frameDuration = std::chrono::microseconds(1000000 / outputFps);
+    auto now = std::chrono::steady_clock::now();
+    // 输出线程被阻塞过久时重新对齐，不连续补帧
+    if(nextFrameTime + frameDuration < now)
+        nextFrameTime = now;
+    std::this_thread::sleep_until(nextFrameTime); // 没到那就等到为止
+    nextFrameTime += frameDuration; // 下一帧的到达时间
 
-    cv::Mat concateFrame = cv::Mat::zeros(frameHeight, frameWidth, CV_8UC3); // 用于存储拼接的帧
-    bool allFrameReady = false; // 用于标记所有输入流的帧是否准备好
-    std::vector<bool> framesProcessed(inputNums, false); //用于记录每个输入流的帧是否已经处理，初始为false, 大小为inputNums
+    // 取走有新帧的输入，交换后addFrame可以继续写入，缩放时不持锁
+    std::vector<int> dirty;
+    for(int index = 0; index < inputNums; index++)
+    {
+        FrameBuffer &buffer = buffers[index];
+        if(buffer.rect.empty())
+            continue;
+        std::unique_lock<std::mutex> lock(*buffer.mutex);
+        if(buffer.generation == buffer.resizeGeneration)
+            continue;
+        cv::swap(buffer.frame, buffer.sourceFrame);
+        buffer.objects.swap(buffer.sourceObjects);
+        buffer.resizeGeneration = buffer.generation;
+        dirty.push_back(index);
+    }
 
-    while(!allFrameReady) // 开始对所有输入流的帧进行处理, 直到每个输入流均有帧处理好，并拼接到目标帧concatedFrame而结束
+    auto resize = [this, &dirty](const cv::Range &range)
     {
-        allFrameReady = true; // 默认所有帧都准备好了
-        for( int index = 0; index < inputNums; index++)
+        for(int i = range.start; i < range.end; i++)
         {
-            std::unique_lock<std::mutex> lock(*buffers[index].mutex);
-            if(buffers[index].hasNewFrame && !buffers[index].frame.empty() && !framesProcessed[index])
-            { // 进入要求： 有新的帧到达，当前输入流的缓冲区帧不为空，该帧未被处理
-                cv::resize(buffers[index].frame, buffers[index].resizeFrame, cv::Size(frameWidth / show_size_plan, frameHeight / show_size_plan));
-                buffers[index].hasNewFrame = false; // 该帧处理完了，没新帧了，除非addFrame在buffer中添加新的帧
-                framesProcessed[index] = true; // 标记该输入流的缓存区的帧已经被处理了
-            }
-
-            if(!framesProcessed[index])
-            { 
-                allFrameReady = false; // 如果该通道的帧尚未处理，设置为 false表示该index对应的输入流的帧未准备好
-            }
-
-            // 如果该输入流的调整后的帧不为空，则将其拼接到目标帧中它该在的位置
-            if(!buffers[index].resizeFrame.empty()) 
-            {   // 用于表示矩形区域的类 四个参数：矩形区域左上角的x坐标，左上角y坐标，矩形的宽度，矩形的高度（index % show_size_plan和index / show_size_plan）
-                buffers[index].resizeFrame.copyTo(concateFrame(cv::Rect(index % show_size_plan * frameWidth / show_size_plan, index / show_size_plan * frameHeight / show_size_plan, 
-                    frameWidth / show_size_plan, frameHeight / show_size_plan)));
+            FrameBuffer &buffer = buffers[dirty[i]];
+            cv::resize(buffer.sourceFrame, buffer.resizeFrame, buffer.rect.size());
+            if(!buffer.sourceObjects.empty())
+            {
+                SnapshotEncoder::draw_objects(buffer.resizeFrame, buffer.sourceObjects,
+                                              static_cast<float>(buffer.rect.width) / buffer.sourceFrame.cols,
+                                              static_cast<float>(buffer.rect.height) / buffer.sourceFrame.rows);
             }
-            else
-            { // 如果缓存中没有帧，则默认该位置为空白
-                cv::Mat defaultFrame = cv::Mat::zeros(frameHeight / show_size_plan, frameWidth / show_size_plan, CV_8UC3);  // 返回空帧
-                defaultFrame.copyTo(concateFrame(cv::Rect(index % show_size_plan * frameWidth / show_size_plan, index / show_size_plan * frameHeight / show_size_plan, 
-                    frameWidth / show_size_plan, frameHeight / show_size_plan)));
-            }
-        }
-        auto elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
-        if( elapsedTime > frameDuration) // 如果超时，无论是否有输入流的帧准备好，则退出
-        {
-            break; // 退出while
         }
+    };
+    if(dirty.size() > 1)
+        cv::parallel_for_(cv::Range(0, static_cast<int>(dirty.size())), resize);
+    else if(dirty.size() == 1)
+        resize(cv::Range(0, 1));
+
+    // 两块画布轮流绘制，只更新这块画布上已过期的格子（包括上一帧在另一块画布上更新的格子）
+    cv::Mat &concateFrame = canvas[backCanvas];
+    std::vector<uint64_t> &drawn = canvasGeneration[backCanvas];
+    for(int index = 0; index < inputNums; index++)
+    {
+        FrameBuffer &buffer = buffers[index];
+        if(buffer.resizeFrame.empty() || drawn[index] == buffer.resizeGeneration)
+            continue;
+        buffer.resizeFrame.copyTo(concateFrame(buffer.rect));
+        drawn[index] = buffer.resizeGeneration;
     }
-    nextFrameTime += frameDuration; // 下一帧的到达时间
-    std::this_thread::sleep_until(nextFrameTime); // 没到那就等到为止
+    backCanvas = 1 - backCanvas;
     return concateFrame;
 }
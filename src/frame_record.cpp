@@ -0,0 +1,510 @@
+#include "frame_record.h"
+#include "async_log.h"
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include "opencv2/imgcodecs.hpp"
+
+static const char FRAME_RECORD_MAGIC[8] = {'S', 'W', 'R', 'E', 'C', 'O', 'R', 'D'};
+static const size_t FRAME_RECORD_FILE_HEADER_BYTES = 16;
+static const size_t FRAME_RECORD_HEADER_BYTES = 24;
+static const size_t FRAME_RECORD_OBJECT_BYTES = 40;
+
+// 小端序定长编解码，与主机字节序和结构体布局无关
+static void put_u32(uint8_t *dst, uint32_t value)
+{
+    for(int i = 0; i < 4; i++)
+        dst[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+static void put_u64(uint8_t *dst, uint64_t value)
+{
+    for(int i = 0; i < 8; i++)
+        dst[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+static uint32_t get_u32(const uint8_t *src)
+{
+    uint32_t value = 0;
+    for(int i = 0; i < 4; i++)
+        value |= static_cast<uint32_t>(src[i]) << (8 * i);
+    return value;
+}
+
+static uint64_t get_u64(const uint8_t *src)
+{
+    uint64_t value = 0;
+    for(int i = 0; i < 8; i++)
+        value |= static_cast<uint64_t>(src[i]) << (8 * i);
+    return value;
+}
+
+static void put_f32(uint8_t *dst, float value)
+{
+    static_assert(sizeof(float) == 4, "float must be IEEE 754 single precision");
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_u32(dst, bits);
+}
+
+static float get_f32(const uint8_t *src)
+{
+    uint32_t bits = get_u32(src);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// 功能：读取并解码一条记录头，文件结束或不完整时返回false
+static bool read_header(FILE *file, FrameRecordHeader &header)
+{
+    uint8_t data[FRAME_RECORD_HEADER_BYTES];
+    if(fread(data, 1, sizeof(data), file) != sizeof(data))
+        return false;
+    header.type = get_u32(data);
+    header.size = get_u32(data + 4);
+    header.frame_seq = get_u64(data + 8);
+    header.timestamp_us = static_cast<int64_t>(get_u64(data + 16));
+    return true;
+}
+
+// 功能：解码检测结果记录的数据，数据长度与目标数不符时返回false
+static bool decode_result(const uint8_t *data, size_t size, RecordedResult &result)
+{
+    if(size < 4)
+        return false;
+    uint32_t count = get_u32(data);
+    if(count > OBJ_NUMS_MAX_SIZE || size != 4 + count * FRAME_RECORD_OBJECT_BYTES)
+        return false;
+    result.resize(count);
+    const uint8_t *src = data + 4;
+    for(detect_result_t &object : result)
+    {
+        memcpy(object.name, src, OBJ_NAME_MAX_SIZE);
+        object.box.left = static_cast<int32_t>(get_u32(src + 16));
+        object.box.right = static_cast<int32_t>(get_u32(src + 20));
+        object.box.top = static_cast<int32_t>(get_u32(src + 24));
+        object.box.bottom = static_cast<int32_t>(get_u32(src + 28));
+        object.prop = get_f32(src + 32);
+        object.track_id = static_cast<int32_t>(get_u32(src + 36));
+        src += FRAME_RECORD_OBJECT_BYTES;
+    }
+    return true;
+}
+
+// 功能：steady_clock的微秒数
+static int64_t steady_now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 功能：打开录制文件并检查文件头，返回的文件位于第一条记录
+static FILE *open_record_file(const std::string &path)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if(!file)
+    {
+        std::cout << "cannot open record file " << path << std::endl;
+        return nullptr;
+    }
+    uint8_t header[FRAME_RECORD_FILE_HEADER_BYTES];
+    if(fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, FRAME_RECORD_MAGIC, sizeof(FRAME_RECORD_MAGIC)) != 0)
+    {
+        std::cout << "not a record file " << path << std::endl;
+        fclose(file);
+        return nullptr;
+    }
+    uint32_t version = get_u32(header + 8);
+    uint32_t header_bytes = get_u32(header + 12);
+    if(version != FRAME_RECORD_VERSION || header_bytes < FRAME_RECORD_FILE_HEADER_BYTES || fseek(file, header_bytes, SEEK_SET) != 0)
+    {
+        std::cout << "unsupported record file " << path << ", version " << version << ", expected " << FRAME_RECORD_VERSION << std::endl;
+        fclose(file);
+        return nullptr;
+    }
+    return file;
+}
+
+// 功能：从当前位置读入所有检测结果，跳过帧数据
+static void read_results(FILE *file, std::map<uint64_t, RecordedResult> &results)
+{
+    FrameRecordHeader header;
+    std::vector<uint8_t> data;
+    while(read_header(file, header))
+    {
+        if(header.type != RECORD_RESULT)
+        {
+            if(fseek(file, header.size, SEEK_CUR) != 0)
+                break;
+            continue;
+        }
+        data.resize(header.size);
+        if(!data.empty() && fread(data.data(), 1, data.size(), file) != data.size())
+            break; // 文件最后一条记录不完整（录制时进程被结束）
+        RecordedResult result;
+        if(!decode_result(data.data(), data.size(), result))
+        {
+            std::cout << "bad result record, frame " << header.frame_seq << std::endl;
+            continue;
+        }
+        results[header.frame_seq].swap(result);
+    }
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    close();
+}
+
+bool FrameRecorder::open(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file = fopen(path.c_str(), "wb");
+    if(!m_file)
+    {
+        std::cout << "cannot create record file " << path << std::endl;
+        return false;
+    }
+    uint8_t header[FRAME_RECORD_FILE_HEADER_BYTES];
+    memcpy(header, FRAME_RECORD_MAGIC, sizeof(FRAME_RECORD_MAGIC));
+    put_u32(header + 8, FRAME_RECORD_VERSION);
+    put_u32(header + 12, FRAME_RECORD_FILE_HEADER_BYTES);
+    fwrite(header, 1, sizeof(header), m_file);
+    std::cout << "record to " << path << std::endl;
+    return true;
+}
+
+void FrameRecorder::close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_file)
+    {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+void FrameRecorder::write_frame(uint64_t frame_seq, int64_t timestamp_us, const cv::Mat &frame)
+{
+    // 编码在锁外进行，写结果的线程不等待编码
+    static const std::vector<int> compression_params = {cv::IMWRITE_JPEG_QUALITY, FRAME_RECORD_JPEG_QUALITY};
+    thread_local std::vector<uchar> jpeg;
+    if(!cv::imencode(".jpg", frame, jpeg, compression_params))
+        return;
+    write_record(RECORD_FRAME, frame_seq, timestamp_us, jpeg.data(), jpeg.size());
+}
+
+void FrameRecorder::write_result(uint64_t frame_seq, const detect_result_group_t &result)
+{
+    int count = std::max(0, std::min(result.count, OBJ_NUMS_MAX_SIZE));
+    uint8_t data[4 + OBJ_NUMS_MAX_SIZE * FRAME_RECORD_OBJECT_BYTES];
+    put_u32(data, static_cast<uint32_t>(count));
+    uint8_t *dst = data + 4;
+    for(int i = 0; i < count; i++)
+    {
+        const detect_result_t &object = result.results[i];
+        // 名称第一个\0之后补0，同样的结果写出的字节相同
+        size_t name_len = strnlen(object.name, OBJ_NAME_MAX_SIZE);
+        memcpy(dst, object.name, name_len);
+        memset(dst + name_len, 0, OBJ_NAME_MAX_SIZE - name_len);
+        put_u32(dst + 16, static_cast<uint32_t>(object.box.left));
+        put_u32(dst + 20, static_cast<uint32_t>(object.box.right));
+        put_u32(dst + 24, static_cast<uint32_t>(object.box.top));
+        put_u32(dst + 28, static_cast<uint32_t>(object.box.bottom));
+        put_f32(dst + 32, object.prop);
+        put_u32(dst + 36, static_cast<uint32_t>(object.track_id));
+        dst += FRAME_RECORD_OBJECT_BYTES;
+    }
+    write_record(RECORD_RESULT, frame_seq, 0, data, dst - data);
+}
+
+void FrameRecorder::write_record(uint32_t type, uint64_t frame_seq, int64_t timestamp_us, const void *data, size_t size)
+{
+    uint8_t header[FRAME_RECORD_HEADER_BYTES];
+    put_u32(header, type);
+    put_u32(header + 4, static_cast<uint32_t>(size));
+    put_u64(header + 8, frame_seq);
+    put_u64(header + 16, static_cast<uint64_t>(timestamp_us));
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(!m_file)
+        return;
+    if(fwrite(header, 1, sizeof(header), m_file) != sizeof(header) || (size > 0 && fwrite(data, 1, size, m_file) != size))
+    {
+        ALOG_EVERY_MS(ERROR, 1000) << "write record file error";
+    }
+}
+
+FrameReplayer::~FrameReplayer()
+{
+    if(m_file)
+        fclose(m_file);
+}
+
+bool FrameReplayer::open(const std::string &path)
+{
+    m_file = open_record_file(path);
+    if(!m_file)
+        return false;
+    m_first_record = ftell(m_file);
+    read_results(m_file, m_results);
+    rewind();
+    return true;
+}
+
+void FrameReplayer::rewind()
+{
+    if(m_file)
+    {
+        clearerr(m_file);
+        fseek(m_file, m_first_record, SEEK_SET);
+    }
+}
+
+bool FrameReplayer::next(uint64_t &frame_seq, int64_t &timestamp_us, cv::Mat &frame)
+{
+    if(!m_file)
+        return false;
+    FrameRecordHeader header;
+    while(read_header(m_file, header))
+    {
+        if(header.type != RECORD_FRAME)
+        {
+            if(fseek(m_file, header.size, SEEK_CUR) != 0)
+                return false;
+            continue;
+        }
+        m_buffer.resize(header.size);
+        if(fread(m_buffer.data(), 1, m_buffer.size(), m_file) != m_buffer.size())
+            return false;
+        frame = cv::imdecode(m_buffer, cv::IMREAD_COLOR);
+        if(frame.empty())
+            continue;
+        frame_seq = header.frame_seq;
+        timestamp_us = header.timestamp_us;
+        return true;
+    }
+    return false;
+}
+
+bool FrameReplayer::load_results(const std::string &path, std::map<uint64_t, RecordedResult> &results)
+{
+    FILE *file = open_record_file(path);
+    if(!file)
+        return false;
+    read_results(file, results);
+    fclose(file);
+    return true;
+}
+
+bool ReplayConfig::is_replay_url(const std::string &url)
+{
+    return url.compare(0, 9, "replay://") == 0;
+}
+
+ReplayConfig ReplayConfig::parse(const std::string &url)
+{
+    ReplayConfig config;
+    std::string rest = url.substr(9);
+    size_t query = rest.find('?');
+    config.path = rest.substr(0, query);
+    if(query == std::string::npos)
+        return config;
+    std::istringstream params(rest.substr(query + 1));
+    std::string param;
+    while(std::getline(params, param, '&'))
+    {
+        size_t equal = param.find('=');
+        std::string key = param.substr(0, equal);
+        std::string value = equal == std::string::npos ? std::string() : param.substr(equal + 1);
+        if(key == "speed")
+            config.speed = std::max(0.0, std::atof(value.c_str()));
+        else if(key == "infer")
+            config.infer = value;
+        else if(key == "expect")
+            config.expect = value;
+        else if(key == "save")
+            config.save = value;
+        else if(key == "loop")
+            config.loop = value != "0";
+        else
+            std::cout << "unknown replay parameter " << key << std::endl;
+    }
+    return config;
+}
+
+ReplayReport &ReplayReport::global()
+{
+    static ReplayReport report;
+    return report;
+}
+
+void ReplayReport::camera_started(int camera_index, const std::map<uint64_t, RecordedResult> &expected, const std::string &save_path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_cameras.empty())
+        m_start_us = steady_now_us();
+    Camera &camera = m_cameras[camera_index];
+    camera.expected = expected;
+    camera.finished = false;
+    if(!save_path.empty())
+    {
+        camera.save.reset(new FrameRecorder());
+        if(!camera.save->open(save_path))
+            camera.save.reset();
+    }
+}
+
+bool ReplayReport::camera_finished(int camera_index)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cameras[camera_index].finished = true;
+    for(const auto &item : m_cameras)
+    {
+        if(!item.second.finished)
+            return false;
+    }
+    return true;
+}
+
+void ReplayReport::frame_read(int camera_index, uint64_t frame_seq, double read_ms)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cameras[camera_index].read_time_us[frame_seq] = steady_now_us();
+    m_read_ms.push_back(read_ms);
+    m_frames_read++;
+}
+
+void ReplayReport::infer_submitted(int camera_index, uint64_t frame_seq)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cameras[camera_index].submit_time_us[frame_seq] = steady_now_us();
+}
+
+void ReplayReport::infer_done(uint64_t frame_seq, const detect_result_group_t &result)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto camera_iter = m_cameras.find(result.id);
+    if(camera_iter == m_cameras.end())
+        return;
+    Camera &camera = camera_iter->second;
+    auto submit_iter = camera.submit_time_us.find(frame_seq);
+    if(submit_iter != camera.submit_time_us.end())
+    {
+        m_infer_ms.push_back((steady_now_us() - submit_iter->second) / 1000.0);
+        camera.submit_time_us.erase(submit_iter);
+    }
+    if(camera.save)
+        camera.save->write_result(frame_seq, result);
+
+    auto expected_iter = camera.expected.find(frame_seq);
+    if(expected_iter == camera.expected.end())
+    {
+        m_missing++;
+        return;
+    }
+    m_compared++;
+    if(!same_result(expected_iter->second, result))
+    {
+        m_mismatched++;
+        ALOG_EVERY_MS(WARNING, 1000) << "replay result mismatch, camera " << result.id << " frame " << frame_seq
+                                     << " expected " << expected_iter->second.size() << " objects, got " << result.count;
+    }
+}
+
+void ReplayReport::frame_processed(int camera_index, uint64_t frame_seq)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto camera_iter = m_cameras.find(camera_index);
+    if(camera_iter == m_cameras.end())
+        return;
+    auto read_iter = camera_iter->second.read_time_us.find(frame_seq);
+    if(read_iter == camera_iter->second.read_time_us.end())
+        return;
+    m_last_processed_us = steady_now_us();
+    m_end_to_end_ms.push_back((m_last_processed_us - read_iter->second) / 1000.0);
+    camera_iter->second.read_time_us.erase(read_iter);
+    m_frames_processed++;
+}
+
+bool ReplayReport::same_result(const RecordedResult &expected, const detect_result_group_t &actual)
+{
+    if(static_cast<int>(expected.size()) != actual.count)
+        return false;
+    for(size_t i = 0; i < expected.size(); i++)
+    {
+        const detect_result_t &a = expected[i];
+        const detect_result_t &b = actual.results[i];
+        if(strncmp(a.name, b.name, OBJ_NAME_MAX_SIZE) != 0 ||
+           std::abs(a.box.left - b.box.left) > REPLAY_BOX_TOLERANCE || std::abs(a.box.right - b.box.right) > REPLAY_BOX_TOLERANCE ||
+           std::abs(a.box.top - b.box.top) > REPLAY_BOX_TOLERANCE || std::abs(a.box.bottom - b.box.bottom) > REPLAY_BOX_TOLERANCE ||
+           std::fabs(a.prop - b.prop) > REPLAY_PROP_TOLERANCE)
+            return false;
+    }
+    return true;
+}
+
+std::string ReplayReport::percentiles(std::vector<double> &samples)
+{
+    if(samples.empty())
+        return "no samples";
+    std::sort(samples.begin(), samples.end());
+    auto at = [&samples](double q) { return samples[std::min(samples.size() - 1, static_cast<size_t>(q * samples.size()))]; };
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << "p50 " << at(0.5) << " ms, p90 " << at(0.9) << " ms, p99 " << at(0.99)
+        << " ms, max " << samples.back() << " ms (" << samples.size() << " frames)";
+    return out.str();
+}
+
+bool ReplayReport::finish(int timeout_ms)
+{
+    // 处理数不再增加超过timeout_ms时不再等待，被丢弃或跳过的帧不会被处理
+    uint64_t last_processed = 0;
+    int64_t last_progress_us = steady_now_us();
+    while(true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            bool drained = true;
+            for(const auto &item : m_cameras)
+                drained = drained && item.second.read_time_us.empty();
+            if(drained)
+                break;
+            if(m_frames_processed != last_processed)
+            {
+                last_processed = m_frames_processed;
+                last_progress_us = steady_now_us();
+            }
+        }
+        if(steady_now_us() - last_progress_us > timeout_ms * 1000LL)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(auto &item : m_cameras)
+    {
+        if(item.second.save)
+            item.second.save->close();
+    }
+    double elapsed_s = std::max<int64_t>(1, m_last_processed_us - m_start_us) / 1e6;
+    std::ostringstream report;
+    report << "replay report\n"
+           << "  cameras         : " << m_cameras.size() << "\n"
+           << "  frames          : read " << m_frames_read << ", processed " << m_frames_processed
+           << ", unprocessed " << m_frames_read - m_frames_processed << "\n"
+           << "  fps             : " << std::fixed << std::setprecision(1) << m_frames_processed / elapsed_s
+           << " (" << std::setprecision(2) << elapsed_s << " s)\n"
+           << "  read latency    : " << percentiles(m_read_ms) << "\n"
+           << "  infer latency   : " << percentiles(m_infer_ms) << "\n"
+           << "  end to end      : " << percentiles(m_end_to_end_ms) << "\n"
+           << "  output          : compared " << m_compared << ", mismatched " << m_mismatched
+           << ", no expected result " << m_missing << "\n";
+    std::cout << report.str() << std::flush;
+    return m_mismatched > 0;
+}
@@ -0,0 +1,273 @@
+#include "frame_trace.h"
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <csignal>
+
+namespace
+{
+    struct TraceEvent
+    {
+        const char *name;
+        uint64_t trace_id;
+        int64_t start_us;
+        int64_t end_us;
+        bool wait;
+    };
+
+    struct ThreadBuffer
+    {
+        std::mutex mutex;
+        std::vector<TraceEvent> events; // 第一次记录时才分配
+        size_t next = 0;  // 下一个写入位置
+        size_t count = 0; // 有效事件数，不超过 FRAME_TRACE_RING_SIZE
+        int tid = 0;
+        std::string name;
+        bool in_use = false;
+    };
+
+    // 所有线程的缓冲区，不析构，线程退出时的thread_local析构还会访问
+    struct TraceRegistry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    };
+
+    TraceRegistry &registry()
+    {
+        static TraceRegistry *registry = new TraceRegistry();
+        return *registry;
+    }
+
+    // 线程退出时把缓冲区标记为空闲，留给新线程复用
+    struct ThreadSlot
+    {
+        ThreadBuffer *buffer = nullptr;
+        ~ThreadSlot()
+        {
+            if(buffer)
+            {
+                std::lock_guard<std::mutex> lock(registry().mutex);
+                buffer->in_use = false;
+            }
+        }
+    };
+
+    ThreadBuffer &thread_buffer()
+    {
+        thread_local ThreadSlot slot;
+        if(slot.buffer)
+            return *slot.buffer;
+        TraceRegistry &trace_registry = registry();
+        std::lock_guard<std::mutex> lock(trace_registry.mutex);
+        // 缓冲区数量达到上限后才复用已退出线程的缓冲区，在此之前保留它们的事件
+        if(trace_registry.buffers.size() >= FRAME_TRACE_THREAD_MAX)
+        {
+            for(auto &buffer : trace_registry.buffers)
+            {
+                if(!buffer->in_use)
+                {
+                    slot.buffer = buffer.get();
+                    break;
+                }
+            }
+        }
+        if(!slot.buffer)
+        {
+            trace_registry.buffers.emplace_back(new ThreadBuffer());
+            slot.buffer = trace_registry.buffers.back().get();
+            slot.buffer->tid = static_cast<int>(trace_registry.buffers.size());
+        }
+        std::lock_guard<std::mutex> buffer_lock(slot.buffer->mutex);
+        slot.buffer->in_use = true;
+        slot.buffer->next = 0;
+        slot.buffer->count = 0; // 上一个线程的事件不再保留，避免显示在新线程名下
+        slot.buffer->name = "thread " + std::to_string(slot.buffer->tid);
+        return *slot.buffer;
+    }
+
+    std::atomic<int> g_sample_interval{FRAME_TRACE_SAMPLE_INTERVAL};
+    std::atomic<uint64_t> g_frame_count{0};
+    std::atomic<uint64_t> g_next_trace_id{0};
+    volatile sig_atomic_t g_dump_requested = 0;
+
+    void on_dump_signal(int)
+    {
+        g_dump_requested = 1;
+    }
+
+    void write_json_string(std::ostringstream &out, const std::string &value)
+    {
+        out << '"';
+        for(char c : value)
+        {
+            if(c == '"' || c == '\\')
+                out << '\\' << c;
+            else if(static_cast<unsigned char>(c) < 0x20)
+                out << ' ';
+            else
+                out << c;
+        }
+        out << '"';
+    }
+}
+
+uint64_t FrameTrace::sample()
+{
+    int interval = g_sample_interval.load(std::memory_order_relaxed);
+    if(interval <= 0)
+        return 0;
+    if(g_frame_count.fetch_add(1, std::memory_order_relaxed) % interval != 0)
+        return 0;
+    return g_next_trace_id.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void FrameTrace::set_sample_interval(int interval)
+{
+    g_sample_interval.store(std::max(0, interval), std::memory_order_relaxed);
+}
+
+int FrameTrace::sample_interval()
+{
+    return g_sample_interval.load(std::memory_order_relaxed);
+}
+
+int64_t FrameTrace::now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void FrameTrace::record(uint64_t trace_id, const char *name, int64_t start_us, int64_t end_us, bool wait)
+{
+    if(trace_id == 0)
+        return;
+    ThreadBuffer &buffer = thread_buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if(buffer.events.empty())
+        buffer.events.resize(FRAME_TRACE_RING_SIZE);
+    TraceEvent &event = buffer.events[buffer.next];
+    event.name = name;
+    event.trace_id = trace_id;
+    event.start_us = start_us;
+    event.end_us = std::max(start_us, end_us);
+    event.wait = wait;
+    buffer.next = (buffer.next + 1) % FRAME_TRACE_RING_SIZE;
+    buffer.count = std::min(buffer.count + 1, static_cast<size_t>(FRAME_TRACE_RING_SIZE));
+}
+
+int64_t FrameTrace::wait(uint64_t trace_id, const char *name, int64_t start_us)
+{
+    if(trace_id == 0)
+        return 0;
+    int64_t now = now_us();
+    record(trace_id, name, start_us, now, true);
+    return now;
+}
+
+void FrameTrace::set_thread_name(const std::string &name)
+{
+    ThreadBuffer &buffer = thread_buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.name = name;
+}
+
+std::string FrameTrace::dump_json()
+{
+    std::ostringstream out;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"seawaystream\"}}";
+
+    TraceRegistry &trace_registry = registry();
+    std::lock_guard<std::mutex> lock(trace_registry.mutex);
+    std::vector<TraceEvent> events;
+    for(auto &buffer : trace_registry.buffers)
+    {
+        std::string name;
+        int tid = 0;
+        {
+            // 只在拷贝时持有缓冲区的锁，格式化在锁外进行
+            std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+            if(buffer->count == 0)
+                continue;
+            events.clear();
+            size_t first = (buffer->next + FRAME_TRACE_RING_SIZE - buffer->count) % FRAME_TRACE_RING_SIZE;
+            for(size_t i = 0; i < buffer->count; i++)
+                events.push_back(buffer->events[(first + i) % FRAME_TRACE_RING_SIZE]);
+            name = buffer->name;
+            tid = buffer->tid;
+        }
+
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":";
+        write_json_string(out, name);
+        out << "}}";
+        for(const TraceEvent &event : events)
+        {
+            if(event.wait)
+            {
+                // 异步事件，同一帧（相同id）的等待区间在Perfetto中显示在同一行
+                out << ",\n{\"name\":";
+                write_json_string(out, event.name);
+                out << ",\"cat\":\"frame\",\"ph\":\"b\",\"id\":" << event.trace_id << ",\"ts\":" << event.start_us
+                    << ",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"trace\":" << event.trace_id << "}}";
+                out << ",\n{\"name\":";
+                write_json_string(out, event.name);
+                out << ",\"cat\":\"frame\",\"ph\":\"e\",\"id\":" << event.trace_id << ",\"ts\":" << event.end_us
+                    << ",\"pid\":1,\"tid\":" << tid << "}";
+            }
+            else
+            {
+                out << ",\n{\"name\":";
+                write_json_string(out, event.name);
+                out << ",\"cat\":\"work\",\"ph\":\"X\",\"ts\":" << event.start_us << ",\"dur\":" << event.end_us - event.start_us
+                    << ",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"trace\":" << event.trace_id << "}}";
+            }
+        }
+    }
+    out << "\n]}\n";
+    return out.str();
+}
+
+bool FrameTrace::dump_file(const std::string &path)
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if(!file)
+    {
+        std::cout << "frame trace cannot open " << path << std::endl;
+        return false;
+    }
+    file << dump_json();
+    return static_cast<bool>(file);
+}
+
+void FrameTrace::install_signal_dump(const std::string &path)
+{
+    static std::once_flag once;
+    std::call_once(once, [path]()
+    {
+        struct sigaction action;
+        action.sa_handler = on_dump_signal;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGUSR2, &action, nullptr);
+        // 信号处理函数中只设置标志，由后台线程写文件
+        std::thread([path]()
+        {
+            while(true)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                if(!g_dump_requested)
+                    continue;
+                g_dump_requested = 0;
+                if(dump_file(path))
+                    std::cout << "frame trace dumped to " << path << std::endl;
+            }
+        }).detach();
+    });
+}
@@ -0,0 +1,242 @@
+#include "kafka_producer.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include "rdkafka.h"
+#include "alarm_json_writer.h"
+#include "async_log.h"
+
+bool KafkaAlarmTemplate::compile(const std::string &text, std::string *error)
+{
+    static const std::map<std::string, Field> fields = {
+        {"alarm_date", AlarmDate}, {"timestamp", Timestamp}, {"pic_url", PicUrl}, {"camera_id", CameraId},
+        {"camera_name", CameraName}, {"camera_index", CameraIndex}, {"alarm_type", AlarmType}};
+
+    m_segments.clear();
+    m_tail.clear();
+    size_t pos = 0;
+    while(true)
+    {
+        size_t begin = text.find("${", pos);
+        if(begin == std::string::npos)
+            break;
+        size_t end = text.find('}', begin);
+        if(end == std::string::npos)
+            break;
+        auto field = fields.find(text.substr(begin + 2, end - begin - 2));
+        if(field == fields.end())
+        {
+            if(error)
+                *error = "unknown field " + text.substr(begin, end - begin + 1);
+            return false;
+        }
+        size_t next = end + 1;
+        // "${name}" 整体替换为JSON值
+        if(begin > pos && text[begin - 1] == '"' && next < text.size() && text[next] == '"')
+        {
+            begin--;
+            next++;
+        }
+        m_segments.push_back(Segment{text.substr(pos, begin - pos), field->second});
+        pos = next;
+    }
+    m_tail = text.substr(pos);
+    m_size_hint = text.size() + 256;
+    return true;
+}
+
+std::string KafkaAlarmTemplate::default_text()
+{
+    Json::Value kafka_root;
+    kafka_root["alertName"] = "发现wz人员";
+    kafka_root["data"]["alarmDate"] = "${alarm_date}";
+    kafka_root["data"]["altitude"] = "1.0";
+    kafka_root["data"]["picUrl"] = "${pic_url}";
+    kafka_root["data"]["channelName"] = "5号jb-红外-新建";
+    kafka_root["data"]["deviceId"] = "99163901901329000007";
+    kafka_root["data"]["deviceName"] = "5号jb";
+    kafka_root["data"]["eventId"] = 12374871;
+    kafka_root["data"]["isRoot"] = 1;
+    kafka_root["data"]["latitude"] = "39.913356";
+    kafka_root["data"]["liveVideo"]["type"] = "GB";
+    kafka_root["data"]["liveVideo"]["value"] = "34020000001320074885";
+    kafka_root["data"]["longtitude"] = "124.221961";
+    kafka_root["data"]["objType"] = "30002";
+    kafka_root["data"]["recordVideo"]["type"] = "GB";
+    kafka_root["data"]["recordVideo"]["value"] = "23475613678313545";
+    kafka_root["data"]["source"] = "边缘计算";
+
+    kafka_root["deviceId"] = kafka_root["data"]["deviceId"];
+    kafka_root["event"] = "specialEvent";
+    kafka_root["headers"]["deviceName"] = kafka_root["data"]["deviceName"];
+    kafka_root["headers"]["orgId"] = "";
+    kafka_root["headers"]["productId"] = "JKSB-SXT";
+    kafka_root["headers"]["type"] = "300002";
+
+    kafka_root["messageId"] = "45453271231234524564";
+    kafka_root["messageType"] = "EVENT";
+    kafka_root["timestamp"] = "${timestamp}";
+
+    Json::StreamWriterBuilder stream_builder;
+    stream_builder["emitUTF8"] = true;
+    std::ostringstream stream;
+    std::unique_ptr<Json::StreamWriter> writer(stream_builder.newStreamWriter());
+    writer->write(kafka_root, &stream);
+    return stream.str();
+}
+
+void KafkaAlarmTemplate::fill(const pipelineInfo &info, int64_t alarm_date_s, int64_t timestamp_ms, const std::string &pic_url, std::string &out) const
+{
+    out.clear();
+    out.reserve(m_size_hint);
+    for(const Segment &segment : m_segments)
+    {
+        out.append(segment.literal);
+        switch(segment.field)
+        {
+            case AlarmDate:   out.append(std::to_string(alarm_date_s)); break;
+            case Timestamp:   out.append(std::to_string(timestamp_ms)); break;
+            case PicUrl:      json_append_string(out, pic_url); break;
+            case CameraId:    json_append_string(out, info.camera_id); break;
+            case CameraName:  json_append_string(out, info.camera_name); break;
+            case CameraIndex: out.append(std::to_string(info.camera_index)); break;
+            case AlarmType:   out.append(std::to_string(info.alarm_type)); break;
+        }
+    }
+    out.append(m_tail);
+}
+
+KafkaProducer::KafkaProducer(const std::string &brokers, const std::string &topic, const std::map<std::string, std::string> &extra_conf)
+    : m_topic(topic)
+{
+    std::map<std::string, std::string> settings = {
+        {"bootstrap.servers", brokers},
+        {"linger.ms", std::to_string(KAFKA_LINGER_MS)},
+        {"batch.size", std::to_string(KAFKA_BATCH_SIZE)},
+        {"compression.type", KAFKA_COMPRESSION_TYPE},
+        {"queue.buffering.max.messages", std::to_string(KAFKA_QUEUE_MAX_MESSAGES)},
+        {"enable.idempotence", "true"},
+        {"partitioner", "murmur2_random"}}; // 与Java客户端相同的key哈希
+    for(const auto &item : extra_conf)
+        settings[item.first] = item.second;
+
+    char errstr[512];
+    rd_kafka_conf_t *conf = rd_kafka_conf_new();
+    for(const auto &item : settings)
+    {
+        if(rd_kafka_conf_set(conf, item.first.c_str(), item.second.c_str(), errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK)
+        {
+            ALOG(ERROR) << "KafkaProducer: " << item.first << "=" << item.second << " error: " << errstr;
+            rd_kafka_conf_destroy(conf);
+            return;
+        }
+    }
+    rd_kafka_conf_set_dr_msg_cb(conf, &KafkaProducer::on_delivery);
+    rd_kafka_conf_set_opaque(conf, this);
+
+    // 成功时conf的所有权转移给rd_kafka_t
+    m_rk = rd_kafka_new(RD_KAFKA_PRODUCER, conf, errstr, sizeof(errstr));
+    if(m_rk == nullptr)
+    {
+        ALOG(ERROR) << "KafkaProducer: create producer fail: " << errstr;
+        rd_kafka_conf_destroy(conf);
+        return;
+    }
+    m_poll_thread = std::thread(&KafkaProducer::poll_loop, this);
+}
+
+KafkaProducer::~KafkaProducer()
+{
+    if(m_rk == nullptr)
+        return;
+    m_stop = true;
+    if(m_poll_thread.joinable())
+        m_poll_thread.join();
+    // 等待本地队列中的消息发送完成，超时的消息被丢弃
+    if(rd_kafka_flush(m_rk, KAFKA_FLUSH_TIMEOUT_MS) != RD_KAFKA_RESP_ERR_NO_ERROR)
+    {
+        ALOG(WARNING) << "KafkaProducer: " << rd_kafka_outq_len(m_rk) << " messages not delivered before exit";
+    }
+    rd_kafka_destroy(m_rk);
+}
+
+bool KafkaProducer::produce(const std::string &key, const std::string &payload, DoneFunction done)
+{
+    if(m_rk == nullptr)
+    {
+        if(done)
+            done(false);
+        return false;
+    }
+    // 回调随消息传入librdkafka，在发送结果回调中取回并释放
+    DoneFunction *opaque = done ? new DoneFunction(std::move(done)) : nullptr;
+    rd_kafka_resp_err_t err = rd_kafka_producev(m_rk,
+                                                RD_KAFKA_V_TOPIC(m_topic.c_str()),
+                                                RD_KAFKA_V_KEY(key.data(), key.size()),
+                                                RD_KAFKA_V_VALUE(const_cast<char *>(payload.data()), payload.size()),
+                                                RD_KAFKA_V_MSGFLAGS(RD_KAFKA_MSG_F_COPY),
+                                                RD_KAFKA_V_OPAQUE(opaque),
+                                                RD_KAFKA_V_END);
+    if(err != RD_KAFKA_RESP_ERR_NO_ERROR)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.failed++;
+            if(err == RD_KAFKA_RESP_ERR__QUEUE_FULL)
+                m_stats.queue_full++;
+        }
+        ALOG_EVERY_MS(WARNING, 1000) << "KafkaProducer: produce fail: " << rd_kafka_err2str(err);
+        if(opaque != nullptr)
+        {
+            (*opaque)(false);
+            delete opaque;
+        }
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.produced++;
+    return true;
+}
+
+KafkaProducerStats KafkaProducer::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void KafkaProducer::poll_loop()
+{
+    while(!m_stop)
+        rd_kafka_poll(m_rk, KAFKA_POLL_INTERVAL_MS);
+}
+
+void KafkaProducer::on_delivery(rd_kafka_t *, const rd_kafka_message_t *message, void *opaque)
+{
+    KafkaProducer *self = static_cast<KafkaProducer *>(opaque);
+    if(DoneFunction *done = static_cast<DoneFunction *>(message->_private))
+    {
+        (*done)(message->err == RD_KAFKA_RESP_ERR_NO_ERROR);
+        delete done;
+    }
+    std::lock_guard<std::mutex> lock(self->m_mutex);
+    if(message->err != RD_KAFKA_RESP_ERR_NO_ERROR)
+    {
+        self->m_stats.failed++;
+        ALOG_EVERY_MS(WARNING, 1000) << "KafkaProducer: delivery fail: " << rd_kafka_err2str(message->err);
+        return;
+    }
+    self->m_stats.delivered++;
+    // 消息的创建时间由produce时设置，单位毫秒
+    rd_kafka_timestamp_type_t type;
+    int64_t create_ms = rd_kafka_message_timestamp(message, &type);
+    if(create_ms >= 0)
+    {
+        int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        double latency_ms = static_cast<double>(std::max<int64_t>(0, now_ms - create_ms));
+        self->m_latency_sum_ms += latency_ms;
+        self->m_stats.latency_avg_ms = self->m_latency_sum_ms / self->m_stats.delivered;
+        self->m_stats.latency_max_ms = std::max(self->m_stats.latency_max_ms, latency_ms);
+    }
+}
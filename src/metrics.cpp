@@ -0,0 +1,318 @@
+#include "metrics.h"
+#include "frame_trace.h"
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/sysinfo.h>
+#include "httplib.h"
+
+int metrics_shard()
+{
+    static std::atomic<int> next_shard{0};
+    thread_local int shard = next_shard.fetch_add(1, std::memory_order_relaxed) % METRICS_SHARD_COUNT;
+    return shard;
+}
+
+std::string metrics_label(const std::string &key, const std::string &value)
+{
+    std::string label = key + "=\"";
+    for(char c : value)
+    {
+        if(c == '\\' || c == '"')
+            label += '\\';
+        if(c == '\n')
+        {
+            label += "\\n";
+            continue;
+        }
+        label += c;
+    }
+    label += '"';
+    return label;
+}
+
+uint64_t Counter::value() const
+{
+    uint64_t value = 0;
+    for(const Shard &shard : m_shards)
+        value += shard.value.load(std::memory_order_relaxed);
+    return value;
+}
+
+void Gauge::add(double delta)
+{
+    double value = m_value.load(std::memory_order_relaxed);
+    while(!m_value.compare_exchange_weak(value, value + delta, std::memory_order_relaxed))
+        ;
+}
+
+Histogram::Histogram(const std::vector<double> &bounds) : m_bounds(bounds)
+{
+    std::sort(m_bounds.begin(), m_bounds.end());
+    for(Shard &shard : m_shards)
+    {
+        shard.counts.reset(new std::atomic<uint64_t>[m_bounds.size() + 1]);
+        for(size_t i = 0; i <= m_bounds.size(); i++)
+            shard.counts[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::observe(double value)
+{
+    // 桶很少，线性查找比二分更快
+    size_t bucket = 0;
+    while(bucket < m_bounds.size() && value > m_bounds[bucket])
+        bucket++;
+    Shard &shard = m_shards[metrics_shard()];
+    shard.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    // 分片只被少数线程使用，CAS基本不会失败
+    double sum = shard.sum.load(std::memory_order_relaxed);
+    while(!shard.sum.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed))
+        ;
+}
+
+void Histogram::snapshot(std::vector<uint64_t> &counts, double &sum) const
+{
+    counts.assign(m_bounds.size() + 1, 0);
+    sum = 0;
+    for(const Shard &shard : m_shards)
+    {
+        for(size_t i = 0; i <= m_bounds.size(); i++)
+            counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+        sum += shard.sum.load(std::memory_order_relaxed);
+    }
+}
+
+std::vector<double> metrics_latency_buckets()
+{
+    return {0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+}
+
+// 功能：进程常驻内存（字节）
+static double process_resident_bytes()
+{
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0, resident = 0;
+    if(!(statm >> pages >> resident))
+        return 0;
+    return static_cast<double>(resident) * sysconf(_SC_PAGESIZE);
+}
+
+MetricsRegistry &MetricsRegistry::global()
+{
+    static MetricsRegistry *registry = []()
+    {
+        MetricsRegistry *registry = new MetricsRegistry(); // 不析构，退出时其他线程可能还在更新
+        registry->gauge_callback("process_resident_memory_bytes", "Resident memory size in bytes.", std::string(),
+                                 process_resident_bytes, nullptr);
+        registry->gauge_callback("seaway_system_memory_free_bytes", "Free system memory in bytes.", std::string(), []()
+        {
+            struct sysinfo info;
+            return sysinfo(&info) == 0 ? static_cast<double>(info.freeram) * info.mem_unit : 0;
+        }, nullptr);
+        registry->gauge_callback("seaway_system_memory_buffer_bytes", "System buffer memory in bytes.", std::string(), []()
+        {
+            struct sysinfo info;
+            return sysinfo(&info) == 0 ? static_cast<double>(info.bufferram) * info.mem_unit : 0;
+        }, nullptr);
+        return registry;
+    }();
+    return *registry;
+}
+
+MetricsRegistry::Series &MetricsRegistry::series(const std::string &name, const std::string &help, const std::string &type, const std::string &labels)
+{
+    Family *family = nullptr;
+    for(auto &item : m_families)
+    {
+        if(item->name == name)
+        {
+            family = item.get();
+            break;
+        }
+    }
+    if(!family)
+    {
+        m_families.emplace_back(new Family());
+        family = m_families.back().get();
+        family->name = name;
+        family->help = help;
+        family->type = type;
+    }
+    for(auto &item : family->series)
+    {
+        if(item->labels == labels)
+            return *item;
+    }
+    family->series.emplace_back(new Series());
+    family->series.back()->labels = labels;
+    return *family->series.back();
+}
+
+Counter &MetricsRegistry::counter(const std::string &name, const std::string &help, const std::string &labels)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Series &item = series(name, help, "counter", labels);
+    if(!item.counter)
+        item.counter.reset(new Counter());
+    return *item.counter;
+}
+
+Gauge &MetricsRegistry::gauge(const std::string &name, const std::string &help, const std::string &labels)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Series &item = series(name, help, "gauge", labels);
+    if(!item.gauge)
+        item.gauge.reset(new Gauge());
+    return *item.gauge;
+}
+
+Histogram &MetricsRegistry::histogram(const std::string &name, const std::string &help, const std::vector<double> &bounds, const std::string &labels)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Series &item = series(name, help, "histogram", labels);
+    if(!item.histogram)
+        item.histogram.reset(new Histogram(bounds));
+    return *item.histogram;
+}
+
+void MetricsRegistry::counter_callback(const std::string &name, const std::string &help, const std::string &labels,
+                                       ValueFunction function, const void *owner)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Series &item = series(name, help, "counter", labels);
+    item.function = function;
+    item.owner = owner;
+}
+
+void MetricsRegistry::gauge_callback(const std::string &name, const std::string &help, const std::string &labels,
+                                     ValueFunction function, const void *owner)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Series &item = series(name, help, "gauge", labels);
+    item.function = function;
+    item.owner = owner;
+}
+
+void MetricsRegistry::remove_callbacks(const void *owner)
+{
+    // 抓取时持有同一把锁，返回后回调不会再被调用
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(auto &family : m_families)
+    {
+        for(auto &item : family->series)
+        {
+            if(item->function && item->owner == owner)
+            {
+                item->function = ValueFunction();
+                item->owner = nullptr;
+            }
+        }
+    }
+}
+
+// 功能：输出一个样本，labels和extra（直方图的le）按逗号连接
+static void write_sample(std::ostringstream &out, const std::string &name, const std::string &labels, const std::string &extra, double value)
+{
+    out << name;
+    if(!labels.empty() || !extra.empty())
+    {
+        out << '{' << labels;
+        if(!labels.empty() && !extra.empty())
+            out << ',';
+        out << extra << '}';
+    }
+    out << ' ' << value << '\n';
+}
+
+std::string MetricsRegistry::render() const
+{
+    std::ostringstream out;
+    out << std::setprecision(12);
+    std::vector<uint64_t> counts;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(const auto &family : m_families)
+    {
+        bool header = false;
+        for(const auto &item : family->series)
+        {
+            if(!item->counter && !item->gauge && !item->histogram && !item->function)
+                continue; // 回调已注销
+            if(!header)
+            {
+                out << "# HELP " << family->name << ' ' << family->help << '\n';
+                out << "# TYPE " << family->name << ' ' << family->type << '\n';
+                header = true;
+            }
+            if(item->counter)
+                write_sample(out, family->name, item->labels, std::string(), static_cast<double>(item->counter->value()));
+            else if(item->gauge)
+                write_sample(out, family->name, item->labels, std::string(), item->gauge->value());
+            else if(item->histogram)
+            {
+                double sum = 0;
+                item->histogram->snapshot(counts, sum);
+                const std::vector<double> &bounds = item->histogram->bounds();
+                uint64_t cumulative = 0;
+                for(size_t i = 0; i < bounds.size(); i++)
+                {
+                    cumulative += counts[i];
+                    std::ostringstream le;
+                    le << std::setprecision(12) << bounds[i];
+                    write_sample(out, family->name + "_bucket", item->labels, metrics_label("le", le.str()), static_cast<double>(cumulative));
+                }
+                cumulative += counts[bounds.size()];
+                write_sample(out, family->name + "_bucket", item->labels, metrics_label("le", "+Inf"), static_cast<double>(cumulative));
+                write_sample(out, family->name + "_sum", item->labels, std::string(), sum);
+                write_sample(out, family->name + "_count", item->labels, std::string(), static_cast<double>(cumulative));
+            }
+            else
+                write_sample(out, family->name, item->labels, std::string(), item->function());
+        }
+    }
+    return out.str();
+}
+
+MetricsServer::MetricsServer(MetricsRegistry &registry, int port) : m_registry(registry), m_port(port), m_server(new httplib::Server())
+{
+    m_server->Get("/metrics", [this](const httplib::Request &, httplib::Response &res)
+    {
+        res.set_content(m_registry.render(), "text/plain; version=0.0.4");
+    });
+    // 帧追踪与指标共用端口，?sample=N 修改采样间隔（0关闭）后返回当前缓冲区中的事件
+    m_server->Get("/trace", [](const httplib::Request &req, httplib::Response &res)
+    {
+        if(req.has_param("sample"))
+            FrameTrace::set_sample_interval(std::atoi(req.get_param_value("sample").c_str()));
+        res.set_header("X-Trace-Sample-Interval", std::to_string(FrameTrace::sample_interval()));
+        res.set_content(FrameTrace::dump_json(), "application/json");
+    });
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+bool MetricsServer::start()
+{
+    if(!m_server->bind_to_port("0.0.0.0", m_port))
+    {
+        std::cout << "metrics server cannot bind port " << m_port << std::endl;
+        return false;
+    }
+    m_listen_thread = std::thread([this]{ m_server->listen_after_bind(); });
+    std::cout << "metrics server listen on port " << m_port << std::endl;
+    return true;
+}
+
+void MetricsServer::stop()
+{
+    m_server->stop();
+    if(m_listen_thread.joinable())
+        m_listen_thread.join();
+}
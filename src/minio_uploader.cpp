@@ -0,0 +1,332 @@
+#include "minio_uploader.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace {
+
+const char *kSpoolSuffix = ".spool";
+const char *kTempSuffix = ".tmp";
+
+// 功能：对象名转换为缓存文件名，'%'和'/'转义，文件名的字典序即对象名的字典序
+std::string escape_key(const std::string &key)
+{
+    std::string name;
+    for(char c : key)
+    {
+        if(c == '%')
+            name += "%25";
+        else if(c == '/')
+            name += "%2F";
+        else
+            name += c;
+    }
+    return name;
+}
+
+std::string unescape_key(const std::string &name)
+{
+    std::string key;
+    for(size_t i = 0; i < name.size(); i++)
+    {
+        if(name[i] == '%' && name.compare(i, 3, "%2F") == 0)
+        {
+            key += '/';
+            i += 2;
+        }
+        else if(name[i] == '%' && name.compare(i, 3, "%25") == 0)
+        {
+            key += '%';
+            i += 2;
+        }
+        else
+            key += name[i];
+    }
+    return key;
+}
+
+bool ends_with(const std::string &str, const char *suffix)
+{
+    size_t len = strlen(suffix);
+    return str.size() >= len && str.compare(str.size() - len, len, suffix) == 0;
+}
+
+int64_t file_size(const std::string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? static_cast<int64_t>(st.st_size) : 0;
+}
+
+bool write_file(const std::string &path, const std::vector<uchar> &data)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+        return false;
+    size_t offset = 0;
+    while(offset < data.size())
+    {
+        ssize_t n = write(fd, data.data() + offset, data.size() - offset);
+        if(n <= 0)
+        {
+            close(fd);
+            return false;
+        }
+        offset += n;
+    }
+    bool ok = fsync(fd) == 0;
+    return close(fd) == 0 && ok;
+}
+
+bool read_file(const std::string &path, std::vector<uchar> &data)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    data.resize(file_size(path));
+    size_t offset = 0;
+    while(offset < data.size())
+    {
+        ssize_t n = read(fd, data.data() + offset, data.size() - offset);
+        if(n <= 0)
+            break;
+        offset += n;
+    }
+    close(fd);
+    data.resize(offset);
+    return true;
+}
+
+} // namespace
+
+MinioUploader::MinioUploader(UploadFactory factory, const std::string &spool_dir, int thread_num, int64_t spool_max_bytes)
+    : m_factory(std::move(factory)), m_spool_dir(spool_dir), m_spool_max_bytes(spool_max_bytes)
+{
+    // 逐级创建缓存目录
+    for(size_t pos = m_spool_dir.find('/', 1); ; pos = m_spool_dir.find('/', pos + 1))
+    {
+        mkdir(m_spool_dir.substr(0, pos).c_str(), 0755);
+        if(pos == std::string::npos)
+            break;
+    }
+    load_spool();
+    m_spool_next_try = std::chrono::steady_clock::now();
+    for(int i = 0; i < std::max(1, thread_num); i++)
+        m_threads.emplace_back(&MinioUploader::worker, this);
+}
+
+MinioUploader::~MinioUploader()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    for(std::thread &thread : m_threads)
+        thread.join();
+    // 还没上传的图片写入磁盘缓存，下次启动时补传
+    for(const Job &job : m_queue)
+        spool(job);
+}
+
+void MinioUploader::load_spool()
+{
+    DIR *dir = opendir(m_spool_dir.c_str());
+    if(dir == nullptr)
+    {
+        std::cout << "MinioUploader: open spool dir " << m_spool_dir << " fail" << std::endl;
+        return;
+    }
+    std::vector<std::string> files;
+    while(struct dirent *entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        std::string path = m_spool_dir + "/" + name;
+        // 临时文件是写入过程中崩溃留下的，内容不完整
+        if(ends_with(name, kTempSuffix))
+            unlink(path.c_str());
+        else if(ends_with(name, kSpoolSuffix))
+            files.push_back(path);
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+    for(const std::string &path : files)
+    {
+        m_spool_files.push_back(path);
+        m_stats.spool_bytes += file_size(path);
+    }
+    if(!files.empty())
+        std::cout << "MinioUploader: " << files.size() << " spooled uploads pending" << std::endl;
+}
+
+std::string MinioUploader::submit(const std::string &bucket, std::vector<uchar> data)
+{
+    std::string key = reserve_key(bucket);
+    submit_key(key, std::move(data));
+    return key;
+}
+
+std::string MinioUploader::reserve_key(const std::string &bucket)
+{
+    int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // 同一毫秒内的多张图片顺延，保证对象名不重复
+    m_last_key_ms = std::max(now_ms, m_last_key_ms + 1);
+    return "/" + bucket + "/" + std::to_string(m_last_key_ms) + ".jpg";
+}
+
+void MinioUploader::submit_key(const std::string &key, std::vector<uchar> data)
+{
+    Job job;
+    job.key = key;
+    job.data = std::move(data);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.submitted++;
+        if(m_queue.size() < MINIO_QUEUE_MAX)
+        {
+            m_queue.push_back(std::move(job));
+            m_cond.notify_one();
+            return;
+        }
+    }
+    spool(job);
+}
+
+MinioUploaderStats MinioUploader::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    MinioUploaderStats stats = m_stats;
+    stats.queued = m_queue.size();
+    stats.spool_files = m_spool_files.size() + m_spool_busy.size();
+    return stats;
+}
+
+void MinioUploader::spool(const Job &job)
+{
+    std::lock_guard<std::mutex> spool_lock(m_spool_mutex);
+    std::string path = m_spool_dir + "/" + escape_key(job.key) + kSpoolSuffix;
+    std::string temp = path + kTempSuffix;
+    if(!write_file(temp, job.data) || rename(temp.c_str(), path.c_str()) != 0)
+    {
+        unlink(temp.c_str());
+        std::cout << "WARNING: MinioUploader spool " << job.key << " fail" << std::endl;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_spool_files.insert(std::upper_bound(m_spool_files.begin(), m_spool_files.end(), path), path);
+    m_stats.spooled++;
+    m_stats.spool_bytes += job.data.size();
+    while(m_stats.spool_bytes > m_spool_max_bytes && m_spool_files.size() > 1)
+    {
+        const std::string &oldest = m_spool_files.front();
+        m_stats.spool_bytes -= file_size(oldest);
+        unlink(oldest.c_str());
+        std::cout << "WARNING: MinioUploader spool full, drop " << oldest << std::endl;
+        m_spool_files.pop_front();
+        m_stats.spool_dropped++;
+    }
+}
+
+bool MinioUploader::take_spooled(Job &job)
+{
+    if(m_spool_files.empty() || std::chrono::steady_clock::now() < m_spool_next_try)
+        return false;
+    job.spool_path = m_spool_files.front();
+    m_spool_files.pop_front();
+    m_spool_busy.insert(job.spool_path);
+    std::string name = job.spool_path.substr(m_spool_dir.size() + 1);
+    job.key = unescape_key(name.substr(0, name.size() - strlen(kSpoolSuffix)));
+    return true;
+}
+
+bool MinioUploader::wait_stop(std::chrono::milliseconds duration)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_cond.wait_for(lock, duration, [this]() { return m_stop; });
+}
+
+void MinioUploader::worker()
+{
+    // 每个线程一个客户端，连接在上传之间复用
+    UploadFunction upload = m_factory();
+    while(true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // 没有新图片时，到了补传时间就处理磁盘缓存
+            m_cond.wait_for(lock, std::chrono::seconds(1), [this]()
+            {
+                return m_stop || !m_queue.empty() ||
+                       (!m_spool_files.empty() && std::chrono::steady_clock::now() >= m_spool_next_try);
+            });
+            if(m_stop)
+                break;
+            if(!m_queue.empty())
+            {
+                job = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            else if(!take_spooled(job))
+                continue;
+        }
+        if(!job.spool_path.empty() && !read_file(job.spool_path, job.data))
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_spool_busy.erase(job.spool_path);
+            continue;
+        }
+
+        bool ok = upload && upload(job.key, job.data.data(), job.data.size());
+        for(int attempt = 0; !ok && attempt < MINIO_RETRY_MAX; attempt++)
+        {
+            if(wait_stop(std::chrono::milliseconds(MINIO_RETRY_BACKOFF_MS << attempt)))
+                break;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stats.retries++;
+            }
+            ok = upload(job.key, job.data.data(), job.data.size());
+        }
+
+        if(job.spool_path.empty())
+        {
+            if(ok)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stats.uploaded++;
+                // 对象存储恢复，立即开始补传磁盘缓存
+                m_spool_next_try = std::chrono::steady_clock::now();
+            }
+            else
+            {
+                std::cout << "WARNING: MinioUploader upload " << job.key << " fail, spool to disk" << std::endl;
+                spool(job);
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_spool_next_try = std::chrono::steady_clock::now() + std::chrono::seconds(MINIO_SPOOL_RETRY_INTERVAL_S);
+            }
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_spool_busy.erase(job.spool_path);
+        if(ok)
+        {
+            unlink(job.spool_path.c_str());
+            m_stats.uploaded++;
+            m_stats.spool_bytes -= job.data.size();
+            std::cout << "MinioUploader: upload spooled " << job.key << " success" << std::endl;
+        }
+        else
+        {
+            // 放回队首，等待下一次补传
+            m_spool_files.push_front(job.spool_path);
+            m_spool_next_try = std::chrono::steady_clock::now() + std::chrono::seconds(MINIO_SPOOL_RETRY_INTERVAL_S);
+        }
+    }
+}
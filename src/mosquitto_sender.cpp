@@ -0,0 +1,102 @@
+#include "mosquitto_sender.h"
+#include <iostream>
+#include "mosquitto.h"
+
+MosquittoSender::MosquittoSender(const std::string &host, int port, const std::string &topic, int qos, int keepalive)
+    : m_topic(topic), m_qos(qos)
+{
+    static std::once_flag lib_init;
+    std::call_once(lib_init, []() { mosquitto_lib_init(); });
+
+    m_mosq = mosquitto_new(nullptr, true, this);
+    if(m_mosq == nullptr)
+    {
+        std::cout << "MosquittoSender: mosquitto_new fail" << std::endl;
+        return;
+    }
+    mosquitto_connect_callback_set(m_mosq, &MosquittoSender::on_connect);
+    mosquitto_disconnect_callback_set(m_mosq, &MosquittoSender::on_disconnect);
+    mosquitto_publish_callback_set(m_mosq, &MosquittoSender::on_publish);
+    mosquitto_reconnect_delay_set(m_mosq, 1, 30, true);
+    // 异步连接，连接失败或断开后由网络线程自动重连
+    int rc = mosquitto_connect_async(m_mosq, host.c_str(), port, keepalive);
+    if(rc != MOSQ_ERR_SUCCESS)
+        std::cout << "MosquittoSender: connect " << host << ":" << port << " fail: " << mosquitto_strerror(rc) << std::endl;
+    mosquitto_loop_start(m_mosq);
+}
+
+MosquittoSender::~MosquittoSender()
+{
+    if(m_mosq == nullptr)
+        return;
+    mosquitto_disconnect(m_mosq);
+    mosquitto_loop_stop(m_mosq, true);
+    mosquitto_destroy(m_mosq);
+}
+
+bool MosquittoSender::connected() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_connected;
+}
+
+bool MosquittoSender::send(const std::string &payload)
+{
+    if(m_mosq == nullptr || !connected())
+        return false;
+
+    int mid = 0;
+    int rc = mosquitto_publish(m_mosq, &mid, m_topic.c_str(), static_cast<int>(payload.size()), payload.data(), m_qos, false);
+    if(rc != MOSQ_ERR_SUCCESS)
+    {
+        std::cout << "MosquittoSender: publish fail: " << mosquitto_strerror(rc) << std::endl;
+        return false;
+    }
+    if(m_qos == 0)
+        return true;
+
+    // 确认可能在这里加锁之前就已到达，已确认的id保存在m_acked中，不会丢失
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // 之前超时的消息的确认没有人取走，超过确认超时时间的直接删除
+    Clock::time_point expire = Clock::now() - std::chrono::milliseconds(MQTT_ACK_TIMEOUT_MS);
+    for(auto it = m_acked.begin(); it != m_acked.end(); )
+    {
+        if(it->first != mid && it->second < expire)
+            it = m_acked.erase(it);
+        else
+            ++it;
+    }
+    m_cond.wait_for(lock, std::chrono::milliseconds(MQTT_ACK_TIMEOUT_MS),
+                    [&]() { return m_acked.count(mid) > 0 || !m_connected; });
+    return m_acked.erase(mid) > 0;
+}
+
+void MosquittoSender::on_connect(struct mosquitto *, void *obj, int rc)
+{
+    MosquittoSender *self = static_cast<MosquittoSender *>(obj);
+    std::lock_guard<std::mutex> lock(self->m_mutex);
+    self->m_connected = (rc == 0);
+    self->m_acked.clear();
+}
+
+void MosquittoSender::on_disconnect(struct mosquitto *, void *obj, int)
+{
+    MosquittoSender *self = static_cast<MosquittoSender *>(obj);
+    {
+        std::lock_guard<std::mutex> lock(self->m_mutex);
+        self->m_connected = false;
+    }
+    self->m_cond.notify_all();
+}
+
+void MosquittoSender::on_publish(struct mosquitto *, void *obj, int mid)
+{
+    MosquittoSender *self = static_cast<MosquittoSender *>(obj);
+    if(self->m_qos == 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(self->m_mutex);
+        self->m_acked[mid] = Clock::now();
+    }
+    self->m_cond.notify_all();
+}
@@ -0,0 +1,185 @@
+#include "mqtt_publisher.h"
+#include <algorithm>
+#include <iostream>
+
+MqttPublisher::MqttPublisher(SendFunction send, int qos, size_t max_bytes, int coalesce_window_ms, int retry_max)
+    : m_send(std::move(send)), m_qos(qos), m_max_bytes(max_bytes),
+      m_coalesce_window(std::max(0, coalesce_window_ms)), m_retry_max(std::max(0, retry_max))
+{
+    m_thread = std::thread(&MqttPublisher::worker, this);
+}
+
+MqttPublisher::~MqttPublisher()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    if(m_thread.joinable())
+        m_thread.join();
+    if(!m_queue.empty())
+        std::cout << "MqttPublisher: discard " << m_queue.size() << " unsent messages" << std::endl;
+}
+
+void MqttPublisher::publish(int camera_index, std::string payload, DoneFunction done)
+{
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.enqueued++;
+    m_stats.queued_bytes += payload.size();
+    if(m_coalesce_window.count() == 0 || camera_index < 0)
+    {
+        m_queue.push_back(Message{camera_index, {}, payload.size(), now, now, 0, {}});
+    }
+    else
+    {
+        // 同一路摄像头还有没开始发送的消息时合并进去，一起发送；重试中的消息不再改变内容
+        for(auto it = m_queue.rbegin(); it != m_queue.rend(); ++it)
+        {
+            if(it->camera_index != camera_index)
+                continue;
+            if(it->attempts == 0 && it->payloads.size() < MQTT_COALESCE_MAX_COUNT)
+            {
+                it->bytes += payload.size();
+                it->payloads.push_back(std::move(payload));
+                if(done)
+                    it->done.push_back(std::move(done));
+                m_stats.coalesced++;
+                trim();
+                return;
+            }
+            break;
+        }
+        // 不在合并窗口内时立即发送，否则等到窗口结束；发送时间决定下一个窗口
+        Clock::time_point &window_end = m_window_end[camera_index];
+        Clock::time_point ready_time = std::max(now, window_end);
+        window_end = ready_time + m_coalesce_window;
+        m_queue.push_back(Message{camera_index, {}, payload.size(), now, ready_time, 0, {}});
+    }
+    m_queue.back().payloads.push_back(std::move(payload));
+    if(done)
+        m_queue.back().done.push_back(std::move(done));
+    trim();
+    m_cond.notify_one();
+}
+
+void MqttPublisher::trim()
+{
+    while(m_stats.queued_bytes > m_max_bytes && m_queue.size() > 1)
+    {
+        std::cout << "WARNING: MqttPublisher queue full (" << m_stats.queued_bytes << " bytes), drop camera "
+                  << m_queue.front().camera_index << " message" << std::endl;
+        m_stats.queued_bytes -= m_queue.front().bytes;
+        for(const DoneFunction &done : m_queue.front().done)
+            done(false);
+        m_stats.dropped += m_queue.front().payloads.size();
+        m_queue.pop_front();
+    }
+}
+
+MqttPublisherStats MqttPublisher::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    MqttPublisherStats stats = m_stats;
+    stats.queued_messages = m_queue.size();
+    return stats;
+}
+
+bool MqttPublisher::take_ready(Clock::time_point now, Message &message, Clock::time_point &next_time)
+{
+    next_time = Clock::time_point::max();
+    // 退避中的消息在队首，后面的消息等它发送成功或失败后再发送，保证顺序
+    if(m_queue.front().attempts > 0 && m_queue.front().ready_time > now)
+    {
+        next_time = m_queue.front().ready_time;
+        return false;
+    }
+    // 在合并窗口中等待的消息不阻塞后面已经可以发送的消息；同一路摄像头的发送时间是递增的，顺序不变
+    for(auto it = m_queue.begin(); it != m_queue.end(); ++it)
+    {
+        if(it->ready_time > now)
+        {
+            next_time = std::min(next_time, it->ready_time);
+            continue;
+        }
+        message = std::move(*it);
+        m_queue.erase(it);
+        m_stats.queued_bytes -= message.bytes;
+        return true;
+    }
+    return false;
+}
+
+const std::string &MqttPublisher::merged_payload(const Message &message, std::string &buffer)
+{
+    if(message.payloads.size() == 1)
+        return message.payloads.front();
+    buffer.clear();
+    buffer.reserve(message.bytes + message.payloads.size() + 2);
+    buffer.push_back('[');
+    for(size_t i = 0; i < message.payloads.size(); i++)
+    {
+        if(i)
+            buffer.push_back(',');
+        buffer.append(message.payloads[i]);
+    }
+    buffer.push_back(']');
+    return buffer;
+}
+
+void MqttPublisher::worker()
+{
+    std::string merged; // 合并消息的拼接缓冲区，在消息之间复用
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(!m_stop)
+    {
+        if(m_queue.empty())
+        {
+            m_cond.wait(lock);
+            continue;
+        }
+        Message message;
+        Clock::time_point next_time;
+        if(!take_ready(Clock::now(), message, next_time))
+        {
+            // 新消息入队、合并或丢弃都可能改变可发送的消息，醒来后重新检查
+            m_cond.wait_until(lock, next_time);
+            continue;
+        }
+
+        lock.unlock();
+        bool ok = m_send(merged_payload(message, merged));
+        Clock::time_point now = Clock::now();
+        lock.lock();
+
+        if(ok)
+        {
+            double latency_ms = std::chrono::duration<double, std::milli>(now - message.enqueue_time).count();
+            m_stats.sent += message.payloads.size();
+            m_latency_sum_ms += latency_ms * message.payloads.size();
+            m_stats.latency_avg_ms = m_latency_sum_ms / m_stats.sent;
+            m_stats.latency_max_ms = std::max(m_stats.latency_max_ms, latency_ms);
+            for(const DoneFunction &done : message.done)
+                done(true);
+        }
+        else if(m_qos > 0 && message.attempts < m_retry_max)
+        {
+            // 放回队首等待退避结束，后面的消息不越过它发送
+            int backoff_ms = MQTT_RETRY_BACKOFF_MS << std::min(message.attempts, 16);
+            message.ready_time = now + std::chrono::milliseconds(std::min(backoff_ms, MQTT_RETRY_BACKOFF_MAX_MS));
+            message.attempts++;
+            m_stats.retries++;
+            m_stats.queued_bytes += message.bytes;
+            m_queue.push_front(std::move(message));
+        }
+        else
+        {
+            m_stats.failed += message.payloads.size();
+            std::cout << "WARNING: MqttPublisher send fail, camera " << message.camera_index << " after "
+                      << message.attempts + 1 << " attempts" << std::endl;
+            for(const DoneFunction &done : message.done)
+                done(false);
+        }
+    }
+}
@@ -0,0 +1,118 @@
+#include "nvr_recorder.h"
+#include <algorithm>
+#include <iostream>
+
+int nvr_channel_from_url(const std::string &url)
+{
+    size_t begin = url.size();
+    while(begin > 0 && url[begin - 1] >= '0' && url[begin - 1] <= '9')
+        begin--;
+    // 超过9位的数字不是通道号
+    if(begin == url.size() || url.size() - begin > 9)
+        return 0;
+    return std::stoi(url.substr(begin));
+}
+
+bool NvrChannelMap::update(const std::vector<std::string> &camera_urls)
+{
+    if(camera_urls == m_urls)
+        return false;
+    m_urls = camera_urls;
+    m_channels.clear();
+    for(const std::string &url : m_urls)
+    {
+        m_channels.push_back(nvr_channel_from_url(url));
+        std::cout << "nvr channel of " << url << " is " << m_channels.back() << std::endl;
+    }
+    return true;
+}
+
+int NvrChannelMap::channel(int camera_index) const
+{
+    if(camera_index < 0 || camera_index >= static_cast<int>(m_channels.size()))
+        return 0;
+    return m_channels[camera_index];
+}
+
+NvrRecorder::NvrRecorder(RecordFunction record, int timeout_ms, size_t queue_max)
+    : m_record(std::move(record)), m_timeout(std::max(0, timeout_ms)), m_queue_max(queue_max)
+{
+    m_thread = std::thread(&NvrRecorder::worker, this);
+}
+
+NvrRecorder::~NvrRecorder()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    if(m_thread.joinable())
+        m_thread.join();
+    for(Request &request : m_queue)
+        request.result.set_value(NvrRecordResult());
+}
+
+std::future<NvrRecordResult> NvrRecorder::submit(int channel, const std::string &alarm_date_str)
+{
+    Request request;
+    request.channel = channel;
+    request.alarm_date_str = alarm_date_str;
+    request.deadline = Clock::now() + m_timeout;
+    std::future<NvrRecordResult> result = request.result.get_future();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.submitted++;
+    if(channel == 0 || m_queue.size() >= m_queue_max)
+    {
+        if(channel != 0)
+        {
+            m_stats.rejected++;
+            std::cout << "WARNING: NvrRecorder queue full, skip record " << alarm_date_str << std::endl;
+        }
+        request.result.set_value(NvrRecordResult());
+        return result;
+    }
+    m_queue.push_back(std::move(request));
+    m_cond.notify_one();
+    return result;
+}
+
+NvrRecorderStats NvrRecorder::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void NvrRecorder::worker()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true)
+    {
+        m_cond.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+        if(m_stop)
+            break;
+        Request request = std::move(m_queue.front());
+        m_queue.pop_front();
+
+        if(Clock::now() > request.deadline)
+        {
+            m_stats.expired++;
+            std::cout << "WARNING: NvrRecorder record " << request.alarm_date_str << " timeout in queue" << std::endl;
+            request.result.set_value(NvrRecordResult());
+            continue;
+        }
+
+        lock.unlock();
+        NvrRecordResult result;
+        result.ok = m_record(request.channel, request.alarm_date_str);
+        result.timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        request.result.set_value(result);
+        lock.lock();
+
+        if(result.ok)
+            m_stats.recorded++;
+        else
+            m_stats.failed++;
+    }
+}
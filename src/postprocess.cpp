@@ -4,7 +4,9 @@
 #include <string.h>
 #include <sys/time.h>
 #include <set>
+#include <algorithm>
 #include "rknn/postprocess.h"
+#include "async_log.h"
 
 // static char *labels[OBJ_CLASS_NUM];
 
@@ -214,7 +216,7 @@ int process(int8_t *input, int *anchor, int gird_h, int gird_w, int height, int
 
 int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h, int model_in_w, float conf_threshold, float nms_threshold,
                 BOX_RECT pads, float scale_w, float scale_h, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
-                 detect_result_group_t *group, std::vector<std::string> labels)
+                 detect_result_group_t *group, std::vector<std::string> labels, int offset_x, int offset_y)
 {
     // memset(group, 0, sizeof(detect_result_group_t));
     *group = detect_result_group_t();
@@ -249,7 +251,7 @@ int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h,
 
     if( validCount <= 0)
     {
-        std::cout << "没有符合的box" << std::endl;
+        ALOG(DEBUG) << "没有符合的box";
         return 0;
     }
 
@@ -288,10 +290,11 @@ int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h,
         float obj_conf = objProbs[n];
         int id = classIds[n];
 
-        group->results[last_count].box.left = (int)(clamp(x1, 0, model_in_w) / scale_w); // （目标值 / 缩放比例 = 原值）原图中对应的值
-        group->results[last_count].box.top = (int)(clamp(y1, 0, model_in_h) / scale_h);
-        group->results[last_count].box.right = (int)(clamp(x2, 0, model_in_w) / scale_w);
-        group->results[last_count].box.bottom = (int)(clamp(y2, 0, model_in_h) / scale_h);
+        // （目标值 / 缩放比例 = 原值）推理区域中对应的值，再加上推理区域在原图中的偏移
+        group->results[last_count].box.left = (int)(clamp(x1, 0, model_in_w) / scale_w) + offset_x;
+        group->results[last_count].box.top = (int)(clamp(y1, 0, model_in_h) / scale_h) + offset_y;
+        group->results[last_count].box.right = (int)(clamp(x2, 0, model_in_w) / scale_w) + offset_x;
+        group->results[last_count].box.bottom = (int)(clamp(y2, 0, model_in_h) / scale_h) + offset_y;
         // （x1,y1）左上角坐标    （x2,y2）右下角坐标
         group->results[last_count].prop = obj_conf;
         // char *strncpy(char *dest, const char *src, size_t n); 目标地址，源地址，最大长度
@@ -305,6 +308,49 @@ int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h,
 }
 
 
+int merge_detect_results(const std::vector<const detect_result_group_t *> &parts, float nms_threshold, detect_result_group_t *group)
+{
+    std::vector<const detect_result_t *> results;
+    for(const detect_result_group_t *part : parts)
+    {
+        for(int i = 0; i < part->count; i++)
+            results.push_back(&part->results[i]);
+    }
+    std::stable_sort(results.begin(), results.end(), [](const detect_result_t *a, const detect_result_t *b) {
+        return a->prop > b->prop;
+    });
+
+    int last_count = 0;
+    for(const detect_result_t *result : results)
+    {
+        if(last_count >= OBJ_NUMS_MAX_SIZE)
+            break;
+        const BOX_RECT &box = result->box;
+        float area = float(box.right - box.left) * float(box.bottom - box.top);
+        bool suppressed = false;
+        for(int k = 0; k < last_count && !suppressed; k++)
+        {
+            const detect_result_t &kept = group->results[k];
+            if(strncmp(kept.name, result->name, OBJ_NAME_MAX_SIZE) != 0)
+                continue;
+            float w = std::min(box.right, kept.box.right) - std::max(box.left, kept.box.left);
+            float h = std::min(box.bottom, kept.box.bottom) - std::max(box.top, kept.box.top);
+            if(w <= 0 || h <= 0)
+                continue;
+            float inter = w * h;
+            float kept_area = float(kept.box.right - kept.box.left) * float(kept.box.bottom - kept.box.top);
+            float iou = inter / (area + kept_area - inter);
+            float ios = inter / std::max(std::min(area, kept_area), 1.f);
+            suppressed = iou > nms_threshold || ios > MERGE_IOS_THRESHOLD;
+        }
+        if(!suppressed)
+            group->results[last_count++] = *result;
+    }
+    group->count = last_count;
+
+    return 0;
+}
+
 void deinitPostProcess()
 {
     std::cout << "deinitPostProcess" << std::endl;
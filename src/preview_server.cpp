@@ -0,0 +1,217 @@
+#include "preview_server.h"
+#include "snapshot_encoder.h"
+
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include "opencv2/imgproc.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include "httplib.h"
+
+PreviewServer::PreviewServer(int camera_count, int port) : m_port(port), m_server(new httplib::Server())
+{
+    for(int index = 0; index < camera_count; index++)
+        m_cameras.emplace_back(new Camera());
+    register_handlers();
+}
+
+PreviewServer::~PreviewServer()
+{
+    stop();
+}
+
+bool PreviewServer::start()
+{
+    if(!m_server->bind_to_port("0.0.0.0", m_port))
+    {
+        std::cout << "preview server cannot bind port " << m_port << std::endl;
+        return false;
+    }
+    m_listen_thread = std::thread([this]{ m_server->listen_after_bind(); });
+    std::cout << "preview server listen on port " << m_port << std::endl;
+    return true;
+}
+
+void PreviewServer::stop()
+{
+    m_quit = true;
+    for(auto &camera : m_cameras)
+    {
+        {
+            std::lock_guard<std::mutex> lock(camera->mutex);
+        }
+        camera->cond.notify_all();
+    }
+    m_server->stop();
+    if(m_listen_thread.joinable())
+        m_listen_thread.join();
+}
+
+void PreviewServer::addFrame(int camera_index, const cv::Mat &frame, const std::list<objectInfo> &objects)
+{
+    if(camera_index < 0 || camera_index >= static_cast<int>(m_cameras.size()) || frame.empty())
+        return;
+    Camera &camera = *m_cameras[camera_index];
+    {
+        std::lock_guard<std::mutex> lock(camera.mutex);
+        if(camera.clients == 0)
+            return;
+        camera.frame = frame; // 只增加引用计数，帧数据不拷贝，编码时才缩放
+        camera.objects = objects;
+        camera.generation++;
+    }
+    camera.cond.notify_all();
+}
+
+PreviewServerStats PreviewServer::stats() const
+{
+    PreviewServerStats stats;
+    stats.frames_encoded = m_frames_encoded;
+    stats.frames_sent = m_frames_sent;
+    stats.rejected = m_rejected;
+    stats.clients = m_clients;
+    return stats;
+}
+
+std::shared_ptr<const std::vector<uchar>> PreviewServer::next_jpeg(Camera &camera, uint64_t &generation, int timeout_ms)
+{
+    {
+        std::unique_lock<std::mutex> lock(camera.mutex);
+        bool ready = camera.cond.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                                          [&]{ return m_quit || (camera.generation > generation && !camera.frame.empty()); });
+        if(!ready || m_quit)
+            return nullptr;
+    }
+
+    // 第一个取到新帧的客户端负责编码，其他客户端等待后直接使用编码结果
+    std::lock_guard<std::mutex> encode_lock(camera.encode_mutex);
+    cv::Mat frame;
+    std::list<objectInfo> objects;
+    uint64_t frame_generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(camera.mutex);
+        if(camera.jpeg && camera.jpeg_generation == camera.generation)
+        {
+            generation = camera.jpeg_generation;
+            return camera.jpeg;
+        }
+        frame = camera.frame;
+        objects = camera.objects;
+        frame_generation = camera.generation;
+    }
+    if(frame.empty())
+        return nullptr;
+
+    thread_local cv::Mat scaled;
+    int width = std::min(PREVIEW_WIDTH, frame.cols);
+    int height = std::max(1, frame.rows * width / frame.cols);
+    cv::resize(frame, scaled, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+    SnapshotEncoder::draw_objects(scaled, objects, static_cast<float>(width) / frame.cols, static_cast<float>(height) / frame.rows);
+    frame.release();
+    static const std::vector<int> compression_params = {cv::IMWRITE_JPEG_QUALITY, PREVIEW_JPEG_QUALITY};
+    std::vector<uchar> buffer;
+    cv::imencode(".jpg", scaled, buffer, compression_params);
+    std::shared_ptr<const std::vector<uchar>> jpeg = std::make_shared<const std::vector<uchar>>(std::move(buffer));
+    m_frames_encoded++;
+
+    std::lock_guard<std::mutex> lock(camera.mutex);
+    if(camera.clients > 0)
+    {
+        camera.jpeg = jpeg;
+        camera.jpeg_generation = frame_generation;
+    }
+    generation = frame_generation;
+    return jpeg;
+}
+
+void PreviewServer::register_handlers()
+{
+    m_server->Get("/", [this](const httplib::Request &, httplib::Response &res)
+    {
+        std::ostringstream html;
+        html << "<html><body>";
+        for(size_t index = 0; index < m_cameras.size(); index++)
+            html << "<p><a href=\"/preview/" << index << "\">camera " << index << "</a></p>";
+        html << "</body></html>";
+        res.set_content(html.str(), "text/html");
+    });
+
+    m_server->Get(R"(/preview/(\d+))", [this](const httplib::Request &req, httplib::Response &res)
+    {
+        int camera_index = std::atoi(req.matches[1].str().c_str());
+        if(camera_index < 0 || camera_index >= static_cast<int>(m_cameras.size()))
+        {
+            res.status = 404;
+            res.set_content("no such camera", "text/plain");
+            return;
+        }
+        int fps = PREVIEW_DEFAULT_FPS;
+        if(req.has_param("fps"))
+            fps = std::max(1, std::min(PREVIEW_MAX_FPS, std::atoi(req.get_param_value("fps").c_str())));
+        if(++m_clients > PREVIEW_CLIENT_MAX)
+        {
+            m_clients--;
+            m_rejected++;
+            res.status = 503;
+            res.set_content("too many preview clients", "text/plain");
+            return;
+        }
+
+        Camera &camera = *m_cameras[camera_index];
+        {
+            std::lock_guard<std::mutex> lock(camera.mutex);
+            camera.clients++;
+        }
+        std::cout << "preview client connected, camera " << camera_index << " fps " << fps << std::endl;
+
+        // 每个客户端自己的进度：已发送的帧代数和下一次发送的时间
+        struct ClientState
+        {
+            uint64_t generation = 0;
+            std::chrono::steady_clock::time_point next_send = std::chrono::steady_clock::now();
+        };
+        std::shared_ptr<ClientState> state = std::make_shared<ClientState>();
+        auto interval = std::chrono::microseconds(1000000 / fps);
+
+        res.set_content_provider("multipart/x-mixed-replace; boundary=frame",
+            [this, &camera, state, interval](size_t, httplib::DataSink &sink)
+            {
+                // 按客户端的帧率限速
+                std::this_thread::sleep_until(state->next_send);
+                std::shared_ptr<const std::vector<uchar>> jpeg;
+                while(!jpeg)
+                {
+                    if(m_quit || !sink.is_writable())
+                        return false;
+                    jpeg = next_jpeg(camera, state->generation, 1000);
+                }
+                auto now = std::chrono::steady_clock::now();
+                state->next_send = std::max(state->next_send + interval, now);
+
+                std::string header = "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: " + std::to_string(jpeg->size()) + "\r\n\r\n";
+                if(!sink.write(header.data(), header.size()) ||
+                   !sink.write(reinterpret_cast<const char *>(jpeg->data()), jpeg->size()) ||
+                   !sink.write("\r\n", 2))
+                    return false;
+                m_frames_sent++;
+                return true;
+            },
+            [this, &camera, camera_index](bool)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(camera.mutex);
+                    camera.clients--;
+                    if(camera.clients == 0)
+                    {
+                        // 最后一个客户端离开，不再引用帧数据
+                        camera.frame.release();
+                        camera.objects.clear();
+                        camera.jpeg.reset();
+                    }
+                }
+                m_clients--;
+                std::cout << "preview client disconnected, camera " << camera_index << std::endl;
+            });
+    });
+}
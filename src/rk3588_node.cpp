@@ -54,7 +54,7 @@ CStatus RK3588Node::init()
 }
 
 // 功能：图像预处理
-cv::Mat RK3588Node::resize_with_padding(const cv::Mat &inputImage, int targetWidth, int targetHeight)
+cv::Mat RK3588Node::resize_with_padding(const cv::Mat &inputImage, int targetWidth, int targetHeight, cv::Rect *content_rect)
 {
     if (inputImage.empty())
     {
@@ -82,7 +82,9 @@ cv::Mat RK3588Node::resize_with_padding(const cv::Mat &inputImage, int targetWid
     int top = (targetHeight - newHeight) / 2;
     int bottom = targetHeight - newHeight - top;
     int left = (targetWidth - newWidth) / 2;
-    int right = targetWidth - newHeight - left;
+    int right = targetWidth - newWidth - left;
+    if(content_rect)
+        *content_rect = cv::Rect(left, top, newWidth, newHeight);
 
     // 填充加边
     cv::Mat outputImage;
@@ -94,31 +96,7 @@ cv::Mat RK3588Node::resize_with_padding(const cv::Mat &inputImage, int targetWid
 // 获取当前时间，包括毫秒时区等
 std::string RK3588Node::get_time_ymdhmm()
 {
-    // 获取当前时间点
-    auto now = std::chrono::system_clock::now();
-    // 将时间点转换为时间戳
-    auto now_c = std::chrono::system_clock::to_time_t(now);
-    // 转换为本地时间
-    struct tm *stm = std::localtime(&now_c);
-
-    // 获取毫秒部分
-    auto duration = now.time_since_epoch();  
-    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() % 1000; // 自纪元开始时间，取模得毫秒
-
-    // 获取时区偏移量
-    int tz_offset = stm->tm_gmtoff;
-    char tz_sign = (tz_offset >= 0) ? '+' : '-';
-    tz_offset = std::abs(tz_offset);
-    int tz_hour = tz_offset / 3600;
-    int tz_min = (tz_offset % 3600) / 60;
-
-    // 使用 stringstream 来格式化时间字符串
-    std::stringstream ss;
-    ss << std::put_time(stm, "%Y-%m-%dT%H:%M:%S"); // 格式化到秒
-    ss << '.' << std::setw(3) << std::setfill('0') << millis; // 添加毫秒
-    ss << tz_sign << std::setw(2) << std::setfill('0') << tz_hour << ':' << std::setw(2) << std::setfill('0') << tz_min; // 添加时区
-
-    return ss.str();
+    return ClockService::iso8601(ClockService::now_ms());
 }
 
 // 获取内存的使用情况，包括总共，空闲区和缓冲区
@@ -348,7 +326,19 @@ void RK3588Node::frame_get_thread(int camera_url_index, std::string camera_url)
     bool ready_to_update = false; // 是否准备好更新数据
     bool new_thread_start = true;  // 是否有新的线程开始
     inputData tmp_frame_buffer; // 临时存储输入
-
+    // 解码帧数，按摄像头区分，抓取端用rate()得到解码帧率
+    Counter &decoded_frames = MetricsRegistry::global().counter("seaway_decoded_frames_total", "Frames decoded per camera.",
+                                                                metrics_label("camera", std::to_string(camera_url_index)));
+    FrameTrace::set_thread_name("frame_get " + std::to_string(camera_url_index));
+    // 录制时该路摄像头解码出的每一帧都写入录制文件，帧序号与检测结果对应
+    uint64_t frame_seq = 0;
+    FrameRecorder *recorder = camera_url_index < static_cast<int>(m_frame_recorders.size()) ? m_frame_recorders[camera_url_index].get() : nullptr;
+
+    if(ReplayConfig::is_replay_url(camera_url))
+    {
+        replay_frames(camera_url_index, camera_url);
+        return;
+    }
     if(contain_IP_address(camera_url, "192.168.1.58"))// 根据输入 URL 选择解码器
     {   
         std::cout << "get the frame from opencv_decoder" << std::endl;
@@ -367,7 +357,7 @@ void RK3588Node::frame_get_thread(int camera_url_index, std::string camera_url)
             ret = opencv_decoder.read(frame); // 从视频流读取一帧,读取到的帧保存在frame中
             if(!ret) // 如果读取失败
             {
-                std::cout << "get frame error from camera_url " << std::endl;
+                ALOG(WARNING) << "get frame error from camera_url " << camera_url;
                 {
                     std::unique_lock<std::mutex> lock(frame_get_thread_mutex);
                     if(edgeI_data_update) // 检查是否需要更新数据 edgeI_data（EdgeInterfaceDate实例）
@@ -389,6 +379,10 @@ void RK3588Node::frame_get_thread(int camera_url_index, std::string camera_url)
                 continue; // 如果读取失败，重新读取新的帧
             }
             reopen_count = 0; // 遇到了读取成功的就重新打开清零了
+            decoded_frames.inc();
+            frame_seq++;
+            if(recorder)
+                recorder->write_frame(frame_seq, FrameTrace::now_us(), frame);
             {
                 std::unique_lock<std::mutex> lock(frame_get_thread_mutex);
                 if(edgeI_data_update) // 检查是否有数据更新
@@ -411,6 +405,9 @@ void RK3588Node::frame_get_thread(int camera_url_index, std::string camera_url)
                 }
                 tmp_frame_buffer.frame_data = frame.clone(); // 开始给模型输入结构体赋值,并存储到输入队列中
                 tmp_frame_buffer.frame_index = camera_url_index;
+                tmp_frame_buffer.frame_seq = frame_seq;
+                tmp_frame_buffer.trace_id = FrameTrace::sample(); // 采样的帧从这里开始记录各段等待
+                tmp_frame_buffer.trace_ts_us = tmp_frame_buffer.trace_id ? FrameTrace::now_us() : 0;
                 m_frame_buffer.push_back(tmp_frame_buffer);
 
                 // 帧间隔，如果已经达到了帧间隔技术，则重新计算
@@ -426,9 +423,14 @@ void RK3588Node::frame_get_thread(int camera_url_index, std::string camera_url)
             {
                 // 其实这一部分放在
                 tmp_frame_buffer.frame_time_stamp = TIME_STAMP_MS; // 帧的时间戳，推理时会用到
-                if(p_algo_infer_pool->put(tmp_frame_buffer)!=0) // 推理成功并添加结果进futures队列则返回0
+#ifdef ROI_CROP_INFER_ENABLE
+                tmp_frame_buffer.roi_rect = get_infer_roi(camera_url_index, tmp_frame_buffer.frame_data.size());
+#endif
+                if(tmp_frame_buffer.trace_id)
+                    tmp_frame_buffer.trace_ts_us = FrameTrace::now_us();
+                if(infer_submit(tmp_frame_buffer)!=0) // 推理成功并添加结果进futures队列则返回0
                 {
-                    std::cout << "infer frame error" << std::endl;
+                    ALOG_EVERY_MS(ERROR, 1000) << "infer frame error";
                     continue;
                 }
             }
@@ -457,7 +459,7 @@ void RK3588Node::frame_get_thread(int camera_url_index, std::string camera_url)
             ret = p_decoder->GetFrame(frame); // 从rtsp服务器读取帧
             if (!ret)
             {
-                std::cout << "get frame error from camera_url" << std::endl;
+                ALOG(WARNING) << "get frame error from camera_url " << camera_url;
                 {
                     std::unique_lock<std::mutex> lock(frame_get_thread_mutex);
                     if(edgeI_data_update)
@@ -478,6 +480,10 @@ void RK3588Node::frame_get_thread(int camera_url_index, std::string camera_url)
                 continue;
             }
             reopen_count = 0;
+            decoded_frames.inc();
+            frame_seq++;
+            if(recorder)
+                recorder->write_frame(frame_seq, FrameTrace::now_us(), frame);
             {
                 std::unique_lock<std::mutex> lock(frame_get_thread_mutex);
                 if(edgeI_data_update)
@@ -501,6 +507,9 @@ void RK3588Node::frame_get_thread(int camera_url_index, std::string camera_url)
 
                 tmp_frame_buffer.frame_data = frame.clone();
                 tmp_frame_buffer.frame_index = camera_url_index;
+                tmp_frame_buffer.frame_seq = frame_seq;
+                tmp_frame_buffer.trace_id = FrameTrace::sample(); // 采样的帧从这里开始记录各段等待
+                tmp_frame_buffer.trace_ts_us = tmp_frame_buffer.trace_id ? FrameTrace::now_us() : 0;
                 m_frame_buffer.push_back(tmp_frame_buffer); // ****将获取的帧读入到输入帧缓冲区中*****
 
                 // 设置帧间隔的目的是为了间隔多少帧，则对帧进行重新计数，否则一天下来，该通道的帧个数会非常大
@@ -515,12 +524,17 @@ void RK3588Node::frame_get_thread(int camera_url_index, std::string camera_url)
             {
                 // 其实这一部分放在frame_process_thread更合适，因为put中就执行了推理操作，get只是对推理后的结果进行拿取
                 tmp_frame_buffer.frame_time_stamp = TIME_STAMP_MS;
-                std::cout << "add input to rknnPool"  << std::endl;
+#ifdef ROI_CROP_INFER_ENABLE
+                tmp_frame_buffer.roi_rect = get_infer_roi(camera_url_index, tmp_frame_buffer.frame_data.size());
+#endif
+                ALOG(DEBUG) << "add input to rknnPool";
                 // futures.push(pool->submit(&rknnModel::infer, models[this->getModelId()], inputdata));
-                std::cout << "Call the put function of rknnPool" << std::endl;
-                if (p_algo_infer_pool->put(tmp_frame_buffer) != 0)
+                ALOG(DEBUG) << "Call the put function of rknnPool";
+                if(tmp_frame_buffer.trace_id)
+                    tmp_frame_buffer.trace_ts_us = FrameTrace::now_us();
+                if (infer_submit(tmp_frame_buffer) != 0)
                 {
-                    std::cout << "infer frame error" << std::endl;
+                    ALOG_EVERY_MS(ERROR, 1000) << "infer frame error";
                     continue;
                 }
                 // TIMER_END(algo_put);
@@ -537,6 +551,213 @@ void RK3588Node::frame_get_thread(int camera_url_index, std::string camera_url)
 }
 
 
+// 功能：回放录制文件代替摄像头，帧进入m_frame_buffer后的处理与摄像头相同。
+// 按录制时的间隔（除以speed）送入帧，speed为0时不等待；不响应配置更新
+void RK3588Node::replay_frames(int camera_url_index, const std::string &camera_url)
+{
+    ReplayConfig config = ReplayConfig::parse(camera_url);
+    FrameReplayer replayer;
+    if(!replayer.open(config.path))
+        return;
+    std::map<uint64_t, RecordedResult> expected;
+    if(config.expect.empty() || !FrameReplayer::load_results(config.expect, expected))
+        expected = replayer.results();
+    ReplayReport &report = ReplayReport::global();
+    report.camera_started(camera_url_index, expected, config.save);
+    std::cout << "replay " << config.path << " speed " << config.speed << " infer " << config.infer << std::endl;
+
+    inputData tmp_frame_buffer;
+    int64_t replayed_frames = 0;
+    int64_t first_record_us = 0, first_replay_us = 0;
+    bool rewound = true;
+    bool reached_end = false;
+    while(true)
+    {
+        CHECK_QUIT_AND_BREAK(quit_mutex, m_quit);
+        uint64_t frame_seq = 0;
+        int64_t record_us = 0;
+        cv::Mat frame;
+        int64_t read_start_us = FrameTrace::now_us();
+        if(!replayer.next(frame_seq, record_us, frame))
+        {
+            if(!config.loop)
+            {
+                reached_end = true;
+                break;
+            }
+            replayer.rewind();
+            rewound = true;
+            continue;
+        }
+        double read_ms = (FrameTrace::now_us() - read_start_us) / 1000.0;
+
+        if(config.speed > 0)
+        {
+            if(rewound)
+            {
+                first_record_us = record_us;
+                first_replay_us = FrameTrace::now_us();
+                rewound = false;
+            }
+            int64_t due_us = first_replay_us + static_cast<int64_t>((record_us - first_record_us) / config.speed);
+            std::this_thread::sleep_for(std::chrono::microseconds(due_us - FrameTrace::now_us()));
+        }
+        report.frame_read(camera_url_index, frame_seq, read_ms);
+
+        tmp_frame_buffer.frame_data = frame; // 每次解码出新的图像，不需要拷贝
+        tmp_frame_buffer.frame_index = camera_url_index;
+        tmp_frame_buffer.frame_seq = frame_seq;
+        // 回放时用回放的帧数作为时间戳，只用于匹配帧和推理结果，循环回放时也不重复
+        tmp_frame_buffer.frame_time_stamp = ++replayed_frames;
+        tmp_frame_buffer.trace_id = FrameTrace::sample();
+        tmp_frame_buffer.trace_ts_us = tmp_frame_buffer.trace_id ? FrameTrace::now_us() : 0;
+        {
+            std::unique_lock<std::mutex> lock(frame_get_thread_mutex);
+            m_frame_buffer.push_back(tmp_frame_buffer);
+            // 与摄像头相同的帧间隔
+            if(frame_interval_count[camera_url_index] == edgeI_data.camera_frame_interval[camera_url_index])
+                frame_interval_count[camera_url_index] = 0;
+            else
+            {
+                frame_interval_count[camera_url_index]++;
+                continue;
+            }
+        }
+#ifdef ALGO_INFER_ENABLE
+        if(config.infer == "none")
+            continue;
+        if(config.infer == "recorded")
+        {
+            // 直接使用录制的检测结果，不经过推理线程池
+            dataEncode recorded;
+            recorded.image = tmp_frame_buffer.frame_data;
+            recorded.frame_time_stamp = tmp_frame_buffer.frame_time_stamp;
+            recorded.frame_seq = frame_seq;
+            recorded.detect_result_group.id = camera_url_index;
+            auto result_iter = replayer.results().find(frame_seq);
+            if(result_iter != replayer.results().end())
+            {
+                recorded.detect_result_group.count = static_cast<int>(std::min<size_t>(result_iter->second.size(), OBJ_NUMS_MAX_SIZE));
+                std::copy(result_iter->second.begin(), result_iter->second.begin() + recorded.detect_result_group.count, recorded.detect_result_group.results);
+            }
+            std::unique_lock<std::mutex> lock(frame_process_thread_mutex);
+            m_algo_frame_result.push_back(recorded);
+            continue;
+        }
+#ifdef ROI_CROP_INFER_ENABLE
+        tmp_frame_buffer.roi_rect = get_infer_roi(camera_url_index, tmp_frame_buffer.frame_data.size());
+#endif
+        if(tmp_frame_buffer.trace_id)
+            tmp_frame_buffer.trace_ts_us = FrameTrace::now_us();
+        report.infer_submitted(camera_url_index, frame_seq);
+        if(infer_submit(tmp_frame_buffer) != 0)
+        {
+            ALOG_EVERY_MS(ERROR, 1000) << "infer frame error";
+        }
+#endif
+    }
+    std::cout << "replay " << config.path << (reached_end ? " finished" : " stopped") << std::endl;
+
+    if(reached_end && report.camera_finished(camera_url_index))
+    {
+        bool mismatched = report.finish(REPLAY_DRAIN_TIMEOUT_MS);
+#if REPLAY_EXIT_ON_END
+        // 离线测试时回放结束即退出，其他线程还在运行，不执行析构；有不一致的结果时退出码为1
+        AsyncLogger::instance().flush();
+        fflush(stdout);
+        std::_Exit(mismatched ? 1 : 0);
+#else
+        (void)mismatched;
+#endif
+    }
+}
+
+// 功能：获取该路摄像头的推理区域。ROI只占画面一部分时，只对ROI外接矩形（加边距）推理，
+// 模型输入分辨率不变，ROI区域内的有效分辨率更高，ROI外的区域不参与推理
+cv::Rect RK3588Node::get_infer_roi(int camera_index, const cv::Size &img_size)
+{
+    InferRoi &infer_roi = m_infer_roi_per_channel[camera_index];
+    const std::string &roi = edgeI_data.camera_roi[camera_index];
+    if(roi == infer_roi.roi && img_size == infer_roi.img_size)
+        return infer_roi.rect;
+
+    infer_roi.roi = roi;
+    infer_roi.img_size = img_size;
+    infer_roi.rect = cv::Rect();
+
+    WKTParser wkt_handle(img_size);
+    VectorZone zones;
+    if(!wkt_handle.parseZones(roi, &zones) || zones.empty())
+        return infer_roi.rect;
+
+    int min_x = img_size.width, min_y = img_size.height, max_x = 0, max_y = 0;
+    for(const GeoZone &zone : zones)
+    {
+        min_x = std::min(min_x, zone.outer.bbox.x);
+        min_y = std::min(min_y, zone.outer.bbox.y);
+        max_x = std::max(max_x, zone.outer.bbox.x + zone.outer.bbox.width);
+        max_y = std::max(max_y, zone.outer.bbox.y + zone.outer.bbox.height);
+    }
+    int margin_x = static_cast<int>((max_x - min_x) * ROI_CROP_MARGIN_RATIO);
+    int margin_y = static_cast<int>((max_y - min_y) * ROI_CROP_MARGIN_RATIO);
+    cv::Rect rect(min_x - margin_x, min_y - margin_y, max_x - min_x + 2 * margin_x + 1, max_y - min_y + 2 * margin_y + 1);
+    rect &= cv::Rect(0, 0, img_size.width, img_size.height);
+    if(rect.empty() || rect.area() >= img_size.area() * ROI_CROP_AREA_RATIO)
+        return infer_roi.rect;
+
+    infer_roi.rect = rect;
+    std::cout << "camera " << camera_index << " infer roi: " << rect.x << "," << rect.y << " " << rect.width << "x" << rect.height << std::endl;
+    return infer_roi.rect;
+}
+
+// 功能：计算切片区域。推理区域（为空时为整幅图像）按网格切片，相邻切片之间有重叠，
+// 切片缩放到模型输入时的缩小比例比整幅图像小得多，远处的小目标不会缩到只剩几个像素
+void RK3588Node::get_slice_rects(const cv::Size &img_size, const cv::Rect &roi_rect, std::vector<cv::Rect> &tiles)
+{
+    tiles.clear();
+    cv::Rect region = roi_rect.empty() ? cv::Rect(0, 0, img_size.width, img_size.height) : roi_rect;
+    if(region.width < SLICE_MIN_WIDTH || (SLICE_GRID_COLS <= 1 && SLICE_GRID_ROWS <= 1))
+        return;
+
+    // 切片宽高 tile 满足 cols * tile - (cols - 1) * overlap * tile = region
+    int tile_w = static_cast<int>(std::ceil(region.width / (SLICE_GRID_COLS - (SLICE_GRID_COLS - 1) * SLICE_OVERLAP_RATIO)));
+    int tile_h = static_cast<int>(std::ceil(region.height / (SLICE_GRID_ROWS - (SLICE_GRID_ROWS - 1) * SLICE_OVERLAP_RATIO)));
+    tile_w = std::min(tile_w, region.width);
+    tile_h = std::min(tile_h, region.height);
+    for(int row = 0; row < SLICE_GRID_ROWS; row++)
+    {
+        // 最后一行/列与推理区域的右边界/下边界对齐
+        int y = (SLICE_GRID_ROWS == 1) ? 0 : (region.height - tile_h) * row / (SLICE_GRID_ROWS - 1);
+        for(int col = 0; col < SLICE_GRID_COLS; col++)
+        {
+            int x = (SLICE_GRID_COLS == 1) ? 0 : (region.width - tile_w) * col / (SLICE_GRID_COLS - 1);
+            tiles.emplace_back(region.x + x, region.y + y, tile_w, tile_h);
+        }
+    }
+    if(SLICE_FULL_FRAME_ENABLE)
+        tiles.push_back(region);
+}
+
+// 功能：提交推理请求。开启切片推理时，同一帧的各个切片分发给线程池中的多个模型上下文并行推理，
+// 在结果队列中作为一个请求，get时合并并做跨切片NMS
+int RK3588Node::infer_submit(const inputData &input_data)
+{
+#ifdef SLICE_INFER_ENABLE
+    std::vector<cv::Rect> tiles;
+    get_slice_rects(input_data.frame_data.size(), input_data.roi_rect, tiles);
+    if(!tiles.empty())
+    {
+        std::vector<inputData> tile_inputs(tiles.size(), input_data); // 共享同一帧图像数据，不拷贝
+        for(size_t i = 0; i < tiles.size(); i++)
+            tile_inputs[i].roi_rect = tiles[i];
+        return p_algo_infer_pool->putBatch(tile_inputs, [](std::vector<dataEncode> &parts) {
+            return merge_slice_results(parts, NMS_THRESHOLD);
+        });
+    }
+#endif
+    return p_algo_infer_pool->put(input_data);
+}
+
 // 功能：对线程池中推理得到的数据进行处理
 void RK3588Node::frame_process_thread()
 {
@@ -546,6 +767,7 @@ void RK3588Node::frame_process_thread()
     auto nextExecution = std::chrono::steady_clock::now() + interval; // 定义帧率输出间隔时间
 
     dataEncode data_to_encode; // 准备用于编码的数据，【帧处理输出数据结构】
+    FrameTrace::set_thread_name("frame_process");
     while(true)
     {
         CHECK_QUIT_AND_BREAK(quit_mutex, m_quit); // 该宏里面有break
@@ -557,6 +779,13 @@ void RK3588Node::frame_process_thread()
             {
                 continue;
             }
+            // 推理完成后在futures队列中等待被取走的时间
+            data_to_encode.trace_ts_us = FrameTrace::wait(data_to_encode.trace_id, "wait infer result", data_to_encode.trace_ts_us);
+            int result_camera = data_to_encode.detect_result_group.id;
+            if(result_camera >= 0 && result_camera < static_cast<int>(m_frame_recorders.size()) && m_frame_recorders[result_camera])
+                m_frame_recorders[result_camera]->write_result(data_to_encode.frame_seq, data_to_encode.detect_result_group);
+            if(m_replay_enabled)
+                ReplayReport::global().infer_done(data_to_encode.frame_seq, data_to_encode.detect_result_group);
             {
                 std::unique_lock<std::mutex> lock(frame_process_thread_mutex);
                 m_algo_frame_result.push_back(data_to_encode); // ******将获取的推理结果添加进推理结果队列中******
@@ -566,7 +795,7 @@ void RK3588Node::frame_process_thread()
         if(now >= nextExecution)
         {
             algo_fps = 0;
-            std::cout << "Algo fps: " << algo_fps / (fps_print_interval_ms / 1000) << std::endl;
+            ALOG(INFO) << "Algo fps: " << algo_fps / (fps_print_interval_ms / 1000);
             now = std::chrono::steady_clock::now();
             nextExecution = now + interval;
         }
@@ -627,14 +856,29 @@ void RK3588Node::show_local_thread()
                     update_frame = true;
                     cv::Mat temp_image;
                     temp_image = m_frame_concate_deque[image_show_index].front().image;
+                    // OSD画在缩放后的显示图像上，不修改原分辨率的帧
+                    std::list<objectInfo> osd_objects;
+                    if(edgeI_data.global_osd_enable)
+                        get_osd_objects(m_frame_concate_deque[image_show_index].front().detect_result_group, osd_objects);
                     m_frame_concate_deque[image_show_index].pop_front();
+                    cv::Rect content_rect;
                     switch (show_size_plan)
                     {
                         case SIZE_1X1:
                             cv::resize(temp_image, m_show_mat, cv::Size(1920, 1080), 0, 0, cv::INTER_LINEAR);
+                            SnapshotEncoder::draw_objects(m_show_mat, osd_objects, 1920.f / temp_image.cols, 1080.f / temp_image.rows);
                             break;
                         default:
-                            temp_image = resize_with_padding(temp_image, 960, 540);
+                            {
+                                cv::Size source_size = temp_image.size();
+                                temp_image = resize_with_padding(temp_image, 960, 540, &content_rect);
+                                if(!osd_objects.empty())
+                                {
+                                    cv::Mat content = temp_image(content_rect); // 只在填充边以内的有效区域画框
+                                    SnapshotEncoder::draw_objects(content, osd_objects, static_cast<float>(content_rect.width) / source_size.width,
+                                                                  static_cast<float>(content_rect.height) / source_size.height);
+                                }
+                            }
                             // cv::resize(temp_image, temp_image, cv::Size(temp_image.cols / show_size_plan, temp_image.rows / show_size_plan), 0, 0, cv::INTER_NEAREST);
                             temp_image.copyTo(m_show_mat(cv::Rect(image_show_index % show_size_plan * 1920 / show_size_plan, image_show_index / show_size_plan * 1080 / show_size_plan,
                                                 1920 / show_size_plan, 1080 / show_size_plan)));
@@ -655,7 +899,7 @@ void RK3588Node::show_local_thread()
         cv::waitKey(20);
         if(now >= nextExecution)
         {
-            std::cout << "Show fps: " << show_fps / (fps_print_interval_ms / 1000) << std::endl;
+            ALOG(INFO) << "Show fps: " << show_fps / (fps_print_interval_ms / 1000);
             show_fps = 0;
             now = std::chrono::steady_clock::now();
             nextExecution = now + interval;
@@ -689,10 +933,10 @@ void RK3588Node::encode_thread()
         {
             continue;
         }
-        p_encoder->WriteFrame(image_show_mat); // 将拼接后的帧通过编码器传输到rtsp服务器中
+        p_mosaic_encoder->write(image_show_mat); // 将拼接后的帧通过编码器传输到rtsp服务器中
         if(now >= nextExecution)
         {
-            std::cout << "Encode fps: " << encode_fps / (fps_print_interval_ms / 1000) << std::endl;
+            ALOG(INFO) << "Encode fps: " << encode_fps / (fps_print_interval_ms / 1000);
             encode_fps = 0;
             now = std::chrono::steady_clock::now();
             nextExecution = now + interval;
@@ -703,12 +947,66 @@ void RK3588Node::encode_thread()
     std::cout <<  "encode_thread release" << std::endl;
 }
 
-// 功能：将一个浮点数按照指定的小数位进行格式化
-std::string RK3588Node::formatFloatValue(float val, int fixed)
+// 功能：注册队列长度和推流、预览的统计，抓取时才读取
+void RK3588Node::register_metrics()
+{
+    MetricsRegistry &registry = MetricsRegistry::global();
+    registry.gauge_callback("seaway_queue_depth", "Current queue depth.", metrics_label("queue", "frame_buffer"), [this]()
+    {
+        std::unique_lock<std::mutex> lock(frame_get_thread_mutex);
+        return static_cast<double>(m_frame_buffer.size());
+    }, this);
+    registry.gauge_callback("seaway_queue_depth", "Current queue depth.", metrics_label("queue", "algo_frame_result"), [this]()
+    {
+        std::unique_lock<std::mutex> lock(frame_process_thread_mutex);
+        return static_cast<double>(m_algo_frame_result.size());
+    }, this);
+#ifdef RTSP_ENCODE_ENABLE
+    registry.counter_callback("seaway_substream_encoded_frames_total", "Frames encoded for per-camera substreams.", std::string(), [this]()
+    {
+        return p_stream_hub ? static_cast<double>(p_stream_hub->stats().frames_encoded) : 0;
+    }, this);
+    registry.gauge_callback("seaway_substream_active", "Substreams with an open encoder session.", std::string(), [this]()
+    {
+        return p_stream_hub ? static_cast<double>(p_stream_hub->stats().active) : 0;
+    }, this);
+#endif
+#ifdef PREVIEW_SERVER_ENABLE
+    registry.counter_callback("seaway_preview_encoded_frames_total", "JPEG frames encoded for MJPEG preview.", std::string(), [this]()
+    {
+        return p_preview_server ? static_cast<double>(p_preview_server->stats().frames_encoded) : 0;
+    }, this);
+    registry.gauge_callback("seaway_preview_clients", "Connected MJPEG preview clients.", std::string(), [this]()
+    {
+        return p_preview_server ? static_cast<double>(p_preview_server->stats().clients) : 0;
+    }, this);
+#endif
+}
+
+RK3588Node::~RK3588Node()
 {
-    std::ostringstream oss; // 输出字符串流，允许将各种数据类型插入到流中
-    oss << std::setprecision(fixed) << val; // std::setprecision 是一个操纵符，它用于设置流的输出精度
-    return oss.str();
+    MetricsRegistry::global().remove_callbacks(this);
+}
+
+// 功能：将一帧的检测结果转换为需要叠加显示的目标，坐标仍是原图坐标，由显示和拼接时按缩放比例绘制
+void RK3588Node::get_osd_objects(const detect_result_group_t &group, std::list<objectInfo> &objects)
+{
+    objects.clear();
+    for(int i = 0; i < group.count && i < OBJ_NUMS_MAX_SIZE; i++)
+    {
+        const detect_result_t &object = group.results[i];
+        if(object.prop == 0)
+            continue;
+        objectInfo osd_object;
+        osd_object.x = object.box.left;
+        osd_object.y = object.box.top;
+        osd_object.w = object.box.right - object.box.left;
+        osd_object.h = object.box.bottom - object.box.top;
+        osd_object.track_id = object.track_id;
+        osd_object.label = object.name;
+        osd_object.score = object.prop;
+        objects.push_back(osd_object);
+    }
 }
 
 // 没有对警告信息和结果信息进行赋值
@@ -721,18 +1019,33 @@ void RK3588Node::camera_setting_to_node(int camera_index, pipelineInfo &output)
     output.camera_id = edgeI_data.camera_id[camera_index]; // 摄像头对应id
     output.camera_name = edgeI_data.camera_name[camera_index]; // 摄像头名字
 
-    output.setting_information.frameInterval = edgeI_data.camera_frame_interval[camera_index]; // 帧间隔
-    output.setting_information.roi = edgeI_data.camera_roi[camera_index]; // ROI
+    output.setting_information = get_camera_setting(camera_index); // 共享同一份配置，不拷贝
+}
+
+// 功能：获取该路摄像头的配置。配置只读，所有报警共享同一份，edgeI_data重新加载时清空缓存
+std::shared_ptr<const settingInfo> RK3588Node::get_camera_setting(int camera_index)
+{
+    if(camera_index >= static_cast<int>(m_setting_per_channel.size()))
+        m_setting_per_channel.resize(camera_index + 1);
+    if(m_setting_per_channel[camera_index])
+        return m_setting_per_channel[camera_index];
+
+    std::shared_ptr<settingInfo> setting = std::make_shared<settingInfo>();
+    setting->frameInterval = edgeI_data.camera_frame_interval[camera_index]; // 帧间隔
+    setting->roi = edgeI_data.camera_roi[camera_index]; // ROI
+
+    setting->confThreshold = edgeI_data.camera_conf_config_threshold[camera_index]; // 置信度阈值
+    setting->nmsThreshold = edgeI_data.camera_nms_config_threshold[camera_index]; // NMS阈值
+    setting->labelThreshMap = edgeI_data.labels_thresh[camera_index];// 标签阈值   std::map<int, std::map<std::string, float>> labels_thresh = {};
 
-    output.setting_information.confThreshold = edgeI_data.camera_conf_config_threshold[camera_index]; // 置信度阈值
-    output.setting_information.nmsThreshold = edgeI_data.camera_nms_config_threshold[camera_index]; // NMS阈值
-    output.setting_information.labelThreshMap = edgeI_data.labels_thresh[camera_index];// 标签阈值   std::map<int, std::map<std::string, float>> labels_thresh = {};
+    setting->alarmInterval = edgeI_data.camera_alarm_interval[camera_index]; // 警告间隔时间
+    setting->alarmSmooth = edgeI_data.camera_alarm_smooth[camera_index]; // 警告是否首次上报
 
-    output.setting_information.alarmInterval = edgeI_data.camera_alarm_interval[camera_index]; // 警告间隔时间
-    output.setting_information.alarmSmooth = edgeI_data.camera_alarm_smooth[camera_index]; // 警告是否首次上报
+    setting->statisiticsStartTime = edgeI_data.camera_statistics_start_time[camera_index];// 开始统计时间
+    setting->statisiticsEndTime = edgeI_data.camera_statistics_end_time[camera_index]; // 结束统计时间
 
-    output.setting_information.statisiticsStartTime = edgeI_data.camera_statistics_start_time[camera_index];// 开始统计时间
-    output.setting_information.statisiticsEndTime = edgeI_data.camera_statistics_end_time[camera_index]; // 结束统计时间
+    m_setting_per_channel[camera_index] = setting;
+    return m_setting_per_channel[camera_index];
 }
 
 // 功能：rk3588对模型进行全流程推理的函数
@@ -755,6 +1068,8 @@ CStatus RK3588Node::run()
         
     }// edgeI_data是EdgeInterfaceDate结构体实例
     edgeI_data = edgeI_config.GetEdgeIDate();// 问题：获取之前不应该先初始化调用json文件内容吗？ 
+    m_setting_per_channel.clear(); // 配置重新加载，共享的配置需要重新创建
+    register_metrics();
 
 // 是否本地设备上显示............................................................
 #ifdef SHOW_LOCAL_ENABLE
@@ -763,15 +1078,42 @@ CStatus RK3588Node::run()
     frame_threads.emplace_back(&RK3588Node::monitor_directory_thread, this, edgeI_data.algorithm_config_path);
 #endif
 
+// 是否开启HTTP预览..............................................................
+#ifdef PREVIEW_SERVER_ENABLE
+    // 需要在帧处理线程启动前创建
+    p_preview_server = std::make_unique<PreviewServer>(edgeI_data.camera_url.size(), PREVIEW_SERVER_PORT);
+    p_preview_server->start();
+#endif
+
+// 录制和回放..............................................................
+    // 需要在帧获取线程启动前创建，回放的摄像头不录制
+    for(int camera_url_index = 0; camera_url_index < static_cast<int>(edgeI_data.camera_url.size()); camera_url_index++)
+    {
+        const std::string &camera_url = edgeI_data.camera_url[camera_url_index];
+        if(ReplayConfig::is_replay_url(camera_url))
+        {
+            m_replay_enabled = true;
+            continue;
+        }
+        if(std::string(FRAME_RECORD_DIR).empty())
+            continue;
+        m_frame_recorders.resize(edgeI_data.camera_url.size());
+        m_frame_recorders[camera_url_index].reset(new FrameRecorder());
+        if(!m_frame_recorders[camera_url_index]->open(std::string(FRAME_RECORD_DIR) + "/camera_" + std::to_string(camera_url_index) + ".rec"))
+            m_frame_recorders[camera_url_index].reset();
+    }
+
 // 是否开启算法推理..............................................................
 #ifdef ALGO_INFER_ENABLE
 
     // 前三个是传入的模板参数，后边的是rknnPool构造函数传入的参数  调用了构造函数
-    p_algo_infer_pool = std::make_unique< rknnPool<rkYolov5s, inputData, dataEncode> >("rk3588/resources/model/rk3588model.rknn","rk3588/resources/config/labels.txt", 2);
+    p_algo_infer_pool = std::make_unique< rknnPool<rkYolov5s, inputData, dataEncode> >("rk3588/resources/model/rk3588model.rknn","rk3588/resources/config/labels.txt", ALGO_INFER_THREAD_COUNT);
     std::cout << "Thread pool creation, start calling init function" << std::endl;
 
     // 调用线程池的初始化函数,里面也包含了rkYolvo5的init函数的调用
     p_algo_infer_pool->init(); 
+    // 推理区域缓存需要在帧获取线程启动前分配好
+    m_infer_roi_per_channel.resize(edgeI_data.camera_url.size());
 
     // 添加帧获取的线程，通过p_decoder获取帧
     for(int camera_url_index = 0; camera_url_index < edgeI_data.camera_url.size(); camera_url_index++ )
@@ -791,19 +1133,37 @@ CStatus RK3588Node::run()
     // 打开rtsp服务，在frame_get_thread中，通过p_decoder->Open(camera_url)打开，然后通过getFrame逐帧获取
     rtsp_server_start(RTSP_SERVER_PORT_DEFAULT, "rk3588/resources/config/config.ini");
 
-    ImageSize size;
-    size.width = 1920;
-    size.height = 1080;
-    // 这个端口不是解码用的端口，而是编码用的
-    if(!p_encoder->Open(ENCODE_TYPE_H264, edgeI_data.global_encode_frame_rate, size, 8554, "stream")) // 打开编码
+    StreamConfig mosaic_config;
+    mosaic_config.name = MOSAIC_STREAM_NAME;
+    mosaic_config.width = MOSAIC_STREAM_WIDTH;
+    mosaic_config.height = MOSAIC_STREAM_HEIGHT;
+    mosaic_config.fps = edgeI_data.global_encode_frame_rate;
+    mosaic_config.port = MOSAIC_STREAM_PORT;
+    p_mosaic_encoder = create_stream_encoder();
+    p_mosaic_encoder->open(mosaic_config); // 拼接画面常开，打开失败时write直接返回
+
+    // 每路摄像头一路子码流；rtsp服务没有客户端连接的回调，不常开时没有调用acquire的地方，不创建子码流线程
+    if(SUBSTREAM_ALWAYS_ON)
     {
-        std::cout << "cannot open Encoder " << std::endl;
+        std::vector<StreamConfig> substream_configs(edgeI_data.camera_url.size());
+        for(size_t camera_index = 0; camera_index < substream_configs.size(); camera_index++)
+        {
+            substream_configs[camera_index].name = SUBSTREAM_NAME_PREFIX + std::to_string(camera_index);
+            substream_configs[camera_index].width = SUBSTREAM_WIDTH;
+            substream_configs[camera_index].height = SUBSTREAM_HEIGHT;
+            substream_configs[camera_index].fps = SUBSTREAM_FPS;
+            substream_configs[camera_index].port = SUBSTREAM_PORT;
+        }
+        p_stream_hub = std::make_unique<StreamHub>(substream_configs);
+        for(size_t camera_index = 0; camera_index < substream_configs.size(); camera_index++)
+            p_stream_hub->acquire(camera_index);
     }
-    frame_threads.emplace_back(&RK3588Node::encode_thread, this); // 加入编码处理的线程
-    PRINT_CURRENT_TIME_WITH_MILLISECONDS("encode_thread start: ");
 
     // 初始化，并传入构造函数的参数
-    p_encode_frame_concate = std::make_unique< FrameConcate >(edgeI_data.camera_url.size(), edgeI_data.global_encode_frame_rate, 1920, 1080); // 帧拼接对象的指针
+    p_encode_frame_concate = std::make_unique< FrameConcate >(edgeI_data.camera_url.size(), edgeI_data.global_encode_frame_rate, MOSAIC_STREAM_WIDTH, MOSAIC_STREAM_HEIGHT); // 帧拼接对象的指针
+    // 编码器和拼接对象创建后再启动编码线程
+    frame_threads.emplace_back(&RK3588Node::encode_thread, this); // 加入编码处理的线程
+    PRINT_CURRENT_TIME_WITH_MILLISECONDS("encode_thread start: ");
 #endif
 
 // 是否本设备上显示...................................................................
@@ -818,6 +1178,16 @@ CStatus RK3588Node::run()
 #endif
 
     int instance_count = edgeI_data.camera_url.size();
+    // 每路摄像头一个跟踪器，跟踪结果的track_id用于后续报警
+    std::map<int, std::string> track_info;
+    for(int camera_index = 0; camera_index < instance_count; camera_index++)
+    {
+        track_info[camera_index] = edgeI_data.camera_id[camera_index];
+    }
+    set_track_info(track_info, edgeI_data.global_encode_frame_rate, TRACK_BUFFER_COUNT);
+    m_alarm_filter_per_channel.resize(instance_count);
+    m_roi_mask_per_channel.resize(instance_count);
+
     // 初始化拼接帧mutex deque
     m_frame_concate_mutex.resize(instance_count);
     m_frame_concate_deque.resize(instance_count); // 问题：在非show_local下如何使用，难道只有本地显示的时候才拼接帧吧
@@ -844,6 +1214,7 @@ CStatus RK3588Node::run()
         std::cout << "display over size" << std::endl;
     }
 
+    FrameTrace::set_thread_name("rk3588_node run");
     // 在该循环中仍然是一帧一帧的去处理，因为有这个data_to_encode，先获取输入帧的id，image, frame_time_stamp 后来又去比较m_algo_frame_result中的内容
     // 幸亏不是去对比m_algo_frame_result.front() 否则慢死
     while(true) 
@@ -864,6 +1235,9 @@ CStatus RK3588Node::run()
             data_to_encode.image = m_frame_buffer.front().frame_data.clone();
             data_to_encode.detect_result_group.id = m_frame_buffer.front().frame_index;
             data_to_encode.frame_time_stamp = m_frame_buffer.front().frame_time_stamp;
+            data_to_encode.frame_seq = m_frame_buffer.front().frame_seq;
+            data_to_encode.trace_id = m_frame_buffer.front().trace_id;
+            data_to_encode.trace_ts_us = FrameTrace::wait(data_to_encode.trace_id, "wait frame buffer", m_frame_buffer.front().trace_ts_us);
             m_frame_buffer.pop_front(); // 取出头部
             check_and_clear_buffer(m_frame_buffer, FRAME_BUFFER_COUNT, "frame buffer"); // 这里是检查并清空，没超过buffer就不用清空
         }
@@ -884,6 +1258,7 @@ CStatus RK3588Node::run()
                     if( (it->detect_result_group.id == data_to_encode.detect_result_group.id) && (it->frame_time_stamp == data_to_encode.frame_time_stamp) )
                     {
                         data_to_encode.detect_result_group = it->detect_result_group; // 迭代器是个指针
+                        FrameTrace::wait(it->trace_id, "wait algo result", it->trace_ts_us);
                         data_to_encode.isNeedTrack = true;
                         m_algo_frame_result.erase(it);
                         break;
@@ -901,8 +1276,17 @@ CStatus RK3588Node::run()
         // 结果转换并赋值到pipeline中
         if(data_to_encode.detect_result_group.count > 0)
         {
+            // 按报警间隔和首次上报配置抑制重复报警，被抑制的目标不进入alarm_information
+            int64_t alarm_time_ms = ClockService::now_ms();
+            AlarmFilter &alarm_filter = m_alarm_filter_per_channel[frame_source_index];
+            alarm_filter.set_config(edgeI_data.camera_alarm_interval[frame_source_index], edgeI_data.camera_alarm_smooth[frame_source_index]);
+            alarm_filter.expire(alarm_time_ms);
+            // 先做ROI判断再做报警抑制，ROI外的目标不占用报警间隔，也不计入持续出现的时间；AppRoiNode仍会再筛选一次
+            RoiMask &roi_mask = m_roi_mask_per_channel[frame_source_index];
+            roi_mask.compile(edgeI_data.camera_roi[frame_source_index], data_to_encode.image.size());
             // 智能指针，离开其作用域时，它所指向的对象会被自动销毁
             std::unique_ptr<pipelineInfoMessageParam> tempdata(new pipelineInfoMessageParam);
+            tempdata->pipelineinfo.alarm_time_ms = alarm_time_ms; // 同一帧的目标共用报警时间，发布时才格式化
             // 在这将dataEncode类型，转换为pipelineinfo类型
             // 目的在于更新pipelineinfo中的result_information和alarm_information
             for(auto object : data_to_encode.detect_result_group.results) 
@@ -922,9 +1306,13 @@ CStatus RK3588Node::run()
                 temp_object.label = object.name;
                 temp_object.score = object.prop; // 将检测结果类型和置信度赋值
 
-                tempdata->pipelineinfo.alarm_date = get_time_ymdhmm();  // 字符串类型，包括毫秒和时区
                 tempdata->pipelineinfo.result_information.result_object_list.push_back(temp_object);
                 tempdata->pipelineinfo.result_information.result_num++;
+                if(!roi_mask.contains(cv::Rect(temp_object.x, temp_object.y, temp_object.w, temp_object.h)) ||
+                   !alarm_filter.check(object.track_id, object.name, alarm_time_ms))
+                {
+                    continue;
+                }
                 tempdata->pipelineinfo.alarm_information.alarm_object_list.push_back(temp_object);
                 tempdata->pipelineinfo.alarm_information.alarm_num++;
             }
@@ -932,35 +1320,41 @@ CStatus RK3588Node::run()
             if(tempdata->pipelineinfo.alarm_information.alarm_num != 0)
             {   
                 // 管道里的摄像头信息也是实时更新的啊
-                tempdata->pipelineinfo.source_image = data_to_encode.image.clone();
+                tempdata->pipelineinfo.source_image = std::make_shared<const cv::Mat>(data_to_encode.image); // OSD只画在缩放后的图像上，原图不再修改，直接共享
                 camera_setting_to_node(data_to_encode.detect_result_group.id, tempdata->pipelineinfo);
+                tempdata->pipelineinfo.trace_id = data_to_encode.trace_id;
+                tempdata->pipelineinfo.trace_ts_us = data_to_encode.trace_id ? FrameTrace::now_us() : 0;
                 // 发送一个 message param  参数列表：(Type, topic, value, strategy) 
                 status = CGRAPH_SEND_MPARAM(pipelineInfoMessageParam, "send-recv", tempdata, CGraph::GMessagePushStrategy::DROP);
             }
-            // 是否开启本地图像的绘画显示，各种描述信息
-            if(edgeI_data.global_osd_enable)
-            {
-                for(auto object : data_to_encode.detect_result_group.results)
-                {
-                    std::string label_name_str(object.name);
-
-                    cv::putText(data_to_encode.image, label_name_str + " " + formatFloatValue(object.prop, 2),
-
-                    cv::Point(object.box.left, object.box.top - 5), 0, 2, cv::Scalar(0, 0, 255), 8);
-                    // cv::rectangle的参数需要传入两个坐标   cv::Rect的参数是左上角坐标和宽高
-                    cv::rectangle(data_to_encode.image, cv::Rect(object.box.left, object.box.top, 
-                        object.box.right - object.box.left, object.box.bottom - object.box.top), cv::Scalar(0, 0, 255), 8);
-                }
-            }
 
         }
 #endif
 
-// 用于将该帧添加到拼接帧的算法中
+// 用于将该帧添加到拼接帧、子码流和预览中
+#if defined(RTSP_ENCODE_ENABLE) || defined(PREVIEW_SERVER_ENABLE)
+        {
+            // 是否开启OSD：目标框和标签在缩放后的图像上绘制，不在原图上绘制
+            // 同一帧交给拼接画面、该路的子码流和预览，都只引用帧数据，不拷贝
+            std::list<objectInfo> osd_objects;
+            if(edgeI_data.global_osd_enable)
+                get_osd_objects(data_to_encode.detect_result_group, osd_objects);
 #ifdef RTSP_ENCODE_ENABLE
             // 问题：这里的id到底是指的是几号摄像头，还是指的是该输入流下的第几个帧  【初步认为是第几个摄像头的意思，因为addFrame的实现】
-            p_encode_frame_concate->addFrame(data_to_encode.detect_result_group.id, data_to_encode.image);
+            p_encode_frame_concate->addFrame(data_to_encode.detect_result_group.id, data_to_encode.image, osd_objects);
+            if(p_stream_hub)
+                p_stream_hub->addFrame(data_to_encode.detect_result_group.id, data_to_encode.image, osd_objects);
+#endif
+#ifdef PREVIEW_SERVER_ENABLE
+            p_preview_server->addFrame(data_to_encode.detect_result_group.id, data_to_encode.image, osd_objects);
 #endif
+        }
+#endif
+        // 从出队到交给报警管道和编码的处理时间
+        if(data_to_encode.trace_id)
+            FrameTrace::record(data_to_encode.trace_id, "process frame", data_to_encode.trace_ts_us, FrameTrace::now_us(), false);
+        if(m_replay_enabled)
+            ReplayReport::global().frame_processed(frame_source_index, data_to_encode.frame_seq);
 
 #ifdef SHOW_LOCAL_ENABLE
         {
@@ -991,54 +1385,54 @@ CStatus RK3588Node::run()
 
 CStatus RK3588Node::track(dataEncode &input_frame)
 {
-    // auto chan_id = input_frame.detect_result_group.id;
-    // auto object_results = input_frame.detect_result_group.results;
-    // int image_width = input_frame.image.cols;
-    // int image_height = input_frame.image.rows;
-    // std::vector<Object> objs;
-    // objs.resize(input_frame.detect_result_group.count);
-    // std::vector<STrack> obj_tracks;
-    // for (int k = 0; k < input_frame.detect_result_group.count; ++k) {
-    //     std::vector<std::string>::iterator label_index = std::find(edgeI_data.labels_string.begin(), edgeI_data.labels_string.end(), object_results[k].name);
-    //     objs[k].label = label_index - edgeI_data.labels_string.begin();//object_results[k].class_id;
-    //     objs[k].prob = object_results[k].prop;
-    //     // ATTENTION:box point1(left, top) point2(right, bottom) 
-    //     float x1 = object_results[k].box.left;
-    //     float y1 = object_results[k].box.top;
-    //     float x2 = object_results[k].box.right;
-    //     float y2 = object_results[k].box.bottom;
-    //     // std::cout << "get track x1 = " << x1 << " y1 = " << y1 << " x2 = " << x2 << " y2 = " << y2 << std::endl;
-    //     objs[k].rect = cv::Rect(cv::Point(x1, y1), cv::Point(x2, y2));
-    // }
-    // obj_tracks = m_tracker_per_channel[chan_id]->update(objs);
-    // for(int object_track_index = 0; object_track_index < obj_tracks.size(); object_track_index++)
-    // {
-    //     std::vector<float> tlwh = obj_tracks[object_track_index].tlwh;
-    //     if(tlwh[2] * tlwh[3] > 20)
-    //     {
-    //         input_frame.detect_result_group.results[object_track_index].track_id = obj_tracks[object_track_index].track_id;
-    //         input_frame.detect_result_group.results[object_track_index].box.left = tlwh[0];
-    //         input_frame.detect_result_group.results[object_track_index].box.top = tlwh[1];
-    //         input_frame.detect_result_group.results[object_track_index].box.right = tlwh[2] + tlwh[0];
-    //         input_frame.detect_result_group.results[object_track_index].box.bottom = tlwh[3] + tlwh[1];
-    //         // std::cout << "obj_tracks[object_track_index].track_id = " << obj_tracks[object_track_index].track_id << std::endl;
-    //         // std::cout << "******id = " << obj_tracks[object_track_index].track_id << " top = " << tlwh[0] << " left = " << tlwh[1] << " width = " << tlwh[2] << " height = " << tlwh[3] << std::endl;
-    //     //     cv::putText(input_frame.image, cv::format("%d", obj_tracks[object_track_index].track_id),
-    //     //                 cv::Point(tlwh[0], tlwh[1] - 5), 0, 2, cv::Scalar(0, 0, 255), 2);
-    //     //     cv::rectangle(input_frame.image, cv::Rect(tlwh[0], tlwh[1], tlwh[2], tlwh[3]), cv::Scalar(0, 0, 255), 2);
-    //     }
-    //     // std::cout << "******id = " << obj_tracks[object_track_index].track_id << " top = " << tlwh[0] << " left = " << tlwh[1] << " width = " << tlwh[2] << " height = " << tlwh[3] << std::endl;
-    // }
-    // // cv::imwrite("result.jpg", input_frame.image);
+    auto chan_id = input_frame.detect_result_group.id;
+    auto tracker_iter = m_tracker_per_channel.find(chan_id);
+    if(tracker_iter == m_tracker_per_channel.end())
+    {
+        ALOG_EVERY_MS(WARNING, 1000) << "no tracker for channel " << chan_id;
+        return CStatus();
+    }
+    detect_result_t *object_results = input_frame.detect_result_group.results;
+    int object_count = input_frame.detect_result_group.count;
+    m_track_objects.resize(object_count);
+    for (int k = 0; k < object_count; ++k) {
+        std::vector<std::string>::iterator label_index = std::find(edgeI_data.labels_string.begin(), edgeI_data.labels_string.end(), object_results[k].name);
+        m_track_objects[k].label = label_index - edgeI_data.labels_string.begin();
+        m_track_objects[k].prob = object_results[k].prop;
+        // ATTENTION:box point1(left, top) point2(right, bottom)
+        m_track_objects[k].rect[0] = object_results[k].box.left;
+        m_track_objects[k].rect[1] = object_results[k].box.top;
+        m_track_objects[k].rect[2] = object_results[k].box.right;
+        m_track_objects[k].rect[3] = object_results[k].box.bottom;
+        object_results[k].track_id = 0; // 未关联到轨迹的检测框track_id为0，在run()中被丢弃
+    }
+    const std::vector<STrack> &obj_tracks = tracker_iter->second->update(m_track_objects);
+    for(const STrack &obj_track : obj_tracks)
+    {
+        // 轨迹在本帧没有关联到检测框（只是预测位置），不输出
+        if(obj_track.det_index < 0)
+            continue;
+        const float *tlwh = obj_track.tlwh;
+        if(tlwh[2] * tlwh[3] > 20)
+        {
+            detect_result_t &object_result = object_results[obj_track.det_index];
+            object_result.track_id = obj_track.track_id;
+            object_result.box.left = tlwh[0];
+            object_result.box.top = tlwh[1];
+            object_result.box.right = tlwh[2] + tlwh[0];
+            object_result.box.bottom = tlwh[3] + tlwh[1];
+        }
+    }
     return CStatus();
 }
 
-// 功能：设置跟踪信息
+// 功能：设置跟踪信息，为每路摄像头创建一个跟踪器
 CStatus RK3588Node::set_track_info(const std::map<int, std::string>& track_info, const int framerate_thres, const int trackbuffer_thres) {
-    // m_track_info = track_info;
-    // for (auto it = m_track_info.begin(); it != m_track_info.end(); ++it) {
-    //     m_tracker_per_channel.insert(std::make_pair(it->first, std::make_shared<BYTETracker>(framerate_thres, trackbuffer_thres)));
-    // }
+    m_track_info = track_info;
+    m_tracker_per_channel.clear();
+    for (auto it = m_track_info.begin(); it != m_track_info.end(); ++it) {
+        m_tracker_per_channel.insert(std::make_pair(it->first, std::make_shared<BYTETracker>(framerate_thres, trackbuffer_thres)));
+    }
 
     return CStatus();
-}
\ No newline at end of file
+}
@@ -1,6 +1,9 @@
 #include <stdio.h>
 #include <mutex>
+#include <chrono>
 #include "rknn/rkYolvo5s.hpp"
+#include "frame_trace.h"
+#include "async_log.h"
 
 
 const int RK3588 = 3;
@@ -159,7 +162,10 @@ int rkYolov5s::init(rknn_context *ctx_in, bool share_weight) // 是否共享权
     // 加载模型标签并绑定NPU核心
     load_label(label_path, labels);
     rknn_core_mask core_mask;
-    switch (get_core_num())
+    core_index = get_core_num();
+    infer_latency = &MetricsRegistry::global().histogram("seaway_infer_seconds", "NPU inference latency (rknn_run and rknn_outputs_get) per core.",
+                                                         metrics_latency_buckets(), metrics_label("core", std::to_string(core_index)));
+    switch (core_index)
     {
         case 0:
             core_mask = RKNN_NPU_CORE_0; //1
@@ -260,15 +266,31 @@ rknn_context *rkYolov5s::get_pctx()
 //功能：推理，输入：inputData 输出：dataEncode
 dataEncode rkYolov5s::infer(inputData input_frame_data)
 {
-    std::cout << "start rkYolov5s infer" << std::endl;
+    ALOG(DEBUG) << "start rkYolov5s infer";
+    // 同一个模型上下文不能同时推理，切片请求较多时同一模型的任务可能被不同线程取到
+    std::lock_guard<std::mutex> lock(mtx);
+    // 从提交到拿到模型上下文都算在线程池队列中的等待
+    int64_t trace_start_us = FrameTrace::wait(input_frame_data.trace_id, "wait infer queue", input_frame_data.trace_ts_us);
     // 初始化数据
     dataEncode data_encode;
     data_encode.frame_time_stamp = input_frame_data.frame_time_stamp;
+    data_encode.frame_seq = input_frame_data.frame_seq;
+    data_encode.trace_id = input_frame_data.trace_id;
 
     // 创建原图对象
     cv::Mat img;
     img = input_frame_data.frame_data; // 原图
     data_encode.image = input_frame_data.frame_data; // 原图赋值给输出结构体
+
+    // 设置了推理区域时只对该区域推理，检测框在后处理时加上区域的偏移映射回原图
+    int offset_x = 0, offset_y = 0;
+    cv::Rect roi_rect = input_frame_data.roi_rect & cv::Rect(0, 0, img.cols, img.rows);
+    if(!roi_rect.empty() && roi_rect.area() < img.cols * img.rows)
+    {
+        img = img(roi_rect); // 不拷贝数据
+        offset_x = roi_rect.x;
+        offset_y = roi_rect.y;
+    }
     img_width = img.cols; // 宽度：列
     img_height = img.rows; // 高度 行
     BOX_RECT pads;
@@ -288,7 +310,7 @@ dataEncode rkYolov5s::infer(inputData input_frame_data)
 
     // 对目标图对象赋值, 将数据保存到输入对象rknn_input中
     cv::Scalar pad_color = cv::Scalar(0, 0, 0);
-    if(img_width != width || img_height != height)
+    if(img_width != width || img_height != height || !img.isContinuous()) // 裁剪后的区域不连续，不能直接作为输入
     {
         letterbox(img, resized_img, pads, min_scale, target_size, pad_color);
         inputs[0].buf = resized_img.data; // 图像的数据的地址赋值 返回一个指向矩阵数据的 ​常量指针
@@ -308,8 +330,11 @@ dataEncode rkYolov5s::infer(inputData input_frame_data)
     }
 
     // 模型推理
+    auto infer_start = std::chrono::steady_clock::now();
     ret = rknn_run(ctx, NULL);
     ret = rknn_outputs_get(ctx, io_num.n_output, outputs, NULL); // 获取输出到outputs中
+    if(infer_latency)
+        infer_latency->observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - infer_start).count());
 
     // 后处理
     std::vector<float> out_scales;
@@ -320,15 +345,43 @@ dataEncode rkYolov5s::infer(inputData input_frame_data)
         out_zps.push_back(output_attrs[i].scale); // 问题：这些值哪来的？什么时候加载到张量属性中的
     }
     post_process((int8_t *)outputs[0].buf, (int8_t *)outputs[1].buf, (int8_t *)outputs[2].buf, height, width, conf_threshold,
-     nms_threshold, pads, scale_w, scale_h, out_zps, out_scales, &data_encode.detect_result_group, labels); // letterbox时获取到了pads
+     nms_threshold, pads, scale_w, scale_h, out_zps, out_scales, &data_encode.detect_result_group, labels, offset_x, offset_y); // letterbox时获取到了pads
 
     ret = rknn_outputs_release(ctx, io_num.n_output, outputs); // 释放模型输出结果占用的资源
     data_encode.detect_result_group.id = input_frame_data.frame_index;
+    if(data_encode.trace_id)
+    {
+        data_encode.trace_ts_us = FrameTrace::now_us();
+        FrameTrace::record(data_encode.trace_id, "infer", trace_start_us, data_encode.trace_ts_us, false);
+    }
 
     return data_encode;
 
 }
 
+// 功能：合并同一帧各个切片的推理结果
+dataEncode merge_slice_results(std::vector<dataEncode> &parts, float nms_threshold)
+{
+    if(parts.empty())
+        return dataEncode();
+
+    std::vector<const detect_result_group_t *> groups;
+    for(const dataEncode &part : parts)
+        groups.push_back(&part.detect_result_group);
+
+    dataEncode data_encode;
+    data_encode.image = parts.front().image;
+    data_encode.frame_time_stamp = parts.front().frame_time_stamp;
+    merge_detect_results(groups, nms_threshold, &data_encode.detect_result_group);
+    data_encode.detect_result_group.id = parts.front().detect_result_group.id;
+    data_encode.frame_seq = parts.front().frame_seq;
+    data_encode.trace_id = parts.front().trace_id;
+    for(const dataEncode &part : parts)
+        data_encode.trace_ts_us = std::max(data_encode.trace_ts_us, part.trace_ts_us); // 最后一个切片完成的时间
+
+    return data_encode;
+}
+
 // 功能：析构函数，销毁所有的堆分配空间
 rkYolov5s::~rkYolov5s()
 {
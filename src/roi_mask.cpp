@@ -0,0 +1,165 @@
+#include "roi_mask.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "opencv2/imgproc.hpp"
+
+bool RoiMask::compile(const std::string &roi, const cv::Size &img_size)
+{
+    if(m_compiled && roi == m_roi && img_size == m_img_size)
+        return m_valid;
+
+    m_roi = roi;
+    m_img_size = img_size;
+    m_compiled = true;
+    m_valid = false;
+    m_zones.clear();
+    m_mask.release();
+
+    WKTParser wkt_handle(img_size);
+    if(!wkt_handle.parseZones(roi, &m_zones) || m_zones.empty())
+    {
+        std::cout << "RoiMask: invalid roi " << roi << std::endl;
+        return false;
+    }
+    m_simple = (m_zones.size() == 1 && m_zones[0].holes.empty());
+
+    int min_x = m_zones[0].outer.bbox.x, min_y = m_zones[0].outer.bbox.y;
+    int max_x = min_x + m_zones[0].outer.bbox.width, max_y = min_y + m_zones[0].outer.bbox.height;
+    for(const GeoZone &zone : m_zones)
+    {
+        min_x = std::min(min_x, zone.outer.bbox.x);
+        min_y = std::min(min_y, zone.outer.bbox.y);
+        max_x = std::max(max_x, zone.outer.bbox.x + zone.outer.bbox.width);
+        max_y = std::max(max_y, zone.outer.bbox.y + zone.outer.bbox.height);
+    }
+    // 外接矩形包含右边界和下边界上的点
+    m_bbox = cv::Rect(min_x, min_y, max_x - min_x + 1, max_y - min_y + 1);
+    int max_side = std::max(m_bbox.width, m_bbox.height);
+    m_scale = max_side > ROI_MASK_MAX_SIDE ? static_cast<float>(ROI_MASK_MAX_SIDE) / max_side : 1.f;
+    int mask_w = std::max(1, static_cast<int>(std::ceil(m_bbox.width * m_scale)));
+    int mask_h = std::max(1, static_cast<int>(std::ceil(m_bbox.height * m_scale)));
+
+    auto to_mask = [this](const VectorPoint &points) {
+        VectorPoint mask_points;
+        mask_points.reserve(points.size());
+        for(const cv::Point &pt : points)
+            mask_points.emplace_back(cvRound((pt.x - m_bbox.x) * m_scale), cvRound((pt.y - m_bbox.y) * m_scale));
+        return mask_points;
+    };
+    std::vector<VectorPoint> outer_rings, hole_rings;
+    m_mask = cv::Mat::zeros(mask_h, mask_w, CV_8UC1);
+    cv::Mat zone_mask;
+    // 每个区域单独填充：外环填充后只清零本区域的内环，再并入掩码。
+    // 不能先填充所有外环再统一清零内环，否则位于其他区域内环中的区域（岛）会被清掉；
+    // 外环逐个填充也避免了重叠的区域按奇偶规则互相抵消
+    for(const GeoZone &zone : m_zones)
+    {
+        outer_rings.push_back(to_mask(zone.outer.points));
+        if(zone.holes.empty())
+        {
+            cv::fillPoly(m_mask, std::vector<VectorPoint>(1, outer_rings.back()), cv::Scalar(MASK_INSIDE));
+            continue;
+        }
+        std::vector<VectorPoint> zone_holes;
+        for(const GeoRing &hole : zone.holes)
+            zone_holes.push_back(to_mask(hole.points));
+        if(zone_mask.empty())
+            zone_mask = cv::Mat::zeros(mask_h, mask_w, CV_8UC1);
+        else
+            zone_mask.setTo(cv::Scalar(MASK_OUTSIDE));
+        cv::fillPoly(zone_mask, std::vector<VectorPoint>(1, outer_rings.back()), cv::Scalar(MASK_INSIDE));
+        cv::fillPoly(zone_mask, zone_holes, cv::Scalar(MASK_OUTSIDE));
+        cv::bitwise_or(m_mask, zone_mask, m_mask);
+        hole_rings.insert(hole_rings.end(), zone_holes.begin(), zone_holes.end());
+    }
+    // 边界经过的格子需要精确判断，线宽取3保证缩放取整后边界附近的格子都被标记
+    int thickness = m_scale < 1.f ? 3 : 1;
+    cv::polylines(m_mask, outer_rings, true, cv::Scalar(MASK_EDGE), thickness);
+    if(!hole_rings.empty())
+        cv::polylines(m_mask, hole_rings, true, cv::Scalar(MASK_EDGE), thickness);
+
+    m_valid = true;
+    return true;
+}
+
+uchar RoiMask::lookup(const cv::Point &point) const
+{
+    int dx = point.x - m_bbox.x;
+    int dy = point.y - m_bbox.y;
+    if(dx < 0 || dy < 0 || dx >= m_bbox.width || dy >= m_bbox.height)
+        return MASK_OUTSIDE;
+    int mx = std::min(static_cast<int>(dx * m_scale), m_mask.cols - 1);
+    int my = std::min(static_cast<int>(dy * m_scale), m_mask.rows - 1);
+    return m_mask.at<uchar>(my, mx);
+}
+
+bool RoiMask::contains(const cv::Point &point) const
+{
+    if(!m_valid)
+        return false;
+    uchar value = lookup(point);
+    if(value == MASK_INSIDE)
+        return true;
+    if(value == MASK_OUTSIDE)
+        return false;
+    for(const GeoZone &zone : m_zones)
+    {
+        if(WKTParser::inZone(zone, point))
+            return true;
+    }
+    return false;
+}
+
+int RoiMask::classify(const cv::Rect &rect) const
+{
+    const cv::Point corners[4] = {rect.tl(), cv::Point(rect.x + rect.width, rect.y),
+                                  rect.br(), cv::Point(rect.x, rect.y + rect.height)};
+    bool exact = false;
+    for(const cv::Point &corner : corners)
+    {
+        uchar value = lookup(corner);
+        if(value == MASK_OUTSIDE)
+            return 0;
+        exact = exact || (value == MASK_EDGE);
+    }
+    // 多个区域或有内环时，四个角点需要落在同一个区域内，且矩形不能覆盖内环
+    if(!exact && m_simple)
+        return 1;
+    return -1;
+}
+
+bool RoiMask::contains(const cv::Rect &rect) const
+{
+    if(!m_valid)
+        return false;
+    int result = classify(rect);
+    if(result >= 0)
+        return result == 1;
+    return WKTParser::inZones(m_zones, rect);
+}
+
+void RoiMask::contains(const std::vector<cv::Rect> &rects, std::vector<uchar> &results)
+{
+    results.assign(rects.size(), 0);
+    if(!m_valid)
+        return;
+    m_exact_rects.clear();
+    m_exact_index.clear();
+    for(size_t i = 0; i < rects.size(); i++)
+    {
+        int result = classify(rects[i]);
+        if(result >= 0)
+        {
+            results[i] = static_cast<uchar>(result);
+            continue;
+        }
+        m_exact_rects.push_back(rects[i]);
+        m_exact_index.push_back(i);
+    }
+    if(m_exact_rects.empty())
+        return;
+    WKTParser::inZones(m_zones, m_exact_rects, m_exact_results);
+    for(size_t i = 0; i < m_exact_index.size(); i++)
+        results[m_exact_index[i]] = m_exact_results[i];
+}
@@ -0,0 +1,103 @@
+#include "snapshot_encoder.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include "opencv2/imgproc.hpp"
+#include "opencv2/imgcodecs.hpp"
+
+bool SnapshotJob::ready() const
+{
+    return full.wait_for(std::chrono::seconds(0)) == std::future_status::ready &&
+           thumbnail.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+std::vector<uchar> JpegBufferPool::acquire()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_free.empty())
+        return std::vector<uchar>();
+    std::vector<uchar> buffer = std::move(m_free.back());
+    m_free.pop_back();
+    return buffer;
+}
+
+void JpegBufferPool::release(std::vector<uchar> &&buffer)
+{
+    if(buffer.capacity() == 0)
+        return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_free.size() < SNAPSHOT_JPEG_POOL_MAX)
+        m_free.push_back(std::move(buffer));
+}
+
+SnapshotEncoder::SnapshotEncoder(int thread_num)
+{
+    m_pool = std::make_unique<dpool::ThreadPool>(std::max(1, thread_num));
+}
+
+SnapshotJob SnapshotEncoder::submit(const std::shared_ptr<const cv::Mat> &image, const std::list<objectInfo> &objects)
+{
+    // 两个任务共享同一份目标列表
+    std::shared_ptr<const std::list<objectInfo>> shared_objects = std::make_shared<const std::list<objectInfo>>(objects);
+    SnapshotJob job;
+    job.full = m_pool->submit(&SnapshotEncoder::encode_full, &m_buffers, image, shared_objects);
+    job.thumbnail = m_pool->submit(&SnapshotEncoder::encode_thumbnail, &m_buffers, image, shared_objects);
+    return job;
+}
+
+void SnapshotEncoder::recycle(std::vector<uchar> &&jpeg)
+{
+    m_buffers.release(std::move(jpeg));
+}
+
+void SnapshotEncoder::draw_objects(cv::Mat &image, const std::list<objectInfo> &objects, float scale)
+{
+    draw_objects(image, objects, scale, scale);
+}
+
+void SnapshotEncoder::draw_objects(cv::Mat &image, const std::list<objectInfo> &objects, float scale_x, float scale_y)
+{
+    // 线宽和字号与原图上的4像素、3号字保持相同的视觉比例
+    float scale = std::min(scale_x, scale_y);
+    int thickness = std::max(1, static_cast<int>(4 * scale + 0.5f));
+    double font_scale = 3.0 * scale;
+    for(const objectInfo &object : objects)
+    {
+        cv::Rect rect(static_cast<int>(object.x * scale_x), static_cast<int>(object.y * scale_y),
+                      static_cast<int>(object.w * scale_x), static_cast<int>(object.h * scale_y));
+        // 参数列表： 【原图，矩阵框（左上角坐标，宽，高），颜色，边框粗细】
+        cv::rectangle(image, rect, cv::Scalar(0, 0, 255), thickness);
+        // 置信度保留两位有效数字，与AlarmJsonWriter::format_float(score, 2)一致
+        std::ostringstream oss;
+        oss << object.label << " " << std::setprecision(2) << object.score;
+        cv::putText(image, oss.str(), cv::Point(rect.x, rect.y - static_cast<int>(10 * scale)),
+                    cv::FONT_HERSHEY_SIMPLEX, font_scale, cv::Scalar(0, 0, 255), thickness);
+    }
+}
+
+std::vector<uchar> SnapshotEncoder::encode_full(JpegBufferPool *buffers, std::shared_ptr<const cv::Mat> image, std::shared_ptr<const std::list<objectInfo>> objects)
+{
+    // 原图是共享的只读对象，拷贝到线程自己的缓冲区后画框
+    thread_local cv::Mat canvas;
+    image->copyTo(canvas);
+    draw_objects(canvas, *objects, 1.f);
+    return encode_jpeg(buffers, canvas);
+}
+
+std::vector<uchar> SnapshotEncoder::encode_thumbnail(JpegBufferPool *buffers, std::shared_ptr<const cv::Mat> image, std::shared_ptr<const std::list<objectInfo>> objects)
+{
+    thread_local cv::Mat canvas;
+    cv::resize(*image, canvas, cv::Size(image->cols / SNAPSHOT_THUMBNAIL_SCALE, image->rows / SNAPSHOT_THUMBNAIL_SCALE), 0, 0, cv::INTER_NEAREST);
+    draw_objects(canvas, *objects, 1.f / SNAPSHOT_THUMBNAIL_SCALE);
+    return encode_jpeg(buffers, canvas);
+}
+
+std::vector<uchar> SnapshotEncoder::encode_jpeg(JpegBufferPool *buffers, const cv::Mat &image)
+{
+    static const std::vector<int> compression_params = {cv::IMWRITE_JPEG_QUALITY, SNAPSHOT_JPEG_QUALITY};
+    // imencode先清空再写入，复用缓冲区已有的容量
+    std::vector<uchar> jpeg = buffers->acquire();
+    cv::imencode(".jpg", image, jpeg, compression_params);
+    return jpeg;
+}
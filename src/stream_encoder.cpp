@@ -0,0 +1,74 @@
+#include "stream_encoder.h"
+
+#include <iostream>
+#include <vector>
+#include <cstdio>
+
+#ifdef STREAM_ENCODER_RK_ENABLE
+bool RKStreamEncoder::open(const StreamConfig &config)
+{
+    close();
+    ImageSize size;
+    size.width = config.width;
+    size.height = config.height;
+    std::shared_ptr<RKEncoder> encoder = std::make_shared<RKEncoder>();
+    // 这个端口不是解码用的端口，而是编码用的
+    if(!encoder->Open(ENCODE_TYPE_H264, config.fps, size, config.port, config.name.c_str()))
+    {
+        std::cout << "cannot open Encoder " << config.name << std::endl;
+        return false;
+    }
+    m_encoder = encoder;
+    return true;
+}
+
+bool RKStreamEncoder::write(const cv::Mat &frame)
+{
+    if(!m_encoder)
+        return false;
+    m_encoder->WriteFrame(frame);
+    return true;
+}
+
+void RKStreamEncoder::close()
+{
+    // 编码会话随编码器对象释放
+    m_encoder.reset();
+}
+#endif
+
+bool SoftwareStreamEncoder::open(const StreamConfig &config)
+{
+    close();
+    std::vector<char> pipeline(512 + config.name.size());
+    snprintf(pipeline.data(), pipeline.size(), SOFTWARE_STREAM_PIPELINE, config.fps * 2, config.port, config.name.c_str());
+    if(!m_writer.open(pipeline.data(), cv::CAP_GSTREAMER, 0, config.fps, cv::Size(config.width, config.height), true))
+    {
+        std::cout << "cannot open software encoder: " << pipeline.data() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SoftwareStreamEncoder::write(const cv::Mat &frame)
+{
+    if(!m_writer.isOpened())
+        return false;
+    m_writer.write(frame);
+    return true;
+}
+
+void SoftwareStreamEncoder::close()
+{
+    if(m_writer.isOpened())
+        m_writer.release();
+}
+
+std::unique_ptr<StreamEncoder> create_stream_encoder()
+{
+#ifdef STREAM_ENCODER_RK_ENABLE
+    return std::unique_ptr<StreamEncoder>(new RKStreamEncoder());
+#else
+    return std::unique_ptr<StreamEncoder>(new SoftwareStreamEncoder());
+#endif
+}
@@ -0,0 +1,183 @@
+#include "stream_hub.h"
+#include "snapshot_encoder.h"
+
+#include <iostream>
+#include <chrono>
+#include "opencv2/imgproc.hpp"
+
+StreamHub::StreamHub(const std::vector<StreamConfig> &configs, EncoderFactory factory) : m_factory(factory)
+{
+    for(const StreamConfig &config : configs)
+    {
+        std::unique_ptr<Substream> substream(new Substream());
+        substream->config = config;
+        if(substream->config.fps <= 0)
+            substream->config.fps = 25;
+        m_substreams.push_back(std::move(substream));
+    }
+    for(auto &substream : m_substreams)
+        substream->worker = std::thread(&StreamHub::substream_thread, this, std::ref(*substream));
+}
+
+StreamHub::~StreamHub()
+{
+    m_quit = true;
+    for(auto &substream : m_substreams)
+    {
+        {
+            std::lock_guard<std::mutex> lock(substream->mutex);
+        }
+        substream->cond.notify_all();
+    }
+    for(auto &substream : m_substreams)
+    {
+        if(substream->worker.joinable())
+            substream->worker.join();
+    }
+}
+
+void StreamHub::addFrame(int camera_index, const cv::Mat &frame, const std::list<objectInfo> &objects)
+{
+    if(camera_index < 0 || camera_index >= static_cast<int>(m_substreams.size()) || frame.empty())
+        return;
+    Substream &substream = *m_substreams[camera_index];
+    std::lock_guard<std::mutex> lock(substream.mutex);
+    if(substream.clients == 0)
+        return;
+    substream.frame = frame; // 只增加引用计数，帧数据不拷贝
+    substream.objects = objects;
+    substream.generation++;
+}
+
+void StreamHub::acquire(int camera_index)
+{
+    if(camera_index < 0 || camera_index >= static_cast<int>(m_substreams.size()))
+        return;
+    Substream &substream = *m_substreams[camera_index];
+    {
+        std::lock_guard<std::mutex> lock(substream.mutex);
+        substream.clients++;
+    }
+    substream.cond.notify_all();
+}
+
+void StreamHub::release(int camera_index)
+{
+    if(camera_index < 0 || camera_index >= static_cast<int>(m_substreams.size()))
+        return;
+    Substream &substream = *m_substreams[camera_index];
+    std::lock_guard<std::mutex> lock(substream.mutex);
+    if(substream.clients > 0)
+        substream.clients--;
+    if(substream.clients == 0)
+    {
+        // 不再引用最后一帧，帧数据可以尽早释放
+        substream.frame.release();
+        substream.objects.clear();
+    }
+}
+
+int StreamHub::find(const std::string &name) const
+{
+    for(size_t index = 0; index < m_substreams.size(); index++)
+    {
+        if(m_substreams[index]->config.name == name)
+            return static_cast<int>(index);
+    }
+    return -1;
+}
+
+StreamHubStats StreamHub::stats() const
+{
+    StreamHubStats stats;
+    stats.opened = m_opened;
+    stats.open_failed = m_open_failed;
+    stats.frames_encoded = m_frames_encoded;
+    stats.active = m_active;
+    return stats;
+}
+
+void StreamHub::substream_thread(Substream &substream)
+{
+    typedef std::chrono::steady_clock Clock;
+    const StreamConfig &config = substream.config;
+    auto frame_duration = std::chrono::microseconds(1000000 / config.fps);
+    std::unique_ptr<StreamEncoder> encoder;
+    Clock::time_point last_client = Clock::now();
+    Clock::time_point next_open = Clock::now();
+    Clock::time_point next_frame = Clock::now();
+    uint64_t encoded_generation = 0;
+    cv::Mat scaled; // 缩放后的帧，分辨率不变时复用内存
+
+    while(!m_quit)
+    {
+        cv::Mat frame;
+        std::list<objectInfo> objects;
+        {
+            std::unique_lock<std::mutex> lock(substream.mutex);
+            if(substream.clients == 0)
+            {
+                if(encoder && Clock::now() - last_client >= std::chrono::milliseconds(STREAM_IDLE_CLOSE_MS))
+                {
+                    encoder->close();
+                    encoder.reset();
+                    m_active--;
+                    std::cout << "stream " << config.name << " closed, no client" << std::endl;
+                }
+                substream.cond.wait_for(lock, std::chrono::milliseconds(encoder ? STREAM_IDLE_CLOSE_MS : 1000),
+                                        [&]{ return m_quit || substream.clients > 0; });
+                continue;
+            }
+            last_client = Clock::now();
+        }
+
+        // 按子码流的帧率输出，阻塞过久时重新对齐，不连续补帧
+        auto now = Clock::now();
+        if(next_frame + frame_duration < now)
+            next_frame = now;
+        std::this_thread::sleep_until(next_frame);
+        next_frame += frame_duration;
+
+        {
+            std::lock_guard<std::mutex> lock(substream.mutex);
+            if(substream.generation == encoded_generation || substream.frame.empty())
+                continue;
+            frame = substream.frame;
+            objects = substream.objects;
+            encoded_generation = substream.generation;
+        }
+
+        if(!encoder)
+        {
+            if(Clock::now() < next_open)
+                continue;
+            encoder = m_factory();
+            if(!encoder || !encoder->open(config))
+            {
+                encoder.reset();
+                m_open_failed++;
+                next_open = Clock::now() + std::chrono::milliseconds(STREAM_REOPEN_INTERVAL_MS);
+                continue;
+            }
+            m_opened++;
+            m_active++;
+            std::cout << "stream " << config.name << " opened " << config.width << "x" << config.height << "@" << config.fps << std::endl;
+        }
+
+        cv::resize(frame, scaled, cv::Size(config.width, config.height));
+        if(!objects.empty())
+        {
+            SnapshotEncoder::draw_objects(scaled, objects, static_cast<float>(config.width) / frame.cols,
+                                          static_cast<float>(config.height) / frame.rows);
+        }
+        frame.release(); // 原图不再需要，尽早释放引用
+        if(encoder->write(scaled))
+            m_frames_encoded++;
+    }
+
+    if(encoder)
+    {
+        encoder->close();
+        m_active--;
+    }
+}
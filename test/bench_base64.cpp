@@ -0,0 +1,113 @@
+// 性能测试：base64编码与改造前实现（legacy，按原代码复制，逐字符追加到std::string）的对比
+// 数据大小对应报警缩略图和1080p、4K原图的JPEG；编码路径见test_base64.cpp，x86上另外编译SSSE3版本
+#include "base64.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <functional>
+
+namespace legacy
+{
+    const std::string base64_chars =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz"
+        "0123456789+/";
+
+    std::string base64_encode(unsigned const char *byteToEncode, unsigned int byteLength)
+    {
+        std::string ret;
+        int i = 0;
+        unsigned char char_array_3[3];
+        unsigned char char_array_4[4];
+        while(byteLength--)
+        {
+            char_array_3[i++] = *(byteToEncode++);
+            if(i == 3)
+            {
+                char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+                char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+                char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+                char_array_4[3] = (char_array_3[2] & 0x3f);
+                for(int j = 0; j < 4; j++)
+                    ret += base64_chars[char_array_4[j]];
+                i = 0;
+            }
+        }
+        if(i)
+        {
+            for(int j = 1; j < 3; j++)
+                char_array_3[j] = '\0';
+            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+            char_array_4[3] = (char_array_3[2] & 0x3f);
+            for(int j = 0; j < 4; j++)
+                ret += (j < (i + 1)) ? base64_chars[char_array_4[j]] : '=';
+        }
+        return ret;
+    }
+}
+
+static double run_mb_per_s(size_t bytes, const std::function<void()> &body)
+{
+    body(); // 预热
+    int rounds = 0;
+    auto start = std::chrono::steady_clock::now();
+    double seconds = 0;
+    do
+    {
+        body();
+        rounds++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while(seconds < 0.5);
+    return static_cast<double>(bytes) * rounds / seconds / (1024 * 1024);
+}
+
+int main()
+{
+#if defined(__aarch64__)
+    const char *path = "neon";
+#elif defined(__SSSE3__)
+    const char *path = "ssse3";
+#else
+    const char *path = "scalar";
+#endif
+    const struct
+    {
+        const char *name;
+        size_t bytes;
+    } sizes[] = {
+        {"thumbnail", 24 * 1024},
+        {"1080p", 200 * 1024},
+        {"4K", 700 * 1024},
+    };
+
+    std::mt19937 rng(35);
+    std::uniform_int_distribution<int> byte(0, 255);
+    printf("encoder path: %s\n", path);
+    printf("%-10s %10s %12s %12s %12s %8s\n", "size", "bytes", "old MB/s", "new MB/s", "append MB/s", "speedup");
+    for(const auto &size : sizes)
+    {
+        std::vector<unsigned char> data(size.bytes);
+        for(unsigned char &b : data)
+            b = static_cast<unsigned char>(byte(rng));
+
+        size_t sink = 0;
+        double old_speed = run_mb_per_s(data.size(), [&]() { sink += legacy::base64_encode(data.data(), data.size()).size(); });
+        double new_speed = run_mb_per_s(data.size(), [&]() { sink += base64_encode(data.data(), data.size()).size(); });
+        // 发布报警时直接追加到复用的消息缓冲区
+        std::string message;
+        double append_speed = run_mb_per_s(data.size(), [&]()
+        {
+            message.clear();
+            base64_encode_append(data.data(), data.size(), message);
+            sink += message.size();
+        });
+        printf("%-10s %10zu %12.0f %12.0f %12.0f %7.1fx\n", size.name, size.bytes, old_speed, new_speed, append_speed, append_speed / old_speed);
+        if(sink == 0)
+            abort();
+    }
+    return 0;
+}
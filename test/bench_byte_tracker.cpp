@@ -0,0 +1,98 @@
+// 性能测试：16路摄像头，每帧1~200个目标时BYTETracker::update的耗时
+// 目标匀速运动并带有抖动，每帧随机漏检一部分，部分检测框为低分框，覆盖三步关联和轨迹丢失/恢复
+#include "byte_tracker.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#define BENCH_CHANNELS 16
+#define BENCH_WARMUP_FRAMES 30
+#define BENCH_FRAMES 300
+
+struct SimObject
+{
+    float x, y, w, h;
+    float vx, vy;
+    int label;
+};
+
+// 功能：生成一帧检测结果，漏检率5%，低分框比例20%
+static void make_frame(std::vector<SimObject> &scene, std::mt19937 &rng, std::vector<Object> &objects)
+{
+    std::uniform_real_distribution<float> jitter(-1.5f, 1.5f);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    objects.clear();
+    for(SimObject &sim : scene)
+    {
+        sim.x += sim.vx;
+        sim.y += sim.vy;
+        if(sim.x < 0 || sim.x + sim.w > 3840)
+            sim.vx = -sim.vx;
+        if(sim.y < 0 || sim.y + sim.h > 2160)
+            sim.vy = -sim.vy;
+        if(unit(rng) < 0.05f)
+            continue;
+        Object object;
+        object.rect[0] = sim.x + jitter(rng);
+        object.rect[1] = sim.y + jitter(rng);
+        object.rect[2] = sim.x + sim.w + jitter(rng);
+        object.rect[3] = sim.y + sim.h + jitter(rng);
+        object.label = sim.label;
+        object.prob = unit(rng) < 0.2f ? 0.3f : 0.85f;
+        objects.push_back(object);
+    }
+}
+
+static std::vector<SimObject> make_scene(int count, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> px(0.f, 3600.f), py(0.f, 1900.f), size(30.f, 200.f), speed(-6.f, 6.f);
+    std::vector<SimObject> scene(count);
+    for(int i = 0; i < count; i++)
+        scene[i] = SimObject{px(rng), py(rng), size(rng) * 0.5f, size(rng), speed(rng), speed(rng), i % 3};
+    return scene;
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? std::max(1, atoi(argv[1])) : BENCH_FRAMES;
+    const int object_counts[] = {1, 10, 50, 100, 200};
+    printf("%8s %14s %14s %14s %18s\n", "objects", "avg us/frame", "p99 us/frame", "max us/frame", "avg us/16 cameras");
+    for(int count : object_counts)
+    {
+        std::mt19937 rng(12345);
+        std::vector<BYTETracker> trackers(BENCH_CHANNELS, BYTETracker(25, 30));
+        std::vector<std::vector<SimObject>> scenes;
+        for(int channel = 0; channel < BENCH_CHANNELS; channel++)
+            scenes.push_back(make_scene(count, rng));
+
+        std::vector<double> samples;
+        samples.reserve(static_cast<size_t>(frames) * BENCH_CHANNELS);
+        std::vector<Object> objects;
+        double total_us = 0;
+        for(int frame = 0; frame < BENCH_WARMUP_FRAMES + frames; frame++)
+        {
+            for(int channel = 0; channel < BENCH_CHANNELS; channel++)
+            {
+                make_frame(scenes[channel], rng, objects);
+                auto start = std::chrono::steady_clock::now();
+                const std::vector<STrack> &tracks = trackers[channel].update(objects);
+                double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+                if(tracks.size() > objects.size() + BYTE_TRACK_MAX_COUNT)
+                    abort(); // 使用返回值，避免被优化掉
+                if(frame >= BENCH_WARMUP_FRAMES)
+                {
+                    samples.push_back(us);
+                    total_us += us;
+                }
+            }
+        }
+        std::sort(samples.begin(), samples.end());
+        printf("%8d %14.1f %14.1f %14.1f %18.1f\n", count, total_us / samples.size(),
+               samples[samples.size() * 99 / 100], samples.back(), total_us / frames);
+    }
+    return 0;
+}
@@ -0,0 +1,168 @@
+// 性能测试：FrameConcate每输出一帧消耗的CPU时间，1、4、9、16路1080p输入拼接为1080p输出，按25fps输出
+// 与改造前实现（legacy，按原代码复制：每帧分配清零的画布、addFrame克隆输入、等待所有输入都有新帧）对比
+// 每个输出周期所有输入都有新帧，或只有三分之一的输入有新帧（输入帧率低于输出帧率）；
+// CPU时间是进程的CPU时间（包括parallel_for_的工作线程和addFrame），sleep不计入
+#include "frame_concate.h"
+
+#include <cstdio>
+#include <ctime>
+#include <random>
+
+#define BENCH_FRAMES 50
+#define BENCH_FPS 25
+#define BENCH_WIDTH 1920
+#define BENCH_HEIGHT 1080
+
+namespace legacy
+{
+    class FrameConcate
+    {
+        public:
+            FrameConcate(int numInputs, int outputFPS, int width, int height) : inputNums(numInputs), outputFps(outputFPS), frameWidth(width), frameHeight(height)
+            {
+                buffers.resize(numInputs);
+                if(numInputs == 1)
+                    show_size_plan = SIZE_1X1;
+                else if(numInputs <= 4)
+                    show_size_plan = SIZE_2X2;
+                else if(numInputs <= 9)
+                    show_size_plan = SIZE_3X3;
+                else
+                    show_size_plan = SIZE_4X4;
+            }
+
+            void addFrame(int inputIndex, const cv::Mat &frame)
+            {
+                std::unique_lock<std::mutex> lock(*buffers[inputIndex].mutex);
+                buffers[inputIndex].frame = frame.clone();
+                buffers[inputIndex].hasNewFrame = true;
+            }
+
+            cv::Mat getConcateFrame()
+            {
+                auto startTime = std::chrono::steady_clock::now();
+                auto frameDuration = std::chrono::milliseconds(1000 / outputFps);
+                cv::Mat concateFrame = cv::Mat::zeros(frameHeight, frameWidth, CV_8UC3);
+                bool allFrameReady = false;
+                std::vector<bool> framesProcessed(inputNums, false);
+                while(!allFrameReady)
+                {
+                    allFrameReady = true;
+                    for(int index = 0; index < inputNums; index++)
+                    {
+                        std::unique_lock<std::mutex> lock(*buffers[index].mutex);
+                        if(buffers[index].hasNewFrame && !buffers[index].frame.empty() && !framesProcessed[index])
+                        {
+                            cv::resize(buffers[index].frame, buffers[index].resizeFrame, cv::Size(frameWidth / show_size_plan, frameHeight / show_size_plan));
+                            buffers[index].hasNewFrame = false;
+                            framesProcessed[index] = true;
+                        }
+                        if(!framesProcessed[index])
+                            allFrameReady = false;
+                        cv::Rect rect(index % show_size_plan * frameWidth / show_size_plan, index / show_size_plan * frameHeight / show_size_plan,
+                                      frameWidth / show_size_plan, frameHeight / show_size_plan);
+                        if(!buffers[index].resizeFrame.empty())
+                        {
+                            buffers[index].resizeFrame.copyTo(concateFrame(rect));
+                        }
+                        else
+                        {
+                            cv::Mat defaultFrame = cv::Mat::zeros(frameHeight / show_size_plan, frameWidth / show_size_plan, CV_8UC3);
+                            defaultFrame.copyTo(concateFrame(rect));
+                        }
+                    }
+                    if(std::chrono::steady_clock::now() - startTime > frameDuration)
+                        break;
+                }
+                nextFrameTime += frameDuration;
+                std::this_thread::sleep_until(nextFrameTime);
+                return concateFrame;
+            }
+
+        private:
+            struct FrameBuffer
+            {
+                cv::Mat frame;
+                cv::Mat resizeFrame;
+                bool hasNewFrame = false;
+                std::unique_ptr<std::mutex> mutex;
+                FrameBuffer() : mutex(std::make_unique<std::mutex>()) {}
+            };
+            int inputNums;
+            int outputFps;
+            int frameWidth, frameHeight;
+            std::vector<FrameBuffer> buffers;
+            std::chrono::steady_clock::time_point nextFrameTime = std::chrono::steady_clock::now();
+            int show_size_plan = 0;
+    };
+}
+
+static double cpu_ms()
+{
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static cv::Mat make_frame(int seed)
+{
+    cv::Mat image(BENCH_HEIGHT, BENCH_WIDTH, CV_8UC3);
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> noise(0, 31);
+    for(int y = 0; y < BENCH_HEIGHT; y++)
+    {
+        uchar *row = image.ptr<uchar>(y);
+        for(int x = 0; x < BENCH_WIDTH * 3; x++)
+            row[x] = static_cast<uchar>((x / 3 + y + seed * 17) % 200 + noise(rng));
+    }
+    return image;
+}
+
+// 功能：输出BENCH_FRAMES帧，每帧之前按divisor送入新帧（divisor为1时所有输入都有新帧），返回每输出一帧的CPU毫秒数
+template <typename Concate>
+static double run(Concate &concate, const std::vector<cv::Mat> &frames, int inputs, int divisor)
+{
+    // 预热：所有格子都有帧，之后只测稳定状态
+    for(int index = 0; index < inputs; index++)
+        concate.addFrame(index, frames[index]);
+    concate.getConcateFrame();
+
+    double start = cpu_ms();
+    size_t sink = 0;
+    for(int frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        for(int index = 0; index < inputs; index++)
+        {
+            if((index + frame) % divisor == 0)
+                concate.addFrame(index, frames[index]);
+        }
+        sink += concate.getConcateFrame().total();
+    }
+    double elapsed = cpu_ms() - start;
+    if(sink == 0)
+        printf("empty output\n");
+    return elapsed / BENCH_FRAMES;
+}
+
+int main()
+{
+    const int input_counts[] = {1, 4, 9, 16};
+    std::vector<cv::Mat> frames;
+    for(int index = 0; index < 16; index++)
+        frames.push_back(make_frame(index));
+
+    printf("output %dx%d at %d fps, 1080p inputs, CPU ms per output frame\n", BENCH_WIDTH, BENCH_HEIGHT, BENCH_FPS);
+    printf("%-8s %-10s %10s %10s %8s\n", "inputs", "new frames", "old ms", "new ms", "speedup");
+    for(int inputs : input_counts)
+    {
+        for(int divisor : {1, 3})
+        {
+            legacy::FrameConcate old_concate(inputs, BENCH_FPS, BENCH_WIDTH, BENCH_HEIGHT);
+            double old_ms = run(old_concate, frames, inputs, divisor);
+            FrameConcate new_concate(inputs, BENCH_FPS, BENCH_WIDTH, BENCH_HEIGHT);
+            double new_ms = run(new_concate, frames, inputs, divisor);
+            printf("%-8d %-10s %10.2f %10.2f %7.1fx\n", inputs, divisor == 1 ? "all" : "1/3", old_ms, new_ms, old_ms / new_ms);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+// 性能测试：SnapshotEncoder在1080p和4K下每秒能完成的报警数
+// 与AppMqttNode相同，最多SNAPSHOT_PENDING_MAX个报警在编码，按提交顺序取结果；
+// 分别测试发布后归还JPEG缓冲区（recycle）和不归还（每次编码重新分配）
+#include "snapshot_encoder.h"
+
+#include <cstdio>
+#include <chrono>
+#include <deque>
+#include <random>
+
+#define BENCH_ALARMS 400
+#define BENCH_OBJECTS 8
+
+// 功能：生成带噪声的图像，JPEG大小接近真实画面
+static std::shared_ptr<const cv::Mat> make_image(int width, int height)
+{
+    cv::Mat image(height, width, CV_8UC3);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> noise(0, 31);
+    for(int y = 0; y < height; y++)
+    {
+        uchar *row = image.ptr<uchar>(y);
+        for(int x = 0; x < width * 3; x++)
+            row[x] = static_cast<uchar>((x / 3 + y) % 200 + noise(rng));
+    }
+    return std::make_shared<const cv::Mat>(image);
+}
+
+static std::list<objectInfo> make_objects(int width, int height)
+{
+    std::list<objectInfo> objects;
+    for(int i = 0; i < BENCH_OBJECTS; i++)
+    {
+        objectInfo object;
+        object.x = width * i / BENCH_OBJECTS;
+        object.y = height / 4;
+        object.w = width / (BENCH_OBJECTS * 2);
+        object.h = height / 3;
+        object.label = "person";
+        object.score = 0.87f;
+        objects.push_back(object);
+    }
+    return objects;
+}
+
+// 功能：编码BENCH_ALARMS个报警，返回每秒报警数
+static double run(SnapshotEncoder &encoder, const std::shared_ptr<const cv::Mat> &image, const std::list<objectInfo> &objects,
+                  bool recycle, size_t &jpeg_bytes)
+{
+    std::deque<SnapshotJob> pending;
+    jpeg_bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < BENCH_ALARMS || !pending.empty(); )
+    {
+        if(i < BENCH_ALARMS && pending.size() < SNAPSHOT_PENDING_MAX)
+        {
+            pending.push_back(encoder.submit(image, objects));
+            i++;
+            continue;
+        }
+        std::vector<uchar> full = pending.front().full.get();
+        std::vector<uchar> thumbnail = pending.front().thumbnail.get();
+        pending.pop_front();
+        jpeg_bytes = full.size() + thumbnail.size();
+        if(recycle)
+        {
+            encoder.recycle(std::move(full));
+            encoder.recycle(std::move(thumbnail));
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return BENCH_ALARMS / seconds;
+}
+
+int main()
+{
+    const struct
+    {
+        const char *name;
+        int width;
+        int height;
+    } resolutions[] = {
+        {"1080p", 1920, 1080},
+        {"4K", 3840, 2160},
+    };
+
+    printf("%-6s %8s %16s %16s %12s\n", "res", "threads", "alarms/s pooled", "alarms/s alloc", "jpeg bytes");
+    for(const auto &resolution : resolutions)
+    {
+        std::shared_ptr<const cv::Mat> image = make_image(resolution.width, resolution.height);
+        std::list<objectInfo> objects = make_objects(resolution.width, resolution.height);
+        for(int threads : {1, SNAPSHOT_ENCODER_THREAD_COUNT})
+        {
+            SnapshotEncoder encoder(threads);
+            size_t jpeg_bytes = 0;
+            run(encoder, image, objects, true, jpeg_bytes); // 预热，线程和缓冲区分配完成
+            double pooled = run(encoder, image, objects, true, jpeg_bytes);
+            double allocated = run(encoder, image, objects, false, jpeg_bytes);
+            printf("%-6s %8d %16.1f %16.1f %12zu\n", resolution.name, threads, pooled, allocated, jpeg_bytes);
+        }
+    }
+    return 0;
+}
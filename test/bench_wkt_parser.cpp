@@ -0,0 +1,188 @@
+// 性能测试：WKTParser与改造前实现（legacy，按原代码复制）的对比
+// 1. 解析：legacy按子串解析，WKTParser在原字符串上解析
+// 2. 矩形框判断：legacy为四次cv::pointPolygonTest，WKTParser为外接矩形排除+整数边表，RoiMask为预编译掩码
+// 3. 改造前AppRoiNode每个目标的流程：构造WKTParser、解析roi、判断；改造后为预编译的RoiMask批量判断
+#include "WKTParser.h"
+#include "roi_mask.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <functional>
+
+#define BENCH_RECTS 10000
+#define BENCH_ROUNDS 20
+
+namespace legacy
+{
+    bool read_wkt_point(const std::string &wkt, point &pt)
+    {
+        std::vector<std::string> tokens;
+        size_t pos_begin = wkt.find_first_of("("), pos_end = 0;
+        if(pos_begin == std::string::npos)
+            return false;
+        pos_end = wkt.find_first_of(" )", pos_begin + 1);
+        while(pos_end != std::string::npos)
+        {
+            tokens.push_back(wkt.substr(pos_begin + 1, pos_end - pos_begin - 1));
+            pos_begin = pos_end;
+            pos_end = wkt.find_first_of(")", pos_begin + 1);
+        }
+        if(tokens.size() != 2)
+            return false;
+        try
+        {
+            pt.x = std::stod(tokens[0]);
+            pt.y = std::stod(tokens[1]);
+        }
+        catch(...)
+        {
+            return false;
+        }
+        return true;
+    }
+
+    bool parsePolygon(const std::string &src, const cv::Size &size, VectorPoint &vp)
+    {
+        std::string wkt = src;
+        std::vector<std::vector<double>> points;
+        size_t pos_begin = wkt.find_first_of("("), pos_end = 0;
+        if(pos_begin == std::string::npos)
+            return false;
+        pos_begin++;
+        pos_end = wkt.find_first_of(",)", pos_begin + 1);
+        while(pos_end != std::string::npos)
+        {
+            std::string token = wkt.substr(pos_begin + 1, pos_end - pos_begin - 1);
+            if(token.empty())
+                break;
+            token = "(" + token + ")";
+            point pt;
+            if(!read_wkt_point(token, pt))
+                return false;
+            points.push_back({pt.x, pt.y});
+            pos_begin = pos_end;
+            pos_end = wkt.find_first_of(",)", pos_begin + 1);
+        }
+        if(points.size() < 4 || points.front() != points.back())
+            return false;
+        vp.resize(points.size());
+        for(size_t i = 0; i < points.size(); i++)
+        {
+            vp[i].x = points[i][0] * size.width;
+            vp[i].y = points[i][1] * size.height;
+        }
+        return true;
+    }
+
+    bool inPolygon(const VectorPoint &polygon, const cv::Point &point)
+    {
+        cv::Point2f pf(point.x, point.y);
+        return cv::pointPolygonTest(polygon, pf, false) >= 0;
+    }
+
+    bool inPolygon(const VectorPoint &polygon, const cv::Rect &rect)
+    {
+        return inPolygon(polygon, rect.tl()) &&
+               inPolygon(polygon, cv::Point(rect.x + rect.width, rect.y)) &&
+               inPolygon(polygon, rect.br()) &&
+               inPolygon(polygon, cv::Point(rect.x, rect.y + rect.height));
+    }
+}
+
+static double run_ns(int rounds, int items, const std::function<void()> &body)
+{
+    body(); // 预热
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < rounds; i++)
+        body();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return ns / rounds / items;
+}
+
+int main()
+{
+    const cv::Size img_size(1920, 1080);
+    const struct
+    {
+        const char *name;
+        const char *wkt;
+    } rois[] = {
+        {"convex 4", "POLYGON((0.1 0.1,0.9 0.1,0.9 0.9,0.1 0.9,0.1 0.1))"},
+        {"concave 8", "POLYGON((0.1 0.1,0.5 0.3,0.9 0.1,0.7 0.5,0.9 0.9,0.5 0.7,0.1 0.9,0.3 0.5,0.1 0.1))"},
+        {"convex 32", nullptr},
+    };
+    // 32个顶点的近似圆
+    std::string circle = "POLYGON((";
+    for(int i = 0; i <= 32; i++)
+    {
+        double angle = 2 * CV_PI * (i % 32) / 32;
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%s%.4f %.4f", i ? "," : "", 0.5 + 0.4 * std::cos(angle), 0.5 + 0.4 * std::sin(angle));
+        circle += buffer;
+    }
+    circle += "))";
+
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> px(0, 1800), py(0, 1000), size(10, 200);
+    std::vector<cv::Rect> rects;
+    for(int i = 0; i < BENCH_RECTS; i++)
+        rects.emplace_back(px(rng), py(rng), size(rng), size(rng));
+
+    printf("%-10s %12s %12s %12s %12s %12s %12s %14s %14s %9s\n", "roi", "parse old", "parse new", "rect old", "rect new",
+           "zones batch", "mask batch", "per obj old", "per obj new", "mismatch");
+    for(const auto &roi : rois)
+    {
+        std::string wkt = roi.wkt ? roi.wkt : circle;
+        VectorPoint legacy_polygon, polygon;
+        legacy::parsePolygon(wkt, img_size, legacy_polygon);
+        WKTParser parser(img_size);
+        parser.parsePolygon(wkt, &polygon);
+        VectorZone zones;
+        parser.parseZones(wkt, &zones);
+        RoiMask mask;
+        mask.compile(wkt, img_size);
+
+        double parse_old = run_ns(BENCH_ROUNDS * 100, 1, [&]() { VectorPoint vp; legacy::parsePolygon(wkt, img_size, vp); });
+        double parse_new = run_ns(BENCH_ROUNDS * 100, 1, [&]() { WKTParser p(img_size); VectorZone z; p.parseZones(wkt, &z); });
+
+        int sink = 0;
+        double rect_old = run_ns(BENCH_ROUNDS, BENCH_RECTS, [&]() { for(const cv::Rect &r : rects) sink += legacy::inPolygon(legacy_polygon, r); });
+        double rect_new = run_ns(BENCH_ROUNDS, BENCH_RECTS, [&]() { for(const cv::Rect &r : rects) sink += WKTParser::inPolygon(polygon, r); });
+        std::vector<uchar> results;
+        double zones_batch = run_ns(BENCH_ROUNDS, BENCH_RECTS, [&]() { WKTParser::inZones(zones, rects, results); sink += results[0]; });
+        double mask_batch = run_ns(BENCH_ROUNDS, BENCH_RECTS, [&]() { mask.contains(rects, results); sink += results[0]; });
+
+        // 改造前每个报警目标都重新构造解析器并解析roi
+        const int per_object_count = 1000;
+        double per_object_old = run_ns(BENCH_ROUNDS, per_object_count, [&]()
+        {
+            for(int i = 0; i < per_object_count; i++)
+            {
+                VectorPoint vp;
+                legacy::parsePolygon(wkt, img_size, vp);
+                sink += legacy::inPolygon(vp, rects[i]);
+            }
+        });
+        double per_object_new = run_ns(BENCH_ROUNDS, per_object_count, [&]()
+        {
+            for(int i = 0; i < per_object_count; i++)
+            {
+                mask.compile(wkt, img_size); // 配置未变化，直接返回
+                sink += mask.contains(rects[i]);
+            }
+        });
+
+        // 没有内环时新旧实现的结果应完全一致
+        int mismatch = 0;
+        for(const cv::Rect &r : rects)
+            mismatch += legacy::inPolygon(legacy_polygon, r) != WKTParser::inZones(zones, r);
+
+        printf("%-10s %10.0fns %10.0fns %10.1fns %10.1fns %10.1fns %10.1fns %12.0fns %12.1fns %9d\n", roi.name, parse_old, parse_new,
+               rect_old, rect_new, zones_batch, mask_batch, per_object_old, per_object_new, mismatch);
+        if(sink == -1)
+            abort();
+    }
+    return 0;
+}
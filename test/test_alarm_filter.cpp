@@ -0,0 +1,133 @@
+// 测试：AlarmFilter的报警抑制状态机
+// 1. AlarmInterval <= 0 时不抑制
+// 2. 首次上报（smooth）的目标立即报警，报警间隔内抑制，同一track_id的不同标签互不影响
+// 3. 非smooth目标持续出现一个报警间隔后才报警；中断超过 ALARM_PERSIST_GAP_MS 后重新计时
+// 4. 长时间未出现的目标被清理，清理每秒最多一次
+// 5. 达到 ALARM_STATE_MAX_COUNT 时先清理过期目标，仍然满时删除最久未出现的目标
+#include "alarm_filter.h"
+#include "test_common.h"
+
+static void test_disabled()
+{
+    AlarmFilter filter;
+    filter.set_config(0, false);
+    for(int64_t now = 0; now < 100; now += 10)
+        TEST_CHECK(filter.check(1, "person", now));
+    TEST_CHECK_EQ(filter.size(), 0u);
+}
+
+static void test_smooth_interval()
+{
+    AlarmFilter filter;
+    filter.set_config(5, true);
+    TEST_CHECK(filter.check(1, "person", 1000));
+    TEST_CHECK(!filter.check(1, "person", 1040));
+    TEST_CHECK(!filter.check(1, "person", 5999));
+    TEST_CHECK(filter.check(1, "person", 6000));
+    TEST_CHECK(!filter.check(1, "person", 6040));
+    // 同一track_id的其他标签、其他track_id是独立的目标
+    TEST_CHECK(filter.check(1, "car", 6040));
+    TEST_CHECK(filter.check(2, "person", 6040));
+    TEST_CHECK_EQ(filter.size(), 3u);
+}
+
+static void test_persist_threshold()
+{
+    AlarmFilter filter;
+    filter.set_config(2, false);
+    // 每40毫秒出现一次，持续满2秒才报警
+    int64_t now = 0;
+    for(; now < 2000; now += 40)
+        TEST_CHECK(!filter.check(7, "person", now));
+    TEST_CHECK(filter.check(7, "person", 2000));
+    // 已报警的目标按报警间隔抑制
+    TEST_CHECK(!filter.check(7, "person", 2040));
+    TEST_CHECK(!filter.check(7, "person", 3999));
+    TEST_CHECK(filter.check(7, "person", 4000));
+}
+
+static void test_gap_reset()
+{
+    AlarmFilter filter;
+    filter.set_config(2, false);
+    TEST_CHECK(!filter.check(3, "person", 0));
+    TEST_CHECK(!filter.check(3, "person", 500));
+    // 中断不超过 ALARM_PERSIST_GAP_MS 时继续计时
+    TEST_CHECK(!filter.check(3, "person", 500 + ALARM_PERSIST_GAP_MS));
+    TEST_CHECK(filter.check(3, "person", 2000));
+
+    // 中断超过 ALARM_PERSIST_GAP_MS 后重新计时
+    AlarmFilter other;
+    other.set_config(2, false);
+    TEST_CHECK(!other.check(3, "person", 0));
+    TEST_CHECK(!other.check(3, "person", 500));
+    int64_t back = 500 + ALARM_PERSIST_GAP_MS + 1;
+    TEST_CHECK(!other.check(3, "person", back));
+    TEST_CHECK(!other.check(3, "person", 2500)); // 不中断时这里已经满2秒
+    TEST_CHECK(!other.check(3, "person", back + 1999));
+    TEST_CHECK(other.check(3, "person", back + 2000));
+
+    // 已报警的目标中断后不重新计时，按报警间隔再次报警
+    TEST_CHECK(!other.check(3, "person", back + 2000 + ALARM_PERSIST_GAP_MS + 100));
+    TEST_CHECK(other.check(3, "person", back + 4000));
+}
+
+static void test_expire()
+{
+    AlarmFilter filter;
+    filter.set_config(5, true);
+    TEST_CHECK(filter.check(1, "person", 0));
+    TEST_CHECK(filter.check(2, "person", 30000));
+    filter.expire(ALARM_STATE_EXPIRE_MS + 1000);
+    TEST_CHECK_EQ(filter.size(), 1u); // 只清理超过 ALARM_STATE_EXPIRE_MS 未出现的目标1
+
+    // 目标2还没有过期
+    filter.expire(ALARM_STATE_EXPIRE_MS + 29900);
+    TEST_CHECK_EQ(filter.size(), 1u);
+    // 距上次清理不到一秒，目标2虽然已过期也不清理
+    filter.expire(ALARM_STATE_EXPIRE_MS + 30500);
+    TEST_CHECK_EQ(filter.size(), 1u);
+    filter.expire(ALARM_STATE_EXPIRE_MS + 30900);
+    TEST_CHECK_EQ(filter.size(), 0u);
+
+    // 清理后再次出现按新目标处理
+    TEST_CHECK(filter.check(1, "person", ALARM_STATE_EXPIRE_MS + 30900));
+}
+
+static void test_eviction()
+{
+    AlarmFilter filter;
+    filter.set_config(5, true);
+    // 填满，track 0最久未出现
+    for(int track = 0; track < ALARM_STATE_MAX_COUNT; track++)
+        TEST_CHECK(filter.check(track, "person", track));
+    TEST_CHECK_EQ(filter.size(), static_cast<size_t>(ALARM_STATE_MAX_COUNT));
+
+    // 没有过期的目标，删除最久未出现的track 0
+    int64_t now = ALARM_STATE_MAX_COUNT;
+    TEST_CHECK(filter.check(ALARM_STATE_MAX_COUNT, "person", now));
+    TEST_CHECK_EQ(filter.size(), static_cast<size_t>(ALARM_STATE_MAX_COUNT));
+    TEST_CHECK(!filter.check(1, "person", now)); // 仍在，报警间隔内抑制
+    TEST_CHECK(filter.check(0, "person", now));  // 已被删除，按新目标报警（删除此时最久未出现的track 2）
+    TEST_CHECK(filter.check(2, "person", now));
+
+    // 满时先清理过期的目标：前一半之后不再出现，过期后只删除它们
+    AlarmFilter half;
+    half.set_config(5, true);
+    for(int track = 0; track < ALARM_STATE_MAX_COUNT; track++)
+        half.check(track, "person", track < ALARM_STATE_MAX_COUNT / 2 ? 0 : ALARM_STATE_EXPIRE_MS);
+    half.check(ALARM_STATE_MAX_COUNT, "person", ALARM_STATE_EXPIRE_MS + 1);
+    TEST_CHECK_EQ(half.size(), static_cast<size_t>(ALARM_STATE_MAX_COUNT / 2 + 1));
+    TEST_CHECK(!half.check(ALARM_STATE_MAX_COUNT / 2, "person", ALARM_STATE_EXPIRE_MS + 2));
+}
+
+int main()
+{
+    test_disabled();
+    test_smooth_interval();
+    test_persist_threshold();
+    test_gap_reset();
+    test_expire();
+    test_eviction();
+    return TEST_RESULT();
+}
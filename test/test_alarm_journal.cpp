@@ -0,0 +1,243 @@
+// 测试：AlarmJournal的轮转、恢复、删除，以及与MqttPublisher结果回调的配合
+// 1. 段由后台线程预先创建，写入时轮转不在写入线程中创建文件；目录中没有多余的空段
+// 2. 重启后未确认的报警全部重放，内容与写入的一致；已确认的不再重放
+// 3. 全部确认后旧的段由后台线程删除
+// 4. 合并发送的报警按各自的结果确认：发送失败和超过内存上限被丢弃的报警不会被确认，在该通道恢复后重放
+#include "alarm_journal.h"
+#include "mqtt_publisher.h"
+#include "test_common.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <unistd.h>
+
+typedef std::chrono::steady_clock Clock;
+
+#define TEST_SEGMENT_BYTES (64 * 1024)
+
+static std::string make_dir()
+{
+    char path[] = "/tmp/test_alarm_journal_XXXXXX";
+    return mkdtemp(path) ? std::string(path) : std::string();
+}
+
+static void remove_dir(const std::string &path)
+{
+    if(DIR *dir = opendir(path.c_str()))
+    {
+        while(struct dirent *entry = readdir(dir))
+        {
+            if(strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+                unlink((path + "/" + entry->d_name).c_str());
+        }
+        closedir(dir);
+    }
+    rmdir(path.c_str());
+}
+
+static size_t count_files(const std::string &path)
+{
+    size_t count = 0;
+    if(DIR *dir = opendir(path.c_str()))
+    {
+        while(struct dirent *entry = readdir(dir))
+            count += entry->d_name[0] != '.';
+        closedir(dir);
+    }
+    return count;
+}
+
+static std::string alarm_payload(uint64_t index)
+{
+    return "{\"alarm\":" + std::to_string(index) + ",\"pad\":\"" + std::string(900 + index % 50, 'x') + "\"}";
+}
+
+// 功能：等待条件成立，超时返回false
+template <typename Predicate>
+static bool wait_until(Predicate predicate, int timeout_ms = 3000)
+{
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+    while(!predicate())
+    {
+        if(Clock::now() >= deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+static void test_rotate_and_recover()
+{
+    std::string dir = make_dir();
+    const int count = 300;
+    std::vector<uint64_t> seqs;
+    {
+        AlarmJournal journal(dir, TEST_SEGMENT_BYTES, 64 * TEST_SEGMENT_BYTES);
+        TEST_CHECK(journal.valid());
+        for(int i = 0; i < count; i++)
+        {
+            // 每写半个段等待一次，给后台线程创建备用段的时间
+            if(i % 30 == 0)
+                TEST_CHECK(wait_until([&]() { return journal.stats().disk_bytes > journal.stats().segments * TEST_SEGMENT_BYTES; }));
+            uint64_t seq = journal.append(JOURNAL_SINK_KAFKA, i % 4, "camera" + std::to_string(i % 4), "ref" + std::to_string(i), alarm_payload(i));
+            TEST_CHECK(seq != 0);
+            seqs.push_back(seq);
+        }
+        // 确认偶数条，奇数条留到重启后重放
+        for(int i = 0; i < count; i += 2)
+            journal.complete(seqs[i], true);
+        JournalStats stats = journal.stats();
+        TEST_CHECK_EQ(stats.appended, static_cast<uint64_t>(count));
+        TEST_CHECK_EQ(stats.acked, static_cast<uint64_t>(count / 2));
+        TEST_CHECK(stats.rotations >= 4);
+        TEST_CHECK_EQ(stats.rotations_sync, 0u);
+        std::cout << "rotations " << stats.rotations << ", sync rotations " << stats.rotations_sync << std::endl;
+    }
+    // 析构时删除没有用到的备用段
+    TEST_CHECK(count_files(dir) > 0);
+    {
+        AlarmJournal journal(dir, TEST_SEGMENT_BYTES, 64 * TEST_SEGMENT_BYTES);
+        TEST_CHECK_EQ(journal.stats().unacked, static_cast<size_t>(count / 2));
+        std::vector<JournalRecord> records = journal.take_replay();
+        TEST_CHECK_EQ(records.size(), static_cast<size_t>(count / 2));
+        for(size_t i = 0; i < records.size(); i++)
+        {
+            int index = static_cast<int>(2 * i + 1);
+            const JournalRecord &record = records[i];
+            TEST_CHECK_EQ(record.seq, seqs[index]);
+            TEST_CHECK_EQ(record.sink, JOURNAL_SINK_KAFKA);
+            TEST_CHECK_EQ(record.camera_index, index % 4);
+            TEST_CHECK_EQ(record.key, "camera" + std::to_string(index % 4));
+            TEST_CHECK_EQ(record.image_ref, "ref" + std::to_string(index));
+            TEST_CHECK(record.payload == alarm_payload(index));
+        }
+        // 新的报警序号接在恢复的序号之后
+        uint64_t seq = journal.append(JOURNAL_SINK_MQTT, 0, "", "", "{}");
+        TEST_CHECK(seq > seqs.back());
+        journal.complete(seq, true);
+        for(const JournalRecord &record : records)
+            journal.complete(record.seq, true);
+        TEST_CHECK_EQ(journal.stats().unacked, 0u);
+
+        // 全部确认后，下一次轮转时旧的段由后台线程删除，只剩当前段和备用段
+        for(int i = 0; journal.stats().rotations == 0 && i < 1000; i++)
+            journal.complete(journal.append(JOURNAL_SINK_MQTT, 0, "", "", alarm_payload(i)), true);
+        TEST_CHECK(wait_until([&]() { return journal.stats().segments == 1 && count_files(dir) == 2; }));
+    }
+    {
+        AlarmJournal journal(dir, TEST_SEGMENT_BYTES, 64 * TEST_SEGMENT_BYTES);
+        TEST_CHECK_EQ(journal.stats().unacked, 0u);
+        TEST_CHECK(journal.take_replay().empty());
+    }
+    remove_dir(dir);
+}
+
+// 功能：可以让发送失败或阻塞的发送函数
+class FakeSender
+{
+    public:
+        bool send(const std::string &)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_blocked_sends += m_blocked ? 1 : 0;
+            m_cond.notify_all();
+            m_cond.wait(lock, [this]() { return !m_blocked; });
+            return !m_fail;
+        }
+
+        void set_fail(bool fail)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_fail = fail;
+        }
+
+        void set_blocked(bool blocked)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_blocked = blocked;
+            }
+            m_cond.notify_all();
+        }
+
+        bool wait_blocked_send()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            return m_cond.wait_for(lock, std::chrono::seconds(2), [this]() { return m_blocked_sends > 0; });
+        }
+
+    private:
+        bool m_fail = false;
+        bool m_blocked = false;
+        int m_blocked_sends = 0;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+};
+
+static void test_publisher_results()
+{
+    std::string dir = make_dir();
+    {
+        AlarmJournal journal(dir, TEST_SEGMENT_BYTES, 64 * TEST_SEGMENT_BYTES);
+        FakeSender sender;
+        auto publish = [&journal](MqttPublisher &publisher, int camera_index, const std::string &payload)
+        {
+            uint64_t seq = journal.append(JOURNAL_SINK_MQTT, camera_index, "", "", payload);
+            publisher.publish(camera_index, payload, [&journal, seq](bool delivered) { journal.complete(seq, delivered); });
+        };
+
+        // 1. 发送成功：第一条立即发送，后两条合并发送，三条都确认
+        {
+            MqttPublisher publisher([&sender](const std::string &payload) { return sender.send(payload); }, 1, MQTT_QUEUE_MAX_BYTES, 100);
+            for(int i = 0; i < 3; i++)
+                publish(publisher, 1, "{\"ok\":" + std::to_string(i) + "}");
+            TEST_CHECK(wait_until([&]() { return journal.stats().acked == 3; }));
+            TEST_CHECK(publisher.stats().coalesced >= 1);
+        }
+
+        // 2. 发送失败，不重试：合并消息中的每条报警都记为失败，不确认
+        sender.set_fail(true);
+        {
+            MqttPublisher publisher([&sender](const std::string &payload) { return sender.send(payload); }, 1, MQTT_QUEUE_MAX_BYTES, 100, 0);
+            for(int i = 0; i < 3; i++)
+                publish(publisher, 2, "{\"fail\":" + std::to_string(i) + "}");
+            TEST_CHECK(wait_until([&]() { return journal.stats().failed == 3; }));
+            TEST_CHECK(publisher.stats().coalesced >= 1);
+        }
+        TEST_CHECK_EQ(journal.stats().acked, 3u);
+        TEST_CHECK_EQ(journal.stats().unacked, 3u);
+        TEST_CHECK(journal.take_replay().empty()); // 该通道还没有恢复
+
+        // 3. 发送阻塞时超过内存上限：被丢弃的报警（包括合并在一起的）记为失败，其余发送成功后确认
+        sender.set_fail(false);
+        sender.set_blocked(true);
+        size_t dropped = 0;
+        {
+            MqttPublisher publisher([&sender](const std::string &payload) { return sender.send(payload); }, 1, 2048, 100);
+            publish(publisher, 3, "{\"first\":0}");
+            TEST_CHECK(sender.wait_blocked_send());
+            for(int i = 0; i < 10; i++)
+                publish(publisher, 3 + i % 2, alarm_payload(i));
+            sender.set_blocked(false);
+            // 每条报警都回调一次：确认或记为失败
+            TEST_CHECK(wait_until([&]() { return journal.stats().acked + journal.stats().failed == 3 + 3 + 11; }));
+            dropped = publisher.stats().dropped;
+        }
+        TEST_CHECK(dropped > 0);
+        JournalStats stats = journal.stats();
+        TEST_CHECK_EQ(stats.unacked, 3 + dropped);
+        TEST_CHECK_EQ(stats.acked, 3 + 11 - dropped);
+        // 该通道发送成功后，失败和被丢弃的报警重放
+        TEST_CHECK_EQ(journal.take_replay().size(), 3 + dropped);
+    }
+    remove_dir(dir);
+}
+
+int main()
+{
+    test_rotate_and_recover();
+    test_publisher_results();
+    return TEST_RESULT();
+}
@@ -0,0 +1,331 @@
+// 测试：AlarmJsonWriter的输出与改造前组装Json::Value再用Json2String(emitUTF8=true)序列化的结果逐字节一致
+// golden_root按改造前AppMqttNode::publish_alarm的写法组装，覆盖转义字符、UTF-8名称、空目标列表、大量目标、nvr字段和配置中的同名键；
+// 写入报警日志的消息不带图片，带alarm_image_path（minio对象名）；nvr更新消息只带nvr字段
+#include "alarm_json_writer.h"
+#include "base64.h"
+#include "clock_service.h"
+#include "test_common.h"
+
+#include "json.h"
+#include <memory>
+#include <random>
+#include <sstream>
+
+// 功能：与AppMqttNode::Json2String相同
+static std::string Json2String(const Json::Value &root)
+{
+    static Json::Value def = []()
+    {
+        Json::Value def;
+        Json::StreamWriterBuilder::setDefaults(&def);
+        def["emitUTF8"] = true;
+        return def;
+    }
+    ();
+    std::ostringstream stream;
+    Json::StreamWriterBuilder stream_builder;
+    stream_builder.settings_ = def;
+    std::unique_ptr<Json::StreamWriter> writer(stream_builder.newStreamWriter());
+    writer->write(root, &stream);
+    return stream.str();
+}
+
+// 功能：改造前的报警消息，字段和类型与publish_alarm中逐个赋值的一致
+static Json::Value golden_root(const pipelineInfo &info, int64_t camera_id, const std::vector<uchar> &raw_pic,
+                               const std::vector<uchar> &thumbnail_pic, const AlarmNvrInfo &nvr, const std::string &image_ref)
+{
+    Json::Value root;
+    if(!image_ref.empty())
+        root["alarm_image_path"] = image_ref;
+    if(nvr.enable)
+    {
+        root["information"]["nvr_ip"] = nvr.ip;
+        root["information"]["nvr_port"] = nvr.port;
+        root["information"]["nvr_user"] = nvr.user;
+        root["information"]["nvr_password"] = nvr.password;
+        root["information"]["nvr_channel"] = nvr.channel;
+        root["information"]["nvr_timestamp"] = static_cast<Json::Int64>(nvr.timestamp);
+        root["channel_no"] = nvr.channel;
+        root["video_url"] = nvr.video_url;
+        root["stop_alarm_date"] = ClockService::iso8601(nvr.stop_alarm_time_ms);
+    }
+    root["camera_id"] = static_cast<Json::Int64>(camera_id);
+    root["camera_name"] = info.camera_name;
+    root["deployment"] = info.seawayos_app;
+    root["namespace"] = info.seawayos_namespace;
+    root["alarm_type"] = info.alarm_type;
+    root["alarm_raw_pic"] = base64_encode(raw_pic.data(), raw_pic.size());
+    root["alarm_thumbnail_pic"] = base64_encode(thumbnail_pic.data(), thumbnail_pic.size());
+    root["alarm_date"] = ClockService::iso8601(info.alarm_time_ms);
+    root["information"]["alarm_num"] = info.alarm_information.alarm_num;
+    root["information"]["result_num"] = info.result_information.result_num;
+
+    Json::Value temp_alarm_array, alarm_array;
+    Json::Value temp_result_array, result_array;
+    for(const auto &alarm_array_info : info.alarm_information.alarm_object_list)
+    {
+        temp_alarm_array["x"] = alarm_array_info.x;
+        temp_alarm_array["y"] = alarm_array_info.y;
+        temp_alarm_array["w"] = alarm_array_info.w;
+        temp_alarm_array["h"] = alarm_array_info.h;
+        temp_alarm_array["track_id"] = alarm_array_info.track_id;
+        temp_alarm_array["label"] = alarm_array_info.label;
+        temp_alarm_array["score"] = alarm_array_info.score;
+        alarm_array.append(temp_alarm_array);
+    }
+    root["information"]["alarm"] = alarm_array;
+    for(const auto &result_array_info : info.result_information.result_object_list)
+    {
+        temp_result_array["x"] = result_array_info.x;
+        temp_result_array["y"] = result_array_info.y;
+        temp_result_array["w"] = result_array_info.w;
+        temp_result_array["h"] = result_array_info.h;
+        temp_result_array["track_id"] = result_array_info.track_id;
+        temp_result_array["label"] = result_array_info.label;
+        temp_result_array["score"] = AlarmJsonWriter::format_float(result_array_info.score, 1);
+        result_array.append(temp_result_array);
+    }
+    root["information"]["result"] = result_array;
+    const settingInfo &settings = *info.setting_information;
+    root["information"]["settings"]["roi"] = settings.roi;
+    root["information"]["settings"]["FrameInterval"] = settings.frameInterval;
+    root["information"]["settings"]["NmsThreshold"] = AlarmJsonWriter::format_float(settings.nmsThreshold, 1);
+    root["information"]["settings"]["AlarmInterval"] = settings.alarmInterval;
+    root["information"]["settings"]["AlarmSmooth"] = settings.alarmSmooth;
+    root["information"]["settings"]["StatisticsStartTime"] = settings.statisiticsStartTime;
+    root["information"]["settings"]["StatisticsEndTime"] = settings.statisiticsEndTime;
+    for(const auto &temp_thresh_map : settings.labelThreshMap)
+        root["information"]["settings"][temp_thresh_map.first] = AlarmJsonWriter::format_float(temp_thresh_map.second, 1);
+    return root;
+}
+
+static std::shared_ptr<const settingInfo> make_settings(const std::map<std::string, float> &thresholds)
+{
+    std::shared_ptr<settingInfo> settings = std::make_shared<settingInfo>();
+    settings->roi = "POLYGON((0.1 0.1,0.9 0.1,0.9 0.9,0.1 0.9,0.1 0.1))";
+    settings->labelThreshMap = thresholds;
+    settings->frameInterval = 5;
+    settings->confThreshold = 0.25f;
+    settings->nmsThreshold = 0.45f;
+    settings->alarmInterval = 30;
+    settings->alarmSmooth = true;
+    settings->statisiticsStartTime = "08:00:00";
+    settings->statisiticsEndTime = "18:00:00";
+    return settings;
+}
+
+static objectInfo make_object(int i, const std::string &label, float score)
+{
+    objectInfo object;
+    object.x = 10 * i;
+    object.y = 20 * i - 5;
+    object.w = 30 + i;
+    object.h = 60 + i;
+    object.track_id = i + 1;
+    object.label = label;
+    object.score = score;
+    return object;
+}
+
+static void add_object(pipelineInfo &info, const objectInfo &object)
+{
+    info.alarm_information.alarm_object_list.push_back(object);
+    info.alarm_information.alarm_num++;
+    info.result_information.result_object_list.push_back(object);
+    info.result_information.result_num++;
+}
+
+static std::vector<uchar> make_picture(size_t size, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<uchar> picture(size);
+    for(uchar &b : picture)
+        b = static_cast<uchar>(rng());
+    return picture;
+}
+
+// 功能：同一个writer连续写入，检查与golden逐字节一致，不一致时输出第一个不同的位置
+static void check_case(AlarmJsonWriter &writer, const char *name, const pipelineInfo &info, int64_t camera_id,
+                       const std::vector<uchar> &raw_pic, const std::vector<uchar> &thumbnail_pic, const AlarmNvrInfo &nvr,
+                       const std::string &image_ref = std::string())
+{
+    std::string expected = Json2String(golden_root(info, camera_id, raw_pic, thumbnail_pic, nvr, image_ref));
+    const std::string &actual = writer.write(info, camera_id, raw_pic, thumbnail_pic, nvr, image_ref);
+    if(actual != expected)
+    {
+        size_t pos = 0;
+        while(pos < actual.size() && pos < expected.size() && actual[pos] == expected[pos])
+            pos++;
+        size_t from = pos > 40 ? pos - 40 : 0;
+        std::cout << name << ": first difference at byte " << pos << "\n  actual:   " << actual.substr(from, 80)
+                  << "\n  expected: " << expected.substr(from, 80) << std::endl;
+    }
+    TEST_CHECK(actual == expected);
+    // 输出是合法的JSON
+    Json::Value parsed;
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    std::string errors;
+    TEST_CHECK(reader->parse(actual.data(), actual.data() + actual.size(), &parsed, &errors));
+}
+
+int main()
+{
+    AlarmJsonWriter writer;
+    AlarmNvrInfo no_nvr;
+    const std::vector<uchar> raw_pic = make_picture(4099, 1);
+    const std::vector<uchar> thumbnail_pic = make_picture(257, 2);
+
+    // 1. 普通报警
+    {
+        pipelineInfo info;
+        info.camera_id = "1001";
+        info.camera_name = "gate-1";
+        info.seawayos_app = "helmet";
+        info.seawayos_namespace = "default";
+        info.alarm_type = 3;
+        info.alarm_time_ms = 1700000000123;
+        info.setting_information = make_settings({{"person", 0.5f}, {"helmet", 0.65f}});
+        add_object(info, make_object(1, "person", 0.87f));
+        add_object(info, make_object(2, "helmet", 0.3f));
+        check_case(writer, "basic", info, 1001, raw_pic, thumbnail_pic, no_nvr);
+    }
+
+    // 2. 需要转义的字符：引号、反斜杠、换行、制表符、控制字符、DEL和'/'
+    {
+        pipelineInfo info;
+        info.camera_name = "say \"hi\"\\ \n\t\r\b\f end\x01\x1f\x7f /path";
+        info.seawayos_app = "app\\name";
+        info.seawayos_namespace = "ns\"1\"";
+        info.alarm_time_ms = 1700000000999;
+        info.setting_information = make_settings({{"la\"bel\n", 0.4f}});
+        add_object(info, make_object(3, "tab\tlabel\\\"", 0.123456f));
+        check_case(writer, "escape", info, -42, raw_pic, thumbnail_pic, no_nvr);
+    }
+
+    // 3. UTF-8的通道名、标签和配置键，非ASCII字节原样输出
+    {
+        pipelineInfo info;
+        info.camera_name = "5号jb-红外-新建";
+        info.seawayos_app = "安全帽检测";
+        info.seawayos_namespace = "边缘计算";
+        info.alarm_time_ms = 1699999999000;
+        info.setting_information = make_settings({{"人员", 0.55f}, {"烟火", 0.7f}});
+        add_object(info, make_object(4, "人员", 0.91f));
+        check_case(writer, "utf8", info, 99163901901329000LL, raw_pic, thumbnail_pic, no_nvr);
+    }
+
+    // 4. 空的目标列表输出null，空图片输出空字符串
+    {
+        pipelineInfo info;
+        info.camera_name = "empty";
+        info.alarm_time_ms = 1700000000000;
+        info.setting_information = make_settings({});
+        check_case(writer, "empty lists", info, 0, std::vector<uchar>(), std::vector<uchar>(), no_nvr);
+    }
+
+    // 5. 大量目标，分数覆盖整数值、很小的值和各种尾数
+    {
+        pipelineInfo info;
+        info.camera_name = "many";
+        info.alarm_time_ms = 1700000012345;
+        info.setting_information = make_settings({{"person", 0.5f}});
+        std::mt19937 rng(36);
+        std::uniform_real_distribution<float> score(0.f, 1.f);
+        add_object(info, make_object(0, "person", 1.0f));
+        add_object(info, make_object(1, "person", 0.f));
+        add_object(info, make_object(2, "person", 1e-7f));
+        for(int i = 3; i < 300; i++)
+            add_object(info, make_object(i, i % 2 ? "person" : "car", score(rng)));
+        check_case(writer, "many objects", info, 7, raw_pic, thumbnail_pic, no_nvr);
+    }
+
+    // 6. nvr录像字段
+    {
+        pipelineInfo info;
+        info.camera_name = "nvr";
+        info.alarm_time_ms = 1700000000500;
+        info.setting_information = make_settings({{"person", 0.5f}});
+        add_object(info, make_object(5, "person", 0.66f));
+        AlarmNvrInfo nvr;
+        nvr.enable = true;
+        nvr.ip = "192.168.1.64";
+        nvr.port = 8000;
+        nvr.user = "admin";
+        nvr.password = "pa\"ss";
+        nvr.channel = 12;
+        nvr.timestamp = 1700000000600;
+        nvr.video_url = "http://minio:9000/nvralarm/20231115061320500.mp4";
+        nvr.stop_alarm_time_ms = 1700000030500;
+        check_case(writer, "nvr", info, 1001, raw_pic, thumbnail_pic, nvr);
+    }
+
+    // 7. 类别阈值与固定配置字段同名时覆盖固定字段，键按字节序与其他字段交错
+    {
+        pipelineInfo info;
+        info.camera_name = "collision";
+        info.alarm_time_ms = 1700000000000;
+        info.setting_information = make_settings({{"NmsThreshold", 0.9f}, {"roi", 0.2f}, {"Aardvark", 0.3f}, {"zebra", 0.4f}, {"_x", 0.1f}});
+        add_object(info, make_object(6, "zebra", 0.5f));
+        check_case(writer, "settings collision", info, 1, raw_pic, thumbnail_pic, no_nvr);
+    }
+
+    // 8. 缓冲区复用：大消息之后写小消息，结果仍与golden一致
+    {
+        pipelineInfo info;
+        info.camera_name = "after large";
+        info.alarm_time_ms = 1700000000000;
+        info.setting_information = make_settings({});
+        add_object(info, make_object(7, "person", 0.5f));
+        check_case(writer, "reuse", info, 2, make_picture(3, 3), make_picture(1, 4), no_nvr);
+    }
+
+    // 9. 写入报警日志的消息：不带图片，用alarm_image_path引用minio中的原图，键按字节序排在alarm_date之后
+    {
+        pipelineInfo info;
+        info.camera_name = "journal";
+        info.alarm_time_ms = 1700000000000;
+        info.setting_information = make_settings({{"person", 0.5f}});
+        add_object(info, make_object(8, "person", 0.75f));
+        check_case(writer, "image ref", info, 3, std::vector<uchar>(), std::vector<uchar>(), no_nvr, "/algo-alarm/1700000000001.jpg");
+    }
+
+    // 10. nvr更新消息：type和alarm_id，camera_id、alarm_date与原报警相同，只带nvr字段，不带图片、目标和配置
+    {
+        pipelineInfo info;
+        info.camera_name = "nvr update";
+        info.alarm_time_ms = 1700000000500;
+        info.setting_information = make_settings({{"person", 0.5f}});
+        add_object(info, make_object(9, "person", 0.8f));
+        AlarmNvrInfo nvr;
+        nvr.enable = true;
+        nvr.ip = "192.168.1.64";
+        nvr.port = 8000;
+        nvr.user = "admin";
+        nvr.password = "pa\"ss";
+        nvr.channel = 12;
+        nvr.timestamp = 1700000004000;
+        nvr.video_url = "http://minio:9000/nvralarm/20231115061320500.mp4";
+        nvr.stop_alarm_time_ms = 1700000030500;
+
+        Json::Value root;
+        root["type"] = ALARM_NVR_UPDATE_TYPE;
+        root["alarm_id"] = "1001_1700000000500";
+        root["camera_id"] = static_cast<Json::Int64>(1001);
+        root["alarm_date"] = ClockService::iso8601(info.alarm_time_ms);
+        root["information"]["nvr_ip"] = nvr.ip;
+        root["information"]["nvr_port"] = nvr.port;
+        root["information"]["nvr_user"] = nvr.user;
+        root["information"]["nvr_password"] = nvr.password;
+        root["information"]["nvr_channel"] = nvr.channel;
+        root["information"]["nvr_timestamp"] = static_cast<Json::Int64>(nvr.timestamp);
+        root["channel_no"] = nvr.channel;
+        root["video_url"] = nvr.video_url;
+        root["stop_alarm_date"] = ClockService::iso8601(nvr.stop_alarm_time_ms);
+        const std::string &actual = writer.write_nvr_update(info, 1001, nvr);
+        TEST_CHECK_EQ(actual, Json2String(root));
+        // 之后的报警消息不受影响
+        check_case(writer, "after nvr update", info, 1001, raw_pic, thumbnail_pic, nvr);
+    }
+    return TEST_RESULT();
+}
@@ -0,0 +1,149 @@
+// 测试：报警从ReadNode经AppRoiNode到AppEndNode的每一步都不拷贝pipelineInfo
+// 替换全局operator new统计内存分配：整条路径的分配次数与目标个数、字符串长度无关，
+// 且只有链表节点和消息本身；原图、配置和字符串的地址在路径前后不变
+#include "alarm_queue.h"
+#include "test_common.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<bool> g_counting{false};
+static std::atomic<size_t> g_allocations{0};
+static std::atomic<size_t> g_allocated_bytes{0};
+
+// 分配和释放不内联，避免编译器把内联后的operator new与free配对检查（-Wmismatched-new-delete）
+__attribute__((noinline)) static void *allocate(size_t size)
+{
+    return std::malloc(size ? size : 1);
+}
+
+__attribute__((noinline)) static void release(void *p)
+{
+    std::free(p);
+}
+
+void *operator new(size_t size)
+{
+    if(g_counting.load(std::memory_order_relaxed))
+    {
+        g_allocations++;
+        g_allocated_bytes += size;
+    }
+    void *p = allocate(size);
+    if(p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    release(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    release(p);
+}
+
+struct HopResult
+{
+    size_t allocations;
+    size_t bytes;
+    bool same_image;
+    bool same_setting;
+    bool same_camera_id;
+    int alarm_num;
+};
+
+// 功能：构造一个有object_count个目标的报警，一半在ROI内，走完整条报警路径
+static HopResult run_alarm_path(int object_count, std::shared_ptr<const cv::Mat> image, std::shared_ptr<const settingInfo> setting,
+                                AlarmRoiFilter &roi_filter)
+{
+    pipelineInfo info;
+    info.camera_index = 3;
+    info.camera_id = "camera-id-long-enough-to-skip-small-string-optimisation-0123456789";
+    info.camera_name = "camera name long enough to skip the small string optimisation";
+    info.source_image = image;
+    info.setting_information = setting;
+    for(int i = 0; i < object_count; i++)
+    {
+        objectInfo object;
+        // ROI为画面左半部分，偶数目标在ROI内
+        object.x = (i % 2 == 0) ? 100 : 1500;
+        object.y = 100 + i;
+        object.w = 100;
+        object.h = 200;
+        object.track_id = i + 1;
+        object.label = "person-label-long-enough-to-skip-small-string-optimisation";
+        object.score = 0.9f;
+        info.alarm_information.alarm_object_list.push_back(object);
+        info.alarm_information.alarm_num++;
+        info.result_information.result_object_list.push_back(object);
+        info.result_information.result_num++;
+    }
+    const cv::Mat *image_ptr = info.source_image.get();
+    const uchar *image_data = info.source_image->data;
+    const settingInfo *setting_ptr = info.setting_information.get();
+    const char *camera_id_data = info.camera_id.data();
+
+    std::list<pipelineInfo> queue; // sendInfoParam::pipelineinfo_list
+    g_allocations = 0;
+    g_allocated_bytes = 0;
+    g_counting = true;
+    // ReadNode
+    std::list<pipelineInfo> batch;
+    AlarmQueue::add(batch, std::move(info));
+    AlarmQueue::append(queue, batch, PIPELINEINFO_LIST_THRESH);
+    // AppRoiNode
+    roi_filter.filter(queue);
+    // AppEndNode
+    std::list<pipelineInfo> ready;
+    AlarmQueue::take_ready(queue, ready);
+    std::unique_ptr<mqttMessageParam> message(new mqttMessageParam());
+    AlarmQueue::to_message(ready.front(), *message);
+    g_counting = false;
+
+    const pipelineInfo &output = message->pipelineinfo;
+    HopResult result;
+    result.allocations = g_allocations;
+    result.bytes = g_allocated_bytes;
+    result.same_image = output.source_image.get() == image_ptr && output.source_image->data == image_data;
+    result.same_setting = output.setting_information.get() == setting_ptr;
+    result.same_camera_id = output.camera_id.data() == camera_id_data;
+    result.alarm_num = output.alarm_information.alarm_num;
+    return result;
+}
+
+int main()
+{
+    std::shared_ptr<const cv::Mat> image = std::make_shared<const cv::Mat>(1080, 1920, CV_8UC3);
+    std::shared_ptr<settingInfo> setting = std::make_shared<settingInfo>();
+    setting->roi = "POLYGON((0 0,0.5 0,0.5 1,0 1,0 0))";
+    setting->labelThreshMap["person"] = 0.5f;
+    std::shared_ptr<const settingInfo> shared_setting = setting;
+
+    AlarmRoiFilter roi_filter;
+    run_alarm_path(64, image, shared_setting, roi_filter); // 第一次编译ROI，复用的缓冲区分配空间
+
+    HopResult one = run_alarm_path(1, image, shared_setting, roi_filter);
+    HopResult many = run_alarm_path(64, image, shared_setting, roi_filter);
+    std::cout << "allocations per alarm: " << one.allocations << " (1 object), " << many.allocations << " (64 objects); bytes: "
+              << one.bytes << ", " << many.bytes << std::endl;
+
+    // 只有ReadNode本批链表的节点和AppEndNode的消息，不随目标个数增加
+    TEST_CHECK_EQ(one.allocations, 2u);
+    TEST_CHECK_EQ(many.allocations, one.allocations);
+    TEST_CHECK_EQ(many.bytes, one.bytes);
+    TEST_CHECK(many.bytes < sizeof(pipelineInfo) * 2 + 256);
+    // 原图、配置和字符串没有被复制
+    TEST_CHECK(one.same_image && many.same_image);
+    TEST_CHECK(one.same_setting && many.same_setting);
+    TEST_CHECK(one.same_camera_id && many.same_camera_id);
+    TEST_CHECK_EQ(image.use_count(), 1);
+    TEST_CHECK_EQ(shared_setting.use_count(), 2);
+    // ROI筛选仍然生效
+    TEST_CHECK_EQ(one.alarm_num, 1);
+    TEST_CHECK_EQ(many.alarm_num, 32);
+    return TEST_RESULT();
+}
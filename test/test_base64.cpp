@@ -0,0 +1,168 @@
+// 测试：base64编码与逐位实现的参考编码一致，并能解码回原数据
+// 编码路径在编译时选择（aarch64为NEON，x86加-mssse3为SSSE3，否则为逐字节查表），test/CMakeLists.txt在x86上另外编译SSSE3版本
+// 1. 1字节、2字节、3字节的所有取值（3字节的所有取值连成一段，同时覆盖SIMD主循环）
+// 2. 随机数据的所有长度0~512、起始地址偏移0~15，覆盖SIMD与尾部查表的每种衔接
+// 3. 固定的测试向量，包括改造前编码错误的2字节尾部（"ab"曾被编码为"YQA="）
+#include "base64.h"
+#include "test_common.h"
+
+#include <cstdint>
+#include <random>
+
+// 功能：参考编码，按位取6位索引，与base64.cpp的实现无关
+static std::string reference_encode(const unsigned char *src, size_t len)
+{
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    size_t bits = len * 8;
+    for(size_t bit = 0; bit < bits; bit += 6)
+    {
+        int index = 0;
+        for(int i = 0; i < 6; i++)
+        {
+            size_t b = bit + i;
+            int value = b < bits ? (src[b / 8] >> (7 - b % 8)) & 1 : 0;
+            index = (index << 1) | value;
+        }
+        out += table[index];
+    }
+    while(out.size() % 4)
+        out += '=';
+    return out;
+}
+
+// 功能：严格解码，遇到非法字符或'='位置不对返回false
+static bool reference_decode(const std::string &text, std::vector<unsigned char> &out)
+{
+    out.clear();
+    if(text.size() % 4)
+        return false;
+    uint32_t value = 0;
+    int bits = 0;
+    size_t padding = 0;
+    for(size_t i = 0; i < text.size(); i++)
+    {
+        char c = text[i];
+        int index;
+        if(c >= 'A' && c <= 'Z') index = c - 'A';
+        else if(c >= 'a' && c <= 'z') index = c - 'a' + 26;
+        else if(c >= '0' && c <= '9') index = c - '0' + 52;
+        else if(c == '+') index = 62;
+        else if(c == '/') index = 63;
+        else if(c == '=' && i + 2 >= text.size()) { padding++; continue; }
+        else return false;
+        if(padding)
+            return false;
+        value = (value << 6) | index;
+        bits += 6;
+        if(bits >= 8)
+        {
+            bits -= 8;
+            out.push_back(static_cast<unsigned char>(value >> bits));
+        }
+    }
+    return padding <= 2;
+}
+
+static const char *encoder_path()
+{
+#if defined(__aarch64__)
+    return "neon";
+#elif defined(__SSSE3__)
+    return "ssse3";
+#else
+    return "scalar";
+#endif
+}
+
+int main()
+{
+    std::cout << "base64 encoder path: " << encoder_path() << std::endl;
+
+    // 固定测试向量（RFC 4648）
+    const struct
+    {
+        const char *plain;
+        const char *encoded;
+    } vectors[] = {
+        {"", ""}, {"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"}, {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"},
+        {"ab", "YWI="}, // 改造前第二个字节被清零，编码为"YQA="
+        {"abcdefghijklmnopqrstuvwxyz", "YWJjZGVmZ2hpamtsbW5vcHFyc3R1dnd4eXo="},
+    };
+    for(const auto &vector : vectors)
+    {
+        std::string plain = vector.plain;
+        TEST_CHECK_EQ(base64_encode(reinterpret_cast<const unsigned char *>(plain.data()), plain.size()), std::string(vector.encoded));
+    }
+
+    // 1字节和2字节的所有取值
+    int short_mismatch = 0;
+    for(int value = 0; value < 65536 + 256; value++)
+    {
+        unsigned char bytes[2] = {static_cast<unsigned char>(value & 0xff), static_cast<unsigned char>(value >> 8)};
+        size_t len = value < 256 ? 1 : 2;
+        char out[4];
+        size_t written = base64_encode_to(bytes, len, out);
+        short_mismatch += std::string(out, written) != reference_encode(bytes, len);
+    }
+    TEST_CHECK_EQ(short_mismatch, 0);
+
+    // 3字节的所有取值连成一段，一次编码
+    {
+        const size_t count = 1 << 24;
+        std::vector<unsigned char> input(count * 3);
+        for(size_t i = 0; i < count; i++)
+        {
+            input[i * 3] = static_cast<unsigned char>(i >> 16);
+            input[i * 3 + 1] = static_cast<unsigned char>(i >> 8);
+            input[i * 3 + 2] = static_cast<unsigned char>(i);
+        }
+        std::string encoded(base64_encoded_size(input.size()), '\0');
+        TEST_CHECK_EQ(base64_encode_to(input.data(), input.size(), &encoded[0]), encoded.size());
+        size_t triple_mismatch = 0;
+        for(size_t i = 0; i < count; i++)
+            triple_mismatch += encoded.compare(i * 4, 4, reference_encode(&input[i * 3], 3)) != 0;
+        TEST_CHECK_EQ(triple_mismatch, 0u);
+    }
+
+    // 随机数据的所有长度和起始偏移，编码结果与参考编码一致且能解码回原数据
+    {
+        std::mt19937 rng(35);
+        std::uniform_int_distribution<int> byte(0, 255);
+        std::vector<unsigned char> data(512 + 16);
+        for(unsigned char &b : data)
+            b = static_cast<unsigned char>(byte(rng));
+        int mismatch = 0, round_trip_fail = 0, append_fail = 0;
+        std::vector<unsigned char> decoded;
+        for(size_t offset = 0; offset < 16; offset++)
+        {
+            for(size_t len = 0; len <= 512; len++)
+            {
+                const unsigned char *src = data.data() + offset;
+                std::string encoded = base64_encode(src, len);
+                mismatch += encoded != reference_encode(src, len);
+                round_trip_fail += !reference_decode(encoded, decoded) || decoded != std::vector<unsigned char>(src, src + len);
+                // 追加到已有内容之后，前面的内容不变
+                std::string message = "{\"img\":\"";
+                base64_encode_append(src, len, message);
+                append_fail += message != "{\"img\":\"" + encoded;
+            }
+        }
+        TEST_CHECK_EQ(mismatch, 0);
+        TEST_CHECK_EQ(round_trip_fail, 0);
+        TEST_CHECK_EQ(append_fail, 0);
+    }
+
+    // 编码只写base64_encoded_size字节，不越界
+    {
+        std::vector<unsigned char> data(100, 0xab);
+        for(size_t len = 0; len <= 100; len++)
+        {
+            std::string out(base64_encoded_size(len) + 8, '#');
+            size_t written = base64_encode_to(data.data(), len, &out[0]);
+            TEST_CHECK_EQ(written, base64_encoded_size(len));
+            TEST_CHECK_EQ(out.substr(written), std::string(8, '#'));
+        }
+    }
+    return TEST_RESULT();
+}
@@ -0,0 +1,34 @@
+#ifndef _TEST_COMMON_H_
+#define _TEST_COMMON_H_
+
+#include <iostream>
+
+// 测试用的断言：失败时输出位置并计数，不中断后续检查；main返回TEST_RESULT()
+static int g_test_failures = 0;
+
+#define TEST_CHECK(condition) \
+    do { \
+        if(!(condition)) \
+        { \
+            std::cout << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+            g_test_failures++; \
+        } \
+    } while(0)
+
+#define TEST_CHECK_EQ(actual, expected) \
+    do { \
+        if(!((actual) == (expected))) \
+        { \
+            std::cout << __FILE__ << ":" << __LINE__ << ": check failed: " #actual " == " #expected \
+                      << "\n  actual:   " << (actual) << "\n  expected: " << (expected) << std::endl; \
+            g_test_failures++; \
+        } \
+    } while(0)
+
+// 缺少运行条件时返回该值，ctest记为跳过
+#define TEST_SKIP_CODE 77
+
+#define TEST_RESULT() (g_test_failures == 0 ? (std::cout << "all checks passed" << std::endl, 0) \
+                                            : (std::cout << g_test_failures << " checks failed" << std::endl, 1))
+
+#endif // _TEST_COMMON_H_
@@ -0,0 +1,191 @@
+// 测试：录制文件的读写
+// 1. 检测结果写入后读回逐字段相同（包括负坐标、16字节不带\0的名称、超过OBJ_NUMS_MAX_SIZE时截断）
+// 2. 文件内容按小端序定长编码，与手工构造的字节逐字节相同，不依赖结构体布局
+// 3. 帧记录读回序号、时间和尺寸；检测结果和帧交错时互不影响
+// 4. 最后一条记录不完整时丢弃该条；版本不对或不是录制文件时拒绝打开
+#include "frame_record.h"
+#include "test_common.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+
+static std::string temp_path(const char *name)
+{
+    return "/tmp/test_frame_record_" + std::to_string(getpid()) + "_" + name + ".rec";
+}
+
+static std::vector<uint8_t> read_file(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void write_file(const std::string &path, const std::vector<uint8_t> &data)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(data.data()), data.size());
+}
+
+static detect_result_t make_object(const char *name, int left, int right, int top, int bottom, float prop, int track_id)
+{
+    detect_result_t object;
+    memset(&object, 0x5a, sizeof(object)); // 填充字节和名称之后的字节不应写入文件
+    strncpy(object.name, name, OBJ_NAME_MAX_SIZE);
+    object.box.left = left;
+    object.box.right = right;
+    object.box.top = top;
+    object.box.bottom = bottom;
+    object.prop = prop;
+    object.track_id = track_id;
+    return object;
+}
+
+static bool same_object(const detect_result_t &a, const detect_result_t &b)
+{
+    return strncmp(a.name, b.name, OBJ_NAME_MAX_SIZE) == 0 && a.box.left == b.box.left && a.box.right == b.box.right &&
+           a.box.top == b.box.top && a.box.bottom == b.box.bottom && memcmp(&a.prop, &b.prop, sizeof(float)) == 0 &&
+           a.track_id == b.track_id;
+}
+
+static void test_results_round_trip()
+{
+    std::string path = temp_path("results");
+    std::vector<detect_result_group_t> groups(4);
+    groups[0].count = 0;
+    groups[1].count = 2;
+    groups[1].results[0] = make_object("person", -5, 1919, 0, 1079, 0.875f, 7);
+    groups[1].results[1] = make_object("0123456789abcdef", 2147483647, -2147483647 - 1, 3, 4, 1e-30f, -1);
+    groups[2].count = OBJ_NUMS_MAX_SIZE;
+    for(int i = 0; i < OBJ_NUMS_MAX_SIZE; i++)
+        groups[2].results[i] = make_object(i % 2 ? "car" : "person", i, i * 2, i * 3, i * 4, i / 64.0f, i);
+    groups[3].count = OBJ_NUMS_MAX_SIZE + 10; // 超过上限时只写前OBJ_NUMS_MAX_SIZE个
+    groups[3].results[0] = make_object("boat", 1, 2, 3, 4, 0.5f, 0);
+    {
+        FrameRecorder recorder;
+        TEST_CHECK(recorder.open(path));
+        for(size_t i = 0; i < groups.size(); i++)
+            recorder.write_result(100 + i, groups[i]);
+    }
+
+    std::map<uint64_t, RecordedResult> results;
+    TEST_CHECK(FrameReplayer::load_results(path, results));
+    TEST_CHECK_EQ(results.size(), groups.size());
+    for(size_t i = 0; i < groups.size(); i++)
+    {
+        const RecordedResult &result = results[100 + i];
+        TEST_CHECK_EQ(result.size(), static_cast<size_t>(std::min(groups[i].count, OBJ_NUMS_MAX_SIZE)));
+        for(size_t j = 0; j < result.size(); j++)
+            TEST_CHECK(same_object(result[j], groups[i].results[j]));
+    }
+    unlink(path.c_str());
+}
+
+static void test_byte_layout()
+{
+    std::string path = temp_path("layout");
+    detect_result_group_t group;
+    group.count = 1;
+    group.results[0] = make_object("person", -1, 258, 65536, 16777216, 0.5f, 3);
+    {
+        FrameRecorder recorder;
+        TEST_CHECK(recorder.open(path));
+        recorder.write_result(0x0102030405060708ull, group);
+    }
+
+    std::vector<uint8_t> expected = {
+        'S', 'W', 'R', 'E', 'C', 'O', 'R', 'D', 2, 0, 0, 0, 16, 0, 0, 0, // 文件头：版本2，16字节
+        2, 0, 0, 0, 44, 0, 0, 0,                                          // RECORD_RESULT，数据44字节
+        8, 7, 6, 5, 4, 3, 2, 1,                                           // frame_seq
+        0, 0, 0, 0, 0, 0, 0, 0,                                           // timestamp_us
+        1, 0, 0, 0,                                                       // 目标数
+        'p', 'e', 'r', 's', 'o', 'n', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,       // name
+        0xff, 0xff, 0xff, 0xff, 2, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1,       // left right top bottom
+        0, 0, 0, 0x3f,                                                    // prop 0.5f
+        3, 0, 0, 0,                                                       // track_id
+    };
+    std::vector<uint8_t> actual = read_file(path);
+    TEST_CHECK_EQ(actual.size(), expected.size());
+    TEST_CHECK(actual == expected);
+    unlink(path.c_str());
+}
+
+static void test_frames_and_truncation()
+{
+    std::string path = temp_path("frames");
+    {
+        FrameRecorder recorder;
+        TEST_CHECK(recorder.open(path));
+        for(int i = 0; i < 3; i++)
+        {
+            cv::Mat frame(48 + i * 16, 64, CV_8UC3, cv::Scalar(i * 40, 80, 120));
+            recorder.write_frame(i + 1, 1000000LL * (i + 1) + 7, frame);
+            detect_result_group_t group;
+            group.count = 1;
+            group.results[0] = make_object("person", i, i + 10, i, i + 20, 0.9f, i);
+            recorder.write_result(i + 1, group);
+        }
+    }
+
+    FrameReplayer replayer;
+    TEST_CHECK(replayer.open(path));
+    TEST_CHECK_EQ(replayer.results().size(), 3u);
+    uint64_t frame_seq = 0;
+    int64_t timestamp_us = 0;
+    cv::Mat frame;
+    for(int i = 0; i < 3; i++)
+    {
+        TEST_CHECK(replayer.next(frame_seq, timestamp_us, frame));
+        TEST_CHECK_EQ(frame_seq, static_cast<uint64_t>(i + 1));
+        TEST_CHECK_EQ(timestamp_us, 1000000LL * (i + 1) + 7);
+        TEST_CHECK_EQ(frame.rows, 48 + i * 16);
+        TEST_CHECK_EQ(frame.cols, 64);
+    }
+    TEST_CHECK(!replayer.next(frame_seq, timestamp_us, frame));
+    replayer.rewind();
+    TEST_CHECK(replayer.next(frame_seq, timestamp_us, frame));
+    TEST_CHECK_EQ(frame_seq, 1u);
+
+    // 录制时进程被结束，最后一条检测结果只写了一部分
+    std::vector<uint8_t> data = read_file(path);
+    data.pop_back();
+    write_file(path, data);
+    std::map<uint64_t, RecordedResult> results;
+    TEST_CHECK(FrameReplayer::load_results(path, results));
+    TEST_CHECK_EQ(results.size(), 2u);
+    TEST_CHECK(results.count(3) == 0);
+    unlink(path.c_str());
+}
+
+static void test_reject_unknown_files()
+{
+    std::string path = temp_path("version");
+    {
+        FrameRecorder recorder;
+        TEST_CHECK(recorder.open(path));
+    }
+    std::vector<uint8_t> data = read_file(path);
+    std::map<uint64_t, RecordedResult> results;
+    TEST_CHECK(FrameReplayer::load_results(path, results));
+
+    data[8] = FRAME_RECORD_VERSION + 1;
+    write_file(path, data);
+    TEST_CHECK(!FrameReplayer::load_results(path, results));
+    FrameReplayer replayer;
+    TEST_CHECK(!replayer.open(path));
+
+    // 第一版录制文件直接写结构体，不能跨架构读取，不再支持
+    write_file(path, {'S', 'W', 'R', 'E', 'C', '0', '1', 0, 2, 0, 0, 0, 0, 0, 0, 0});
+    TEST_CHECK(!FrameReplayer::load_results(path, results));
+    unlink(path.c_str());
+}
+
+int main()
+{
+    test_results_round_trip();
+    test_byte_layout();
+    test_frames_and_truncation();
+    test_reject_unknown_files();
+    return TEST_RESULT();
+}
@@ -0,0 +1,187 @@
+// 测试：KafkaAlarmTemplate和KafkaProducer
+// 1. 默认模板生成的消息与改造前组装kafka_root再用Json2String(emitUTF8=true)序列化的结果逐字节一致
+// 2. 自定义模板覆盖所有字段，字符串字段的转义和UTF-8可以被jsoncpp正确解析；未知字段编译失败
+// 3. 使用librdkafka内置的模拟集群（test.mock.num.brokers）发送，所有消息回调为true，统计与回调一致
+//    librdkafka不支持模拟集群时只运行模板测试，模板测试通过则返回77跳过
+#include "kafka_producer.h"
+#include "test_common.h"
+
+#include "json.h"
+#include <memory>
+#include <sstream>
+#include <chrono>
+#include <condition_variable>
+
+// 功能：与AppMqttNode::Json2String相同
+static std::string Json2String(const Json::Value &root)
+{
+    static Json::Value def = []()
+    {
+        Json::Value def;
+        Json::StreamWriterBuilder::setDefaults(&def);
+        def["emitUTF8"] = true;
+        return def;
+    }
+    ();
+    std::ostringstream stream;
+    Json::StreamWriterBuilder stream_builder;
+    stream_builder.settings_ = def;
+    std::unique_ptr<Json::StreamWriter> writer(stream_builder.newStreamWriter());
+    writer->write(root, &stream);
+    return stream.str();
+}
+
+// 功能：改造前AppMqttNode::publish_alarm中组装的kafka消息
+static Json::Value golden_kafka_root(int64_t time_stamp_ms, const std::string &alarm_image_path)
+{
+    Json::Value kafka_root;
+    kafka_root["alertName"] = "发现wz人员";
+    kafka_root["data"]["alarmDate"] = static_cast<Json::Int64>(time_stamp_ms / 1000);
+    kafka_root["data"]["altitude"] = "1.0";
+    kafka_root["data"]["picUrl"] = alarm_image_path;
+    kafka_root["data"]["channelName"] = "5号jb-红外-新建";
+    kafka_root["data"]["deviceId"] = "99163901901329000007";
+    kafka_root["data"]["deviceName"] = "5号jb";
+    kafka_root["data"]["eventId"] = 12374871;
+    kafka_root["data"]["isRoot"] = 1;
+    kafka_root["data"]["latitude"] = "39.913356";
+    kafka_root["data"]["liveVideo"]["type"] = "GB";
+    kafka_root["data"]["liveVideo"]["value"] = "34020000001320074885";
+    kafka_root["data"]["longtitude"] = "124.221961";
+    kafka_root["data"]["objType"] = "30002";
+    kafka_root["data"]["recordVideo"]["type"] = "GB";
+    kafka_root["data"]["recordVideo"]["value"] = "23475613678313545";
+    kafka_root["data"]["source"] = "边缘计算";
+
+    kafka_root["deviceId"] = kafka_root["data"]["deviceId"];
+    kafka_root["event"] = "specialEvent";
+    kafka_root["headers"]["deviceName"] = kafka_root["data"]["deviceName"];
+    kafka_root["headers"]["orgId"] = "";
+    kafka_root["headers"]["productId"] = "JKSB-SXT";
+    kafka_root["headers"]["type"] = "300002";
+
+    kafka_root["messageId"] = "45453271231234524564";
+    kafka_root["messageType"] = "EVENT";
+    kafka_root["timestamp"] = static_cast<Json::Int64>(time_stamp_ms);
+    return kafka_root;
+}
+
+static bool parse_json(const std::string &text, Json::Value &root)
+{
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    std::string errors;
+    return reader->parse(text.data(), text.data() + text.size(), &root, &errors);
+}
+
+static void test_default_template()
+{
+    KafkaAlarmTemplate kafka_template;
+    TEST_CHECK(kafka_template.compile(KafkaAlarmTemplate::default_text()));
+    pipelineInfo info;
+    info.camera_id = "1001";
+    info.camera_name = "camera";
+    const std::string paths[] = {
+        "",
+        "http://127.0.0.1:9000/alarm/1001/20240101_120000_000.jpg",
+        "http://minio/桶/图片.jpg?a=1&b=\"q\"\\\t\n\x01",
+    };
+    const int64_t times[] = {0, 1704081600123, 4102444800999};
+    std::string message;
+    for(const std::string &path : paths)
+        for(int64_t time_stamp_ms : times)
+        {
+            kafka_template.fill(info, time_stamp_ms / 1000, time_stamp_ms, path, message);
+            TEST_CHECK_EQ(message, Json2String(golden_kafka_root(time_stamp_ms, path)));
+        }
+}
+
+static void test_custom_template()
+{
+    KafkaAlarmTemplate kafka_template;
+    const std::string text = "{\"id\": \"${camera_id}\", \"name\": \"${camera_name}\", \"index\": \"${camera_index}\", "
+                             "\"type\": ${alarm_type}, \"date\": \"${alarm_date}\", \"ts\": ${timestamp}, "
+                             "\"pic\": \"${pic_url}\", \"fixed\": \"$ {x}\"}";
+    TEST_CHECK(kafka_template.compile(text));
+    pipelineInfo info;
+    info.camera_index = 7;
+    info.camera_id = "cam-\"7\"";
+    info.camera_name = "东门\\入口\n\x1f/";
+    info.alarm_type = 3;
+    std::string message;
+    kafka_template.fill(info, 1700000000, 1700000000456, "http://x/y.jpg", message);
+    Json::Value root;
+    TEST_CHECK(parse_json(message, root));
+    TEST_CHECK_EQ(root["id"].asString(), info.camera_id);
+    TEST_CHECK_EQ(root["name"].asString(), info.camera_name);
+    TEST_CHECK_EQ(root["index"].asInt(), 7);
+    TEST_CHECK_EQ(root["type"].asInt(), 3);
+    TEST_CHECK_EQ(root["date"].asInt64(), 1700000000);
+    TEST_CHECK_EQ(root["ts"].asInt64(), 1700000000456);
+    TEST_CHECK_EQ(root["pic"].asString(), "http://x/y.jpg");
+    TEST_CHECK_EQ(root["fixed"].asString(), "$ {x}");
+
+    // 消息缓冲区复用，第二次填充不残留上一条的内容
+    std::string first = message;
+    info.camera_name = "n";
+    kafka_template.fill(info, 1, 2, "", message);
+    TEST_CHECK(message.size() < first.size());
+    TEST_CHECK(parse_json(message, root));
+    TEST_CHECK_EQ(root["name"].asString(), "n");
+
+    std::string error;
+    TEST_CHECK(!kafka_template.compile("{\"a\": \"${unknown}\"}", &error));
+    TEST_CHECK(error.find("${unknown}") != std::string::npos);
+}
+
+// 功能：模拟集群发送，返回false表示librdkafka不支持模拟集群
+static bool test_mock_cluster()
+{
+    const int count = 100;
+    std::mutex mutex;
+    std::condition_variable cond;
+    int called = 0, delivered = 0;
+    {
+        KafkaProducer producer("", "seaway-test", {{"test.mock.num.brokers", "3"}});
+        if(!producer.valid())
+            return false;
+        for(int i = 0; i < count; i++)
+        {
+            bool queued = producer.produce("camera" + std::to_string(i % 4), "{\"seq\":" + std::to_string(i) + "}", [&](bool ok)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                called++;
+                delivered += ok ? 1 : 0;
+                cond.notify_all();
+            });
+            TEST_CHECK(queued);
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        TEST_CHECK(cond.wait_for(lock, std::chrono::seconds(10), [&]() { return called == count; }));
+        lock.unlock();
+
+        KafkaProducerStats stats = producer.stats();
+        TEST_CHECK_EQ(stats.produced, static_cast<uint64_t>(count));
+        TEST_CHECK_EQ(stats.delivered, static_cast<uint64_t>(count));
+        TEST_CHECK_EQ(stats.failed, 0u);
+        TEST_CHECK(stats.latency_max_ms >= stats.latency_avg_ms);
+        std::cout << "mock cluster: " << stats.delivered << " delivered, latency avg " << stats.latency_avg_ms
+                  << " ms max " << stats.latency_max_ms << " ms" << std::endl;
+    }
+    // 析构时flush，每条消息只回调一次
+    TEST_CHECK_EQ(called, count);
+    TEST_CHECK_EQ(delivered, count);
+    return true;
+}
+
+int main()
+{
+    test_default_template();
+    test_custom_template();
+    if(!test_mock_cluster())
+    {
+        std::cout << "skip: librdkafka mock cluster not available" << std::endl;
+        return g_test_failures == 0 ? TEST_SKIP_CODE : TEST_RESULT();
+    }
+    return TEST_RESULT();
+}
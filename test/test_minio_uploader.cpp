@@ -0,0 +1,211 @@
+// 测试：MinioUploader的磁盘缓存，上传函数由测试注入（模拟对象存储），不需要minio服务
+// 1. 对象存储不可达时，重试用完的图片写入磁盘缓存；析构时还没上传的图片也写入缓存
+// 2. 重启后加载磁盘缓存，删除写入过程中崩溃留下的临时文件，按对象名（提交顺序）补传，补传成功后删除缓存文件
+// 3. 磁盘缓存超过上限时删除最早的缓存，补传时只剩最新的图片
+#include "minio_uploader.h"
+#include "test_common.h"
+
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <map>
+#include <unistd.h>
+
+typedef std::chrono::steady_clock Clock;
+
+// 功能：模拟的对象存储，可以设置为不可达，记录上传成功的对象和顺序
+class FakeStore
+{
+    public:
+        MinioUploader::UploadFactory factory()
+        {
+            return [this]()
+            {
+                return [this](const std::string &key, const uchar *data, size_t size)
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_attempts++;
+                    if(m_down)
+                        return false;
+                    m_order.push_back(key);
+                    m_objects[key].assign(data, data + size);
+                    return true;
+                };
+            };
+        }
+
+        void set_down(bool down)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_down = down;
+        }
+
+        int attempts()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_attempts;
+        }
+
+        std::vector<std::string> order()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_order;
+        }
+
+        std::vector<uchar> object(const std::string &key)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_objects[key];
+        }
+
+    private:
+        bool m_down = false;
+        int m_attempts = 0;
+        std::vector<std::string> m_order;
+        std::map<std::string, std::vector<uchar>> m_objects;
+        std::mutex m_mutex;
+};
+
+static std::string make_dir()
+{
+    char path[] = "/tmp/test_minio_uploader_XXXXXX";
+    return mkdtemp(path) ? std::string(path) : std::string();
+}
+
+static std::vector<std::string> list_files(const std::string &path)
+{
+    std::vector<std::string> names;
+    if(DIR *dir = opendir(path.c_str()))
+    {
+        while(struct dirent *entry = readdir(dir))
+        {
+            if(entry->d_name[0] != '.')
+                names.push_back(entry->d_name);
+        }
+        closedir(dir);
+    }
+    return names;
+}
+
+static void remove_dir(const std::string &path)
+{
+    for(const std::string &name : list_files(path))
+        unlink((path + "/" + name).c_str());
+    rmdir(path.c_str());
+}
+
+static std::vector<uchar> image_data(int index, size_t size)
+{
+    std::vector<uchar> data(size);
+    for(size_t i = 0; i < size; i++)
+        data[i] = static_cast<uchar>(index * 31 + i);
+    return data;
+}
+
+// 功能：等待条件成立，超时返回false
+template <typename Predicate>
+static bool wait_until(Predicate predicate, int timeout_ms = 5000)
+{
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+    while(!predicate())
+    {
+        if(Clock::now() >= deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+static void test_outage_and_restart()
+{
+    std::string dir = make_dir();
+    FakeStore store;
+    std::vector<std::string> keys;
+
+    // 1. 对象存储不可达：重试用完后写入磁盘缓存，析构时队列中的图片也写入缓存
+    store.set_down(true);
+    {
+        MinioUploader uploader(store.factory(), dir, 1);
+        keys.push_back(uploader.submit("alarm", image_data(0, 100)));
+        TEST_CHECK(wait_until([&]() { return uploader.stats().spooled == 1; }));
+        MinioUploaderStats stats = uploader.stats();
+        TEST_CHECK_EQ(stats.retries, static_cast<uint64_t>(MINIO_RETRY_MAX));
+        TEST_CHECK_EQ(store.attempts(), MINIO_RETRY_MAX + 1);
+        TEST_CHECK_EQ(stats.uploaded, 0u);
+        TEST_CHECK_EQ(stats.spool_bytes, 100);
+        for(int i = 1; i < 5; i++)
+            keys.push_back(uploader.submit("alarm", image_data(i, 100 + i)));
+    }
+    TEST_CHECK_EQ(list_files(dir).size(), keys.size());
+    TEST_CHECK(store.order().empty());
+
+    // 写入过程中崩溃留下的临时文件
+    std::string temp = dir + "/%2Falarm%2F1.jpg.spool.tmp";
+    {
+        std::ofstream file(temp);
+        file << "partial";
+    }
+
+    // 2. 重启后对象存储恢复：删除临时文件，按提交顺序补传，补传成功后删除缓存文件
+    store.set_down(false);
+    {
+        MinioUploader uploader(store.factory(), dir, 1);
+        TEST_CHECK(access(temp.c_str(), F_OK) != 0);
+        TEST_CHECK(wait_until([&]() { return uploader.stats().uploaded == keys.size(); }));
+        MinioUploaderStats stats = uploader.stats();
+        TEST_CHECK_EQ(stats.spool_files, 0u);
+        TEST_CHECK_EQ(stats.spool_bytes, 0);
+    }
+    TEST_CHECK(store.order() == keys);
+    for(size_t i = 0; i < keys.size(); i++)
+        TEST_CHECK(store.object(keys[i]) == image_data(static_cast<int>(i), 100 + i));
+    TEST_CHECK(list_files(dir).empty());
+    remove_dir(dir);
+}
+
+static void test_spool_limit()
+{
+    std::string dir = make_dir();
+    FakeStore store;
+    std::vector<std::string> keys;
+
+    // 3. 缓存上限1000字节，5张300字节的图片只保留最新的3张
+    store.set_down(true);
+    {
+        MinioUploader uploader(store.factory(), dir, 1, 1000);
+        for(int i = 0; i < 5; i++)
+            keys.push_back(uploader.submit("limit", image_data(i, 300)));
+    }
+    TEST_CHECK_EQ(list_files(dir).size(), 3u);
+
+    store.set_down(false);
+    {
+        MinioUploader uploader(store.factory(), dir, 1, 1000);
+        TEST_CHECK(wait_until([&]() { return uploader.stats().uploaded == 3; }));
+    }
+    TEST_CHECK(store.order() == std::vector<std::string>(keys.begin() + 2, keys.end()));
+    TEST_CHECK(list_files(dir).empty());
+
+    // 运行中超过上限时删除最早的缓存并计数
+    store.set_down(true);
+    {
+        MinioUploader uploader(store.factory(), dir, 1, 1000);
+        for(int i = 0; i < 2; i++)
+        {
+            uploader.submit("count", image_data(i, 600));
+            TEST_CHECK(wait_until([&]() { return uploader.stats().spooled == static_cast<uint64_t>(i + 1); }));
+        }
+        MinioUploaderStats stats = uploader.stats();
+        TEST_CHECK_EQ(stats.spool_dropped, 1u);
+        TEST_CHECK_EQ(stats.spool_files, 1u);
+        TEST_CHECK_EQ(stats.spool_bytes, 600);
+    }
+    remove_dir(dir);
+}
+
+int main()
+{
+    test_outage_and_restart();
+    test_spool_limit();
+    return TEST_RESULT();
+}
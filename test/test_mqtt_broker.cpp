@@ -0,0 +1,272 @@
+// 测试：MqttPublisher + MosquittoSender连接本地mosquitto broker，中途杀掉broker再重启（注入断线）
+// 1. broker正常时所有报警送达订阅者，回调为true
+// 2. broker断开期间发布的报警在重连后重试送达，回调为true，每条只回调一次
+// 3. 打开合并窗口时，重连后合并窗口内的报警作为JSON数组送达，订阅者收到全部报警
+// 需要mosquitto可执行文件（环境变量MOSQUITTO_BIN或PATH中的mosquitto），找不到时返回77跳过
+#include "mqtt_publisher.h"
+#include "mosquitto_sender.h"
+#include "test_common.h"
+#include "mosquitto.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <csignal>
+#include <map>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define TEST_BROKER_PORT 18883
+#define TEST_TOPIC "seaway/test/alarm"
+
+typedef std::chrono::steady_clock Clock;
+
+// 功能：启动mosquitto并等待端口可以连接，失败返回-1
+static pid_t start_broker(const char *binary)
+{
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+        std::string port = std::to_string(TEST_BROKER_PORT);
+        execlp(binary, binary, "-p", port.c_str(), static_cast<char *>(nullptr));
+        _exit(127);
+    }
+    if(pid < 0)
+        return -1;
+    Clock::time_point deadline = Clock::now() + std::chrono::seconds(3);
+    while(Clock::now() < deadline)
+    {
+        int status = 0;
+        if(waitpid(pid, &status, WNOHANG) == pid)
+            return -1;
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(TEST_BROKER_PORT);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bool ok = connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+        close(fd);
+        if(ok)
+            return pid;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+    return -1;
+}
+
+static void kill_broker(pid_t pid)
+{
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+}
+
+// 功能：订阅测试topic，统计收到的报警（合并消息按数组中的报警计数）
+class Subscriber
+{
+    public:
+        Subscriber()
+        {
+            m_mosq = mosquitto_new(nullptr, true, this);
+            mosquitto_connect_callback_set(m_mosq, &Subscriber::on_connect);
+            mosquitto_subscribe_callback_set(m_mosq, &Subscriber::on_subscribe);
+            mosquitto_disconnect_callback_set(m_mosq, &Subscriber::on_disconnect);
+            mosquitto_message_callback_set(m_mosq, &Subscriber::on_message);
+            mosquitto_reconnect_delay_set(m_mosq, 1, 1, false);
+            mosquitto_connect_async(m_mosq, "127.0.0.1", TEST_BROKER_PORT, 60);
+            mosquitto_loop_start(m_mosq);
+        }
+
+        ~Subscriber()
+        {
+            mosquitto_disconnect(m_mosq);
+            mosquitto_loop_stop(m_mosq, true);
+            mosquitto_destroy(m_mosq);
+        }
+
+        bool wait_subscribed(int timeout_ms)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            return m_cond.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this]() { return m_subscribed; });
+        }
+
+        bool wait_alarms(const std::string &prefix, int count, int timeout_ms)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            return m_cond.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&]() { return alarms(prefix) >= count; });
+        }
+
+        // 功能：收到的以prefix开头的报警个数，需持有m_mutex
+        int alarms(const std::string &prefix)
+        {
+            int count = 0;
+            for(const auto &item : m_alarms)
+                count += item.first.compare(0, prefix.size(), prefix) == 0;
+            return count;
+        }
+
+        int arrays()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_arrays;
+        }
+
+    private:
+        static void on_connect(struct mosquitto *mosq, void *, int rc)
+        {
+            if(rc == 0)
+                mosquitto_subscribe(mosq, nullptr, TEST_TOPIC, 1);
+        }
+
+        static void on_subscribe(struct mosquitto *, void *obj, int, int, const int *)
+        {
+            Subscriber *self = static_cast<Subscriber *>(obj);
+            {
+                std::lock_guard<std::mutex> lock(self->m_mutex);
+                self->m_subscribed = true;
+            }
+            self->m_cond.notify_all();
+        }
+
+        static void on_disconnect(struct mosquitto *, void *obj, int)
+        {
+            Subscriber *self = static_cast<Subscriber *>(obj);
+            std::lock_guard<std::mutex> lock(self->m_mutex);
+            self->m_subscribed = false;
+        }
+
+        // 报警内容为 {"id":"<名称>"}，合并消息为 [{"id":"a"},{"id":"b"}]
+        static void on_message(struct mosquitto *, void *obj, const struct mosquitto_message *message)
+        {
+            Subscriber *self = static_cast<Subscriber *>(obj);
+            std::string payload(static_cast<const char *>(message->payload), message->payloadlen);
+            {
+                std::lock_guard<std::mutex> lock(self->m_mutex);
+                if(!payload.empty() && payload[0] == '[')
+                    self->m_arrays++;
+                const std::string key = "{\"id\":\"";
+                for(size_t pos = payload.find(key); pos != std::string::npos; pos = payload.find(key, pos + 1))
+                {
+                    size_t begin = pos + key.size();
+                    self->m_alarms[payload.substr(begin, payload.find('"', begin) - begin)]++;
+                }
+            }
+            self->m_cond.notify_all();
+        }
+
+        struct mosquitto *m_mosq = nullptr;
+        bool m_subscribed = false;
+        int m_arrays = 0;
+        std::map<std::string, int> m_alarms;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+};
+
+// 功能：记录回调结果，同一条报警回调多次记为失败
+class DoneRecorder
+{
+    public:
+        MqttPublisher::DoneFunction done(const std::string &name)
+        {
+            return [this, name](bool delivered)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_delivered[name] += delivered ? 1 : 0;
+                m_calls[name]++;
+            };
+        }
+
+        // 功能：等待以prefix开头的count条报警都回调，返回回调为true且只回调一次的个数
+        int wait_delivered(const std::string &prefix, int count, int timeout_ms)
+        {
+            Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+            while(true)
+            {
+                int called = 0, delivered = 0;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    for(const auto &item : m_calls)
+                    {
+                        if(item.first.compare(0, prefix.size(), prefix) != 0)
+                            continue;
+                        called++;
+                        delivered += item.second == 1 && m_delivered[item.first] == 1;
+                    }
+                }
+                if(called >= count || Clock::now() >= deadline)
+                    return delivered;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+
+    private:
+        std::map<std::string, int> m_delivered;
+        std::map<std::string, int> m_calls;
+        std::mutex m_mutex;
+};
+
+static std::string alarm_payload(const std::string &name)
+{
+    return "{\"id\":\"" + name + "\"}";
+}
+
+int main()
+{
+    const char *binary = getenv("MOSQUITTO_BIN") ? getenv("MOSQUITTO_BIN") : "mosquitto";
+    signal(SIGPIPE, SIG_IGN);
+    pid_t broker = start_broker(binary);
+    if(broker < 0)
+    {
+        std::cout << "skip: cannot start " << binary << " on port " << TEST_BROKER_PORT << std::endl;
+        return TEST_SKIP_CODE;
+    }
+
+    {
+        Subscriber subscriber;
+        TEST_CHECK(subscriber.wait_subscribed(3000));
+        MosquittoSender sender("127.0.0.1", TEST_BROKER_PORT, TEST_TOPIC, 1);
+        DoneRecorder recorder;
+        MqttPublisher publisher([&sender](const std::string &payload) { return sender.send(payload); }, 1, MQTT_QUEUE_MAX_BYTES, 200);
+        Clock::time_point deadline = Clock::now() + std::chrono::seconds(3);
+        while(!sender.connected() && Clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        TEST_CHECK(sender.connected());
+
+        // 1. broker正常，每路摄像头一条，都立即发送
+        for(int i = 0; i < 10; i++)
+            publisher.publish(i, alarm_payload("up" + std::to_string(i)), recorder.done("up" + std::to_string(i)));
+        TEST_CHECK_EQ(recorder.wait_delivered("up", 10, 3000), 10);
+        TEST_CHECK(subscriber.wait_alarms("up", 10, 3000));
+
+        // 2. 杀掉broker，断开期间发布，500毫秒后重启
+        kill_broker(broker);
+        for(int i = 0; i < 5; i++)
+            publisher.publish(-1, alarm_payload("down" + std::to_string(i)), recorder.done("down" + std::to_string(i)));
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        broker = start_broker(binary);
+        TEST_CHECK(broker > 0);
+        // 重试用完前重连并送达
+        TEST_CHECK_EQ(recorder.wait_delivered("down", 5, 10000), 5);
+        MqttPublisherStats stats = publisher.stats();
+        TEST_CHECK(stats.retries > 0);
+        TEST_CHECK_EQ(stats.failed, 0u);
+
+        // 3. 订阅者重新订阅后，同一路摄像头的连续报警：第一条立即发送，其余合并为JSON数组
+        TEST_CHECK(subscriber.wait_subscribed(5000));
+        for(int i = 0; i < 8; i++)
+            publisher.publish(20, alarm_payload("burst" + std::to_string(i)), recorder.done("burst" + std::to_string(i)));
+        TEST_CHECK_EQ(recorder.wait_delivered("burst", 8, 5000), 8);
+        TEST_CHECK(subscriber.wait_alarms("burst", 8, 3000));
+        TEST_CHECK(subscriber.arrays() >= 1);
+        stats = publisher.stats();
+        TEST_CHECK(stats.coalesced >= 1);
+        TEST_CHECK_EQ(stats.dropped, 0u);
+        std::cout << "sent " << stats.sent << " alarms, " << stats.retries << " retries, " << stats.coalesced
+                  << " coalesced, latency avg " << stats.latency_avg_ms << " ms max " << stats.latency_max_ms << " ms" << std::endl;
+    }
+    if(broker > 0)
+        kill_broker(broker);
+    return TEST_RESULT();
+}
@@ -0,0 +1,321 @@
+// 测试：MqttPublisher的合并窗口、发送顺序、重试和丢弃，发送函数由测试注入，不需要broker
+// 1. 同一路摄像头没有待发送的消息时立即发送，窗口内的后续报警合并为JSON数组，每条报警都以合并消息的结果回调
+// 2. 在合并窗口中等待的消息不阻塞其他摄像头
+// 3. 默认不合并：连续报警每条单独发送，消息是原来的JSON对象
+// 4. 发送失败和超过内存上限被丢弃时，合并消息中的每条报警都回调false，且只回调一次
+#include "mqtt_publisher.h"
+#include "test_common.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+
+typedef std::chrono::steady_clock Clock;
+
+// 功能：记录发送的消息和时间，可以让发送失败或阻塞
+class FakeBroker
+{
+    public:
+        bool send(const std::string &payload)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this]() { return !m_blocked; });
+            m_attempts++;
+            if(m_fail)
+                return false;
+            m_sent.push_back(std::make_pair(payload, Clock::now()));
+            m_cond.notify_all();
+            return true;
+        }
+
+        MqttPublisher::SendFunction function()
+        {
+            return [this](const std::string &payload) { return send(payload); };
+        }
+
+        // 功能：等待收到count条消息，超时返回false
+        bool wait_sent(size_t count, int timeout_ms = 2000)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            return m_cond.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&]() { return m_sent.size() >= count; });
+        }
+
+        std::vector<std::pair<std::string, Clock::time_point>> sent()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_sent;
+        }
+
+        void set_fail(bool fail)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_fail = fail;
+        }
+
+        void set_blocked(bool blocked)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_blocked = blocked;
+            }
+            m_cond.notify_all();
+        }
+
+        int attempts()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_attempts;
+        }
+
+    private:
+        std::vector<std::pair<std::string, Clock::time_point>> m_sent;
+        bool m_fail = false;
+        bool m_blocked = false;
+        int m_attempts = 0;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+};
+
+// 功能：记录每条报警的回调结果和次数
+class DoneRecorder
+{
+    public:
+        MqttPublisher::DoneFunction done(const std::string &name)
+        {
+            return [this, name](bool delivered)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_results[name] = delivered;
+                m_calls[name]++;
+            };
+        }
+
+        // 功能：回调结果，0为失败，1为成功，-1为没有回调，-2为回调了多次
+        int result(const std::string &name)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(m_calls[name] == 0)
+                return -1;
+            if(m_calls[name] > 1)
+                return -2;
+            return m_results[name] ? 1 : 0;
+        }
+
+        bool wait_all(const std::vector<std::string> &names, int timeout_ms = 3000)
+        {
+            Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+            while(Clock::now() < deadline)
+            {
+                bool all = true;
+                for(const std::string &name : names)
+                    all = all && result(name) != -1;
+                if(all)
+                    return true;
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            return false;
+        }
+
+    private:
+        std::map<std::string, bool> m_results;
+        std::map<std::string, int> m_calls;
+        std::mutex m_mutex;
+};
+
+static double ms_between(Clock::time_point from, Clock::time_point to)
+{
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// 第一条立即发送，窗口内的后续报警合并为一条，窗口结束时发送
+static void test_coalesce()
+{
+    FakeBroker broker;
+    DoneRecorder recorder;
+    MqttPublisher publisher(broker.function(), 1, MQTT_QUEUE_MAX_BYTES, 300);
+    Clock::time_point start = Clock::now();
+    publisher.publish(1, "{\"a\":1}", recorder.done("a"));
+    TEST_CHECK(broker.wait_sent(1));
+    publisher.publish(1, "{\"b\":2}", recorder.done("b"));
+    publisher.publish(1, "{\"c\":3}", recorder.done("c"));
+    TEST_CHECK(broker.wait_sent(2));
+    auto sent = broker.sent();
+    TEST_CHECK_EQ(sent.size(), 2u);
+    if(sent.size() == 2)
+    {
+        TEST_CHECK_EQ(sent[0].first, std::string("{\"a\":1}"));
+        TEST_CHECK_EQ(sent[1].first, std::string("[{\"b\":2},{\"c\":3}]"));
+        TEST_CHECK(ms_between(start, sent[0].second) < 100); // 不等待合并窗口
+        TEST_CHECK(ms_between(sent[0].second, sent[1].second) > 250);
+    }
+    TEST_CHECK(recorder.wait_all({"a", "b", "c"}));
+    TEST_CHECK_EQ(recorder.result("a"), 1);
+    TEST_CHECK_EQ(recorder.result("b"), 1);
+    TEST_CHECK_EQ(recorder.result("c"), 1);
+    MqttPublisherStats stats = publisher.stats();
+    TEST_CHECK_EQ(stats.enqueued, 3u);
+    TEST_CHECK_EQ(stats.coalesced, 1u);
+    TEST_CHECK_EQ(stats.sent, 3u);
+
+    // 窗口结束后没有新报警，下一条又立即发送
+    std::this_thread::sleep_for(std::chrono::milliseconds(350));
+    Clock::time_point later = Clock::now();
+    publisher.publish(1, "{\"d\":4}", recorder.done("d"));
+    TEST_CHECK(broker.wait_sent(3));
+    sent = broker.sent();
+    if(sent.size() == 3)
+        TEST_CHECK(ms_between(later, sent[2].second) < 100);
+}
+
+// 在合并窗口中等待的消息不阻塞其他摄像头，camera_index为负的消息不合并
+static void test_no_head_of_line_blocking()
+{
+    FakeBroker broker;
+    DoneRecorder recorder;
+    MqttPublisher publisher(broker.function(), 1, MQTT_QUEUE_MAX_BYTES, 500);
+    publisher.publish(1, "x1", recorder.done("x1"));
+    TEST_CHECK(broker.wait_sent(1));
+    Clock::time_point start = Clock::now();
+    publisher.publish(1, "x2", recorder.done("x2")); // 等待窗口结束
+    publisher.publish(2, "y1", recorder.done("y1"));
+    publisher.publish(-1, "z1", recorder.done("z1"));
+    publisher.publish(-1, "z2", recorder.done("z2"));
+    TEST_CHECK(broker.wait_sent(4, 300));
+    auto sent = broker.sent();
+    TEST_CHECK_EQ(sent.size(), 4u);
+    if(sent.size() >= 4)
+    {
+        TEST_CHECK_EQ(sent[1].first, std::string("y1"));
+        TEST_CHECK_EQ(sent[2].first, std::string("z1"));
+        TEST_CHECK_EQ(sent[3].first, std::string("z2"));
+        TEST_CHECK(ms_between(start, sent[3].second) < 200);
+    }
+    TEST_CHECK(broker.wait_sent(5));
+    sent = broker.sent();
+    if(sent.size() == 5)
+        TEST_CHECK_EQ(sent[4].first, std::string("x2"));
+    TEST_CHECK(recorder.wait_all({"x1", "x2", "y1", "z1", "z2"}));
+}
+
+// 重试用完仍失败时，合并消息中的每条报警都回调false
+static void test_failure_callbacks()
+{
+    FakeBroker broker;
+    DoneRecorder recorder;
+    broker.set_fail(true);
+    MqttPublisher publisher(broker.function(), 1, MQTT_QUEUE_MAX_BYTES, 100, 1);
+    publisher.publish(3, "f1", recorder.done("f1"));
+    while(broker.attempts() == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    publisher.publish(3, "f2", recorder.done("f2")); // f1在退避中，不再合并，f2和f3合并为第二条消息
+    publisher.publish(3, "f3", recorder.done("f3"));
+    TEST_CHECK(recorder.wait_all({"f1", "f2", "f3"}));
+    TEST_CHECK_EQ(recorder.result("f1"), 0);
+    TEST_CHECK_EQ(recorder.result("f2"), 0);
+    TEST_CHECK_EQ(recorder.result("f3"), 0);
+    MqttPublisherStats stats = publisher.stats();
+    TEST_CHECK_EQ(stats.failed, 3u);
+    TEST_CHECK_EQ(stats.sent, 0u);
+    TEST_CHECK_EQ(broker.attempts(), 4); // 两条消息各发送一次、重试一次
+}
+
+// QoS为0时发送失败不重试
+static void test_qos0_no_retry()
+{
+    FakeBroker broker;
+    DoneRecorder recorder;
+    broker.set_fail(true);
+    MqttPublisher publisher(broker.function(), 0, MQTT_QUEUE_MAX_BYTES, 0);
+    publisher.publish(1, "q", recorder.done("q"));
+    TEST_CHECK(recorder.wait_all({"q"}));
+    TEST_CHECK_EQ(recorder.result("q"), 0);
+    TEST_CHECK_EQ(broker.attempts(), 1);
+    TEST_CHECK_EQ(publisher.stats().retries, 0u);
+}
+
+// 超过内存上限时丢弃最早的消息，合并消息中的每条报警都回调false
+static void test_trim_callbacks()
+{
+    FakeBroker broker;
+    DoneRecorder recorder;
+    broker.set_blocked(true);
+    MqttPublisher publisher(broker.function(), 1, 100, 1000);
+    publisher.publish(1, std::string(30, 'a'), recorder.done("sending")); // 发送线程阻塞在这条消息上
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    publisher.publish(1, std::string(30, 'b'), recorder.done("b1"));
+    publisher.publish(1, std::string(30, 'c'), recorder.done("b2")); // 与b1合并
+    publisher.publish(2, std::string(30, 'd'), recorder.done("d"));
+    publisher.publish(2, std::string(50, 'e'), recorder.done("e")); // 与d合并，超过上限，丢弃b1和b2
+    TEST_CHECK_EQ(recorder.result("b1"), 0);
+    TEST_CHECK_EQ(recorder.result("b2"), 0);
+    TEST_CHECK_EQ(recorder.result("d"), -1);
+    MqttPublisherStats stats = publisher.stats();
+    TEST_CHECK_EQ(stats.dropped, 2u);
+    TEST_CHECK_EQ(stats.queued_messages, 1u);
+    TEST_CHECK_EQ(stats.queued_bytes, 80u);
+    broker.set_blocked(false);
+    TEST_CHECK(recorder.wait_all({"sending", "d", "e"}));
+    TEST_CHECK_EQ(recorder.result("sending"), 1);
+    TEST_CHECK_EQ(recorder.result("d"), 1);
+    TEST_CHECK_EQ(recorder.result("e"), 1);
+}
+
+// 一条合并消息最多MQTT_COALESCE_MAX_COUNT条报警
+static void test_coalesce_max_count()
+{
+    FakeBroker broker;
+    DoneRecorder recorder;
+    MqttPublisher publisher(broker.function(), 1, MQTT_QUEUE_MAX_BYTES, 100);
+    std::vector<std::string> names;
+    for(int i = 0; i < MQTT_COALESCE_MAX_COUNT + 2; i++)
+    {
+        names.push_back("m" + std::to_string(i));
+        publisher.publish(4, "1", recorder.done(names.back()));
+        if(i == 0)
+            TEST_CHECK(broker.wait_sent(1)); // 第一条单独发送，后面的在窗口内
+    }
+    TEST_CHECK(recorder.wait_all(names));
+    auto sent = broker.sent();
+    TEST_CHECK_EQ(sent.size(), 3u);
+    if(sent.size() == 3)
+    {
+        TEST_CHECK_EQ(sent[0].first, std::string("1"));
+        TEST_CHECK_EQ(sent[1].first.size(), static_cast<size_t>(MQTT_COALESCE_MAX_COUNT * 2 + 1));
+        TEST_CHECK_EQ(sent[2].first, std::string("1"));
+        TEST_CHECK(ms_between(sent[1].second, sent[2].second) > 80); // 下一个窗口
+    }
+}
+
+// 默认合并窗口为0：同一路摄像头的连续报警按顺序逐条发送，不拼成数组
+static void test_default_no_coalesce()
+{
+    FakeBroker broker;
+    DoneRecorder recorder;
+    broker.set_blocked(true);
+    MqttPublisher publisher(broker.function());
+    std::vector<std::string> names;
+    for(int i = 0; i < 5; i++)
+    {
+        names.push_back("n" + std::to_string(i));
+        publisher.publish(6, "{\"alarm\":" + std::to_string(i) + "}", recorder.done(names.back()));
+    }
+    broker.set_blocked(false);
+    TEST_CHECK(recorder.wait_all(names));
+    auto sent = broker.sent();
+    TEST_CHECK_EQ(sent.size(), 5u);
+    for(size_t i = 0; i < sent.size(); i++)
+        TEST_CHECK_EQ(sent[i].first, "{\"alarm\":" + std::to_string(i) + "}");
+    TEST_CHECK_EQ(publisher.stats().coalesced, 0u);
+}
+
+int main()
+{
+    test_coalesce();
+    test_no_head_of_line_blocking();
+    test_failure_callbacks();
+    test_qos0_no_retry();
+    test_trim_callbacks();
+    test_coalesce_max_count();
+    test_default_no_coalesce();
+    return TEST_RESULT();
+}
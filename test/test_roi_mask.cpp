@@ -0,0 +1,102 @@
+// 测试：RoiMask的判断结果与WKTParser一致
+// 1. 区域在另一个区域的内环中（岛）时，岛内的点和框在ROI内
+// 2. 单个多边形、带内环的多边形、多多边形，掩码缩小（scale < 1）和不缩小时，随机的点与WKTParser::inZone一致，
+//    随机的框逐个判断和批量判断都与WKTParser::inZones一致
+#include "roi_mask.h"
+#include "test_common.h"
+
+#include <random>
+
+static VectorZone parse_zones(const std::string &wkt, const cv::Size &img_size)
+{
+    WKTParser parser(img_size);
+    VectorZone zones;
+    TEST_CHECK(parser.parseZones(wkt, &zones));
+    return zones;
+}
+
+static bool in_any_zone(const VectorZone &zones, const cv::Point &point)
+{
+    for(const GeoZone &zone : zones)
+    {
+        if(WKTParser::inZone(zone, point))
+            return true;
+    }
+    return false;
+}
+
+static void test_island_in_hole()
+{
+    // 第一个区域是带方形内环的方框，第二个区域是内环中间的岛
+    const std::string wkt = "MULTIPOLYGON(((0.1 0.1,0.9 0.1,0.9 0.9,0.1 0.9,0.1 0.1),(0.3 0.3,0.7 0.3,0.7 0.7,0.3 0.7,0.3 0.3)),"
+                            "((0.4 0.4,0.6 0.4,0.6 0.6,0.4 0.6,0.4 0.4)))";
+    for(const cv::Size &img_size : {cv::Size(200, 200), cv::Size(1920, 1080)})
+    {
+        VectorZone zones = parse_zones(wkt, img_size);
+        TEST_CHECK_EQ(zones.size(), 2u);
+        RoiMask mask;
+        TEST_CHECK(mask.compile(wkt, img_size));
+        cv::Point center(img_size.width / 2, img_size.height / 2);
+        cv::Rect island(img_size.width * 45 / 100, img_size.height * 45 / 100, img_size.width / 10, img_size.height / 10);
+        cv::Rect hole(img_size.width * 32 / 100, img_size.height * 32 / 100, img_size.width / 20, img_size.height / 20);
+        TEST_CHECK(in_any_zone(zones, center));
+        TEST_CHECK(mask.contains(center));
+        TEST_CHECK(WKTParser::inZones(zones, island));
+        TEST_CHECK(mask.contains(island));
+        TEST_CHECK(!WKTParser::inZones(zones, hole));
+        TEST_CHECK(!mask.contains(hole));
+        std::vector<uchar> results;
+        mask.contains(std::vector<cv::Rect>{island, hole}, results);
+        TEST_CHECK(results[0] == 1 && results[1] == 0);
+    }
+}
+
+static void test_matches_wkt_parser()
+{
+    const char *wkts[] = {
+        "POLYGON((0.1 0.1,0.9 0.1,0.5 0.4,0.9 0.9,0.1 0.9,0.1 0.1))",
+        "POLYGON((0 0,1 0,1 1,0 1,0 0),(0.3 0.3,0.7 0.3,0.5 0.7,0.3 0.3))",
+        "MULTIPOLYGON(((0 0,0.6 0,0.6 0.6,0 0.6,0 0),(0.2 0.2,0.4 0.2,0.4 0.4,0.2 0.4,0.2 0.2)),((0.5 0.5,1 0.5,1 1,0.5 1,0.5 0.5)))",
+        "MULTIPOLYGON(((0.1 0.1,0.9 0.1,0.9 0.9,0.1 0.9,0.1 0.1),(0.3 0.3,0.7 0.3,0.7 0.7,0.3 0.7,0.3 0.3)),"
+        "((0.4 0.4,0.6 0.4,0.5 0.65,0.4 0.4)),((0.35 0.6,0.45 0.6,0.45 0.68,0.35 0.68,0.35 0.6)))",
+    };
+    std::mt19937 rng(11);
+    for(const cv::Size &img_size : {cv::Size(300, 200), cv::Size(1920, 1080)})
+    {
+        std::uniform_int_distribution<int> pos_x(-50, img_size.width), pos_y(-50, img_size.height);
+        std::uniform_int_distribution<int> size(1, img_size.width / 3);
+        for(const char *wkt : wkts)
+        {
+            VectorZone zones = parse_zones(wkt, img_size);
+            RoiMask mask;
+            TEST_CHECK(mask.compile(wkt, img_size));
+            int point_mismatched = 0, rect_mismatched = 0, batch_mismatched = 0;
+            for(int i = 0; i < 2000; i++)
+            {
+                cv::Point point(pos_x(rng), pos_y(rng));
+                point_mismatched += mask.contains(point) != in_any_zone(zones, point);
+            }
+            std::vector<cv::Rect> rects;
+            for(int i = 0; i < 2000; i++)
+                rects.emplace_back(pos_x(rng), pos_y(rng), size(rng), size(rng));
+            std::vector<uchar> results;
+            mask.contains(rects, results);
+            for(size_t i = 0; i < rects.size(); i++)
+            {
+                bool expected = WKTParser::inZones(zones, rects[i]);
+                rect_mismatched += mask.contains(rects[i]) != expected;
+                batch_mismatched += (results[i] != 0) != expected;
+            }
+            TEST_CHECK_EQ(point_mismatched, 0);
+            TEST_CHECK_EQ(rect_mismatched, 0);
+            TEST_CHECK_EQ(batch_mismatched, 0);
+        }
+    }
+}
+
+int main()
+{
+    test_island_in_hole();
+    test_matches_wkt_parser();
+    return TEST_RESULT();
+}
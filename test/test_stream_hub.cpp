@@ -0,0 +1,145 @@
+// 测试：StreamHub的按需编码，编码器由测试注入，不需要rk_vcodec和rtsp服务
+// 1. 没有客户端时不创建编码会话，addFrame直接返回；第一个客户端acquire后才创建，其他摄像头的子码流不受影响
+// 2. 按子码流的帧率编码，输入帧率更高时不超过配置的帧率；没有新帧时不重复编码
+// 3. 最后一个客户端离开后保持 STREAM_IDLE_CLOSE_MS，期间重连不重新创建编码会话；超时后关闭
+#include "stream_hub.h"
+#include "test_common.h"
+
+#include <atomic>
+
+typedef std::chrono::steady_clock Clock;
+
+#define TEST_FPS 20
+
+// 功能：记录所有假编码器的创建、编码和关闭
+struct EncoderLog
+{
+    std::mutex mutex;
+    std::vector<std::string> opened; // 每次open的流名称
+    int closed = 0;
+    std::vector<Clock::time_point> writes;
+
+    size_t write_count()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return writes.size();
+    }
+};
+
+class FakeEncoder : public StreamEncoder
+{
+    public:
+        explicit FakeEncoder(EncoderLog &log) : m_log(log) {}
+
+        bool open(const StreamConfig &config) override
+        {
+            std::lock_guard<std::mutex> lock(m_log.mutex);
+            m_log.opened.push_back(config.name);
+            return true;
+        }
+
+        bool write(const cv::Mat &) override
+        {
+            std::lock_guard<std::mutex> lock(m_log.mutex);
+            m_log.writes.push_back(Clock::now());
+            return true;
+        }
+
+        void close() override
+        {
+            std::lock_guard<std::mutex> lock(m_log.mutex);
+            m_log.closed++;
+        }
+
+    private:
+        EncoderLog &m_log;
+};
+
+// 功能：按interval_ms持续给camera_index输入新帧，直到duration_ms结束
+static void feed(StreamHub &hub, int camera_index, int interval_ms, int duration_ms)
+{
+    cv::Mat frame(360, 640, CV_8UC3);
+    std::list<objectInfo> objects;
+    Clock::time_point end = Clock::now() + std::chrono::milliseconds(duration_ms);
+    while(Clock::now() < end)
+    {
+        hub.addFrame(camera_index, frame, objects);
+        hub.addFrame(1, frame, objects); // 没有客户端的子码流
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+    }
+}
+
+int main()
+{
+    EncoderLog log;
+    std::vector<StreamConfig> configs(2);
+    for(size_t index = 0; index < configs.size(); index++)
+    {
+        configs[index].name = "camera" + std::to_string(index);
+        configs[index].width = 64;
+        configs[index].height = 36;
+        configs[index].fps = TEST_FPS;
+    }
+    StreamHub hub(configs, [&log]() { return std::unique_ptr<StreamEncoder>(new FakeEncoder(log)); });
+    TEST_CHECK_EQ(hub.find("camera1"), 1);
+    TEST_CHECK_EQ(hub.find("camera9"), -1);
+
+    // 1. 没有客户端：有帧输入也不创建编码会话
+    feed(hub, 0, 5, 300);
+    StreamHubStats stats = hub.stats();
+    TEST_CHECK_EQ(stats.opened, 0u);
+    TEST_CHECK_EQ(stats.active, 0);
+    TEST_CHECK_EQ(log.write_count(), 0u);
+
+    // 2. 客户端到来后创建编码会话，200fps输入按TEST_FPS编码
+    hub.acquire(0);
+    feed(hub, 0, 5, 1000);
+    stats = hub.stats();
+    TEST_CHECK_EQ(stats.opened, 1u);
+    TEST_CHECK_EQ(stats.active, 1);
+    {
+        std::lock_guard<std::mutex> lock(log.mutex);
+        TEST_CHECK_EQ(log.opened.size(), 1u);
+        if(!log.opened.empty())
+            TEST_CHECK_EQ(log.opened[0], std::string("camera0"));
+        // 1秒内约TEST_FPS帧，不超过配置的帧率；某一帧编码晚了时下一帧按原来的节拍补上，间隔可能变短，
+        // 所以只检查总数和n帧的跨度（至少n-2个帧间隔）
+        size_t count = log.writes.size();
+        TEST_CHECK(count >= TEST_FPS / 2 && count <= TEST_FPS + 2);
+        if(count > 2)
+            TEST_CHECK(log.writes.back() - log.writes.front() >= std::chrono::milliseconds(1000 / TEST_FPS * (count - 2)));
+        std::cout << "encoded " << log.writes.size() << " frames in 1s at " << TEST_FPS << " fps" << std::endl;
+    }
+    TEST_CHECK_EQ(stats.frames_encoded, static_cast<uint64_t>(log.write_count()));
+
+    // 没有新帧时不重复编码
+    size_t encoded = log.write_count();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    TEST_CHECK(log.write_count() <= encoded + 1); // 最多编码停止输入前的最后一帧
+
+    // 3. 客户端离开后保持编码会话，期间重连继续使用
+    hub.release(0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(STREAM_IDLE_CLOSE_MS / 5));
+    TEST_CHECK_EQ(hub.stats().active, 1);
+    hub.acquire(0);
+    feed(hub, 0, 5, 300);
+    TEST_CHECK_EQ(hub.stats().opened, 1u);
+    TEST_CHECK(log.write_count() > encoded + 1);
+
+    // 超过 STREAM_IDLE_CLOSE_MS 没有客户端后关闭
+    hub.release(0);
+    Clock::time_point released = Clock::now();
+    Clock::time_point deadline = released + std::chrono::milliseconds(STREAM_IDLE_CLOSE_MS * 2);
+    while(hub.stats().active != 0 && Clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    double close_ms = std::chrono::duration<double, std::milli>(Clock::now() - released).count();
+    TEST_CHECK_EQ(hub.stats().active, 0);
+    TEST_CHECK(close_ms >= STREAM_IDLE_CLOSE_MS * 0.9);
+    {
+        std::lock_guard<std::mutex> lock(log.mutex);
+        TEST_CHECK_EQ(log.closed, 1);
+        TEST_CHECK_EQ(log.opened.size(), 1u); // camera1一直没有客户端
+    }
+    std::cout << "closed " << close_ms << " ms after the last client left" << std::endl;
+    return TEST_RESULT();
+}
@@ -0,0 +1,79 @@
+// 测试：WKTParser的区域判断，重点是内环（排除区域）与矩形框的关系，以及批量接口与逐个判断一致
+#include "WKTParser.h"
+#include "test_common.h"
+
+#include <random>
+
+static VectorZone parse_zones(const std::string &wkt)
+{
+    WKTParser parser(cv::Size(1000, 1000));
+    VectorZone zones;
+    TEST_CHECK(parser.parseZones(wkt, &zones));
+    return zones;
+}
+
+static void test_hole_edges()
+{
+    // 外环为整个画面，内环是一条横向的窄带
+    VectorZone zones = parse_zones("POLYGON((0 0,1 0,1 1,0 1,0 0),(0.2 0.45,0.8 0.45,0.8 0.55,0.2 0.55,0.2 0.45))");
+    TEST_CHECK_EQ(zones.size(), 1u);
+    // 内环的顶点都在框外，但窄带横穿框
+    TEST_CHECK(!WKTParser::inZones(zones, cv::Rect(400, 300, 200, 400)));
+    // 框的下边与内环的上边重合，内环边界属于区域
+    TEST_CHECK(WKTParser::inZones(zones, cv::Rect(100, 100, 800, 350)));
+    // 框包含整个内环
+    TEST_CHECK(!WKTParser::inZones(zones, cv::Rect(100, 100, 800, 800)));
+    // 框在内环内部
+    TEST_CHECK(!WKTParser::inZones(zones, cv::Rect(300, 470, 100, 50)));
+    // 框只在角点碰到内环
+    TEST_CHECK(WKTParser::inZones(zones, cv::Rect(100, 300, 100, 150)));
+    // 框与内环不相交
+    TEST_CHECK(WKTParser::inZones(zones, cv::Rect(100, 600, 800, 300)));
+    // 内环的一个角伸进框内
+    TEST_CHECK(!WKTParser::inZones(zones, cv::Rect(750, 500, 200, 200)));
+}
+
+static void test_multipolygon()
+{
+    VectorZone zones = parse_zones("MULTIPOLYGON(((0 0,0.5 0,0.5 0.5,0 0.5,0 0)),((0.5 0.5,1 0.5,1 1,0.5 1,0.5 0.5)))");
+    TEST_CHECK_EQ(zones.size(), 2u);
+    TEST_CHECK(WKTParser::inZones(zones, cv::Rect(100, 100, 100, 100)));
+    TEST_CHECK(WKTParser::inZones(zones, cv::Rect(600, 600, 100, 100)));
+    // 四个角点分别在两个区域内，但框不在任何一个区域内
+    TEST_CHECK(!WKTParser::inZones(zones, cv::Rect(400, 400, 200, 200)));
+    TEST_CHECK(!WKTParser::inZones(zones, cv::Rect(600, 100, 100, 100)));
+}
+
+static void test_batch_matches_single()
+{
+    const char *wkts[] = {
+        "POLYGON((0.1 0.1,0.9 0.1,0.9 0.9,0.1 0.9,0.1 0.1))",
+        "POLYGON((0.1 0.1,0.9 0.1,0.5 0.4,0.9 0.9,0.1 0.9,0.1 0.1))",
+        "POLYGON((0 0,1 0,1 1,0 1,0 0),(0.3 0.3,0.7 0.3,0.5 0.7,0.3 0.3))",
+        "MULTIPOLYGON(((0 0,0.6 0,0.6 0.6,0 0.6,0 0),(0.2 0.2,0.4 0.2,0.4 0.4,0.2 0.4,0.2 0.2)),((0.5 0.5,1 0.5,1 1,0.5 1,0.5 0.5)))",
+    };
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> pos(-50, 1000), size(1, 400);
+    for(const char *wkt : wkts)
+    {
+        VectorZone zones = parse_zones(wkt);
+        std::vector<cv::Rect> rects;
+        for(int i = 0; i < 2000; i++)
+            rects.emplace_back(pos(rng), pos(rng), size(rng), size(rng));
+        std::vector<uchar> results;
+        WKTParser::inZones(zones, rects, results);
+        TEST_CHECK_EQ(results.size(), rects.size());
+        int mismatched = 0;
+        for(size_t i = 0; i < rects.size(); i++)
+            mismatched += (results[i] != 0) != WKTParser::inZones(zones, rects[i]);
+        TEST_CHECK_EQ(mismatched, 0);
+    }
+}
+
+int main()
+{
+    test_hole_edges();
+    test_multipolygon();
+    test_batch_matches_single();
+    return TEST_RESULT();
+}